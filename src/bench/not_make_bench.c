@@ -0,0 +1,410 @@
+/*核心热点函数微基准套件：迷宫生成、BFS寻路、矩形碰撞、炮弹运动、射线反射、ID池、哈希表查找、对局检查点。
+  不参与主程序编译（not_make_前缀），通过`make bench`按多种地图尺寸分别编译并运行，结果以JSON输出到bench_<宽>x<高>.json。
+  也可单独编译（地图尺寸通过-DHORIZON_GRID_NUMBER=16 -DVERTICAL_GRID_NUMBER=14覆盖）：
+  gcc -O2 $(find src -mindepth 1 -type d -printf '-I%p ') src/bench/not_make_bench.c src/game_state.c src/utils/*.c -o bench -lm -lbsd -pthread
+  参数：./bench [--warmup N] [--reps N] [--seed N] [--filter 子串] [--list]
+  每个用例先运行warmup轮预热（不计时），再计时reps轮，每轮执行ops次操作，报告每次操作耗时(ns)在各轮间的分布*/
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stddef.h>
+#include <math.h>
+#include "game_state.h"
+#include "hashtbl.h"
+#include "idpool.h"
+#include "maze.h"
+#include "tools.h"
+
+#define BENCH_DEFAULT_WARMUP 3
+#define BENCH_DEFAULT_REPS   20
+#define BENCH_DEFAULT_SEED   12345
+
+typedef struct {
+    const char *name;
+    const char *params;   // JSON对象内容，描述用例参数
+    unsigned long ops;    // 每轮操作次数
+    void (*setup)(int arg);
+    void (*run)(int arg);
+    void (*teardown)(int arg);
+    int arg;
+} BenchCase;
+
+static volatile unsigned long bench_sink = 0; // 防止被测调用的结果被编译器优化掉
+
+/*迷宫生成与墙壁提取*/
+#define MAZE_OPS (MAX(1, 4096 / MAX_GRID_ID)) // 地图越大单次越慢，按网格数缩放每轮次数
+static Maze bench_maze;
+
+static void run_maze_generate(int arg) {
+    for (int i = 0; i < MAZE_OPS; i++) {
+        maze_generate(&bench_maze, i);
+        bench_sink += bench_maze.open[0];
+    }
+}
+
+static void run_get_block_positions(int arg) {
+    tk_uint16_t block_count = 0;
+    Block *blocks = NULL;
+
+    for (int i = 0; i < MAZE_OPS; i++) {
+        blocks = get_block_positions(&tk_shared_game_state.maze, &block_count);
+        bench_sink += block_count;
+        free(blocks);
+    }
+}
+
+/*BFS最短路径：随机起止网格*/
+#define BFS_PAIRS 256
+static MazePathBFSearchManager bench_bfs_manager;
+static Grid bench_bfs_ends[BFS_PAIRS][2];
+
+static Grid random_grid() {
+    return (Grid){rand() % HORIZON_GRID_NUMBER, rand() % VERTICAL_GRID_NUMBER};
+}
+
+static void setup_bfs(int arg) {
+    bench_bfs_manager.maze = &tk_shared_game_state.maze;
+    for (int i = 0; i < BFS_PAIRS; i++) {
+        bench_bfs_ends[i][0] = random_grid();
+        bench_bfs_ends[i][1] = random_grid();
+    }
+}
+
+static void run_bfs(int arg) {
+    for (int i = 0; i < BFS_PAIRS; i++) {
+        bench_bfs_manager.start = bench_bfs_ends[i][0];
+        bench_bfs_manager.end = bench_bfs_ends[i][1];
+        bfs_shortest_path_search(&bench_bfs_manager);
+        bench_sink += bench_bfs_manager.success;
+    }
+}
+
+/*矩形碰撞：两两随机摆放的坦克轮廓，约一半相交*/
+#define RECT_PAIRS 1024
+static Rectangle bench_rects[RECT_PAIRS][2];
+
+static Point random_point_in(tk_float32_t x, tk_float32_t y, tk_float32_t range) {
+    return (Point){x + (rand() / (tk_float32_t)RAND_MAX) * range, y + (rand() / (tk_float32_t)RAND_MAX) * range};
+}
+
+static void setup_rect_collision(int arg) {
+    for (int i = 0; i < RECT_PAIRS; i++) {
+        Point p0 = random_point_in(100, 100, 50), p1 = random_point_in(100, 100, 50);
+        calculate_tank_outline(&p0, TANK_LENGTH, TANK_WIDTH, rand() % 360, &bench_rects[i][0]);
+        calculate_tank_outline(&p1, TANK_LENGTH, TANK_WIDTH, rand() % 360, &bench_rects[i][1]);
+    }
+}
+
+static void run_rect_collision(int arg) {
+    for (int i = 0; i < RECT_PAIRS; i++) {
+        bench_sink += is_rectangle_collision(&bench_rects[i][0], &bench_rects[i][1]);
+    }
+}
+
+static void run_rect_collision_projection(int arg) {
+    for (int i = 0; i < RECT_PAIRS; i++) {
+        bench_sink += is_rectangle_collision_projection(&bench_rects[i][0], &bench_rects[i][1]);
+    }
+}
+
+/*炮弹运动：arg=0为沿坐标轴方向（0/90/180/270度，走专门的分支），arg=1为斜向。炮弹在各轮之间持续运动、反弹*/
+#define BENCH_SHELLS 64
+#define SHELL_STEPS  16
+static Shell bench_shells[BENCH_SHELLS];
+
+static Point random_grid_center() {
+    Grid g = random_grid();
+    return (Point){g.x * GRID_SIZE + tk_maze_offset.x + GRID_SIZE / 2, g.y * GRID_SIZE + tk_maze_offset.y + GRID_SIZE / 2};
+}
+
+static void setup_shell_movement(int arg) {
+    memset(bench_shells, 0, sizeof(bench_shells));
+    for (int i = 0; i < BENCH_SHELLS; i++) {
+        bench_shells[i].position = random_grid_center();
+        bench_shells[i].angle_deg = arg ? (rand() % 4) * 90 + 1 + rand() % 89 : (i % 4) * 90;
+        bench_shells[i].speed = SHELL_INIT_SPEED;
+        bench_shells[i].game = &tk_shared_game_state; // 只用到其中的地图
+        bench_shells[i].ttl = 255;
+    }
+}
+
+static void run_shell_movement(int arg) {
+    for (int step = 0; step < SHELL_STEPS; step++) {
+        for (int i = 0; i < BENCH_SHELLS; i++) {
+            bench_shells[i].ttl = 255; // 不让炮弹湮灭
+            update_one_shell_movement_position(&bench_shells[i], 0);
+        }
+    }
+    bench_sink += (unsigned long)bench_shells[0].position.x;
+}
+
+/*射线反射链：同draw_tank_coordinates()绘制前进方向轴，至多反射6次*/
+#define RAY_CHAINS 256
+#define RAY_MAX_REFLECT 6
+static Point bench_ray_starts[RAY_CHAINS];
+static tk_float32_t bench_ray_angles[RAY_CHAINS];
+
+static void setup_ray_chain(int arg) {
+    for (int i = 0; i < RAY_CHAINS; i++) {
+        bench_ray_starts[i] = random_grid_center();
+        bench_ray_angles[i] = rand() % 360;
+    }
+}
+
+static void run_ray_chain(int arg) {
+    Ray_Intersection_Dot_Info info;
+
+    for (int i = 0; i < RAY_CHAINS; i++) {
+        info.maze = &tk_shared_game_state.maze;
+        info.start_point = bench_ray_starts[i];
+        info.angle_deg = bench_ray_angles[i];
+        info.current_grid = get_grid_by_tank_position(&bench_ray_starts[i]);
+        info.terminate_flag = 0;
+        for (int j = 0; j < RAY_MAX_REFLECT; j++) {
+            get_ray_intersection_dot_with_grid(&info);
+            if (info.terminate_flag) {
+                break;
+            }
+            info.start_point = info.intersection_dot;
+            if ((info.current_grid.x == info.next_grid.x) && (info.current_grid.y == info.next_grid.y)) {
+                info.angle_deg = info.reflect_angle_deg;
+            }
+            info.current_grid = info.next_grid;
+        }
+        bench_sink += (unsigned long)info.intersection_dot.x;
+    }
+}
+
+/*ID池：先占用arg%的ID，之后每次操作随机释放一个已占用ID再分配一个*/
+#define IDPOOL_CHURN_OPS 4096
+static IDPool *bench_pool = NULL;
+static int *bench_held_ids = NULL;
+static int bench_held_num = 0;
+
+static void setup_idpool_churn(int arg) {
+    bench_pool = id_pool_create(ID_POOL_SIZE);
+    bench_held_num = ID_POOL_SIZE * arg / 100;
+    bench_held_ids = malloc(sizeof(int) * bench_held_num);
+    for (int i = 0; i < bench_held_num; i++) {
+        bench_held_ids[i] = id_pool_allocate(bench_pool);
+    }
+}
+
+static void run_idpool_churn(int arg) {
+    for (int i = 0; i < IDPOOL_CHURN_OPS; i++) {
+        int k = rand() % bench_held_num;
+        id_pool_release(bench_pool, bench_held_ids[k]);
+        bench_held_ids[k] = id_pool_allocate(bench_pool);
+    }
+    bench_sink += bench_held_ids[0];
+}
+
+static void teardown_idpool_churn(int arg) {
+    id_pool_destroy(bench_pool);
+    bench_pool = NULL;
+    free(bench_held_ids);
+    bench_held_ids = NULL;
+}
+
+/*哈希表查找：固定1024个桶（不扩容），装载因子为arg/4，查询90%命中*/
+#define HASHTBL_LOG_SIZE 10
+#define HASHTBL_QUERIES  4096
+typedef struct {
+    int key;
+    hashtbl_link_t hashlink;
+} BenchHashItem;
+static hashtbl_t *bench_tbl = NULL;
+static BenchHashItem *bench_hash_items = NULL;
+static BenchHashItem bench_hash_queries[HASHTBL_QUERIES];
+
+static int bench_hash_item_cmp(void *item, void *target) {
+    return ((BenchHashItem *)item)->key == ((BenchHashItem *)target)->key;
+}
+
+static void setup_hashtbl_find(int arg) {
+    int num = (1 << HASHTBL_LOG_SIZE) * arg / 4;
+
+    bench_tbl = hashtbl_init(HASHTBL_LOG_SIZE, offsetof(BenchHashItem, hashlink), 0);
+    bench_hash_items = calloc(num, sizeof(BenchHashItem));
+    for (int i = 0; i < num; i++) {
+        bench_hash_items[i].key = i * 2654435761u >> 1; // 打散键值
+        hashtbl_insert(bench_tbl, bench_hash_items[i].key, &bench_hash_items[i]);
+    }
+    for (int i = 0; i < HASHTBL_QUERIES; i++) {
+        bench_hash_queries[i].key = (rand() % 10) ? bench_hash_items[rand() % num].key : -1 - rand();
+    }
+}
+
+static void run_hashtbl_find(int arg) {
+    for (int i = 0; i < HASHTBL_QUERIES; i++) {
+        bench_sink += (hashtbl_find(bench_tbl, &bench_hash_queries[i], bench_hash_queries[i].key, bench_hash_item_cmp) != NULL);
+    }
+}
+
+static void teardown_hashtbl_find(int arg) {
+    hashtbl_destroy(bench_tbl);
+    bench_tbl = NULL;
+    free(bench_hash_items);
+    bench_hash_items = NULL;
+}
+
+/*对局检查点：arg辆傻瓜敌人先对战一段时间（场上有炮弹、ID有空洞），之后每次操作保存/恢复一次完整的模拟状态*/
+#define CHECKPOINT_OPS 64
+#define CHECKPOINT_WARMUP_TICKS 100
+static GameState *bench_game = NULL;
+static GameCheckpoint bench_checkpoint;
+
+static void setup_checkpoint(int arg) {
+    char name[TANK_NAME_MAXLEN];
+
+    tk_debug_object_lifecycle = 0; // 对象日志会混进JSON输出
+    bench_game = malloc(sizeof(GameState));
+    init_game_state(bench_game, rand(), rand());
+    bench_game->max_tank_num = arg;
+    for (int tick = 0; tick < CHECKPOINT_WARMUP_TICKS; tick++) {
+        while (bench_game->tank_num < bench_game->max_tank_num) {
+            snprintf(name, sizeof(name), "muggle-%d", tick);
+            create_tank(bench_game, (tk_uint8_t *)name, get_random_grid_pos_for_tank(bench_game),
+                game_random_range(bench_game, 0, 360), TANK_ROLE_ENEMY_MUGGLE);
+        }
+        game_state_tick(bench_game);
+    }
+    memset(&bench_checkpoint, 0, sizeof(bench_checkpoint));
+    game_checkpoint_save(bench_game, &bench_checkpoint);
+}
+
+static void run_checkpoint_save(int arg) {
+    for (int i = 0; i < CHECKPOINT_OPS; i++) {
+        game_checkpoint_save(bench_game, &bench_checkpoint);
+    }
+    bench_sink += bench_checkpoint.size;
+}
+
+static void run_checkpoint_restore(int arg) {
+    for (int i = 0; i < CHECKPOINT_OPS; i++) {
+        game_checkpoint_restore(bench_game, &bench_checkpoint);
+    }
+    bench_sink += bench_game->tick;
+}
+
+static void teardown_checkpoint(int arg) {
+    game_checkpoint_free(&bench_checkpoint);
+    cleanup_game_state(bench_game);
+    free(bench_game);
+    bench_game = NULL;
+}
+
+static BenchCase bench_cases[] = {
+    {"maze_generate", "", MAZE_OPS, NULL, run_maze_generate, NULL, 0},
+    {"get_block_positions", "", MAZE_OPS, NULL, run_get_block_positions, NULL, 0},
+    {"bfs_shortest_path_search", "\"endpoints\": \"random\"", BFS_PAIRS, setup_bfs, run_bfs, NULL, 0},
+    {"is_rectangle_collision", "\"method\": \"sat\"", RECT_PAIRS, setup_rect_collision, run_rect_collision, NULL, 0},
+    {"is_rectangle_collision_projection", "\"method\": \"projection\"", RECT_PAIRS, setup_rect_collision, run_rect_collision_projection, NULL, 0},
+    {"update_one_shell_movement_position", "\"headings\": \"axis\"", BENCH_SHELLS * SHELL_STEPS, setup_shell_movement, run_shell_movement, NULL, 0},
+    {"update_one_shell_movement_position", "\"headings\": \"oblique\"", BENCH_SHELLS * SHELL_STEPS, setup_shell_movement, run_shell_movement, NULL, 1},
+    {"get_ray_intersection_dot_with_grid", "\"max_reflect\": 6", RAY_CHAINS, setup_ray_chain, run_ray_chain, NULL, 0},
+    {"id_pool_churn", "\"occupancy\": 0.50", IDPOOL_CHURN_OPS, setup_idpool_churn, run_idpool_churn, teardown_idpool_churn, 50},
+    {"id_pool_churn", "\"occupancy\": 0.95", IDPOOL_CHURN_OPS, setup_idpool_churn, run_idpool_churn, teardown_idpool_churn, 95},
+    {"hashtbl_find", "\"load\": 0.25", HASHTBL_QUERIES, setup_hashtbl_find, run_hashtbl_find, teardown_hashtbl_find, 1},
+    {"hashtbl_find", "\"load\": 1.00", HASHTBL_QUERIES, setup_hashtbl_find, run_hashtbl_find, teardown_hashtbl_find, 4},
+    {"hashtbl_find", "\"load\": 4.00", HASHTBL_QUERIES, setup_hashtbl_find, run_hashtbl_find, teardown_hashtbl_find, 16},
+    {"hashtbl_find", "\"load\": 16.00", HASHTBL_QUERIES, setup_hashtbl_find, run_hashtbl_find, teardown_hashtbl_find, 64},
+    {"game_checkpoint_save", "\"tanks\": 8", CHECKPOINT_OPS, setup_checkpoint, run_checkpoint_save, teardown_checkpoint, 8},
+    {"game_checkpoint_save", "\"tanks\": 64", CHECKPOINT_OPS, setup_checkpoint, run_checkpoint_save, teardown_checkpoint, 64},
+    {"game_checkpoint_save", "\"tanks\": 512", CHECKPOINT_OPS, setup_checkpoint, run_checkpoint_save, teardown_checkpoint, 512},
+    {"game_checkpoint_restore", "\"tanks\": 8", CHECKPOINT_OPS, setup_checkpoint, run_checkpoint_restore, teardown_checkpoint, 8},
+    {"game_checkpoint_restore", "\"tanks\": 64", CHECKPOINT_OPS, setup_checkpoint, run_checkpoint_restore, teardown_checkpoint, 64},
+    {"game_checkpoint_restore", "\"tanks\": 512", CHECKPOINT_OPS, setup_checkpoint, run_checkpoint_restore, teardown_checkpoint, 512},
+};
+#define BENCH_CASE_NUM (sizeof(bench_cases) / sizeof(bench_cases[0]))
+
+static int compare_doubles(const void *a, const void *b) {
+    double da = *(const double *)a, db = *(const double *)b;
+    return (da > db) - (da < db);
+}
+
+// 运行一个用例并输出一条JSON结果
+static void run_case(BenchCase *c, int warmup, int reps, int first) {
+    double *samples = malloc(sizeof(double) * reps);
+    double sum = 0, var = 0, mean = 0;
+    uint64_t start = 0;
+
+    if (c->setup) c->setup(c->arg);
+    for (int i = 0; i < warmup; i++) {
+        c->run(c->arg);
+    }
+    for (int i = 0; i < reps; i++) {
+        start = tk_get_monotonic_ns();
+        c->run(c->arg);
+        samples[i] = (double)(tk_get_monotonic_ns() - start) / c->ops;
+        sum += samples[i];
+    }
+    if (c->teardown) c->teardown(c->arg);
+
+    mean = sum / reps;
+    for (int i = 0; i < reps; i++) {
+        var += (samples[i] - mean) * (samples[i] - mean);
+    }
+    qsort(samples, reps, sizeof(double), compare_doubles);
+    printf("%s    {\"name\": \"%s\", \"params\": {%s}, \"ops_per_rep\": %lu, \"ns_per_op\": "
+        "{\"min\": %.2f, \"median\": %.2f, \"mean\": %.2f, \"p90\": %.2f, \"max\": %.2f, \"stddev\": %.2f}}",
+        first ? "" : ",\n", c->name, c->params, c->ops, samples[0], samples[reps / 2], mean,
+        samples[(int)((reps - 1) * 0.9)], samples[reps - 1], sqrt(var / reps));
+    fflush(stdout);
+    free(samples);
+}
+
+static void usage(const char *prog) {
+    fprintf(stderr, "usage: %s [--warmup N] [--reps N] [--seed N] [--filter SUBSTR] [--list]\n", prog);
+}
+
+int main(int argc, char *argv[]) {
+    int warmup = BENCH_DEFAULT_WARMUP, reps = BENCH_DEFAULT_REPS;
+    unsigned int seed = BENCH_DEFAULT_SEED;
+    const char *filter = NULL;
+    int first = 1;
+
+    for (int i = 1; i < argc; i++) {
+        if (!strcmp(argv[i], "--list")) {
+            for (size_t j = 0; j < BENCH_CASE_NUM; j++) {
+                printf("%s {%s}\n", bench_cases[j].name, bench_cases[j].params);
+            }
+            return 0;
+        } else if ((i + 1) >= argc) {
+            usage(argv[0]);
+            return 1;
+        } else if (!strcmp(argv[i], "--warmup")) {
+            warmup = atoi(argv[++i]);
+        } else if (!strcmp(argv[i], "--reps")) {
+            reps = atoi(argv[++i]);
+        } else if (!strcmp(argv[i], "--seed")) {
+            seed = strtoul(argv[++i], NULL, 10);
+        } else if (!strcmp(argv[i], "--filter")) {
+            filter = argv[++i];
+        } else {
+            usage(argv[0]);
+            return 1;
+        }
+    }
+    if ((warmup < 0) || (reps <= 0)) {
+        usage(argv[0]);
+        return 1;
+    }
+
+    // 地图与各用例的输入序列都由seed决定，保证可复现
+    maze_generate(&tk_shared_game_state.maze, seed);
+    srand(seed);
+
+    printf("{\n  \"suite\": \"tank3-microbench\",\n  \"map\": {\"horizon\": %d, \"vertical\": %d, \"grid_size\": %d},\n"
+        "  \"warmup\": %d,\n  \"reps\": %d,\n  \"seed\": %u,\n  \"results\": [\n",
+        HORIZON_GRID_NUMBER, VERTICAL_GRID_NUMBER, GRID_SIZE, warmup, reps, seed);
+    for (size_t i = 0; i < BENCH_CASE_NUM; i++) {
+        if (filter && !strstr(bench_cases[i].name, filter)) {
+            continue;
+        }
+        run_case(&bench_cases[i], warmup, reps, first);
+        first = 0;
+    }
+    printf("\n  ]\n}\n");
+    return 0;
+}
@@ -0,0 +1,183 @@
+/*哈希表微基准：模拟文本缓存（sdl_text.c）的查找负载，对比链式hashtbl与开放寻址oahashtbl。
+  不参与主程序编译（not_make_前缀），单独编译运行：
+  gcc -O2 -Isrc/include src/bench/not_make_bench_hashtbl.c src/utils/hashtbl.c src/utils/oahashtbl.c -o bench_hashtbl && ./bench_hashtbl
+  可选参数：./bench_hashtbl [每轮查找次数]*/
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stddef.h>
+#include <time.h>
+#include "hashtbl.h"
+#include "oahashtbl.h"
+
+// 与TextCacheItem对应的字段（不依赖SDL头文件）
+typedef struct _BenchTextItem {
+    char* text;
+    unsigned char color[4];
+    int font_size;
+    tk_uint32_t hashkey;
+    hashtbl_link_t hashlink;
+} BenchTextItem;
+
+// 同sdl_text.c中的calc_text_hash_tag()
+static tk_uint32_t calc_text_hash_tag(char *text, int max_len) {
+    unsigned long hash = 5381;
+    int i = 0;
+    while (i < max_len && text[i] != '\0') {
+        hash = ((hash << 5) + hash) + text[i];
+        i++;
+    }
+    return (tk_uint32_t)(hash & 0x7FFFFFFF);
+}
+
+// 同sdl_text.c中的text_cache_item_hash_cmp()
+static int bench_text_item_cmp(void *_item, void *_target_item) {
+    BenchTextItem *item = (BenchTextItem *)_item, *target_item = (BenchTextItem *)_target_item;
+    return (strcmp(item->text, target_item->text) == 0) && (memcmp(item->color, target_item->color, 4) == 0) &&
+        (item->font_size == target_item->font_size);
+}
+
+static double now_ns() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1e9 + ts.tv_nsec;
+}
+
+// 生成第i条缓存文本：前360条是角度数值，其后是坦克名、按钮文字，再往后是长时间运行累积下来的各种变化标签
+static void make_text(int i, char *buf, size_t size) {
+    static const char *labels[] = {"暂停", "开始", "重开一局", "yangdai"};
+    if (i < 360) {
+        snprintf(buf, size, "%d", i);
+    } else if (i < 364) {
+        snprintf(buf, size, "%s", labels[i - 360]);
+    } else if (i < 400) {
+        snprintf(buf, size, "muggle-%d", i - 364);
+    } else {
+        snprintf(buf, size, "score: %d, time: %ds", i * 7, i / 3);
+    }
+}
+
+static BenchTextItem *make_items(int num) {
+    char buf[64];
+    BenchTextItem *items = calloc(num, sizeof(BenchTextItem));
+    for (int i = 0; i < num; i++) {
+        make_text(i, buf, sizeof(buf));
+        items[i].text = strdup(buf);
+        items[i].color[3] = 255; // TK_BLACK
+        items[i].font_size = (i >= 360 && i < 363) ? 16 : 8;
+        items[i].hashkey = calc_text_hash_tag(items[i].text, 256);
+    }
+    return items;
+}
+
+// 查询序列：90%命中（偏向角度文本，模拟每帧的绘制），10%未命中
+static BenchTextItem *make_queries(BenchTextItem *items, int num_items, int num_queries) {
+    char buf[64];
+    BenchTextItem *queries = calloc(num_queries, sizeof(BenchTextItem));
+    srand(12345);
+    for (int i = 0; i < num_queries; i++) {
+        int r = rand() % 10;
+        if (r == 0) {
+            snprintf(buf, sizeof(buf), "miss-%d", rand());
+            queries[i].text = strdup(buf);
+            queries[i].color[3] = 255;
+            queries[i].font_size = 8;
+            queries[i].hashkey = calc_text_hash_tag(queries[i].text, 256);
+        } else {
+            int idx = (r < 6) ? rand() % MIN(num_items, 360) : rand() % num_items;
+            queries[i] = items[idx];
+            queries[i].text = strdup(items[idx].text); // 与缓存项不共享字符串，和真实调用一致
+        }
+    }
+    return queries;
+}
+
+static void free_items(BenchTextItem *items, int num) {
+    for (int i = 0; i < num; i++) {
+        free(items[i].text);
+    }
+    free(items);
+}
+
+static double bench_hashtbl(BenchTextItem *items, int num_items, BenchTextItem *queries, int num_queries,
+    int log_size, int auto_grow, int *found, float *avg_chain) {
+    hashtbl_t *tbl = hashtbl_init(log_size, offsetof(BenchTextItem, hashlink), auto_grow);
+    hashtbl_stats_t stats;
+    double start;
+    int i = 0;
+
+    for (i = 0; i < num_items; i++) {
+        hashtbl_insert(tbl, items[i].hashkey, &items[i]);
+    }
+    for (i = 0; i < num_queries; i++) { // 预热，同时让渐进式rehash完成
+        hashtbl_find(tbl, &queries[i], queries[i].hashkey, bench_text_item_cmp);
+    }
+    *found = 0;
+    start = now_ns();
+    for (i = 0; i < num_queries; i++) {
+        if (hashtbl_find(tbl, &queries[i], queries[i].hashkey, bench_text_item_cmp)) {
+            (*found)++;
+        }
+    }
+    start = (now_ns() - start) / num_queries;
+    hashtbl_get_stats(tbl, &stats);
+    *avg_chain = stats.avg_chain_len;
+    hashtbl_destroy(tbl);
+    return start;
+}
+
+static double bench_oahashtbl(BenchTextItem *items, int num_items, BenchTextItem *queries, int num_queries, int *found) {
+    oahashtbl_t *tbl = oahashtbl_init(6);
+    double start;
+    int i = 0;
+
+    for (i = 0; i < num_items; i++) {
+        oahashtbl_insert(tbl, items[i].hashkey, &items[i]);
+    }
+    for (i = 0; i < num_queries; i++) {
+        oahashtbl_find(tbl, &queries[i], queries[i].hashkey, bench_text_item_cmp);
+    }
+    *found = 0;
+    start = now_ns();
+    for (i = 0; i < num_queries; i++) {
+        if (oahashtbl_find(tbl, &queries[i], queries[i].hashkey, bench_text_item_cmp)) {
+            (*found)++;
+        }
+    }
+    start = (now_ns() - start) / num_queries;
+    oahashtbl_destroy(tbl);
+    return start;
+}
+
+int main(int argc, char *argv[]) {
+    int populations[] = {400, 4096, 65536, 262144}; // 400约为一局游戏的常驻文本数，后面模拟缓存不淘汰时的长时间运行
+    int num_queries = (argc > 1) ? atoi(argv[1]) : 1000000;
+    int found[3];
+    float avg_chain[2];
+    double ns[3];
+
+    if (num_queries <= 0) {
+        num_queries = 1000000;
+    }
+    printf("text cache lookup, %d queries per run (ns/lookup)\n", num_queries);
+    printf("%10s %22s %22s %12s\n", "items", "hashtbl(log 12,fixed)", "hashtbl(auto_grow)", "oahashtbl");
+    for (size_t p = 0; p < sizeof(populations) / sizeof(populations[0]); p++) {
+        int num_items = populations[p];
+        BenchTextItem *items = make_items(num_items);
+        BenchTextItem *queries = make_queries(items, num_items, num_queries);
+
+        ns[0] = bench_hashtbl(items, num_items, queries, num_queries, 12, 0, &found[0], &avg_chain[0]);
+        ns[1] = bench_hashtbl(items, num_items, queries, num_queries, 6, 1, &found[1], &avg_chain[1]);
+        ns[2] = bench_oahashtbl(items, num_items, queries, num_queries, &found[2]);
+        printf("%10d %13.1f(chain %4.1f) %13.1f(chain %4.1f) %12.1f\n", num_items, ns[0], avg_chain[0],
+            ns[1], avg_chain[1], ns[2]);
+        if ((found[0] != found[1]) || (found[1] != found[2])) {
+            printf("ERROR: results mismatch (%d/%d/%d)\n", found[0], found[1], found[2]);
+            return 1;
+        }
+
+        free_items(queries, num_queries);
+        free_items(items, num_items);
+    }
+    return 0;
+}
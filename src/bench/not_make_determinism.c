@@ -0,0 +1,158 @@
+/*确定性检查：固定种子运行一局有傻瓜敌人与脚本操控坦克的游戏，逐帧累积状态哈希（坐标、角度按位参与），定期打印。
+  不参与主程序编译（not_make_前缀），通过`make determinism`以多个优化级别分别编译运行并比对输出，
+  `make determinism FIXED=1`检查定点数学模式（见fixed_math.h）。也可单独编译：
+  gcc -O2 $(find src -mindepth 1 -type d -printf '-I%p ') src/bench/not_make_determinism.c src/game_state.c src/utils/*.c -o determinism -lm -lbsd -pthread
+  参数：./determinism [--ticks N] [--enemies N] [--players N] [--seed N]*/
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "game_state.h"
+#include "tools.h"
+
+#define DETERMINISM_DEFAULT_TICKS   6000
+#define DETERMINISM_DEFAULT_ENEMIES 32
+#define DETERMINISM_DEFAULT_PLAYERS 4
+#define DETERMINISM_DEFAULT_SEED    12345
+#define DETERMINISM_REPORT_TICKS    500
+#define DETERMINISM_MAX_PLAYERS     16
+
+typedef struct {
+    id_handle_t handle;
+    KeyValue key_value;
+    uint32_t hold_ticks;
+} ScriptedPlayer;
+
+static void usage(const char *prog) {
+    printf("usage: %s [--ticks N] [--enemies N] [--players N] [--seed N]\n", prog);
+}
+
+// FNV-1a
+static uint32_t hash_bytes(uint32_t hash, const void *data, size_t len) {
+    const uint8_t *p = (const uint8_t *)data;
+    for (size_t i = 0; i < len; i++) {
+        hash ^= p[i];
+        hash *= 16777619u;
+    }
+    return hash;
+}
+
+static uint32_t hash_game_state(uint32_t hash, GameState *gs) {
+    Tank *tank = NULL;
+    Shell *shell = NULL;
+
+    hash = hash_bytes(hash, &gs->tick, sizeof(gs->tick));
+    TAILQ_FOREACH(tank, &gs->tank_list, chain) {
+        hash = hash_bytes(hash, &tank->position, sizeof(tank->position));
+        hash = hash_bytes(hash, &tank->angle_deg, sizeof(tank->angle_deg));
+        hash = hash_bytes(hash, &tank->practical_outline, sizeof(tank->practical_outline));
+        hash = hash_bytes(hash, &tank->health, sizeof(tank->health));
+        hash = hash_bytes(hash, &tank->flags, sizeof(tank->flags));
+        TAILQ_FOREACH(shell, &tank->shell_list, chain) {
+            hash = hash_bytes(hash, &shell->position, sizeof(shell->position));
+            hash = hash_bytes(hash, &shell->angle_deg, sizeof(shell->angle_deg));
+            hash = hash_bytes(hash, &shell->ttl, sizeof(shell->ttl));
+        }
+    }
+    return hash;
+}
+
+// 被击毁的坦克补充，保持战场规模（只依赖对局的随机数发生器）
+static int refill_tanks(GameState *gs, ScriptedPlayer *players, uint32_t player_num, uint32_t enemies) {
+    char name[TANK_NAME_MAXLEN];
+    Tank *tank = NULL;
+
+    for (uint32_t i = 0; i < player_num; i++) {
+        if (get_tank_by_handle(gs, players[i].handle)) {
+            continue;
+        }
+        snprintf(name, sizeof(name), "player-%u", i);
+        tank = create_tank(gs, (tk_uint8_t *)name, get_random_grid_pos_for_tank(gs), game_random_range(gs, 0, 71) * 5, TANK_ROLE_REMOTE);
+        if (!tank) {
+            return -1;
+        }
+        players[i].handle = tank->handle;
+    }
+    if (gs->tank_num < player_num + enemies) {
+        return spawn_muggle_enemies(gs, player_num + enemies - gs->tank_num);
+    }
+    return 0;
+}
+
+// 脚本操控：随机按住方向键若干帧（与按键重复一样每帧移动两次），偶尔开炮
+static void drive_players(GameState *gs, ScriptedPlayer *players, uint32_t player_num, uint32_t *rng_state) {
+    static const tk_uint32_t masks[] = {TK_KEY_W_ACTIVE, TK_KEY_W_ACTIVE, TK_KEY_S_ACTIVE, TK_KEY_A_ACTIVE, TK_KEY_D_ACTIVE,
+        TK_KEY_W_ACTIVE | TK_KEY_A_ACTIVE, TK_KEY_W_ACTIVE | TK_KEY_D_ACTIVE};
+    Tank *tank = NULL;
+
+    for (uint32_t i = 0; i < player_num; i++) {
+        tank = get_tank_by_handle(gs, players[i].handle);
+        if (!tank || !TST_FLAG(tank, flags, TANK_ALIVE)) {
+            continue;
+        }
+        if (players[i].hold_ticks == 0) {
+            players[i].key_value.mask = masks[tk_rand_range(rng_state, 0, sizeof(masks) / sizeof(masks[0]) - 1)];
+            players[i].hold_ticks = tk_rand_range(rng_state, 3, 15);
+        }
+        players[i].hold_ticks--;
+        for (int step = 0; step < TK_TICK_MS / RENDER_FPS_MS; step++) {
+            tank->key_value_for_control = players[i].key_value;
+            handle_key(tank, &tank->key_value_for_control);
+        }
+        if (tk_rand_range(rng_state, 0, 5) == 0) {
+            create_shell_for_tank(tank);
+        }
+    }
+}
+
+int main(int argc, char *argv[]) {
+    uint32_t ticks = DETERMINISM_DEFAULT_TICKS, enemies = DETERMINISM_DEFAULT_ENEMIES, player_num = DETERMINISM_DEFAULT_PLAYERS;
+    uint32_t seed = DETERMINISM_DEFAULT_SEED, rng_state = 0, hash = 2166136261u;
+    ScriptedPlayer players[DETERMINISM_MAX_PLAYERS];
+    GameState *gs = NULL;
+
+    for (int i = 1; i < argc; i++) {
+        if ((i + 1) >= argc) {
+            usage(argv[0]);
+            return 1;
+        } else if (!strcmp(argv[i], "--ticks")) {
+            ticks = strtoul(argv[++i], NULL, 10);
+        } else if (!strcmp(argv[i], "--enemies")) {
+            enemies = strtoul(argv[++i], NULL, 10);
+        } else if (!strcmp(argv[i], "--players")) {
+            player_num = MIN(strtoul(argv[++i], NULL, 10), DETERMINISM_MAX_PLAYERS);
+        } else if (!strcmp(argv[i], "--seed")) {
+            seed = strtoul(argv[++i], NULL, 10);
+        } else {
+            usage(argv[0]);
+            return 1;
+        }
+    }
+
+    gs = malloc(sizeof(GameState));
+    if (!gs) {
+        return 1;
+    }
+    tk_debug_object_lifecycle = 0;
+    if (init_game_state(gs, seed, tk_rand_seed(seed + 1)) != 0) {
+        return 1;
+    }
+    gs->max_tank_num = player_num + enemies;
+    memset(players, 0, sizeof(players));
+    rng_state = tk_rand_seed(seed + 2);
+    printf("map %dx%d, %u enemies, %u players, %u ticks, seed %u\n", HORIZON_GRID_NUMBER, VERTICAL_GRID_NUMBER, enemies,
+        player_num, ticks, seed);
+    for (uint32_t i = 1; i <= ticks; i++) {
+        if (refill_tanks(gs, players, player_num, enemies) != 0) {
+            return 1;
+        }
+        drive_players(gs, players, player_num, &rng_state);
+        game_state_tick(gs);
+        hash = hash_game_state(hash, gs);
+        if ((i % DETERMINISM_REPORT_TICKS == 0) || (i == ticks)) {
+            printf("tick %6u hash %08x (shots %lu, hits %lu, tanks spawned %lu)\n", i, hash, gs->shots, gs->hits, gs->muggles_spawned);
+        }
+    }
+    cleanup_game_state(gs);
+    free(gs);
+    return 0;
+}
@@ -0,0 +1,309 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <signal.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include "bot_shm.h"
+#include "headless.h"
+#include "game_state.h"
+#include "tools.h"
+#include "debug.h"
+
+#define BOT_HOST_LIVENESS_TICKS 20 // 实时模式下每隔这么多帧检查一次已接入的机器人进程是否还在
+
+typedef struct {
+    const BotHostConfig *config;
+    GameState *game;
+    TkBotShmRegion *region;
+    uint32_t expected[TK_BOT_SHM_MAX_BOTS]; // 发布本帧视图时已接入的机器人（线程ID），步进模式等待它们的输入
+    uint32_t attached;
+    // 统计
+    tk_uint32_t ticks;
+    tk_uint32_t late_ticks;
+    tk_uint32_t bots_served;
+    uint64_t wait_ns; // 等待机器人输入的总耗时
+    uint64_t sim_ns;  // 应用输入、推进模拟、发布视图的总耗时
+} BotHost;
+
+static volatile sig_atomic_t tk_bot_host_stop = 0;
+
+static void bot_host_sigint(int sig) {
+    tk_bot_host_stop = 1;
+}
+
+static void release_slot(TkBotSlot *slot, uint32_t owner) {
+    __atomic_compare_exchange_n(&slot->owner, &owner, 0, 0, __ATOMIC_ACQ_REL, __ATOMIC_RELAXED);
+}
+
+// 机器人进程已不存在（没来得及把owner改回0，例如被kill -9）时代为释放槽位，返回是否释放
+static int reap_slot(TkBotSlot *slot, uint32_t owner, uint32_t index) {
+    if ((kill(owner, 0) != 0) && (errno == ESRCH)) {
+        tk_debug("Warn: bot %u of slot %u is gone, release the slot\n", owner, index);
+        release_slot(slot, owner);
+        return 1;
+    }
+    return 0;
+}
+
+// 已接入的槽位创建（重生）坦克，释放了的槽位删除坦克，傻瓜敌人补足数量
+static int sync_slots(BotHost *host) {
+    GameState *gs = host->game;
+    TkBotSlot *slot = NULL;
+    char name[TANK_NAME_MAXLEN];
+    Tank *tank = NULL;
+    uint32_t owner = 0, players = 0;
+
+    host->attached = 0;
+    for (uint32_t i = 0; i < host->config->slots; i++) {
+        slot = &host->region->slots[i];
+        owner = __atomic_load_n(&slot->owner, __ATOMIC_ACQUIRE);
+        // 实时模式不等待输入，不会像步进模式那样在超时时发现机器人已退出，改为定期检查
+        if (owner && host->config->pace_ms && (gs->tick % BOT_HOST_LIVENESS_TICKS == 0) && reap_slot(slot, owner, i)) {
+            owner = __atomic_load_n(&slot->owner, __ATOMIC_ACQUIRE);
+        }
+        tank = get_tank_by_handle(gs, slot->tank_handle);
+        host->expected[i] = owner;
+        if (!owner) {
+            if (tank) {
+                tk_debug("bot slot %u detached\n", i);
+                delete_tank(tank, 1);
+            }
+            slot->tank_handle = 0;
+            continue;
+        }
+        host->attached++;
+        players++;
+        if (tank) {
+            continue;
+        }
+        if (!slot->tank_handle) {
+            tk_debug("bot slot %u attached by %u\n", i, owner);
+            slot->late_ticks = 0;
+            host->bots_served++;
+        }
+        snprintf(name, sizeof(name), "bot-%u", i);
+        tank = create_tank(gs, (tk_uint8_t *)name, get_random_grid_pos_for_tank(gs), game_random_range(gs, 0, 71) * 5, TANK_ROLE_EXTERNAL);
+        if (!tank) {
+            return -1;
+        }
+        slot->tank_handle = tank->handle;
+    }
+    if (gs->tank_num < players + host->config->enemies) {
+        return spawn_muggle_enemies(gs, players + host->config->enemies - gs->tank_num);
+    }
+    return 0;
+}
+
+// 序列锁写端：写视图前后各把序列号加1，写完唤醒所有等待新一帧的机器人
+static void publish_view(BotHost *host) {
+    TkBotShmRegion *region = host->region;
+    TkBotWorldView *view = &region->view;
+    GameState *gs = host->game;
+    uint32_t seq = region->view_seq;
+    Tank *tank = NULL;
+    Shell *shell = NULL;
+
+    __atomic_store_n(&region->view_seq, seq + 1, __ATOMIC_RELAXED);
+    __atomic_thread_fence(__ATOMIC_RELEASE);
+    view->tick = gs->tick;
+    view->tank_num = view->shell_num = view->truncated = 0;
+    TAILQ_FOREACH(tank, &gs->tank_list, chain) {
+        if (view->tank_num < TK_BOT_SHM_MAX_TANKS) {
+            view->tanks[view->tank_num++] = (TkBotTankView){tank->handle, POS(tank->position), tank->angle_deg, tank->health,
+                tank->role, TST_FLAG(tank, flags, TANK_ALIVE) ? 1 : 0};
+        } else {
+            view->truncated = 1;
+        }
+        TAILQ_FOREACH(shell, &tank->shell_list, chain) {
+            if (view->shell_num < TK_BOT_SHM_MAX_SHELLS) {
+                view->shells[view->shell_num++] = (TkBotShellView){shell->owner_handle, POS(shell->position), shell->angle_deg};
+            } else {
+                view->truncated = 1;
+            }
+        }
+    }
+    __atomic_store_n(&region->view_seq, seq + 2, __ATOMIC_RELEASE);
+    tk_bot_shm_wake(&region->view_seq);
+}
+
+static void apply_inputs(BotHost *host) {
+    TkBotSlot *slot = NULL;
+    Tank *tank = NULL;
+    uint32_t buttons = 0;
+
+    for (uint32_t i = 0; i < host->config->slots; i++) {
+        slot = &host->region->slots[i];
+        tank = get_tank_by_handle(host->game, slot->tank_handle);
+        if (!host->expected[i] || !tank || !TST_FLAG(tank, flags, TANK_ALIVE)) {
+            continue;
+        }
+        buttons = __atomic_load_n(&slot->buttons, __ATOMIC_ACQUIRE);
+        tank->key_value_for_control.mask = buttons & (TK_KEY_W_ACTIVE | TK_KEY_A_ACTIVE | TK_KEY_S_ACTIVE | TK_KEY_D_ACTIVE);
+        if (tank->key_value_for_control.mask) {
+            handle_key(tank, &tank->key_value_for_control);
+        }
+        if (buttons & TK_BOT_BUTTON_FIRE) {
+            create_shell_for_tank(tank);
+        }
+    }
+}
+
+// 步进模式：等待发布视图时已接入的每个机器人针对本帧给出输入（中途退出的不再等待）。
+// 超时的机器人沿用上一次的按键，其进程已不存在时代为释放槽位
+static void wait_inputs(BotHost *host) {
+    TkBotShmRegion *region = host->region;
+    TkBotSlot *slot = NULL;
+    uint64_t start = tk_get_monotonic_ns();
+    uint64_t deadline = start + TK_BOT_SHM_STEP_TIMEOUT_MS * 1000000ULL, now = 0;
+    uint32_t bell = 0, pending = 0;
+
+    for (;;) {
+        bell = __atomic_load_n(&region->input_bell, __ATOMIC_ACQUIRE);
+        pending = 0;
+        for (uint32_t i = 0; i < host->config->slots; i++) {
+            slot = &region->slots[i];
+            if (host->expected[i] && (__atomic_load_n(&slot->owner, __ATOMIC_ACQUIRE) == host->expected[i]) &&
+                (__atomic_load_n(&slot->input_tick, __ATOMIC_ACQUIRE) != host->game->tick)) {
+                pending++;
+            }
+        }
+        now = tk_get_monotonic_ns();
+        if (!pending || (now >= deadline) || tk_bot_host_stop) {
+            break;
+        }
+        tk_bot_shm_wait(&region->input_bell, bell, (deadline - now) / 1000000 + 1);
+    }
+    host->wait_ns += now - start;
+    if (!pending) {
+        return;
+    }
+    for (uint32_t i = 0; i < host->config->slots; i++) {
+        slot = &region->slots[i];
+        if (!host->expected[i] || (__atomic_load_n(&slot->owner, __ATOMIC_ACQUIRE) != host->expected[i]) ||
+            (__atomic_load_n(&slot->input_tick, __ATOMIC_ACQUIRE) == host->game->tick)) {
+            continue;
+        }
+        slot->late_ticks++;
+        host->late_ticks++;
+        reap_slot(slot, host->expected[i], i);
+    }
+}
+
+static TkBotShmRegion* create_region(const BotHostConfig *config) {
+    TkBotShmRegion *region = NULL;
+    int fd = shm_open(config->name, O_RDWR | O_CREAT | O_TRUNC, 0600);
+
+    if (fd < 0) {
+        tk_debug("Error: shm_open(%s) failed: %s\n", config->name, strerror(errno));
+        return NULL;
+    }
+    if (ftruncate(fd, sizeof(TkBotShmRegion)) != 0) {
+        tk_debug("Error: ftruncate(%s) failed: %s\n", config->name, strerror(errno));
+        close(fd);
+        shm_unlink(config->name);
+        return NULL;
+    }
+    region = mmap(NULL, sizeof(TkBotShmRegion), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd);
+    if (region == MAP_FAILED) {
+        tk_debug("Error: mmap(%s) failed: %s\n", config->name, strerror(errno));
+        shm_unlink(config->name);
+        return NULL;
+    }
+    return region; // ftruncate()扩展出的内容全为0
+}
+
+int tk_run_bot_host(const BotHostConfig *config) {
+    BotHost host;
+    TkBotShmRegion *region = NULL;
+    struct sigaction sa;
+    uint64_t start = 0, sim_start = 0, next_tick_ns = 0, now = 0;
+    int ret = -1;
+
+    if ((config->slots == 0) || (config->slots > TK_BOT_SHM_MAX_BOTS)) {
+        tk_debug("Error: bot slots must be 1~%d\n", TK_BOT_SHM_MAX_BOTS);
+        return -1;
+    }
+    memset(&host, 0, sizeof(host));
+    host.config = config;
+    host.game = tk_headless_game_create(config->seed, config->slots + config->enemies, 0);
+    if (!host.game) {
+        return -1;
+    }
+    region = host.region = create_region(config);
+    if (!region) {
+        goto out;
+    }
+    region->magic = TK_BOT_SHM_MAGIC;
+    region->version = TK_BOT_SHM_VERSION;
+    region->map_horizon = HORIZON_GRID_NUMBER;
+    region->map_vertical = VERTICAL_GRID_NUMBER;
+    region->grid_size = GRID_SIZE;
+    region->tick_ms = TK_TICK_MS;
+    region->maze_seed = host.game->maze_seed;
+    region->slot_num = config->slots;
+    region->pace_ms = config->pace_ms;
+    __atomic_store_n(&region->running, 1, __ATOMIC_RELEASE);
+
+    memset(&sa, 0, sizeof(sa));
+    sa.sa_handler = bot_host_sigint; // 不带SA_RESTART，打断futex等待
+    sigaction(SIGINT, &sa, NULL);
+    tk_debug("bot host on shm %s(%zu B): %u slots, map %dx%d, %u enemies, %s, seed %u\n", config->name, sizeof(TkBotShmRegion),
+        config->slots, HORIZON_GRID_NUMBER, VERTICAL_GRID_NUMBER, config->enemies, config->pace_ms ? "realtime" : "step mode",
+        config->seed);
+
+    if (sync_slots(&host) != 0) {
+        goto out;
+    }
+    publish_view(&host);
+    start = next_tick_ns = tk_get_monotonic_ns();
+    while (!tk_bot_host_stop && (!config->duration || (host.game->tick < config->duration))) {
+        if (config->pace_ms) {
+            next_tick_ns += config->pace_ms * 1000000ULL;
+            now = tk_get_monotonic_ns();
+            if (next_tick_ns > now) {
+                usleep((next_tick_ns - now) / 1000);
+            }
+        } else if (!host.attached) { // 步进模式下没有机器人就不推进，有机器人接入时重新发布视图（带上它的坦克）
+            tk_bot_shm_wait(&region->input_bell, __atomic_load_n(&region->input_bell, __ATOMIC_ACQUIRE), 100);
+            if (sync_slots(&host) != 0) {
+                goto out;
+            }
+            if (host.attached) {
+                publish_view(&host);
+            }
+            continue;
+        } else {
+            wait_inputs(&host);
+        }
+        sim_start = tk_get_monotonic_ns();
+        apply_inputs(&host);
+        game_state_tick(host.game);
+        if (sync_slots(&host) != 0) {
+            goto out;
+        }
+        publish_view(&host);
+        host.sim_ns += tk_get_monotonic_ns() - sim_start;
+        host.ticks++;
+    }
+    now = tk_get_monotonic_ns();
+    tk_debug("bot host done: %lu ticks in %.2fs(%.0f ticks/s), %lu bots served, %lu late ticks, "
+        "per tick %.1fus waiting for bots + %.1fus simulating\n",
+        host.ticks, (now - start) / 1e9, (now > start) ? host.ticks * 1e9 / (now - start) : 0.0, host.bots_served,
+        host.late_ticks, host.ticks ? host.wait_ns / 1e3 / host.ticks : 0.0, host.ticks ? host.sim_ns / 1e3 / host.ticks : 0.0);
+    ret = 0;
+
+out:
+    if (region) {
+        __atomic_store_n(&region->running, 0, __ATOMIC_RELEASE);
+        __atomic_add_fetch(&region->view_seq, 2, __ATOMIC_RELEASE);
+        tk_bot_shm_wake(&region->view_seq);
+        munmap(region, sizeof(TkBotShmRegion));
+        shm_unlink(config->name);
+    }
+    tk_headless_game_destroy(host.game);
+    signal(SIGINT, SIG_DFL);
+    return ret;
+}
@@ -1,20 +1,15 @@
 #include "event_loop.h"
 #include <errno.h>
 #include <unistd.h>
+#include <string.h>
 #include "game_state.h"
 #include "debug.h"
+#include "profiler.h"
+#include "trace.h"
+#include "replay.h"
+#include "tools.h"
 
-extern MazePathBFSearchManager tk_bfs_search_manager;
-
-// 全局事件基（仅控制线程使用）
-struct event_base* tk_event_base = NULL;
-// 用于线程通信的管道（线程共享，控制线程读端，GUI线程写端）
-int tk_pipe_fds[2] = {-1, -1};
-// 管道事件（控制线程检测到管道读事件，会从全局坦克事件队列中取出具体的键盘等事件进行handle处理）
-struct event *tk_pipe_event = NULL;
-// 定时器事件（用于周期更新子弹移动等游戏状态数据。如果启用ENABLE_EVENT_PRIORITY，则定时器事件优先级定义为最低）
-struct event *tk_tank_update_timer_event = NULL;
-#define TIMER_INTERVAL_MS (RENDER_FPS_MS*2)
+#define TIMER_INTERVAL_MS TK_TICK_MS
 
 #ifdef ENABLE_EVENT_PRIORITY
 #define TK_EVENT_PRIORITY_TOTAL_LEVEL 2
@@ -22,22 +17,39 @@ struct event *tk_tank_update_timer_event = NULL;
 #define TK_EVENT_PRIORITY_LOWEST_LEVEL (TK_EVENT_PRIORITY_TOTAL_LEVEL-1)
 #endif
 
-// 全局坦克事件队列（控制线程、GUI线程共享）
-EventQueue tk_event_queue;
+// GUI对局的事件循环（控制线程使用）
+EventLoopContext tk_event_loop = {.pipe_fds = {-1, -1}};
 
-extern void cleanup_event_loop(void);
-extern void handle_event(Event* event);
 #ifdef ENABLE_EVENT_PRIORITY
-extern struct event* add_timer_event(int timeout_ms, void (*callback)(void*), void* arg, int priority);
+static struct event* add_timer_event(struct event_base *base, int timeout_ms, event_callback_fn callback, void* arg, int priority);
 #else
-extern struct event* add_timer_event(int timeout_ms, void (*callback)(void*), void* arg);
+static struct event* add_timer_event(struct event_base *base, int timeout_ms, event_callback_fn callback, void* arg);
 #endif
-extern void update_game_state_timer_handle();
+static void update_game_state_timer_handle(evutil_socket_t fd, short what, void *arg);
+
+// 暂停期间把游戏定时器从事件基中移除，控制线程只阻塞在管道上，不再每TIMER_INTERVAL_MS空转唤醒一次；继续时重新加入
+static void sync_game_timer_with_pause_state(EventLoopContext *ctx) {
+    struct timeval timeout = {TIMER_INTERVAL_MS / 1000, (TIMER_INTERVAL_MS % 1000) * 1000};
+
+    if (!ctx->timer_event) return;
+    if (ctx->game->stop_game && !ctx->timer_removed) {
+        event_del(ctx->timer_event);
+        ctx->timer_removed = 1;
+        tk_debug_internal(DEBUG_EVENT_LOOP, "game paused, timer removed\n");
+    } else if (!ctx->game->stop_game && ctx->timer_removed) {
+        if (event_add(ctx->timer_event, &timeout) == -1) {
+            tk_debug("Error: failed to re-add timer event\n");
+            return;
+        }
+        ctx->timer_removed = 0;
+        ctx->last_tick_ns = 0; // 暂停的时长不算作定时器迟到
+        tk_debug_internal(DEBUG_EVENT_LOOP, "game resumed, timer re-added\n");
+    }
+}
 
-// 记录写端连接状态
-static int writer_connected = 0;
 // 管道读取回调函数
-void pipe_read_callback(evutil_socket_t fd, short what, void *arg) {
+static void pipe_read_callback(evutil_socket_t fd, short what, void *arg) {
+    EventLoopContext *ctx = (EventLoopContext *)arg;
     char buf[1024];
     int len;
     int total_bytes = 0;
@@ -49,28 +61,32 @@ void pipe_read_callback(evutil_socket_t fd, short what, void *arg) {
 
         if (len > 0) {
             // 有数据可读
-            if (!writer_connected) {
+            if (!ctx->writer_connected) {
                 tk_debug_internal(DEBUG_EVENT_LOOP, "Writer connected\n");
-                writer_connected = 1;
+                ctx->writer_connected = 1;
             }
             total_bytes += len;
             tk_debug_internal(DEBUG_EVENT_LOOP, "Read chunk: %d bytes\n", len); // 一个字节就代表一个坦克事件
             // 处理数据
             // 从事件队列中取出事件并处理
-            Event* event = dequeue_event(&tk_event_queue, 0);
+            {
+            TK_PROFILE_SCOPE(TK_PHASE_EVENT_DRAIN);
+            Event* event = dequeue_event(&ctx->queue, 0);
             while (event) {
-                handle_event(event);
+                handle_event(ctx, event);
                 free_event(event);
                 // if ((--len) <= 0) {
                 //     break;
                 // }
-                event = dequeue_event(&tk_event_queue, 0);
+                event = dequeue_event(&ctx->queue, 0);
             }
+            }
+            sync_game_timer_with_pause_state(ctx); // 暂停/继续/重开都经由管道事件改变stop_game
         } else if (len == 0) {
             // 写端关闭
-            if (writer_connected) {
+            if (ctx->writer_connected) {
                 tk_debug_internal(DEBUG_EVENT_LOOP, "Writer disconnected\n");
-                writer_connected = 0;
+                ctx->writer_connected = 0;
             }
             break;
         } else {
@@ -91,132 +107,201 @@ void pipe_read_callback(evutil_socket_t fd, short what, void *arg) {
 }
 
 // 初始化事件循环
-int init_event_loop() {
+int init_event_loop(EventLoopContext *ctx, GameState *game, struct event_base *base) {
     int i = 0;
     int ret = -1;
 
-    init_event_queue(&tk_event_queue);
+    memset(ctx, 0, sizeof(*ctx));
+    ctx->game = game;
+    ctx->pipe_fds[0] = ctx->pipe_fds[1] = -1;
+    init_event_queue(&ctx->queue);
+    if (base) { // 共享调用者的事件基，没有GUI线程向这一局发送事件，不需要管道
+        ctx->base = base;
+        goto add_timer;
+    }
     // 创建管道用于线程间通信
-    if (pipe(tk_pipe_fds) == -1) {
+    if (pipe(ctx->pipe_fds) == -1) {
         tk_debug("Error: failed to create pipe\n");
         goto error;
     }
     // 设置管道为非阻塞
-    for (i=0; i<(sizeof(tk_pipe_fds)/sizeof(int)); i++) {
-        evutil_make_socket_nonblocking(tk_pipe_fds[i]);
+    for (i=0; i<(sizeof(ctx->pipe_fds)/sizeof(int)); i++) {
+        evutil_make_socket_nonblocking(ctx->pipe_fds[i]);
     }
 
-    // 创建全局事件基
-    tk_event_base = event_base_new();
-    if (!tk_event_base) {
+    // 创建事件基
+    ctx->base = event_base_new();
+    if (!ctx->base) {
         tk_debug("Error: failed to create event base\n");
         goto error;
     }
+    ctx->owns_base = 1;
 #ifdef ENABLE_EVENT_PRIORITY
     tk_debug("Info: event priority enabled\n");
-    event_base_priority_init(tk_event_base, TK_EVENT_PRIORITY_TOTAL_LEVEL); // 设置2个优先级级别
+    event_base_priority_init(ctx->base, TK_EVENT_PRIORITY_TOTAL_LEVEL); // 设置2个优先级级别
 #endif
     // 创建管道读取事件
-    tk_pipe_event = event_new(tk_event_base, tk_pipe_fds[0], 
+    ctx->pipe_event = event_new(ctx->base, ctx->pipe_fds[0], 
                 EV_READ | EV_PERSIST | EV_ET,  // 添加 EV_ET 标志启用边缘触发
-                pipe_read_callback, NULL);
-    if (!tk_pipe_event) {
+                pipe_read_callback, ctx);
+    if (!ctx->pipe_event) {
         tk_debug("Error: failed to create pipe event\n");
         goto error;
     }
 #ifdef ENABLE_EVENT_PRIORITY
     // 设置高优先级（0是最高优先级）
-    event_priority_set(tk_pipe_event, TK_EVENT_PRIORITY_HIGHEST_LEVEL);
+    event_priority_set(ctx->pipe_event, TK_EVENT_PRIORITY_HIGHEST_LEVEL);
 #endif
     // 添加管道事件到事件基
-    if (event_add(tk_pipe_event, NULL) == -1) {
+    if (event_add(ctx->pipe_event, NULL) == -1) {
         tk_debug("Error: failed to add pipe event\n");
         goto error;
     }
+add_timer:
 #ifdef ENABLE_EVENT_PRIORITY
-    tk_tank_update_timer_event = add_timer_event(TIMER_INTERVAL_MS, update_game_state_timer_handle, NULL, 
+    ctx->timer_event = add_timer_event(ctx->base, TIMER_INTERVAL_MS, update_game_state_timer_handle, ctx, 
         TK_EVENT_PRIORITY_LOWEST_LEVEL);
 #else
-    tk_tank_update_timer_event = add_timer_event(TIMER_INTERVAL_MS, update_game_state_timer_handle, NULL);
+    ctx->timer_event = add_timer_event(ctx->base, TIMER_INTERVAL_MS, update_game_state_timer_handle, ctx);
 #endif
-    if (!tk_tank_update_timer_event) {
+    if (!ctx->timer_event) {
         goto error;
     }
     ret = 0;
 
     return ret;
 error:
-    cleanup_event_loop();
+    cleanup_event_loop(ctx);
     return ret;
 }
 
-void close_read_end_of_pipe() {
-    if (tk_pipe_fds[0] == -1) return;
-    close(tk_pipe_fds[0]);
-    tk_pipe_fds[0] = -1;
+static void close_read_end_of_pipe(EventLoopContext *ctx) {
+    if (ctx->pipe_fds[0] == -1) return;
+    close(ctx->pipe_fds[0]);
+    ctx->pipe_fds[0] = -1;
 }
 
-void close_write_end_of_pipe() {
-    if (tk_pipe_fds[1] == -1) return;
-    close(tk_pipe_fds[1]);
-    tk_pipe_fds[1] = -1;
+void close_write_end_of_pipe(EventLoopContext *ctx) {
+    if (ctx->pipe_fds[1] == -1) return;
+    close(ctx->pipe_fds[1]);
+    ctx->pipe_fds[1] = -1;
 }
 
-void cleanup_event_loop() {
-    if (tk_pipe_event) {
-        event_free(tk_pipe_event);
-        tk_pipe_event = NULL;
+void cleanup_event_loop(EventLoopContext *ctx) {
+    if (!ctx->game) return; // 未初始化或已清理
+    if (ctx->pipe_event) {
+        event_free(ctx->pipe_event);
+        ctx->pipe_event = NULL;
     }
-    if (tk_tank_update_timer_event) {
-        event_free(tk_tank_update_timer_event);
-        tk_tank_update_timer_event = NULL;
+    if (ctx->timer_event) {
+        event_free(ctx->timer_event);
+        ctx->timer_event = NULL;
     }
-    if (tk_event_base) {
-        event_base_free(tk_event_base);
-        tk_event_base = NULL;
+    if (ctx->base && ctx->owns_base) {
+        event_base_free(ctx->base);
     }
-    close_read_end_of_pipe();
-    close_write_end_of_pipe();
-    cleanup_event_queue(&tk_event_queue);
+    ctx->base = NULL;
+    ctx->owns_base = 0;
+    close_read_end_of_pipe(ctx);
+    close_write_end_of_pipe(ctx);
+    cleanup_event_queue(&ctx->queue);
+    ctx->game = NULL;
 }
 
 // 运行事件循环
-void run_event_loop() {
-    if (!tk_event_base) return;
+void run_event_loop(EventLoopContext *ctx) {
+    if (!ctx->base) return;
 
     // 进入事件循环
-    event_base_dispatch(tk_event_base);
+    event_base_dispatch(ctx->base);
 }
 
 // 停止事件循环
-void stop_event_loop() {
-    if (!tk_event_base) return;
-
-    // event_del(tk_pipe_event);
-    // event_free(tk_pipe_event);
-    // tk_pipe_event=NULL;
+void stop_event_loop(EventLoopContext *ctx) {
+    if (!ctx->base) return;
 
     // 退出事件循环
-    // event_base_loopbreak(tk_event_base);
-    // tk_event_base = NULL;
+    // event_base_loopbreak(ctx->base);
     struct timeval immediate = {0, 0};
-    event_base_loopexit(tk_event_base, &immediate);
+    event_base_loopexit(ctx->base, &immediate);
 }
 
 // 从其他线程通知事件循环有新事件要处理
-void notify_event_loop() {
-    if (tk_pipe_fds[1] == -1) return;
+void notify_event_loop(EventLoopContext *ctx) {
+    if (ctx->pipe_fds[1] == -1) return;
 
     // 向管道写入一个字节，触发管道事件
     char c = 'x';
-    write(tk_pipe_fds[1], &c, 1);
+    write(ctx->pipe_fds[1], &c, 1);
+}
+
+// 按键事件更新方向键状态。返回1表示随后应执行handle_key()，开火与非按键事件返回0
+int update_key_value(KeyValue *key_value, Event *event) {
+    if (event->type == EVENT_KEY_PRESS) {
+        tk_debug_internal(DEBUG_CONTROL_THREAD_DETAIL, "recv key %d down\n", event->data.key);
+        switch (event->data.key) {
+            case KEY_W:
+                SET_FLAG(key_value, mask, TK_KEY_W_ACTIVE);
+                break;
+            case KEY_S:
+                SET_FLAG(key_value, mask, TK_KEY_S_ACTIVE);
+                break;
+            case KEY_A:
+                SET_FLAG(key_value, mask, TK_KEY_A_ACTIVE);
+                break;
+            case KEY_D:
+                SET_FLAG(key_value, mask, TK_KEY_D_ACTIVE);
+                break;
+            case KEY_SPACE:
+                return 0;
+        }
+    } else if (event->type == EVENT_KEY_RELEASE) {
+        tk_debug_internal(DEBUG_CONTROL_THREAD_DETAIL, "recv key %d up\n", event->data.key);
+        switch (event->data.key) {
+            case KEY_W:
+                CLR_FLAG(key_value, mask, TK_KEY_W_ACTIVE);
+                break;
+            case KEY_S:
+                CLR_FLAG(key_value, mask, TK_KEY_S_ACTIVE);
+                break;
+            case KEY_A:
+                CLR_FLAG(key_value, mask, TK_KEY_A_ACTIVE);
+                break;
+            case KEY_D:
+                CLR_FLAG(key_value, mask, TK_KEY_D_ACTIVE);
+                break;
+        }
+    } else {
+        return 0;
+    }
+    return 1;
+}
+
+// 把一个按键事件作用到指定坦克上（本地GUI线程的我的坦克，或网络客户端各自的坦克，见net_server.c）
+void handle_tank_key_event(Tank *tank, Event *event) {
+    if (tank->game->stop_game) {
+        return;
+    }
+    if ((event->type == EVENT_KEY_PRESS) && (event->data.key == KEY_SPACE)) {
+        // tk_debug_internal(DEBUG_CONTROL_THREAD_DETAIL, "发射子弹\n");
+        create_shell_for_tank(tank);
+        return;
+    }
+    if (!update_key_value(&(tank->key_value_for_control), event)) {
+        return;
+    }
+    handle_key(tank, &(tank->key_value_for_control));
+    print_key_value(&(tank->key_value_for_control));
 }
 
-// 处理来自本地GUI线程或其他（TODO：如网络）的坦克事件
-void handle_event(Event* event) {
+// 处理来自本地GUI线程（或回放）的事件。网络客户端的按键由net_server.c经handle_tank_key_event()作用到各自的坦克
+void handle_event(EventLoopContext *ctx, Event* event) {
+    GameState *gs = ctx->game;
+    MazePathBFSearchManager *bfs = &gs->bfs;
     Grid start;
     if (!event) return;
-    if (!mytankptr || TST_FLAG(mytankptr, flags, TANK_DEAD)) {
+    tk_replay_record_event(gs, event); // 录像：事件与模拟帧的先后顺序决定了回放结果
+    if (!gs->my_tank || TST_FLAG(gs->my_tank, flags, TANK_DEAD)) {
         tk_debug("warning: your tank is dead, game is over\n");
         if (event->type == EVENT_QUIT) {
             goto quit_event_loop;
@@ -224,100 +309,63 @@ void handle_event(Event* event) {
             goto recv_stop_event;
         } else if (event->type == EVENT_GAME_START) {
             goto recv_start_event;
+        } else if (event->type == EVENT_GAME_RESTART) {
+            goto recv_restart_event;
         }
         return;
     }
     switch (event->type) {
+    case EVENT_GAME_RESTART:
+    {
+recv_restart_event:
+        tk_debug("重开一局\n");
+        start_new_game(gs);
+    }
+    break;
     case EVENT_GAME_STOP:
     {
 recv_stop_event:
         tk_debug("暂停游戏\n");
-        tk_shared_game_state.stop_game = 1;
+        gs->stop_game = 1;
     }
     break;
     case EVENT_GAME_START:
     {
 recv_start_event:
         tk_debug("继续游戏\n");
-        tk_shared_game_state.stop_game = 0;
+        gs->stop_game = 0;
     }
     break;
     case EVENT_PATH_SEARCH:
     {
         /*点击地图任意网格（终点网格），则自动搜索当前我的坦克到指定网格的最短路径，并且GUI会绘制该路径，若要取消绘制，则再次点击终点网格*/
-        tk_debug("收到路径搜索请求mytank_position(%f,%f)->destination_grid(%d,%d)\n", POS(mytankptr->position), POS(event->data.path_search_request.end));
-        start = get_grid_by_tank_position(&mytankptr->position);
-        lock(&tk_bfs_search_manager.spinlock);
-        if (is_two_grids_the_same(&event->data.path_search_request.end, &tk_bfs_search_manager.end) && tk_bfs_search_manager.success) {
-            tk_bfs_search_manager.success = 0; //相当于置为invalid，这样GUI就不会再去绘制路径了
+        TK_TRACE_SCOPE("path search");
+        tk_debug("收到路径搜索请求mytank_position(%f,%f)->destination_grid(%d,%d)\n", POS(gs->my_tank->position), POS(event->data.path_search_request.end));
+        start = get_grid_by_tank_position(&gs->my_tank->position);
+        lock(&bfs->spinlock);
+        if (is_two_grids_the_same(&event->data.path_search_request.end, &bfs->end) && bfs->success) {
+            bfs->success = 0; //相当于置为invalid，这样GUI就不会再去绘制路径了
             tk_debug("取消路径搜索\n");
-        } else if (!(is_two_grids_the_same(&start, &tk_bfs_search_manager.start) 
-            && is_two_grids_the_same(&event->data.path_search_request.end, &tk_bfs_search_manager.end) && (tk_bfs_search_manager.success))) {
-            tk_bfs_search_manager.start = start;
-            tk_bfs_search_manager.end = event->data.path_search_request.end;
-            tk_bfs_search_manager.bfs_search(&tk_bfs_search_manager);
+        } else if (!(is_two_grids_the_same(&start, &bfs->start) 
+            && is_two_grids_the_same(&event->data.path_search_request.end, &bfs->end) && (bfs->success))) {
+            bfs->start = start;
+            bfs->end = event->data.path_search_request.end;
+            bfs->bfs_search(bfs);
         }
-        unlock(&tk_bfs_search_manager.spinlock);
+        unlock(&bfs->spinlock);
     }
     break;
     case EVENT_KEY_PRESS:
-    {
-        if (tk_shared_game_state.stop_game) {
-            break;
-        }
-        tk_debug_internal(DEBUG_CONTROL_THREAD_DETAIL, "recv key %d down\n", event->data.key);
-        switch (event->data.key) {
-            case KEY_W:
-                SET_FLAG(&(mytankptr->key_value_for_control), mask, TK_KEY_W_ACTIVE);
-                break;
-            case KEY_S:
-                SET_FLAG(&(mytankptr->key_value_for_control), mask, TK_KEY_S_ACTIVE);
-                break;
-            case KEY_A:
-                SET_FLAG(&(mytankptr->key_value_for_control), mask, TK_KEY_A_ACTIVE);
-                break;
-            case KEY_D:
-                SET_FLAG(&(mytankptr->key_value_for_control), mask, TK_KEY_D_ACTIVE);
-                break;
-            case KEY_SPACE:
-                // tk_debug_internal(DEBUG_CONTROL_THREAD_DETAIL, "发射子弹\n");
-                create_shell_for_tank(mytankptr);
-                // break;
-                return;
-        }
-        handle_key(mytankptr, &(mytankptr->key_value_for_control));
-        print_key_value(&(mytankptr->key_value_for_control));
-    }
-    break;
     case EVENT_KEY_RELEASE:
     {
-        if (tk_shared_game_state.stop_game) {
-            break;
-        }
-        tk_debug_internal(DEBUG_CONTROL_THREAD_DETAIL, "recv key %d up\n", event->data.key);
-        switch (event->data.key) {
-            case KEY_W:
-                CLR_FLAG(&(mytankptr->key_value_for_control), mask, TK_KEY_W_ACTIVE);
-                break;
-            case KEY_S:
-                CLR_FLAG(&(mytankptr->key_value_for_control), mask, TK_KEY_S_ACTIVE);
-                break;
-            case KEY_A:
-                CLR_FLAG(&(mytankptr->key_value_for_control), mask, TK_KEY_A_ACTIVE);
-                break;
-            case KEY_D:
-                CLR_FLAG(&(mytankptr->key_value_for_control), mask, TK_KEY_D_ACTIVE);
-                break;
-        }
-        handle_key(mytankptr, &(mytankptr->key_value_for_control));
-        print_key_value(&(mytankptr->key_value_for_control));
+        handle_tank_key_event(gs->my_tank, event);
     }
     break;
     case EVENT_QUIT:
     {
 quit_event_loop:
         tk_debug("recv quit event, stop_event_loop\n");
-        stop_event_loop();
+        stop_event_loop(ctx);
     }
     break;
     }
@@ -325,19 +373,18 @@ quit_event_loop:
 
 // 添加周期定时器事件
 #ifdef ENABLE_EVENT_PRIORITY
-struct event* add_timer_event(int timeout_ms, void (*callback)(void*), void* arg, int priority) {
+static struct event* add_timer_event(struct event_base *base, int timeout_ms, event_callback_fn callback, void* arg, int priority) {
 #else
-struct event* add_timer_event(int timeout_ms, void (*callback)(void*), void* arg) {
+static struct event* add_timer_event(struct event_base *base, int timeout_ms, event_callback_fn callback, void* arg) {
 #endif
-    if (!tk_event_base || !callback) return NULL;
+    if (!base || !callback) return NULL;
     
     // 创建定时器事件
     struct timeval timeout;
     timeout.tv_sec = timeout_ms / 1000;
     timeout.tv_usec = (timeout_ms % 1000) * 1000;
     
-    struct event* timer_event = event_new(tk_event_base, -1, EV_PERSIST, 
-                                         (event_callback_fn)callback, arg);
+    struct event* timer_event = event_new(base, -1, EV_PERSIST, callback, arg);
     if (!timer_event) {
         tk_debug("Error: failed to create timer event\n");
         return NULL;
@@ -355,9 +402,25 @@ struct event* add_timer_event(int timeout_ms, void (*callback)(void*), void* arg
     return timer_event;
 }
 
-void update_game_state_timer_handle() {
-    if (tk_shared_game_state.stop_game) return;
-    tk_debug_internal(DEBUG_EVENT_LOOP, "update_game_state_timer_handle(%u)\n", tk_shared_game_state.game_time);
-    update_muggle_enemy_position();
-    update_all_shell_movement_position();
-}
\ No newline at end of file
+static void update_game_state_timer_handle(evutil_socket_t fd, short what, void *arg) {
+    EventLoopContext *ctx = (EventLoopContext *)arg;
+    uint64_t now_ns = tk_get_monotonic_ns();
+
+    if (ctx->game->stop_game) return;
+    if (ctx->last_tick_ns && (now_ns - ctx->last_tick_ns > (uint64_t)TK_LATE_TICK_MS * 1000000)) {
+        ctx->late_ticks++;
+    }
+    ctx->last_tick_ns = now_ns;
+    tk_debug_internal(DEBUG_EVENT_LOOP, "update_game_state_timer_handle(%lu)\n", ctx->game->tick);
+    game_state_tick(ctx->game);
+    tk_replay_record_tick(ctx->game);
+    if (ctx->on_tick) {
+        ctx->on_tick(ctx);
+    }
+    if (ctx->tick_limit && (ctx->game->tick >= ctx->tick_limit)) { // 对局结束：事件基上没有其他事件时dispatch随之返回
+        event_del(ctx->timer_event);
+        if (ctx->on_finish) {
+            ctx->on_finish(ctx);
+        }
+    }
+}
@@ -2,6 +2,26 @@
 #include <string.h>
 #include <stdlib.h>
 #include "debug.h"
+#include "trace.h"
+
+static tk_uint32_t tk_next_event_id = 0;
+
+// 同tk_lock_acquire()：先尝试一次，只有发生争用且跟踪打开时才记录等待区间
+static void lock_event_queue(EventQueue* queue) {
+    int traced = 0;
+
+    if (pthread_mutex_trylock(&queue->mutex_lock) == 0) {
+        return;
+    }
+    if (TK_TRACE_ON()) {
+        tk_trace_event(TK_TRACE_PH_BEGIN, "event queue", 0, 0, 0);
+        traced = 1;
+    }
+    pthread_mutex_lock(&queue->mutex_lock);
+    if (traced) {
+        tk_trace_event(TK_TRACE_PH_END, "event queue", 0, 0, 0);
+    }
+}
 
 Event* create_event(EventType type) {
     Event* event = (Event *)malloc(sizeof(Event));
@@ -51,7 +71,10 @@ void cleanup_event_queue(EventQueue* queue) {
 void enqueue_event(EventQueue* queue, Event* event) {
     if (!queue || !event) return;
 
-    pthread_mutex_lock(&queue->mutex_lock);
+    event->id = __atomic_add_fetch(&tk_next_event_id, 1, __ATOMIC_RELAXED);
+    TK_TRACE_INSTANT("enqueue", event->id, event->type);
+    TK_TRACE_FLOW_START("event", event->id);
+    lock_event_queue(queue);
     while (queue->count >= TK_EVENT_QUEUE_MAX_ITEM_NUM) {
         tk_debug("警告：事件队列满！(GUI线程)正在等待队列空位的条件锁...\n"); // 当前队列缓存足够大，不可能发生。一旦发生，意味着GUI线程卡住，
         // 这时候可以考虑不要等待条件锁，而是直接丢弃该事件（参考dequeue_event()增加wait参数），避免GUI线程卡死，确保GUI线程主循环能够继续运行下去
@@ -70,7 +93,7 @@ void enqueue_event(EventQueue* queue, Event* event) {
 Event* dequeue_event(EventQueue* queue, tk_uint8_t wait) {
     if (!queue) return NULL;
 
-    pthread_mutex_lock(&queue->mutex_lock);
+    lock_event_queue(queue);
     while (queue->count <= 0) {
         if (!wait) {
             pthread_mutex_unlock(&queue->mutex_lock);
@@ -88,5 +111,7 @@ Event* dequeue_event(EventQueue* queue, tk_uint8_t wait) {
     pthread_cond_signal(&queue->space_available_condition);
     pthread_mutex_unlock(&queue->mutex_lock);
 
+    TK_TRACE_FLOW_END("event", first_event->id);
+    TK_TRACE_INSTANT("dequeue", first_event->id, first_event->type);
     return first_event;
 }
\ No newline at end of file
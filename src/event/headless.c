@@ -0,0 +1,60 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include "headless.h"
+#include "game_state.h"
+#include "profiler.h"
+#include "tk_lock.h"
+#include "tools.h"
+#include "debug.h"
+
+void tk_headless_begin(tk_uint8_t flags) {
+    if (flags & TK_HEADLESS_QUIET_OBJECTS) {
+        tk_debug_object_lifecycle = 0;
+    }
+    if (flags & TK_HEADLESS_THREADED_LOG) {
+        tk_log_start();
+    }
+}
+
+int tk_headless_end(tk_uint8_t flags, int ret) {
+    if (flags & TK_HEADLESS_THREADED_LOG) {
+        tk_log_stop();
+    }
+    if (flags & TK_HEADLESS_PROFILE) {
+        tk_profiler_report();
+    }
+    if (flags & TK_HEADLESS_LOCK_STATS) {
+        tk_lock_report();
+    }
+    tk_debug_object_lifecycle = 1;
+    return ret;
+}
+
+int tk_headless_game_init(GameState *gs, uint32_t seed, tk_uint32_t max_tank_num, tk_uint32_t enemies) {
+    if (init_game_state(gs, seed, tk_rand_seed(seed + 1)) != 0) {
+        return -1;
+    }
+    gs->max_tank_num = max_tank_num;
+    return spawn_muggle_enemies(gs, enemies);
+}
+
+GameState* tk_headless_game_create(uint32_t seed, tk_uint32_t max_tank_num, tk_uint32_t enemies) {
+    GameState *gs = malloc(sizeof(GameState));
+
+    if (!gs) {
+        tk_debug("Error: %s malloc failed\n", __func__);
+        return NULL;
+    }
+    if (tk_headless_game_init(gs, seed, max_tank_num, enemies) != 0) {
+        tk_headless_game_destroy(gs);
+        return NULL;
+    }
+    return gs;
+}
+
+void tk_headless_game_destroy(GameState *gs) {
+    if (gs) {
+        cleanup_game_state(gs);
+        free(gs);
+    }
+}
@@ -0,0 +1,458 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+#include <poll.h>
+#include <time.h>
+#include <pthread.h>
+#include <sys/socket.h>
+#include "lockstep.h"
+#include "headless.h"
+#include "game_state.h"
+#include "net_snapshot.h"
+#include "replay.h"
+#include "profiler.h"
+#include "tools.h"
+#include "debug.h"
+
+#define LOCKSTEP_RX_BUFFER (LOCKSTEP_MSG_BYTES * 32)
+
+typedef struct {
+    tk_uint32_t tick; // 0表示空槽（模拟帧从1开始）
+    tk_uint8_t buttons;
+    uint32_t hash;    // 发送方第tick-input_delay帧结束时的状态哈希
+} LockstepInput;
+
+typedef struct {
+    uint32_t index;
+    pthread_t tid;
+    const LockstepConfig *config;
+    GameState *game;
+    tk_uint8_t game_inited;
+    int fds[LOCKSTEP_MAX_PEERS]; // 与其他对端的连接，自己的位置为-1
+    tk_uint8_t closed[LOCKSTEP_MAX_PEERS];
+    uint8_t rx[LOCKSTEP_MAX_PEERS][LOCKSTEP_RX_BUFFER];
+    uint32_t rx_len[LOCKSTEP_MAX_PEERS];
+    LockstepInput inputs[LOCKSTEP_MAX_PEERS][LOCKSTEP_WINDOW];
+    uint32_t hashes[LOCKSTEP_WINDOW]; // 本地每帧结束时的状态哈希
+    id_handle_t tanks[LOCKSTEP_MAX_PEERS]; // 每个对端操控的坦克（各对端上句柄相同）
+    uint32_t rng_state; // 本地操控脚本的随机数，与对局的随机数发生器无关
+    tk_uint8_t held;
+    uint32_t hold_ticks;
+    // 结果
+    int ok;
+    tk_uint32_t ticks;
+    tk_uint32_t desync_tick; // 检测到的第一个失步帧
+    tk_uint32_t stalled_ticks;
+    uint64_t stall_ns;
+    uint64_t bytes_sent;
+    uint64_t elapsed_ns;
+    tk_uint32_t peak_shells;
+    uint32_t final_hash;
+} LockstepPeer;
+
+static void put_u32(uint8_t *p, uint32_t v) {
+    p[0] = v & 0xff;
+    p[1] = (v >> 8) & 0xff;
+    p[2] = (v >> 16) & 0xff;
+    p[3] = v >> 24;
+}
+
+static uint32_t get_u32(const uint8_t *p) {
+    return p[0] | (p[1] << 8) | (p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+
+static int write_all(int fd, const uint8_t *data, size_t len) {
+    ssize_t n = 0;
+
+    while (len > 0) {
+        n = send(fd, data, len, MSG_NOSIGNAL);
+        if (n < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            return -1;
+        }
+        data += n;
+        len -= n;
+    }
+    return 0;
+}
+
+static tk_uint32_t count_shells(GameState *gs) {
+    tk_uint32_t shells = 0;
+    Tank *tank = NULL;
+    Shell *shell = NULL;
+
+    TAILQ_FOREACH(tank, &gs->tank_list, chain) {
+        TAILQ_FOREACH(shell, &tank->shell_list, chain) {
+            shells++;
+        }
+    }
+    return shells;
+}
+
+// 被击毁的坦克（已删除）按对端顺序重生，敌人补足数量。只依赖对局状态，每个对端上的结果相同
+static int respawn_tanks(LockstepPeer *peer) {
+    GameState *gs = peer->game;
+    char name[TANK_NAME_MAXLEN];
+    Tank *tank = NULL;
+    tk_uint32_t players = 0;
+
+    for (uint32_t i = 0; i < peer->config->peers; i++) {
+        if (get_tank_by_handle(gs, peer->tanks[i])) {
+            players++;
+            continue;
+        }
+        snprintf(name, sizeof(name), "peer-%u", i);
+        tank = create_tank(gs, (tk_uint8_t *)name, get_random_grid_pos_for_tank(gs), 0, TANK_ROLE_REMOTE);
+        if (!tank) {
+            return -1;
+        }
+        peer->tanks[i] = tank->handle;
+        players++;
+    }
+    if (gs->tank_num < players + peer->config->enemies) {
+        return spawn_muggle_enemies(gs, players + peer->config->enemies - gs->tank_num);
+    }
+    return 0;
+}
+
+// 本地操控脚本：随机按住一组方向键若干帧，偶尔开炮
+static tk_uint8_t next_buttons(LockstepPeer *peer) {
+    static const tk_uint8_t masks[] = {0, TK_KEY_W_ACTIVE, TK_KEY_W_ACTIVE, TK_KEY_S_ACTIVE, TK_KEY_A_ACTIVE, TK_KEY_D_ACTIVE,
+        TK_KEY_W_ACTIVE | TK_KEY_A_ACTIVE, TK_KEY_W_ACTIVE | TK_KEY_D_ACTIVE};
+
+    if (peer->hold_ticks == 0) {
+        peer->held = masks[tk_rand_range(&peer->rng_state, 0, sizeof(masks) / sizeof(masks[0]) - 1)];
+        peer->hold_ticks = tk_rand_range(&peer->rng_state, 3, 12);
+    }
+    peer->hold_ticks--;
+    return peer->held | ((tk_rand_range(&peer->rng_state, 0, 7) == 0) ? LOCKSTEP_BUTTON_FIRE : 0);
+}
+
+static int send_input(LockstepPeer *peer, tk_uint32_t tick, tk_uint8_t buttons, uint32_t hash) {
+    uint8_t msg[LOCKSTEP_MSG_BYTES];
+
+    peer->inputs[peer->index][tick % LOCKSTEP_WINDOW] = (LockstepInput){tick, buttons, hash};
+    put_u32(msg, tick);
+    msg[4] = buttons;
+    put_u32(msg + 5, hash);
+    for (uint32_t i = 0; i < peer->config->peers; i++) {
+        if (i == peer->index) {
+            continue;
+        }
+        if (write_all(peer->fds[i], msg, sizeof(msg)) != 0) {
+            tk_debug("Error: send input of tick %lu to peer %u failed: %s\n", tick, i, strerror(errno));
+            return -1;
+        }
+        peer->bytes_sent += sizeof(msg);
+    }
+    return 0;
+}
+
+static int receive_inputs(LockstepPeer *peer, uint32_t from) {
+    uint8_t *rx = peer->rx[from];
+    uint32_t pos = 0;
+    tk_uint32_t tick = 0;
+    ssize_t n = 0;
+
+    n = read(peer->fds[from], rx + peer->rx_len[from], LOCKSTEP_RX_BUFFER - peer->rx_len[from]);
+    if (n <= 0) {
+        if ((n < 0) && (errno == EINTR)) {
+            return 0;
+        }
+        peer->closed[from] = 1;
+        return 0;
+    }
+    peer->rx_len[from] += n;
+    for (pos = 0; pos + LOCKSTEP_MSG_BYTES <= peer->rx_len[from]; pos += LOCKSTEP_MSG_BYTES) {
+        tick = get_u32(rx + pos);
+        peer->inputs[from][tick % LOCKSTEP_WINDOW] = (LockstepInput){tick, rx[pos + 4], get_u32(rx + pos + 5)};
+    }
+    memmove(rx, rx + pos, peer->rx_len[from] - pos);
+    peer->rx_len[from] -= pos;
+    return 0;
+}
+
+static int all_inputs_ready(LockstepPeer *peer, tk_uint32_t tick) {
+    for (uint32_t i = 0; i < peer->config->peers; i++) {
+        if (peer->inputs[i][tick % LOCKSTEP_WINDOW].tick != tick) {
+            return 0;
+        }
+    }
+    return 1;
+}
+
+// 停顿直到所有对端第tick帧的输入到齐
+static int wait_for_inputs(LockstepPeer *peer, tk_uint32_t tick) {
+    struct pollfd pfds[LOCKSTEP_MAX_PEERS];
+    uint32_t from[LOCKSTEP_MAX_PEERS];
+    uint64_t start_ns = 0;
+    int nfds = 0, ret = 0;
+
+    if (all_inputs_ready(peer, tick)) {
+        return 0;
+    }
+    peer->stalled_ticks++;
+    start_ns = tk_get_monotonic_ns();
+    while (!all_inputs_ready(peer, tick)) {
+        nfds = 0;
+        for (uint32_t i = 0; i < peer->config->peers; i++) {
+            if (peer->inputs[i][tick % LOCKSTEP_WINDOW].tick == tick) {
+                continue;
+            }
+            if (peer->closed[i]) {
+                tk_debug("Error: peer %u left before sending input of tick %lu\n", i, tick);
+                return -1;
+            }
+            pfds[nfds] = (struct pollfd){peer->fds[i], POLLIN, 0};
+            from[nfds++] = i;
+        }
+        ret = poll(pfds, nfds, LOCKSTEP_STALL_TIMEOUT_MS);
+        if (ret < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            return -1;
+        } else if (ret == 0) {
+            tk_debug("Error: stalled %dms waiting for input of tick %lu\n", LOCKSTEP_STALL_TIMEOUT_MS, tick);
+            return -1;
+        }
+        for (int i = 0; i < nfds; i++) {
+            if (pfds[i].revents) {
+                receive_inputs(peer, from[i]);
+            }
+        }
+    }
+    peer->stall_ns += tk_get_monotonic_ns() - start_ns;
+    return 0;
+}
+
+// 各对端输入按对端顺序生效，然后推进一个模拟帧
+static void step(LockstepPeer *peer, tk_uint32_t tick) {
+    const LockstepInput *input = NULL;
+    Tank *tank = NULL;
+
+    for (uint32_t i = 0; i < peer->config->peers; i++) {
+        input = &peer->inputs[i][tick % LOCKSTEP_WINDOW];
+        tank = get_tank_by_handle(peer->game, peer->tanks[i]);
+        if (!tank || !TST_FLAG(tank, flags, TANK_ALIVE)) {
+            continue;
+        }
+        tank->key_value_for_control.mask = input->buttons & (TK_KEY_W_ACTIVE | TK_KEY_A_ACTIVE | TK_KEY_S_ACTIVE | TK_KEY_D_ACTIVE);
+        if (tank->key_value_for_control.mask) {
+            handle_key(tank, &tank->key_value_for_control);
+        }
+        if (input->buttons & LOCKSTEP_BUTTON_FIRE) {
+            create_shell_for_tank(tank);
+        }
+    }
+    game_state_tick(peer->game);
+}
+
+static int run_peer(LockstepPeer *peer) {
+    const LockstepConfig *config = peer->config;
+    GameState *gs = peer->game;
+    const LockstepInput *input = NULL;
+    tk_uint32_t delay = config->input_delay;
+    tk_uint32_t tick = 0;
+    Tank *tank = NULL;
+
+    peer->game_inited = 1; // 初始化失败也需要清理
+    if (tk_headless_game_init(gs, config->seed, config->peers + config->enemies, 0) != 0) {
+        return -1;
+    }
+    if (respawn_tanks(peer) != 0) {
+        return -1;
+    }
+    peer->rng_state = tk_rand_seed(config->seed + 100 + peer->index);
+    peer->hashes[0] = tk_game_state_hash(gs);
+    // 开局的前delay-1帧没有人来得及产生输入，各对端一致视为空输入
+    for (tick = 1; tick < delay; tick++) {
+        for (uint32_t i = 0; i < config->peers; i++) {
+            peer->inputs[i][tick % LOCKSTEP_WINDOW] = (LockstepInput){tick, 0, 0};
+        }
+    }
+
+    for (tick = 1; tick <= config->duration; tick++) {
+        if ((tick - 1 + delay <= config->duration) &&
+            (send_input(peer, tick - 1 + delay, next_buttons(peer), peer->hashes[(tick - 1) % LOCKSTEP_WINDOW]) != 0)) {
+            return -1;
+        }
+        if (wait_for_inputs(peer, tick) != 0) {
+            return -1;
+        }
+        if (tick >= delay) {
+            for (uint32_t i = 0; i < config->peers; i++) {
+                input = &peer->inputs[i][tick % LOCKSTEP_WINDOW];
+                if ((i != peer->index) && (input->hash != peer->hashes[(tick - delay) % LOCKSTEP_WINDOW])) {
+                    peer->desync_tick = tick - delay;
+                    tk_debug("Error: desync with peer %u at tick %lu (state hash %08x, peer %08x)\n", i, peer->desync_tick,
+                        peer->hashes[(tick - delay) % LOCKSTEP_WINDOW], input->hash);
+                    return -1;
+                }
+            }
+        }
+        if (respawn_tanks(peer) != 0) {
+            return -1;
+        }
+        step(peer, tick);
+        if ((tick == config->desync_tick) && (peer->index == config->peers - 1) &&
+            (tank = get_tank_by_handle(gs, peer->tanks[peer->index]))) {
+            tank->position.x += 1;
+        }
+        peer->hashes[tick % LOCKSTEP_WINDOW] = tk_game_state_hash(gs);
+        peer->peak_shells = MAX(peer->peak_shells, count_shells(gs));
+        peer->ticks = tick;
+        if (config->jitter_ms) {
+            usleep(tk_rand_range(&peer->rng_state, 0, config->jitter_ms) * 1000);
+        }
+    }
+    peer->final_hash = peer->hashes[config->duration % LOCKSTEP_WINDOW];
+    return 0;
+}
+
+static void* lockstep_peer_thread(void *arg) {
+    LockstepPeer *peer = (LockstepPeer *)arg;
+    char name[32];
+    uint64_t start_ns = 0;
+
+    snprintf(name, sizeof(name), "peer-%u", peer->index);
+    reset_debug_prefix(name);
+    start_ns = tk_get_monotonic_ns();
+    peer->ok = (run_peer(peer) == 0);
+    peer->elapsed_ns = tk_get_monotonic_ns() - start_ns;
+    if (!peer->ok) { // 让其他对端尽快发现（而不是等到停顿超时）
+        for (uint32_t i = 0; i < peer->config->peers; i++) {
+            if (i != peer->index) {
+                shutdown(peer->fds[i], SHUT_RDWR);
+            }
+        }
+    }
+    return NULL;
+}
+
+// 状态复制方式下同一局面一帧完整快照的大小，与锁步的带宽对照
+static int snapshot_bytes(GameState *gs) {
+    static uint8_t buf[TK_SNAPSHOT_MAX_BYTES];
+    Snapshot *snap = malloc(sizeof(Snapshot));
+    int len = -1;
+
+    if (snap && (tk_snapshot_capture(snap, gs) == 0)) {
+        len = tk_snapshot_encode(snap, NULL, buf, sizeof(buf));
+    }
+    free(snap);
+    return len;
+}
+
+int tk_run_lockstep(const LockstepConfig *config) {
+    LockstepPeer *peers = NULL;
+    int fds[2];
+    uint32_t started = 0, failed = 0, desync_tick = 0, mismatched = 0;
+    uint64_t bytes_sent = 0;
+    tk_uint32_t ticks = 0;
+    int full_bytes = -1, ret = -1;
+
+    if ((config->peers < 2) || (config->peers > LOCKSTEP_MAX_PEERS)) {
+        tk_debug("Error: lockstep needs 2~%d peers\n", LOCKSTEP_MAX_PEERS);
+        return -1;
+    }
+    if ((config->input_delay < 1) || (config->input_delay > LOCKSTEP_MAX_INPUT_DELAY)) {
+        tk_debug("Error: input delay must be 1~%d ticks\n", LOCKSTEP_MAX_INPUT_DELAY);
+        return -1;
+    }
+    peers = calloc(config->peers, sizeof(LockstepPeer));
+    if (!peers) {
+        return -1;
+    }
+    for (uint32_t i = 0; i < config->peers; i++) {
+        peers[i].index = i;
+        peers[i].config = config;
+        peers[i].game = calloc(1, sizeof(GameState));
+        if (!peers[i].game) {
+            goto out;
+        }
+        for (uint32_t j = 0; j < LOCKSTEP_MAX_PEERS; j++) {
+            peers[i].fds[j] = -1;
+        }
+    }
+    for (uint32_t i = 0; i < config->peers; i++) {
+        for (uint32_t j = i + 1; j < config->peers; j++) {
+            if (socketpair(AF_UNIX, SOCK_STREAM, 0, fds) != 0) {
+                tk_debug("Error: socketpair failed: %s\n", strerror(errno));
+                goto out;
+            }
+            peers[i].fds[j] = fds[0];
+            peers[j].fds[i] = fds[1];
+        }
+    }
+    tk_debug("lockstep: %u peers, map %dx%d, %u enemies, input delay %u ticks, jitter %ums, run %u ticks, seed %u\n",
+        config->peers, HORIZON_GRID_NUMBER, VERTICAL_GRID_NUMBER, config->enemies, config->input_delay, config->jitter_ms,
+        config->duration, config->seed);
+
+    for (uint32_t i = 0; i < config->peers; i++) {
+        if (pthread_create(&peers[i].tid, NULL, lockstep_peer_thread, &peers[i]) != 0) {
+            tk_debug("Error: failed to create lockstep peer thread %u\n", i);
+            break;
+        }
+        started++;
+    }
+    for (uint32_t i = 0; i < started; i++) {
+        pthread_join(peers[i].tid, NULL);
+    }
+    if (started == config->peers) {
+        full_bytes = snapshot_bytes(peers[0].game);
+    }
+
+    tk_log_flush();
+    printf("%5s %6s %8s %9s %10s %12s %8s %8s\n", "peer", "ticks", "stalled", "stall(ms)", "ticks/s", "sent(B/tick)", "shells", "hash");
+    for (uint32_t i = 0; i < config->peers; i++) {
+        LockstepPeer *peer = &peers[i];
+        if (!peer->ok) {
+            failed++;
+        }
+        if (peer->desync_tick && (!desync_tick || (peer->desync_tick < desync_tick))) {
+            desync_tick = peer->desync_tick;
+        }
+        if (peer->ok && (peer->final_hash != peers[0].final_hash)) {
+            mismatched++;
+        }
+        bytes_sent += peer->bytes_sent;
+        ticks += peer->ticks;
+        printf("%5u %6lu %8lu %9.1f %10.1f %12.1f %8lu %08x%s\n", i, peer->ticks, peer->stalled_ticks, peer->stall_ns / 1e6,
+            peer->elapsed_ns ? peer->ticks * 1e9 / peer->elapsed_ns : 0.0, peer->ticks ? (double)peer->bytes_sent / peer->ticks : 0.0,
+            peer->peak_shells, peer->final_hash, peer->ok ? "" : "  (failed)");
+    }
+    tk_debug("lockstep done: %u/%u peers finished, %u final hash mismatches, %.1f B/tick per peer pair\n",
+        config->peers - failed, config->peers, mismatched, ticks ? (double)bytes_sent / ticks / (config->peers - 1) : 0.0);
+    if (full_bytes >= 0) {
+        tk_debug("state replication would send a %d B full snapshot for the final tick alone\n", full_bytes);
+    } else {
+        tk_debug("the final tick exceeds the state snapshot capacity(%d tanks, %d shells)\n", TK_SNAPSHOT_MAX_TANKS, TK_SNAPSHOT_MAX_SHELLS);
+    }
+    if (desync_tick) {
+        tk_debug("first desync at tick %u (injected at tick %u)\n", desync_tick, config->desync_tick);
+    }
+    if (config->desync_tick) {
+        ret = (desync_tick == config->desync_tick) ? 0 : -1;
+    } else {
+        ret = (failed || mismatched) ? -1 : 0;
+    }
+
+out:
+    for (uint32_t i = 0; i < config->peers; i++) {
+        for (uint32_t j = 0; j < LOCKSTEP_MAX_PEERS; j++) {
+            if (peers[i].fds[j] >= 0) {
+                close(peers[i].fds[j]);
+            }
+        }
+        if (peers[i].game_inited) {
+            cleanup_game_state(peers[i].game);
+        }
+        free(peers[i].game);
+    }
+    free(peers);
+    return ret;
+}
@@ -0,0 +1,195 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+#include "match_runner.h"
+#include "headless.h"
+#include "event_loop.h"
+#include "game_state.h"
+#include "replay.h"
+#include "tools.h"
+#include "trace.h"
+#include "debug.h"
+
+// 一局游戏：状态与事件循环上下文都在堆上，由所属工作线程创建、推进和释放
+typedef struct {
+    GameState game;
+    EventLoopContext loop;
+    uint32_t index;
+    uint32_t seed;
+    int ok;
+    // 结果
+    tk_uint32_t ticks;
+    tk_uint32_t late_ticks;
+    tk_uint32_t tanks_alive;
+    tk_uint32_t shells;
+    int my_tank_alive;
+    uint32_t state_hash;
+} Match;
+
+typedef struct {
+    uint32_t id;
+    pthread_t tid;
+    const MatchRunnerConfig *config;
+    Match *matches; // 分到本线程的对局（连续一段）
+    uint32_t match_num;
+    uint32_t running; // 尚未结束的对局数
+    uint64_t elapsed_ns;
+} MatchWorker;
+
+static int setup_match(Match *match, const MatchRunnerConfig *config, struct event_base *base) {
+    GameState *gs = &match->game;
+
+    if (tk_headless_game_init(gs, match->seed, config->enemies + 1, 0) != 0) {
+        return -1;
+    }
+    if (config->fire_interval) {
+        gs->muggle_shoot_interval = config->fire_interval;
+    }
+    if (start_new_game(gs) != 0) { // 一辆我的坦克（原地不动）和muggle-0
+        return -1;
+    }
+    if ((config->enemies > 1) && (spawn_muggle_enemies(gs, config->enemies - 1) != 0)) {
+        return -1;
+    }
+    if (init_event_loop(&match->loop, gs, base) != 0) {
+        return -1;
+    }
+    match->loop.tick_limit = config->duration;
+    return 0;
+}
+
+static void collect_match_result(Match *match) {
+    GameState *gs = &match->game;
+    Tank *tank = NULL;
+    Shell *shell = NULL;
+
+    match->ticks = gs->tick;
+    match->late_ticks = match->loop.late_ticks;
+    match->my_tank_alive = gs->my_tank && TST_FLAG(gs->my_tank, flags, TANK_ALIVE);
+    TAILQ_FOREACH(tank, &gs->tank_list, chain) {
+        if (TST_FLAG(tank, flags, TANK_ALIVE)) {
+            match->tanks_alive++;
+        }
+        TAILQ_FOREACH(shell, &tank->shell_list, chain) {
+            match->shells++;
+        }
+    }
+    match->state_hash = tk_game_state_hash(gs);
+    match->ok = (match->ticks == match->loop.tick_limit);
+}
+
+static void match_finished(void *arg) {
+    EventLoopContext *loop = (EventLoopContext *)arg;
+    MatchWorker *worker = (MatchWorker *)loop->user_data;
+
+    worker->running--; // 最后一局结束后事件基上已没有事件，dispatch返回
+}
+
+static void* match_worker_thread(void *arg) {
+    MatchWorker *worker = (MatchWorker *)arg;
+    struct event_base *base = NULL;
+    char name[32];
+    uint64_t start_ns = 0;
+    uint32_t i = 0;
+
+    snprintf(name, sizeof(name), "match-%u", worker->id);
+    reset_debug_prefix(name);
+    tk_trace_thread_name(name);
+    base = event_base_new();
+    if (!base) {
+        tk_debug("Error: failed to create event base\n");
+        return NULL;
+    }
+    for (i = 0; i < worker->match_num; i++) {
+        if (setup_match(&worker->matches[i], worker->config, base) != 0) {
+            tk_debug("Error: failed to set up match %u\n", worker->matches[i].index);
+            goto out;
+        }
+        worker->matches[i].loop.on_finish = match_finished;
+        worker->matches[i].loop.user_data = worker;
+        worker->running++;
+    }
+    start_ns = tk_get_monotonic_ns();
+    event_base_dispatch(base);
+    worker->elapsed_ns = tk_get_monotonic_ns() - start_ns;
+    if (worker->running) {
+        tk_debug("Error: event loop exited with %u matches still running\n", worker->running);
+    }
+
+out:
+    for (i = 0; i < worker->match_num; i++) {
+        if (worker->matches[i].loop.timer_event) {
+            collect_match_result(&worker->matches[i]);
+        }
+        cleanup_event_loop(&worker->matches[i].loop); // 未能建立的对局没有初始化事件循环上下文，为空操作
+        cleanup_game_state(&worker->matches[i].game);
+    }
+    event_base_free(base);
+    return NULL;
+}
+
+int tk_run_matches(const MatchRunnerConfig *config) {
+    MatchWorker workers[MATCH_RUNNER_MAX_THREADS];
+    Match *matches = NULL;
+    uint32_t threads = config->threads ? config->threads : config->matches;
+    uint32_t next = 0, per_thread = 0, extra = 0, failed = 0, started = 0;
+    tk_uint32_t total_ticks = 0, late_ticks = 0;
+    uint64_t elapsed_ns = 0;
+
+    if ((config->matches == 0) || (config->duration == 0)) {
+        return -1;
+    }
+    threads = MIN(MIN(threads, config->matches), MATCH_RUNNER_MAX_THREADS);
+    matches = calloc(config->matches, sizeof(Match));
+    if (!matches) {
+        tk_debug("Error: %s calloc %u matches failed\n", __func__, config->matches);
+        return -1;
+    }
+    tk_debug("match runner: %u matches on %u threads, map %dx%d, %u enemies each, run %u ticks(%us game time), seed %u\n",
+        config->matches, threads, HORIZON_GRID_NUMBER, VERTICAL_GRID_NUMBER, config->enemies, config->duration,
+        config->duration * TK_TICK_MS / 1000, config->seed);
+
+    per_thread = config->matches / threads;
+    extra = config->matches % threads;
+    memset(workers, 0, sizeof(workers));
+    for (uint32_t i = 0; i < threads; i++) {
+        workers[i].id = i;
+        workers[i].config = config;
+        workers[i].matches = &matches[next];
+        workers[i].match_num = per_thread + ((i < extra) ? 1 : 0);
+        for (uint32_t j = 0; j < workers[i].match_num; j++) {
+            matches[next + j].index = next + j;
+            matches[next + j].seed = config->seed + next + j;
+        }
+        next += workers[i].match_num;
+        if (pthread_create(&workers[i].tid, NULL, match_worker_thread, &workers[i]) != 0) {
+            tk_debug("Error: failed to create match worker thread %u\n", i);
+            break;
+        }
+        started++;
+    }
+    for (uint32_t i = 0; i < started; i++) {
+        pthread_join(workers[i].tid, NULL);
+        elapsed_ns = MAX(elapsed_ns, workers[i].elapsed_ns);
+    }
+
+    tk_log_flush();
+    printf("%6s %10s %6s %6s %6s %6s %6s %8s\n", "match", "seed", "ticks", "late", "tanks", "shells", "mine", "hash");
+    for (uint32_t i = 0; i < config->matches; i++) {
+        Match *match = &matches[i];
+        if (!match->ok) {
+            failed++;
+        }
+        total_ticks += match->ticks;
+        late_ticks += match->late_ticks;
+        printf("%6u %10u %6lu %6lu %6lu %6lu %6s %08x%s\n", match->index, match->seed, match->ticks, match->late_ticks,
+            match->tanks_alive, match->shells, match->my_tank_alive ? "alive" : "dead", match->state_hash,
+            match->ok ? "" : "  (failed)");
+    }
+    tk_debug("match runner done: %u/%u matches finished, %lu ticks in %.3fs (%.1f ticks/s), %lu late ticks(>%dms apart)\n",
+        config->matches - failed, config->matches, total_ticks, elapsed_ns / 1e9,
+        elapsed_ns ? total_ticks * 1e9 / elapsed_ns : 0.0, late_ticks, TK_LATE_TICK_MS);
+    free(matches);
+    return failed ? -1 : 0;
+}
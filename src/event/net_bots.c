@@ -0,0 +1,312 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <event2/event.h>
+#include "net_server.h"
+#include "net_protocol.h"
+#include "net_snapshot.h"
+#include "net_predict.h"
+#include "event_queue.h"
+#include "game_state.h"
+#include "tools.h"
+#include "debug.h"
+
+#define NET_BOT_NO_KEY 0xff
+
+struct _NetBots;
+
+typedef struct {
+    struct _NetBots *bots;
+    struct bufferevent *bev;
+    uint32_t index;
+    uint32_t rng_state;
+    uint32_t tank_id;     // 0表示还没收到WELCOME
+    uint8_t held_key;     // 当前按住的方向键
+    uint8_t tank_present; // 最近一帧世界状态中是否有自己的坦克
+    uint8_t done;
+    Predictor predictor; // 预测自己的坦克，统计预测错误
+    Snapshot *history; // 解码出的最近TK_SNAPSHOT_HISTORY帧，服务器以其中已确认的一帧为差分基准
+    uint32_t states;
+    uint32_t full_states;
+    uint32_t last_tick;
+    uint64_t bytes;
+    uint32_t bad_states;
+    uint32_t respawns;
+} NetBot;
+
+typedef struct _NetBots {
+    const NetBotsConfig *config;
+    struct event_base *base;
+    struct event *input_timer;
+    NetBot *bot_list;
+    uint32_t running;
+    uint32_t failures;
+} NetBots;
+
+static uint8_t tk_net_bots_payload[TK_NET_MAX_PAYLOAD];
+
+static void bot_finish(NetBot *bot, int failed) {
+    NetBots *bots = bot->bots;
+
+    if (bot->done) {
+        return;
+    }
+    bot->done = 1;
+    bots->failures += failed;
+    bufferevent_free(bot->bev);
+    bot->bev = NULL;
+    if (--bots->running == 0) {
+        event_base_loopexit(bots->base, NULL);
+    }
+}
+
+static void bot_send_input(NetBot *bot, uint8_t type, uint8_t key) {
+    struct evbuffer *payload = evbuffer_new();
+
+    if (!payload) {
+        return;
+    }
+    tk_net_put_u8(payload, type);
+    tk_net_put_u8(payload, key);
+    tk_net_put_u32(payload, tk_predict_input(&bot->predictor, type, key));
+    tk_net_frame_message(bufferevent_get_output(bot->bev), TK_NET_MSG_INPUT, payload);
+    evbuffer_free(payload);
+}
+
+static void bot_send_hello(NetBot *bot) {
+    struct evbuffer *payload = evbuffer_new();
+    char name[TANK_NAME_MAXLEN];
+
+    if (!payload) {
+        return;
+    }
+    snprintf(name, sizeof(name), "bot-%u", bot->index);
+    tk_net_put_u8(payload, TK_NET_VERSION);
+    evbuffer_add(payload, name, strlen(name));
+    tk_net_frame_message(bufferevent_get_output(bot->bev), TK_NET_MSG_HELLO, payload);
+    evbuffer_free(payload);
+}
+
+static void bot_send_ack(NetBot *bot, uint32_t tick) {
+    struct evbuffer *payload = evbuffer_new();
+
+    if (!payload) {
+        return;
+    }
+    tk_net_put_u32(payload, tick);
+    tk_net_frame_message(bufferevent_get_output(bot->bev), TK_NET_MSG_ACK, payload);
+    evbuffer_free(payload);
+}
+
+// 找到服务器所用的基准后解码（帧号必须递增），再校正预测的坦克
+static int bot_decode_state(NetBot *bot, const uint8_t *data, uint32_t len) {
+    NetReader reader = {data, len, 0, 0};
+    uint32_t input_seq = tk_net_get_u32(&reader);
+    const Snapshot *baseline = NULL;
+    Snapshot *snap = NULL;
+    uint32_t tick = 0, baseline_tick = 0;
+    int has_baseline = 0;
+
+    if (reader.error) {
+        return -1;
+    }
+    data += reader.pos;
+    len -= reader.pos;
+    has_baseline = tk_snapshot_peek(data, len, &tick, &baseline_tick);
+    if ((has_baseline < 0) || (bot->states && (tick <= bot->last_tick))) {
+        return -1;
+    }
+    if (has_baseline) {
+        baseline = &bot->history[baseline_tick % TK_SNAPSHOT_HISTORY];
+        if ((tick - baseline_tick >= TK_SNAPSHOT_HISTORY) || (baseline->tick != baseline_tick)) {
+            return -1;
+        }
+    } else {
+        bot->full_states++;
+    }
+    snap = &bot->history[tick % TK_SNAPSHOT_HISTORY];
+    if (tk_snapshot_decode(data, len, baseline, snap) != 0) {
+        snap->tick = 0;
+        return -1;
+    }
+    bot->last_tick = tick;
+    bot->tank_present = (tk_snapshot_find_tank(snap, bot->tank_id) != NULL);
+    tk_predict_reconcile(&bot->predictor, input_seq, snap);
+    bot_send_ack(bot, tick);
+    return 0;
+}
+
+static void bot_read_cb(struct bufferevent *bev, void *arg) {
+    NetBot *bot = (NetBot *)arg;
+    struct evbuffer *input = bufferevent_get_input(bev);
+    NetReader reader;
+    uint32_t maze_seed = 0;
+    uint8_t type = 0;
+    uint16_t len = 0;
+
+    while (!bot->done && (tk_net_read_message(input, &type, tk_net_bots_payload, &len) == 1)) {
+        reader = (NetReader){tk_net_bots_payload, len, 0, 0};
+        bot->bytes += TK_NET_HEADER_LEN + len;
+        if (type == TK_NET_MSG_WELCOME) {
+            reader.pos = 4; // 跳过版本、地图尺寸与帧间隔
+            maze_seed = tk_net_get_u32(&reader);
+            bot->respawns += (bot->tank_id != 0);
+            bot->tank_id = tk_net_get_u32(&reader);
+            if (!bot->predictor.game && (tk_predict_init(&bot->predictor, maze_seed) != 0)) {
+                bot_finish(bot, 1);
+                break;
+            }
+            tk_predict_set_tank(&bot->predictor, bot->tank_id);
+            bot->tank_present = 1;
+        } else if (type == TK_NET_MSG_STATE) {
+            if (bot_decode_state(bot, tk_net_bots_payload, len) != 0) {
+                bot->bad_states++;
+            }
+            if (++bot->states >= bot->bots->config->duration) {
+                bot_finish(bot, bot->bad_states != 0);
+            }
+        } else if (type == TK_NET_MSG_REJECT) {
+            tk_debug("bot-%u rejected by server, reason %u\n", bot->index, tk_net_get_u8(&reader));
+            bot_finish(bot, 1);
+        }
+    }
+}
+
+static void bot_event_cb(struct bufferevent *bev, short what, void *arg) {
+    NetBot *bot = (NetBot *)arg;
+    int one = 1;
+
+    if (what & BEV_EVENT_CONNECTED) {
+        setsockopt(bufferevent_getfd(bev), IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+        bot_send_hello(bot);
+    } else if (what & (BEV_EVENT_EOF | BEV_EVENT_ERROR)) {
+        tk_debug("bot-%u lost connection after %u states\n", bot->index, bot->states);
+        bot_finish(bot, 1);
+    }
+}
+
+// 每个逻辑帧：和GUI线程一样重发按住的方向键，偶尔换方向、开火，被击毁后请求重生
+static void bots_input_timer_cb(evutil_socket_t fd, short what, void *arg) {
+    NetBots *bots = (NetBots *)arg;
+    NetBot *bot = NULL;
+    uint8_t key = 0;
+
+    for (uint32_t i = 0; i < bots->config->bots; i++) {
+        bot = &bots->bot_list[i];
+        if (bot->done || !bot->tank_id) {
+            continue;
+        }
+        if (!bot->tank_present) {
+            bot_send_input(bot, EVENT_GAME_RESTART, 0); // 坦克仍在DYING时服务器会忽略，下一帧再发
+            bot->tank_present = 1;
+            continue;
+        }
+        if (tk_rand_range(&bot->rng_state, 0, 9) == 0) {
+            if (bot->held_key != NET_BOT_NO_KEY) {
+                bot_send_input(bot, EVENT_KEY_RELEASE, bot->held_key);
+            }
+            key = tk_rand_range(&bot->rng_state, KEY_LEFT, KEY_BACKWARD + 1);
+            bot->held_key = (key > KEY_BACKWARD) ? NET_BOT_NO_KEY : key;
+        }
+        if (bot->held_key != NET_BOT_NO_KEY) {
+            bot_send_input(bot, EVENT_KEY_PRESS, bot->held_key);
+        }
+        if (tk_rand_range(&bot->rng_state, 0, 19) == 0) {
+            bot_send_input(bot, EVENT_KEY_PRESS, KEY_SPACE);
+            bot_send_input(bot, EVENT_KEY_RELEASE, KEY_SPACE);
+        }
+    }
+}
+
+int tk_run_net_bots(const NetBotsConfig *config) {
+    NetBots bots;
+    NetBot *bot = NULL;
+    struct sockaddr_storage addr;
+    int addr_len = sizeof(addr);
+    struct timeval interval = {RENDER_FPS_MS / 1000, (RENDER_FPS_MS % 1000) * 1000};
+    uint64_t total_bytes = 0;
+    uint64_t total_states = 0, full_states = 0;
+    uint32_t bad_states = 0;
+    uint32_t respawns = 0, reconciles = 0, rewinds = 0, corrections = 0;
+    tk_float32_t max_correction_px = 0;
+    int ret = -1;
+
+    memset(&bots, 0, sizeof(bots));
+    bots.config = config;
+    memset(&addr, 0, sizeof(addr));
+    if (evutil_parse_sockaddr_port(config->address, (struct sockaddr *)&addr, &addr_len) != 0) {
+        tk_debug("Error: invalid server address %s\n", config->address);
+        return -1;
+    }
+    bots.bot_list = calloc(config->bots, sizeof(NetBot));
+    bots.base = event_base_new();
+    if (!bots.bot_list || !bots.base) {
+        goto out;
+    }
+    for (uint32_t i = 0; i < config->bots; i++) {
+        bot = &bots.bot_list[i];
+        bot->bots = &bots;
+        bot->index = i;
+        bot->rng_state = tk_rand_seed(config->seed + i);
+        bot->held_key = NET_BOT_NO_KEY;
+        bot->history = calloc(TK_SNAPSHOT_HISTORY, sizeof(Snapshot));
+        if (!bot->history) {
+            goto out;
+        }
+        bot->bev = bufferevent_socket_new(bots.base, -1, BEV_OPT_CLOSE_ON_FREE);
+        if (!bot->bev) {
+            goto out;
+        }
+        bots.running++;
+        bufferevent_setcb(bot->bev, bot_read_cb, NULL, bot_event_cb, bot);
+        bufferevent_enable(bot->bev, EV_READ | EV_WRITE);
+        if (bufferevent_socket_connect(bot->bev, (struct sockaddr *)&addr, addr_len) != 0) {
+            bot_finish(bot, 1);
+        }
+    }
+    bots.input_timer = event_new(bots.base, -1, EV_PERSIST, bots_input_timer_cb, &bots);
+    if (!bots.input_timer || (event_add(bots.input_timer, &interval) != 0)) {
+        goto out;
+    }
+    if (bots.running) {
+        event_base_dispatch(bots.base);
+    }
+
+    for (uint32_t i = 0; i < config->bots; i++) {
+        bot = &bots.bot_list[i];
+        total_bytes += bot->bytes;
+        total_states += bot->states;
+        full_states += bot->full_states;
+        reconciles += bot->predictor.reconciles;
+        rewinds += bot->predictor.rewinds;
+        corrections += bot->predictor.corrections;
+        max_correction_px = MAX(max_correction_px, bot->predictor.max_correction_px);
+        bad_states += bot->bad_states;
+        respawns += bot->respawns;
+    }
+    tk_debug("%u bots: %lu states received(%lu full, %.1f KB, %.0f B/state), %u bad states, %u respawns, %u failures\n",
+        config->bots, (unsigned long)total_states, (unsigned long)full_states, total_bytes / 1024.0,
+        total_states ? (double)total_bytes / total_states : 0.0, bad_states, respawns, bots.failures);
+    tk_debug("prediction: %u reconciles, %u rewinds, %u corrections(max %.2f px)\n", reconciles, rewinds, corrections,
+        max_correction_px);
+    ret = bots.failures ? -1 : 0;
+
+out:
+    for (uint32_t i = 0; bots.bot_list && (i < config->bots); i++) {
+        if (bots.bot_list[i].bev) {
+            bufferevent_free(bots.bot_list[i].bev);
+        }
+        free(bots.bot_list[i].history);
+        tk_predict_cleanup(&bots.bot_list[i].predictor);
+    }
+    if (bots.input_timer) {
+        event_free(bots.input_timer);
+    }
+    if (bots.base) {
+        event_base_free(bots.base);
+    }
+    free(bots.bot_list);
+    return ret;
+}
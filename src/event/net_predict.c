@@ -0,0 +1,149 @@
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include "net_predict.h"
+#include "event_loop.h"
+#include "tools.h"
+#include "debug.h"
+
+int tk_predict_init(Predictor *p, uint32_t maze_seed) {
+    memset(p, 0, sizeof(Predictor));
+    p->next_seq = 1;
+    p->game = malloc(sizeof(GameState));
+    if (!p->game) {
+        return -1;
+    }
+    if (init_game_state(p->game, maze_seed, tk_rand_seed(maze_seed + 1)) != 0) { // 同一个maze_seed生成同一张地图
+        cleanup_game_state(p->game);
+        free(p->game);
+        p->game = NULL;
+        return -1;
+    }
+    return 0;
+}
+
+void tk_predict_cleanup(Predictor *p) {
+    if (!p->game) {
+        return;
+    }
+    cleanup_game_state(p->game);
+    free(p->game);
+    p->game = NULL;
+    p->tank = NULL;
+}
+
+static void drop_tank(Predictor *p) {
+    if (p->tank) {
+        delete_tank(p->tank, 1);
+        p->tank = NULL;
+    }
+}
+
+void tk_predict_set_tank(Predictor *p, tk_uint32_t tank_id) {
+    drop_tank(p);
+    p->tank_id = tank_id;
+    p->key_value.mask = 0; // 服务器上的新坦克没有按住的方向键
+    p->acked_mask = 0;
+    p->acked_has_state = 0;
+}
+
+tk_uint32_t tk_predict_input(Predictor *p, EventType type, KeyCode key) {
+    PredictedInput *input = &p->inputs[p->next_seq % TK_PREDICT_HISTORY];
+    Event event;
+
+    memset(&event, 0, sizeof(event));
+    event.type = type;
+    event.data.key = key;
+    input->seq = p->next_seq;
+    input->moves = update_key_value(&p->key_value, &event); // 与服务器上handle_tank_key_event()的处理一致
+    input->mask = p->key_value.mask;
+    input->has_state = (p->tank != NULL);
+    if (p->tank) {
+        if (input->moves) {
+            p->tank->key_value_for_control = p->key_value;
+            handle_key(p->tank, &p->tank->key_value_for_control);
+        }
+        input->position = p->tank->position;
+        input->angle_deg = p->tank->angle_deg;
+    }
+    return p->next_seq++;
+}
+
+// 处理完acked_seq后的预测状态量化后与权威状态相同，说明服务器与本地执行了同样的移动
+static int prediction_confirmed(const Predictor *p, const SnapshotTank *st) {
+    return p->acked_has_state && (tk_snapshot_quantize_x(p->acked_position.x) == st->x) &&
+        (tk_snapshot_quantize_y(p->acked_position.y) == st->y) && (tk_snapshot_quantize_angle(p->acked_angle_deg) == st->angle);
+}
+
+void tk_predict_reconcile(Predictor *p, tk_uint32_t acked_seq, const Snapshot *snap) {
+    const SnapshotTank *st = tk_snapshot_find_tank(snap, p->tank_id);
+    PredictedInput *input = NULL;
+    Point authoritative, predicted = {0, 0};
+    tk_float32_t predicted_angle_deg = 0, error_px = 0;
+    tk_uint32_t first = 0;
+    int had_tank = (p->tank != NULL);
+
+    if ((acked_seq < p->acked_seq) || (acked_seq >= p->next_seq)) {
+        return;
+    }
+    if (acked_seq > p->acked_seq) {
+        if (p->next_seq - acked_seq <= TK_PREDICT_HISTORY) {
+            input = &p->inputs[acked_seq % TK_PREDICT_HISTORY];
+            p->acked_mask = input->mask;
+            p->acked_has_state = input->has_state;
+            p->acked_position = input->position;
+            p->acked_angle_deg = input->angle_deg;
+        } else { // 该输入已被新输入覆盖，沿用之前的方向键状态，并强制重置
+            p->acked_has_state = 0;
+        }
+        p->acked_seq = acked_seq;
+    }
+    if (!st || !(st->flags & TANK_ALIVE)) { // 坦克已被击毁（服务器不再响应它的输入），直接显示权威状态
+        drop_tank(p);
+        return;
+    }
+    p->reconciles++;
+    if (p->tank && prediction_confirmed(p, st)) {
+        return;
+    }
+
+    authoritative = (Point){TK_SNAPSHOT_TO_X(st->x), TK_SNAPSHOT_TO_Y(st->y)};
+    if (!p->tank) {
+        p->tank = create_tank(p->game, (tk_uint8_t *)"predicted", authoritative, TK_SNAPSHOT_TO_DEG(st->angle), TANK_ROLE_REMOTE);
+        if (!p->tank) {
+            return;
+        }
+    } else {
+        predicted = p->tank->position;
+        predicted_angle_deg = p->tank->angle_deg;
+        p->rewinds++;
+    }
+
+    // 回到权威状态，重放服务器还没处理的输入，同时刷新这些输入之后的预测状态
+    place_tank(p->tank, authoritative, TK_SNAPSHOT_TO_DEG(st->angle)); // 远程坦克的角度总是TK_SNAPSHOT_ANGLE_STEP的整数倍，见net_server.c
+    p->tank->outline = p->tank->practical_outline; // 调试用的轮廓也不再停留在回滚前的位置
+    p->acked_has_state = 1;
+    p->acked_position = p->tank->position;
+    p->acked_angle_deg = p->tank->angle_deg;
+    first = MAX(p->acked_seq + 1, (p->next_seq > TK_PREDICT_HISTORY) ? (p->next_seq - TK_PREDICT_HISTORY) : 1);
+    for (tk_uint32_t seq = first; seq < p->next_seq; seq++) {
+        input = &p->inputs[seq % TK_PREDICT_HISTORY];
+        p->tank->key_value_for_control.mask = input->mask;
+        if (input->moves) {
+            handle_key(p->tank, &p->tank->key_value_for_control);
+            p->replayed++;
+        }
+        input->has_state = 1;
+        input->position = p->tank->position;
+        input->angle_deg = p->tank->angle_deg;
+    }
+    p->tank->key_value_for_control.mask = p->key_value.mask;
+
+    if (had_tank) {
+        error_px = hypotf(p->tank->position.x - predicted.x, p->tank->position.y - predicted.y);
+        if ((error_px > TK_PREDICT_CORRECTION_PX) || (fabsf(p->tank->angle_deg - predicted_angle_deg) > 1e-3f)) {
+            p->corrections++;
+            p->max_correction_px = MAX(p->max_correction_px, error_px);
+        }
+    }
+}
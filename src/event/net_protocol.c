@@ -0,0 +1,70 @@
+#include "net_protocol.h"
+#include "debug.h"
+
+void tk_net_put_u8(struct evbuffer *buf, uint8_t v) {
+    evbuffer_add(buf, &v, 1);
+}
+
+void tk_net_put_u16(struct evbuffer *buf, uint16_t v) {
+    uint8_t b[2] = {v & 0xff, v >> 8};
+    evbuffer_add(buf, b, 2);
+}
+
+void tk_net_put_u32(struct evbuffer *buf, uint32_t v) {
+    uint8_t b[4] = {v & 0xff, (v >> 8) & 0xff, (v >> 16) & 0xff, v >> 24};
+    evbuffer_add(buf, b, 4);
+}
+
+static const uint8_t *reader_take(NetReader *r, uint32_t n) {
+    static const uint8_t zeros[4] = {0};
+    if (r->error || (r->pos + n > r->len)) {
+        r->error = 1;
+        return zeros;
+    }
+    r->pos += n;
+    return r->data + r->pos - n;
+}
+
+uint8_t tk_net_get_u8(NetReader *r) {
+    return reader_take(r, 1)[0];
+}
+
+uint16_t tk_net_get_u16(NetReader *r) {
+    const uint8_t *b = reader_take(r, 2);
+    return b[0] | (b[1] << 8);
+}
+
+uint32_t tk_net_get_u32(NetReader *r) {
+    const uint8_t *b = reader_take(r, 4);
+    return b[0] | (b[1] << 8) | (b[2] << 16) | ((uint32_t)b[3] << 24);
+}
+
+int tk_net_frame_message(struct evbuffer *out, uint8_t type, struct evbuffer *payload) {
+    size_t len = evbuffer_get_length(payload);
+
+    if (len > TK_NET_MAX_PAYLOAD) {
+        tk_debug("Error: net message(type %u) too large: %zu bytes\n", type, len);
+        evbuffer_drain(payload, len);
+        return -1;
+    }
+    tk_net_put_u16(out, (uint16_t)len);
+    tk_net_put_u8(out, type);
+    evbuffer_add_buffer(out, payload);
+    return 0;
+}
+
+int tk_net_read_message(struct evbuffer *in, uint8_t *type, uint8_t *payload, uint16_t *len) {
+    uint8_t header[TK_NET_HEADER_LEN];
+
+    if (evbuffer_copyout(in, header, TK_NET_HEADER_LEN) < TK_NET_HEADER_LEN) {
+        return 0;
+    }
+    *len = header[0] | (header[1] << 8);
+    if (evbuffer_get_length(in) < (size_t)TK_NET_HEADER_LEN + *len) {
+        return 0;
+    }
+    *type = header[2];
+    evbuffer_drain(in, TK_NET_HEADER_LEN);
+    evbuffer_remove(in, payload, *len);
+    return 1;
+}
@@ -0,0 +1,377 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <signal.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <arpa/inet.h>
+#include <event2/listener.h>
+#include "net_server.h"
+#include "headless.h"
+#include "net_protocol.h"
+#include "net_snapshot.h"
+#include "event_loop.h"
+#include "game_state.h"
+#include "tools.h"
+#include "debug.h"
+
+struct _NetServer;
+
+typedef struct _NetClient {
+    struct bufferevent *bev;
+    struct _NetServer *server;
+    id_handle_t tank_handle; // 0表示还没有（或已失去）坦克
+    tk_uint8_t name[TANK_NAME_MAXLEN];
+    tk_uint8_t closing;      // 已发送REJECT，发送缓冲清空后断开
+    tk_uint8_t has_ack;
+    tk_uint32_t acked_tick;  // 客户端最近确认的一帧，作为差分编码的基准
+    tk_uint32_t input_seq;   // 最近处理的一条输入，随世界状态告知客户端用于预测校正
+    tk_uint32_t dropped_states;
+    TAILQ_ENTRY(_NetClient) chain;
+} NetClient;
+
+typedef struct _NetServer {
+    GameState *game;
+    EventLoopContext loop;
+    struct event_base *base;
+    struct evconnlistener *listener;
+    struct event *sigint_event;
+    Snapshot *history; // 最近TK_SNAPSHOT_HISTORY帧的快照，按tick取模存放
+    TAILQ_HEAD(_net_clients_list, _NetClient) clients;
+    tk_uint32_t client_num;
+    tk_uint32_t clients_served;
+    tk_uint32_t states_sent;
+    tk_uint32_t full_states; // 其中没有可用基准、发送完整快照的次数
+    uint64_t bytes_sent;
+} NetServer;
+
+static uint8_t tk_net_server_payload[TK_NET_MAX_PAYLOAD]; // 服务器是单线程的，所有连接共用一个接收缓冲
+static uint8_t tk_net_server_snapshot[TK_SNAPSHOT_MAX_BYTES];
+
+static void free_client(NetClient *client) {
+    NetServer *server = client->server;
+    Tank *tank = get_tank_by_handle(server->game, client->tank_handle);
+
+    if (tank) { // 客户端断开，坦克随之离场
+        delete_tank(tank, 1);
+    }
+    tk_debug("client(%s) disconnected, %lu states dropped\n", client->name[0] ? (char *)client->name : "-", client->dropped_states);
+    TAILQ_REMOVE(&server->clients, client, chain);
+    server->client_num--;
+    bufferevent_free(client->bev);
+    free(client);
+}
+
+static void send_message(NetClient *client, uint8_t type, struct evbuffer *payload) {
+    tk_net_frame_message(bufferevent_get_output(client->bev), type, payload);
+}
+
+static void reject_client(NetClient *client, uint8_t reason) {
+    struct evbuffer *payload = evbuffer_new();
+
+    if (payload) {
+        tk_net_put_u8(payload, reason);
+        send_message(client, TK_NET_MSG_REJECT, payload);
+        evbuffer_free(payload);
+    }
+    client->closing = 1;
+    bufferevent_disable(client->bev, EV_READ);
+}
+
+static int spawn_client_tank(NetClient *client) {
+    GameState *gs = client->server->game;
+    // 每次转向5°（见handle_key()），初始角度也取5°的整数倍，快照中的角度就是精确值，客户端预测可以完全复现
+    Tank *tank = create_tank(gs, client->name, get_random_grid_pos_for_tank(gs),
+        game_random_range(gs, 0, 360 / TK_SNAPSHOT_ANGLE_STEP - 1) * TK_SNAPSHOT_ANGLE_STEP, TANK_ROLE_REMOTE);
+
+    if (!tank) {
+        return -1;
+    }
+    client->tank_handle = tank->handle;
+    return 0;
+}
+
+static void send_welcome(NetClient *client) {
+    GameState *gs = client->server->game;
+    struct evbuffer *payload = evbuffer_new();
+
+    if (!payload) {
+        return;
+    }
+    tk_net_put_u8(payload, TK_NET_VERSION);
+    tk_net_put_u8(payload, HORIZON_GRID_NUMBER);
+    tk_net_put_u8(payload, VERTICAL_GRID_NUMBER);
+    tk_net_put_u8(payload, TK_TICK_MS);
+    tk_net_put_u32(payload, gs->maze_seed);
+    tk_net_put_u32(payload, HANDLE2ID(client->tank_handle));
+    tk_net_put_u32(payload, gs->tick);
+    send_message(client, TK_NET_MSG_WELCOME, payload);
+    evbuffer_free(payload);
+}
+
+static void handle_hello(NetClient *client, NetReader *r) {
+    uint8_t version = tk_net_get_u8(r);
+    const uint8_t *name = r->data + r->pos;
+    uint32_t name_len = MIN(r->len - r->pos, TANK_NAME_MAXLEN - 1);
+
+    if (client->tank_handle) {
+        return;
+    }
+    if (version != TK_NET_VERSION) {
+        tk_debug("Warn: client protocol version %u != %u\n", version, TK_NET_VERSION);
+        reject_client(client, TK_NET_REJECT_VERSION);
+        return;
+    }
+    memcpy(client->name, name, name_len);
+    client->name[name_len] = '\0';
+    if (spawn_client_tank(client) != 0) {
+        reject_client(client, TK_NET_REJECT_FULL);
+        return;
+    }
+    tk_debug("client(%s) joined with tank %d, %lu clients online\n", client->name, HANDLE2ID(client->tank_handle),
+        client->server->client_num);
+    send_welcome(client);
+}
+
+static void handle_input(NetClient *client, NetReader *r) {
+    Event event;
+    Tank *tank = NULL;
+    uint32_t seq = 0;
+
+    memset(&event, 0, sizeof(event));
+    event.type = tk_net_get_u8(r);
+    event.data.key = tk_net_get_u8(r);
+    seq = tk_net_get_u32(r);
+    if (r->error || !client->tank_handle) {
+        return;
+    }
+    client->input_seq = seq; // 坦克已被击毁等情况下被忽略的输入也算已处理
+    tank = get_tank_by_handle(client->server->game, client->tank_handle);
+    if (event.type == EVENT_GAME_RESTART) { // 被击毁（坦克已删除）后重生，客户端的坦克ID随之改变
+        if (!tank && (spawn_client_tank(client) == 0)) {
+            send_welcome(client);
+        }
+    } else if (tank && TST_FLAG(tank, flags, TANK_ALIVE)) { // 暂停、退出等影响整局的事件不接受来自客户端
+        handle_tank_key_event(tank, &event);
+    }
+}
+
+static void handle_ack(NetClient *client, NetReader *r) {
+    uint32_t tick = tk_net_get_u32(r);
+#ifdef ENABLE_LAG_COMPENSATION
+    Tank *tank = NULL;
+#endif
+
+    if (r->error || (tick > client->server->game->tick)) {
+        return;
+    }
+    if (!client->has_ack || (tick > client->acked_tick)) { // 确认可能乱序到达（重生前后），只前进
+        client->acked_tick = tick;
+        client->has_ack = 1;
+    }
+#ifdef ENABLE_LAG_COMPENSATION
+    // 客户端确认的是它刚收到、正在显示的一帧，此后发射的炮弹按这一帧的世界判定命中
+    tank = get_tank_by_handle(client->server->game, client->tank_handle);
+    if (tank && (client->acked_tick > tank->view_tick)) {
+        tank->view_tick = client->acked_tick;
+    }
+#endif
+}
+
+static void client_read_cb(struct bufferevent *bev, void *arg) {
+    NetClient *client = (NetClient *)arg;
+    struct evbuffer *input = bufferevent_get_input(bev);
+    NetReader reader;
+    uint8_t type = 0;
+    uint16_t len = 0;
+
+    while (!client->closing && (tk_net_read_message(input, &type, tk_net_server_payload, &len) == 1)) {
+        reader = (NetReader){tk_net_server_payload, len, 0, 0};
+        if (type == TK_NET_MSG_HELLO) {
+            handle_hello(client, &reader);
+        } else if (type == TK_NET_MSG_INPUT) {
+            handle_input(client, &reader);
+        } else if (type == TK_NET_MSG_ACK) {
+            handle_ack(client, &reader);
+        } else {
+            tk_debug("Warn: unknown message type %u from client(%s)\n", type, client->name);
+        }
+    }
+}
+
+static void client_write_cb(struct bufferevent *bev, void *arg) {
+    NetClient *client = (NetClient *)arg;
+
+    if (client->closing) { // REJECT已发送完毕
+        free_client(client);
+    }
+}
+
+static void client_event_cb(struct bufferevent *bev, short what, void *arg) {
+    if (what & (BEV_EVENT_EOF | BEV_EVENT_ERROR)) {
+        free_client((NetClient *)arg);
+    }
+}
+
+static void accept_cb(struct evconnlistener *listener, evutil_socket_t fd, struct sockaddr *addr, int socklen, void *arg) {
+    NetServer *server = (NetServer *)arg;
+    NetClient *client = NULL;
+    int one = 1;
+
+    setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one)); // 每帧一条小消息，不能被Nagle算法攒着
+    client = malloc(sizeof(NetClient));
+    if (!client) {
+        evutil_closesocket(fd);
+        return;
+    }
+    memset(client, 0, sizeof(NetClient));
+    client->server = server;
+    client->bev = bufferevent_socket_new(server->base, fd, BEV_OPT_CLOSE_ON_FREE);
+    if (!client->bev) {
+        evutil_closesocket(fd);
+        free(client);
+        return;
+    }
+    TAILQ_INSERT_TAIL(&server->clients, client, chain);
+    server->client_num++;
+    server->clients_served++;
+    bufferevent_setcb(client->bev, client_read_cb, client_write_cb, client_event_cb, client);
+    bufferevent_enable(client->bev, EV_READ | EV_WRITE);
+    if (server->client_num > TK_NET_MAX_CLIENTS) {
+        reject_client(client, TK_NET_REJECT_FULL);
+    }
+}
+
+// 客户端确认的基准还在历史快照中时返回它，否则返回NULL（发送完整快照）
+static const Snapshot *client_baseline(NetClient *client, const Snapshot *snap) {
+    const Snapshot *baseline = NULL;
+
+    if (!client->has_ack || (client->acked_tick >= snap->tick) || (snap->tick - client->acked_tick >= TK_SNAPSHOT_HISTORY)) {
+        return NULL;
+    }
+    baseline = &client->server->history[client->acked_tick % TK_SNAPSHOT_HISTORY];
+    return (baseline->tick == client->acked_tick) ? baseline : NULL;
+}
+
+// 每个模拟帧之后：世界状态只量化一次，再按各客户端确认的基准分别差分编码
+static void broadcast_state(void *arg) {
+    EventLoopContext *loop = (EventLoopContext *)arg;
+    NetServer *server = (NetServer *)loop->user_data;
+    Snapshot *snap = &server->history[server->game->tick % TK_SNAPSHOT_HISTORY];
+    const Snapshot *baseline = NULL;
+    NetClient *client = NULL;
+    struct evbuffer *payload = NULL;
+    int len = 0;
+
+    if (tk_snapshot_capture(snap, server->game) != 0) {
+        snap->tick = 0; // 不能作为基准
+        return;
+    }
+    payload = evbuffer_new();
+    if (!payload) {
+        return;
+    }
+    TAILQ_FOREACH(client, &server->clients, chain) {
+        if (!client->tank_handle || client->closing) {
+            continue;
+        }
+        if (evbuffer_get_length(bufferevent_get_output(client->bev)) > TK_NET_MAX_PENDING_BYTES) {
+            client->dropped_states++;
+            continue;
+        }
+        baseline = client_baseline(client, snap);
+        len = tk_snapshot_encode(snap, baseline, tk_net_server_snapshot, sizeof(tk_net_server_snapshot));
+        if ((len < 0) || (len + 4 > TK_NET_MAX_PAYLOAD)) {
+            continue;
+        }
+        tk_net_put_u32(payload, client->input_seq);
+        evbuffer_add(payload, tk_net_server_snapshot, len);
+        tk_net_frame_message(bufferevent_get_output(client->bev), TK_NET_MSG_STATE, payload);
+        server->states_sent++;
+        server->full_states += (baseline == NULL);
+        server->bytes_sent += TK_NET_HEADER_LEN + 4 + len;
+    }
+    evbuffer_free(payload);
+}
+
+static void server_finished(void *arg) {
+    EventLoopContext *loop = (EventLoopContext *)arg;
+
+    event_base_loopexit(loop->base, NULL);
+}
+
+static void sigint_cb(evutil_socket_t sig, short what, void *arg) {
+    NetServer *server = (NetServer *)arg;
+
+    tk_debug("recv SIGINT, stop server\n");
+    event_base_loopexit(server->base, NULL);
+}
+
+int tk_run_net_server(const NetServerConfig *config) {
+    NetServer server;
+    struct sockaddr_in sin;
+    int ret = -1;
+
+    memset(&server, 0, sizeof(server));
+    TAILQ_INIT(&server.clients);
+    server.history = calloc(TK_SNAPSHOT_HISTORY, sizeof(Snapshot));
+    if (!server.history) {
+        return -1;
+    }
+    server.game = tk_headless_game_create(config->seed, TK_NET_MAX_CLIENTS + config->enemies, config->enemies);
+    if (!server.game) {
+        goto out;
+    }
+    server.base = event_base_new();
+    if (!server.base) {
+        tk_debug("Error: failed to create event base\n");
+        goto out;
+    }
+    memset(&sin, 0, sizeof(sin));
+    sin.sin_family = AF_INET;
+    sin.sin_addr.s_addr = htonl(INADDR_LOOPBACK); // 只接受本机连接
+    sin.sin_port = htons(config->port);
+    server.listener = evconnlistener_new_bind(server.base, accept_cb, &server, LEV_OPT_CLOSE_ON_FREE | LEV_OPT_REUSEABLE, -1,
+        (struct sockaddr *)&sin, sizeof(sin));
+    if (!server.listener) {
+        tk_debug("Error: failed to listen on 127.0.0.1:%u\n", config->port);
+        goto out;
+    }
+    server.sigint_event = evsignal_new(server.base, SIGINT, sigint_cb, &server);
+    if (!server.sigint_event || (event_add(server.sigint_event, NULL) != 0)) {
+        goto out;
+    }
+    if (init_event_loop(&server.loop, server.game, server.base) != 0) {
+        goto out;
+    }
+    server.loop.tick_limit = config->duration;
+    server.loop.on_tick = broadcast_state;
+    server.loop.on_finish = server_finished;
+    server.loop.user_data = &server;
+
+    tk_debug("server listening on 127.0.0.1:%u, map %dx%d, %u enemies, seed %u\n", config->port, HORIZON_GRID_NUMBER,
+        VERTICAL_GRID_NUMBER, config->enemies, config->seed);
+    event_base_dispatch(server.base);
+    tk_debug("server done: %lu ticks, %lu clients served, %lu states sent(%lu full, %.1f KB, %.0f B/state), %lu late ticks\n",
+        server.game->tick, server.clients_served, server.states_sent, server.full_states, server.bytes_sent / 1024.0,
+        server.states_sent ? (double)server.bytes_sent / server.states_sent : 0.0, server.loop.late_ticks);
+    ret = 0;
+
+out:
+    while (!TAILQ_EMPTY(&server.clients)) {
+        free_client(TAILQ_FIRST(&server.clients));
+    }
+    cleanup_event_loop(&server.loop);
+    if (server.sigint_event) {
+        event_free(server.sigint_event);
+    }
+    if (server.listener) {
+        evconnlistener_free(server.listener);
+    }
+    if (server.base) {
+        event_base_free(server.base);
+    }
+    tk_headless_game_destroy(server.game);
+    free(server.history);
+    return ret;
+}
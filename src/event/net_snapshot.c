@@ -0,0 +1,490 @@
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include "net_snapshot.h"
+#include "maze.h"
+#include "debug.h"
+
+#define SNAPSHOT_ANGLE_STEPS (360 / TK_SNAPSHOT_ANGLE_STEP)
+#define SNAPSHOT_ANGLE_BITS 7
+#define SNAPSHOT_ROLE_BITS 2
+#define SNAPSHOT_FLAGS_BITS 32
+#define SNAPSHOT_POS_DELTA_LIMIT (1 << 10) // 之字形差分达到该值时直接发送完整坐标（EG3编码此时已不比完整坐标短）
+#define SNAPSHOT_MAX_EG_PREFIX 32
+
+// 角色与标记按固定位宽编码，超出的部分会被put_bits()悄悄截掉，新增角色或标记时在编译期发现
+_Static_assert(TANK_ROLE_NUM <= (1 << SNAPSHOT_ROLE_BITS), "tank roles do not fit in SNAPSHOT_ROLE_BITS");
+_Static_assert(((uint64_t)TANK_FLAGS_MASK >> SNAPSHOT_FLAGS_BITS) == 0, "tank flags do not fit in SNAPSHOT_FLAGS_BITS");
+
+typedef struct {
+    uint8_t *data;
+    uint32_t cap;    // 字节
+    uint32_t bitpos;
+    int error;
+} BitWriter;
+
+typedef struct {
+    const uint8_t *data;
+    uint32_t len;    // 字节
+    uint32_t bitpos;
+    int error;
+} BitReader;
+
+static void put_bits(BitWriter *w, uint32_t v, int n) {
+    uint32_t off = 0;
+    int take = 0;
+
+    if (w->error || (w->bitpos + n > w->cap * 8)) {
+        w->error = 1;
+        return;
+    }
+    while (n > 0) {
+        off = w->bitpos & 7;
+        take = MIN(8 - (int)off, n);
+        if (off == 0) {
+            w->data[w->bitpos >> 3] = 0;
+        }
+        w->data[w->bitpos >> 3] |= (uint8_t)((v & ((1u << take) - 1)) << off);
+        v = (take < 32) ? (v >> take) : 0;
+        n -= take;
+        w->bitpos += take;
+    }
+}
+
+static uint32_t get_bits(BitReader *r, int n) {
+    uint32_t v = 0, off = 0;
+    int take = 0, shift = 0;
+
+    if (r->error || (r->bitpos + n > r->len * 8)) {
+        r->error = 1;
+        return 0;
+    }
+    while (n > 0) {
+        off = r->bitpos & 7;
+        take = MIN(8 - (int)off, n);
+        v |= (uint32_t)((r->data[r->bitpos >> 3] >> off) & ((1u << take) - 1)) << shift;
+        shift += take;
+        n -= take;
+        r->bitpos += take;
+    }
+    return v;
+}
+
+// k阶指数哥伦布编码：前缀m个0和一个1，随后m+k位
+static void put_eg(BitWriter *w, uint32_t v, int k) {
+    uint64_t u = (uint64_t)v + (1ULL << k);
+    int m = 63 - __builtin_clzll(u) - k;
+
+    put_bits(w, 0, m);
+    put_bits(w, 1, 1);
+    if (m + k > 32) {
+        put_bits(w, (uint32_t)u, 32);
+        put_bits(w, (uint32_t)(u >> 32), m + k - 32);
+    } else {
+        put_bits(w, (uint32_t)u, m + k);
+    }
+}
+
+static uint32_t get_eg(BitReader *r, int k) {
+    int m = 0;
+    uint64_t u = 0;
+
+    while (!get_bits(r, 1)) {
+        if (r->error || (++m > SNAPSHOT_MAX_EG_PREFIX)) {
+            r->error = 1;
+            return 0;
+        }
+    }
+    if (m + k > 32) {
+        u = get_bits(r, 32);
+        u |= (uint64_t)get_bits(r, m + k - 32) << 32;
+    } else {
+        u = get_bits(r, m + k);
+    }
+    return (uint32_t)((u | (1ULL << (m + k))) - (1ULL << k));
+}
+
+static uint32_t zigzag(int32_t d) {
+    return ((uint32_t)d << 1) ^ (uint32_t)(d >> 31);
+}
+
+static int32_t unzigzag(uint32_t z) {
+    return (int32_t)(z >> 1) ^ -(int32_t)(z & 1);
+}
+
+static uint32_t max_pos(void) {
+    return MAX(HORIZON_GRID_NUMBER, VERTICAL_GRID_NUMBER) * GRID_SIZE * TK_SNAPSHOT_POS_SCALE;
+}
+
+// 能表示0~max_pos()的位数
+static int pos_bits(void) {
+    static int bits = 0;
+    if (!bits) {
+        bits = 32 - __builtin_clz(max_pos());
+    }
+    return bits;
+}
+
+static tk_uint32_t quantize_pos(tk_float32_t v, tk_float32_t offset) {
+    tk_float32_t q = roundf((v - offset) * TK_SNAPSHOT_POS_SCALE);
+
+    if (q < 0) {
+        return 0;
+    }
+    return MIN((tk_uint32_t)q, max_pos());
+}
+
+tk_uint32_t tk_snapshot_quantize_x(tk_float32_t x) {
+    return quantize_pos(x, tk_maze_offset.x);
+}
+
+tk_uint32_t tk_snapshot_quantize_y(tk_float32_t y) {
+    return quantize_pos(y, tk_maze_offset.y);
+}
+
+tk_uint8_t tk_snapshot_quantize_angle(tk_float32_t deg) {
+    int step = (int)lroundf(deg / TK_SNAPSHOT_ANGLE_STEP) % SNAPSHOT_ANGLE_STEPS;
+    return (tk_uint8_t)((step < 0) ? (step + SNAPSHOT_ANGLE_STEPS) : step);
+}
+
+static void put_pos(BitWriter *w, tk_uint32_t v, const tk_uint32_t *base) {
+    uint32_t z = 0;
+
+    if (base) {
+        if (v == *base) {
+            put_bits(w, 0, 1);
+            return;
+        }
+        put_bits(w, 1, 1);
+        z = zigzag((int32_t)(v - *base));
+        if (z < SNAPSHOT_POS_DELTA_LIMIT) {
+            put_bits(w, 0, 1);
+            put_eg(w, z, 3);
+            return;
+        }
+        put_bits(w, 1, 1);
+    }
+    put_bits(w, v, pos_bits());
+}
+
+static tk_uint32_t get_pos(BitReader *r, const tk_uint32_t *base) {
+    tk_uint32_t v = 0;
+
+    if (base) {
+        if (!get_bits(r, 1)) {
+            return *base;
+        }
+        if (!get_bits(r, 1)) {
+            v = *base + unzigzag(get_eg(r, 3));
+            goto check;
+        }
+    }
+    v = get_bits(r, pos_bits());
+check:
+    if (v > max_pos()) {
+        r->error = 1;
+    }
+    return v;
+}
+
+// 变了才发送
+static void put_changed(BitWriter *w, uint32_t v, uint32_t base, int n) {
+    put_bits(w, v != base, 1);
+    if (v != base) {
+        put_bits(w, v, n);
+    }
+}
+
+static uint32_t get_changed(BitReader *r, uint32_t base, int n) {
+    return get_bits(r, 1) ? get_bits(r, n) : base;
+}
+
+static int compare_tank_id(const void *a, const void *b) {
+    tk_uint32_t x = (*(Tank * const *)a)->id, y = (*(Tank * const *)b)->id;
+    return (x > y) - (x < y);
+}
+
+static int compare_shell_id(const void *a, const void *b) {
+    tk_uint32_t x = ((const SnapshotShell *)a)->id, y = ((const SnapshotShell *)b)->id;
+    return (x > y) - (x < y);
+}
+
+int tk_snapshot_capture(Snapshot *snap, GameState *gs) {
+    Tank *tanks[TK_SNAPSHOT_MAX_TANKS];
+    SnapshotTank *st = NULL;
+    SnapshotShell *ss = NULL;
+    Tank *tank = NULL;
+    Shell *shell = NULL;
+    uint32_t tank_num = 0;
+
+    TAILQ_FOREACH(tank, &gs->tank_list, chain) {
+        if (tank_num >= TK_SNAPSHOT_MAX_TANKS) {
+            tk_debug("Error: too many tanks for snapshot(max %d)\n", TK_SNAPSHOT_MAX_TANKS);
+            return -1;
+        }
+        tanks[tank_num++] = tank;
+    }
+    qsort(tanks, tank_num, sizeof(Tank *), compare_tank_id);
+    snap->tick = gs->tick;
+    snap->tank_num = tank_num;
+    snap->shell_num = 0;
+    for (uint32_t i = 0; i < tank_num; i++) {
+        tank = tanks[i];
+        st = &snap->tanks[i];
+        st->id = tank->id;
+        st->role = tank->role;
+        st->angle = tk_snapshot_quantize_angle(tank->angle_deg);
+        st->health = tank->health;
+        st->x = tk_snapshot_quantize_x(tank->position.x);
+        st->y = tk_snapshot_quantize_y(tank->position.y);
+        st->flags = tank->flags;
+        st->shell_start = snap->shell_num;
+        TAILQ_FOREACH(shell, &tank->shell_list, chain) {
+            if (snap->shell_num >= TK_SNAPSHOT_MAX_SHELLS) {
+                tk_debug("Error: too many shells for snapshot(max %d)\n", TK_SNAPSHOT_MAX_SHELLS);
+                return -1;
+            }
+            ss = &snap->shells[snap->shell_num++];
+            ss->id = shell->id;
+            ss->x = tk_snapshot_quantize_x(shell->position.x);
+            ss->y = tk_snapshot_quantize_y(shell->position.y);
+            ss->angle = tk_snapshot_quantize_angle(shell->angle_deg);
+            ss->ttl = shell->ttl;
+        }
+        st->shell_num = snap->shell_num - st->shell_start;
+        qsort(&snap->shells[st->shell_start], st->shell_num, sizeof(SnapshotShell), compare_shell_id); // 新炮弹插在链表头部
+    }
+    return 0;
+}
+
+// 在按ID升序的数组中从*cursor开始查找id，cursor随之前进（当前与基准两个序列同向归并）
+#define SNAPSHOT_MATCH(array, num, cursor, target_id, out) do { \
+    (out) = NULL; \
+    while (((cursor) < (num)) && ((array)[cursor].id < (target_id))) { \
+        (cursor)++; \
+    } \
+    if (((cursor) < (num)) && ((array)[cursor].id == (target_id))) { \
+        (out) = &(array)[cursor]; \
+    } \
+} while (0)
+
+static void encode_shells(BitWriter *w, const Snapshot *snap, const SnapshotTank *st, const Snapshot *baseline, const SnapshotTank *bt) {
+    const SnapshotShell *base_shells = bt ? &baseline->shells[bt->shell_start] : NULL;
+    const SnapshotShell *ss = NULL, *bs = NULL;
+    uint32_t cursor = 0, prev_id = 0;
+
+    put_eg(w, st->shell_num, 0);
+    for (uint32_t i = 0; i < st->shell_num; i++) {
+        ss = &snap->shells[st->shell_start + i];
+        put_eg(w, ss->id - prev_id - 1, 3);
+        prev_id = ss->id;
+        bs = NULL;
+        if (bt) {
+            SNAPSHOT_MATCH(base_shells, bt->shell_num, cursor, ss->id, bs);
+            put_bits(w, bs != NULL, 1);
+        }
+        if (bs) {
+            put_pos(w, ss->x, &bs->x);
+            put_pos(w, ss->y, &bs->y);
+            put_changed(w, ss->angle, bs->angle, SNAPSHOT_ANGLE_BITS);
+            put_changed(w, ss->ttl, bs->ttl, 8);
+        } else {
+            put_pos(w, ss->x, NULL);
+            put_pos(w, ss->y, NULL);
+            put_bits(w, ss->angle, SNAPSHOT_ANGLE_BITS);
+            put_bits(w, ss->ttl, 8);
+        }
+    }
+}
+
+int tk_snapshot_encode(const Snapshot *snap, const Snapshot *baseline, uint8_t *out, uint32_t cap) {
+    BitWriter w = {out, cap, 0, 0};
+    const SnapshotTank *st = NULL, *bt = NULL;
+    uint32_t cursor = 0, prev_id = 0;
+
+    if (baseline && (baseline->tick >= snap->tick)) {
+        tk_debug("Error: snapshot baseline(tick %lu) is not older than tick %lu\n", baseline->tick, snap->tick);
+        return -1;
+    }
+    put_bits(&w, snap->tick, 32);
+    put_bits(&w, baseline != NULL, 1);
+    if (baseline) {
+        put_eg(&w, snap->tick - baseline->tick - 1, 0);
+    }
+    put_eg(&w, snap->tank_num, 4);
+    for (uint32_t i = 0; i < snap->tank_num; i++) {
+        st = &snap->tanks[i];
+        put_eg(&w, st->id - prev_id - 1, 2);
+        prev_id = st->id;
+        bt = NULL;
+        if (baseline) {
+            SNAPSHOT_MATCH(baseline->tanks, baseline->tank_num, cursor, st->id, bt);
+            if (bt && (bt->role != st->role)) { // ID被另一辆坦克复用
+                bt = NULL;
+            }
+            put_bits(&w, bt != NULL, 1);
+        }
+        if (bt) {
+            put_pos(&w, st->x, &bt->x);
+            put_pos(&w, st->y, &bt->y);
+            put_changed(&w, st->angle, bt->angle, SNAPSHOT_ANGLE_BITS);
+            put_changed(&w, st->health, bt->health, 16);
+            put_changed(&w, st->flags, bt->flags, SNAPSHOT_FLAGS_BITS);
+        } else {
+            put_bits(&w, st->role, SNAPSHOT_ROLE_BITS);
+            put_pos(&w, st->x, NULL);
+            put_pos(&w, st->y, NULL);
+            put_bits(&w, st->angle, SNAPSHOT_ANGLE_BITS);
+            put_bits(&w, st->health, 16);
+            put_bits(&w, st->flags, SNAPSHOT_FLAGS_BITS);
+        }
+        encode_shells(&w, snap, st, baseline, bt);
+    }
+    if (w.error) {
+        tk_debug("Error: snapshot(tick %lu) exceeds %u bytes\n", snap->tick, cap);
+        return -1;
+    }
+    return (w.bitpos + 7) / 8;
+}
+
+int tk_snapshot_peek(const uint8_t *data, uint32_t len, uint32_t *tick, uint32_t *baseline_tick) {
+    BitReader r = {data, len, 0, 0};
+    int has_baseline = 0;
+
+    *tick = get_bits(&r, 32);
+    has_baseline = get_bits(&r, 1);
+    *baseline_tick = has_baseline ? (*tick - get_eg(&r, 0) - 1) : 0;
+    return r.error ? -1 : has_baseline;
+}
+
+static int decode_shells(BitReader *r, Snapshot *out, SnapshotTank *st, const Snapshot *baseline, const SnapshotTank *bt) {
+    const SnapshotShell *base_shells = bt ? &baseline->shells[bt->shell_start] : NULL;
+    const SnapshotShell *bs = NULL;
+    SnapshotShell *ss = NULL;
+    uint32_t cursor = 0, prev_id = 0, shell_num = get_eg(r, 0);
+
+    if (out->shell_num + shell_num > TK_SNAPSHOT_MAX_SHELLS) {
+        return -1;
+    }
+    st->shell_start = out->shell_num;
+    st->shell_num = shell_num;
+    for (uint32_t i = 0; (i < shell_num) && !r->error; i++) {
+        ss = &out->shells[out->shell_num++];
+        ss->id = prev_id + get_eg(r, 3) + 1;
+        prev_id = ss->id;
+        bs = NULL;
+        if (bt && get_bits(r, 1)) {
+            SNAPSHOT_MATCH(base_shells, bt->shell_num, cursor, ss->id, bs);
+            if (!bs) {
+                return -1;
+            }
+        }
+        if (bs) {
+            ss->x = get_pos(r, &bs->x);
+            ss->y = get_pos(r, &bs->y);
+            ss->angle = get_changed(r, bs->angle, SNAPSHOT_ANGLE_BITS);
+            ss->ttl = get_changed(r, bs->ttl, 8);
+        } else {
+            ss->x = get_pos(r, NULL);
+            ss->y = get_pos(r, NULL);
+            ss->angle = get_bits(r, SNAPSHOT_ANGLE_BITS);
+            ss->ttl = get_bits(r, 8);
+        }
+        if (ss->angle >= SNAPSHOT_ANGLE_STEPS) {
+            return -1;
+        }
+    }
+    return r->error ? -1 : 0;
+}
+
+int tk_snapshot_decode(const uint8_t *data, uint32_t len, const Snapshot *baseline, Snapshot *out) {
+    BitReader r = {data, len, 0, 0};
+    SnapshotTank *st = NULL;
+    const SnapshotTank *bt = NULL;
+    uint32_t cursor = 0, prev_id = 0, tank_num = 0;
+    int has_baseline = 0;
+
+    out->tick = get_bits(&r, 32);
+    has_baseline = get_bits(&r, 1);
+    if (has_baseline && (!baseline || (baseline->tick != out->tick - get_eg(&r, 0) - 1))) {
+        return -1;
+    }
+    if (!has_baseline) {
+        baseline = NULL;
+    }
+    tank_num = get_eg(&r, 4);
+    if (r.error || (tank_num > TK_SNAPSHOT_MAX_TANKS)) {
+        return -1;
+    }
+    out->tank_num = tank_num;
+    out->shell_num = 0;
+    for (uint32_t i = 0; (i < tank_num) && !r.error; i++) {
+        st = &out->tanks[i];
+        st->id = prev_id + get_eg(&r, 2) + 1;
+        prev_id = st->id;
+        bt = NULL;
+        if (baseline && get_bits(&r, 1)) {
+            SNAPSHOT_MATCH(baseline->tanks, baseline->tank_num, cursor, st->id, bt);
+            if (!bt) {
+                return -1;
+            }
+        }
+        if (bt) {
+            st->role = bt->role;
+            st->x = get_pos(&r, &bt->x);
+            st->y = get_pos(&r, &bt->y);
+            st->angle = get_changed(&r, bt->angle, SNAPSHOT_ANGLE_BITS);
+            st->health = get_changed(&r, bt->health, 16);
+            st->flags = get_changed(&r, bt->flags, SNAPSHOT_FLAGS_BITS);
+        } else {
+            st->role = get_bits(&r, SNAPSHOT_ROLE_BITS);
+            st->x = get_pos(&r, NULL);
+            st->y = get_pos(&r, NULL);
+            st->angle = get_bits(&r, SNAPSHOT_ANGLE_BITS);
+            st->health = get_bits(&r, 16);
+            st->flags = get_bits(&r, SNAPSHOT_FLAGS_BITS);
+        }
+        if ((st->angle >= SNAPSHOT_ANGLE_STEPS) || (decode_shells(&r, out, st, baseline, bt) != 0)) {
+            return -1;
+        }
+    }
+    // 末尾只允许不足一字节的填充
+    if (r.error || ((r.bitpos + 7) / 8 != len)) {
+        return -1;
+    }
+    return 0;
+}
+
+int tk_snapshot_equal(const Snapshot *a, const Snapshot *b) {
+    const SnapshotTank *ta = NULL, *tb = NULL;
+    const SnapshotShell *sa = NULL, *sb = NULL;
+
+    if ((a->tick != b->tick) || (a->tank_num != b->tank_num) || (a->shell_num != b->shell_num)) {
+        return 0;
+    }
+    for (uint32_t i = 0; i < a->tank_num; i++) {
+        ta = &a->tanks[i];
+        tb = &b->tanks[i];
+        if ((ta->id != tb->id) || (ta->role != tb->role) || (ta->angle != tb->angle) || (ta->health != tb->health) ||
+            (ta->x != tb->x) || (ta->y != tb->y) || (ta->flags != tb->flags) ||
+            (ta->shell_start != tb->shell_start) || (ta->shell_num != tb->shell_num)) {
+            return 0;
+        }
+    }
+    for (uint32_t i = 0; i < a->shell_num; i++) {
+        sa = &a->shells[i];
+        sb = &b->shells[i];
+        if ((sa->id != sb->id) || (sa->x != sb->x) || (sa->y != sb->y) || (sa->angle != sb->angle) || (sa->ttl != sb->ttl)) {
+            return 0;
+        }
+    }
+    return 1;
+}
+
+const SnapshotTank *tk_snapshot_find_tank(const Snapshot *snap, tk_uint32_t id) {
+    const SnapshotTank *tank = NULL;
+    uint32_t cursor = 0;
+
+    SNAPSHOT_MATCH(snap->tanks, snap->tank_num, cursor, id, tank);
+    return tank;
+}
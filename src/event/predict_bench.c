@@ -0,0 +1,277 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include "net_predict.h"
+#include "event_loop.h"
+#include "headless.h"
+#include "profiler.h"
+#include "tools.h"
+#include "debug.h"
+
+#define LAG_CHANNEL_CAPACITY 1024
+#define PREDICT_BENCH_FRAMES_PER_TICK (TK_TICK_MS / RENDER_FPS_MS)
+#define PREDICT_BENCH_POS_TOLERANCE (0.7072f / TK_SNAPSHOT_POS_SCALE + 1e-3f) // x、y各差半个量化单位时的距离
+
+typedef enum {
+    LAG_MSG_INPUT,   // 客户端 -> 服务器
+    LAG_MSG_WELCOME, // 服务器 -> 客户端：新坦克
+    LAG_MSG_STATE    // 服务器 -> 客户端：已处理的输入序号 + 完整快照
+} LagMessageKind;
+
+typedef struct {
+    uint32_t deliver_frame;
+    LagMessageKind kind;
+    tk_uint8_t type;
+    tk_uint8_t key;
+    tk_uint32_t seq;  // 输入序号（INPUT/STATE）或坦克ID（WELCOME）
+    uint8_t *data;    // 编码后的快照
+    int len;
+} LagMessage;
+
+// 进程内的人为延迟信道：每条消息固定延迟delay_frames个逻辑帧后按发送顺序送达
+typedef struct {
+    LagMessage msgs[LAG_CHANNEL_CAPACITY];
+    uint32_t head;
+    uint32_t tail;
+    uint32_t delay_frames;
+} LagChannel;
+
+static int lag_channel_push(LagChannel *ch, uint32_t now, LagMessage *msg) {
+    if (ch->tail - ch->head >= LAG_CHANNEL_CAPACITY) {
+        tk_debug("Error: lag channel is full\n");
+        return -1;
+    }
+    msg->deliver_frame = now + ch->delay_frames;
+    ch->msgs[ch->tail++ % LAG_CHANNEL_CAPACITY] = *msg;
+    return 0;
+}
+
+static LagMessage *lag_channel_pop(LagChannel *ch, uint32_t now) {
+    LagMessage *msg = NULL;
+
+    if ((ch->head == ch->tail) || (ch->msgs[ch->head % LAG_CHANNEL_CAPACITY].deliver_frame > now)) {
+        return NULL;
+    }
+    msg = &ch->msgs[ch->head++ % LAG_CHANNEL_CAPACITY];
+    return msg;
+}
+
+static void lag_channel_clear(LagChannel *ch) {
+    LagMessage *msg = NULL;
+
+    while ((msg = lag_channel_pop(ch, UINT32_MAX))) {
+        free(msg->data);
+    }
+}
+
+typedef struct {
+    const PredictBenchConfig *config;
+    GameState *server;
+    id_handle_t player_handle;
+    tk_uint32_t input_seq;  // 服务器处理的最后一条输入
+    Predictor predictor;
+    Snapshot *snap;         // 服务器端量化用
+    Snapshot *decoded;      // 客户端解码用
+    LagChannel up;          // 客户端 -> 服务器
+    LagChannel down;        // 服务器 -> 客户端
+    uint32_t rng_state;
+    tk_uint8_t held_key;
+    uint32_t frame;
+    uint32_t issue_frame[TK_PREDICT_HISTORY]; // 每条输入的发出帧，按seq取模
+    tk_uint32_t display_seq; // 不预测时，画面上的坦克已反映到哪条输入（即最近一帧权威状态的输入序号）
+    tk_histogram_t predicted_latency; // 输入到画面的延迟（毫秒）
+    tk_histogram_t authoritative_latency;
+    uint32_t respawns;
+} PredictBench;
+
+#define PREDICT_BENCH_NO_KEY 0xff
+
+static int spawn_player(PredictBench *b) {
+    GameState *gs = b->server;
+    LagMessage msg = {0};
+    Tank *tank = create_tank(gs, (tk_uint8_t *)"player", get_random_grid_pos_for_tank(gs),
+        game_random_range(gs, 0, 360 / TK_SNAPSHOT_ANGLE_STEP - 1) * TK_SNAPSHOT_ANGLE_STEP, TANK_ROLE_REMOTE); // 同net_server.c
+
+    if (!tank) {
+        return -1;
+    }
+    b->player_handle = tank->handle;
+    msg.kind = LAG_MSG_WELCOME;
+    msg.seq = tank->id;
+    return lag_channel_push(&b->down, b->frame, &msg);
+}
+
+// 服务器：处理送达的输入，每PREDICT_BENCH_FRAMES_PER_TICK个逻辑帧推进一个模拟帧并发出世界状态
+static int server_frame(PredictBench *b) {
+    static uint8_t buf[TK_SNAPSHOT_MAX_BYTES];
+    LagMessage *in = NULL, out = {0};
+    Tank *tank = NULL;
+    Event event;
+
+    while ((in = lag_channel_pop(&b->up, b->frame))) {
+        memset(&event, 0, sizeof(event));
+        event.type = in->type;
+        event.data.key = in->key;
+        b->input_seq = in->seq;
+        tank = get_tank_by_handle(b->server, b->player_handle);
+        if (tank && TST_FLAG(tank, flags, TANK_ALIVE)) {
+            handle_tank_key_event(tank, &event);
+        }
+    }
+    if ((b->frame % PREDICT_BENCH_FRAMES_PER_TICK) != 0) {
+        return 0;
+    }
+    game_state_tick(b->server);
+    if (!get_tank_by_handle(b->server, b->player_handle)) { // 被击毁后立即重生
+        b->respawns++;
+        if (spawn_player(b) != 0) {
+            return -1;
+        }
+    }
+    if (tk_snapshot_capture(b->snap, b->server) != 0) {
+        return -1;
+    }
+    out.len = tk_snapshot_encode(b->snap, NULL, buf, sizeof(buf));
+    out.data = (out.len > 0) ? malloc(out.len) : NULL;
+    if (!out.data) {
+        return -1;
+    }
+    memcpy(out.data, buf, out.len);
+    out.kind = LAG_MSG_STATE;
+    out.seq = b->input_seq;
+    if (lag_channel_push(&b->down, b->frame, &out) != 0) {
+        free(out.data);
+        return -1;
+    }
+    return 0;
+}
+
+static void client_input(PredictBench *b, EventType type, KeyCode key) {
+    LagMessage msg = {0};
+    int applied = (b->predictor.tank != NULL);
+
+    msg.kind = LAG_MSG_INPUT;
+    msg.type = type;
+    msg.key = key;
+    msg.seq = tk_predict_input(&b->predictor, type, key);
+    b->issue_frame[msg.seq % TK_PREDICT_HISTORY] = b->frame;
+    if (applied) { // 预测的坦克在本帧就已响应，下一次渲染即可看到
+        tk_histogram_record(&b->predicted_latency, RENDER_FPS_MS);
+    }
+    lag_channel_push(&b->up, b->frame, &msg);
+}
+
+// 客户端：收取世界状态并校正，然后产生本帧的脚本化输入（同net_bots.c，按住的方向键每帧重发）
+static int client_frame(PredictBench *b, int scripted) {
+    LagMessage *msg = NULL;
+    uint8_t key = 0;
+    int ret = 0;
+
+    while ((msg = lag_channel_pop(&b->down, b->frame))) {
+        if (msg->kind == LAG_MSG_WELCOME) {
+            tk_predict_set_tank(&b->predictor, msg->seq);
+            continue;
+        }
+        if (tk_snapshot_decode(msg->data, msg->len, NULL, b->decoded) != 0) {
+            ret = -1;
+        } else {
+            tk_predict_reconcile(&b->predictor, msg->seq, b->decoded);
+            // 不预测时，画面上的坦克要等这帧权威状态才反映这些输入
+            for (tk_uint32_t seq = b->display_seq + 1; seq <= msg->seq; seq++) {
+                tk_histogram_record(&b->authoritative_latency, (b->frame - b->issue_frame[seq % TK_PREDICT_HISTORY] + 1) * RENDER_FPS_MS);
+            }
+            b->display_seq = MAX(b->display_seq, msg->seq);
+        }
+        free(msg->data);
+    }
+    if (!scripted) {
+        if (b->held_key != PREDICT_BENCH_NO_KEY) {
+            client_input(b, EVENT_KEY_RELEASE, b->held_key);
+            b->held_key = PREDICT_BENCH_NO_KEY;
+        }
+        return ret;
+    }
+    if (tk_rand_range(&b->rng_state, 0, 9) == 0) {
+        if (b->held_key != PREDICT_BENCH_NO_KEY) {
+            client_input(b, EVENT_KEY_RELEASE, b->held_key);
+        }
+        key = tk_rand_range(&b->rng_state, KEY_LEFT, KEY_BACKWARD + 1);
+        b->held_key = (key > KEY_BACKWARD) ? PREDICT_BENCH_NO_KEY : key;
+    }
+    if (b->held_key != PREDICT_BENCH_NO_KEY) {
+        client_input(b, EVENT_KEY_PRESS, b->held_key);
+    }
+    return ret;
+}
+
+int tk_run_predict_bench(const PredictBenchConfig *config) {
+    PredictBench *b = NULL;
+    Tank *tank = NULL;
+    uint32_t frames = config->duration * PREDICT_BENCH_FRAMES_PER_TICK, settle_frames = 0;
+    tk_float32_t error_px = -1;
+    int ret = -1;
+
+    b = calloc(1, sizeof(PredictBench));
+    if (!b) {
+        return -1;
+    }
+    b->config = config;
+    b->snap = malloc(sizeof(Snapshot));
+    b->decoded = malloc(sizeof(Snapshot));
+    if (!b->snap || !b->decoded) {
+        goto out;
+    }
+    b->server = tk_headless_game_create(config->seed, config->enemies + 1, config->enemies);
+    if (!b->server || (tk_predict_init(&b->predictor, config->seed) != 0)) {
+        goto cleanup;
+    }
+    b->up.delay_frames = b->down.delay_frames = (config->rtt_ms / 2 + RENDER_FPS_MS / 2) / RENDER_FPS_MS;
+    b->rng_state = tk_rand_seed(config->seed + 2);
+    b->held_key = PREDICT_BENCH_NO_KEY;
+    tk_histogram_init(&b->predicted_latency);
+    tk_histogram_init(&b->authoritative_latency);
+    if (spawn_player(b) != 0) {
+        goto cleanup;
+    }
+    tk_debug("predict bench: map %dx%d, rtt %ums(%u frames each way), %u enemies, run %u ticks, seed %u\n", HORIZON_GRID_NUMBER,
+        VERTICAL_GRID_NUMBER, config->rtt_ms, b->up.delay_frames, config->enemies, config->duration, config->seed);
+
+    // 停止输入后再等一个往返加两个模拟帧，让所有输入都被确认
+    settle_frames = 2 * b->up.delay_frames + 2 * PREDICT_BENCH_FRAMES_PER_TICK + 1;
+    for (b->frame = 1; b->frame <= frames + settle_frames; b->frame++) {
+        if ((client_frame(b, b->frame <= frames) != 0) || (server_frame(b) != 0)) {
+            tk_debug("Error: predict bench failed at frame %u\n", b->frame);
+            goto cleanup;
+        }
+    }
+
+    tk_histogram_print_header("latency(ms)");
+    printf("\n");
+    tk_histogram_print_row("predicted", &b->predicted_latency, 1);
+    printf("\n");
+    tk_histogram_print_row("authoritative", &b->authoritative_latency, 1);
+    printf("\n");
+    tank = get_tank_by_handle(b->server, b->player_handle);
+    if (tank && b->predictor.tank) {
+        error_px = hypotf(tank->position.x - b->predictor.tank->position.x, tank->position.y - b->predictor.tank->position.y);
+    }
+    tk_debug("predict bench done: %lu reconciles, %lu rewinds, %lu corrections(max %.2f px), %.1f inputs replayed per rewind, "
+        "%u respawns, final prediction error %.3f px\n", b->predictor.reconciles, b->predictor.rewinds, b->predictor.corrections,
+        b->predictor.max_correction_px, b->predictor.rewinds ? (double)b->predictor.replayed / b->predictor.rewinds : 0.0,
+        b->respawns, error_px);
+    // 所有输入确认后，预测的坦克与服务器上的坦克只差量化误差
+    ret = ((error_px < 0) || ((error_px <= PREDICT_BENCH_POS_TOLERANCE) &&
+        (fabsf(tank->angle_deg - b->predictor.tank->angle_deg) < 1e-3f))) ? 0 : -1;
+
+cleanup:
+    lag_channel_clear(&b->up);
+    lag_channel_clear(&b->down);
+    tk_predict_cleanup(&b->predictor);
+    tk_headless_game_destroy(b->server);
+out:
+    free(b->decoded);
+    free(b->snap);
+    free(b);
+    return ret;
+}
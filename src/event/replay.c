@@ -0,0 +1,542 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "replay.h"
+#include "event_loop.h"
+#include "game_state.h"
+#include "tools.h"
+#include "debug.h"
+
+// 可增长的字节缓冲，用于拼装快照
+typedef struct {
+    uint8_t *data;
+    size_t len;
+    size_t cap;
+} ReplayBuf;
+
+// 只读游标，越界后error置1，之后读出的都是0
+typedef struct {
+    const uint8_t *data;
+    size_t len;
+    size_t pos;
+    int error;
+} ReplayReader;
+
+static void buf_put(ReplayBuf *buf, const void *src, size_t n) {
+    if (buf->len + n > buf->cap) {
+        size_t cap = buf->cap ? buf->cap : 256;
+        while (cap < buf->len + n) {
+            cap *= 2;
+        }
+        uint8_t *data = realloc(buf->data, cap);
+        if (!data) {
+            tk_debug("Error: %s realloc %zu bytes failed\n", __func__, cap);
+            exit(1);
+        }
+        buf->data = data;
+        buf->cap = cap;
+    }
+    memcpy(buf->data + buf->len, src, n);
+    buf->len += n;
+}
+
+static void buf_put_u8(ReplayBuf *buf, uint8_t v) {
+    buf_put(buf, &v, 1);
+}
+
+static void buf_put_u16(ReplayBuf *buf, uint16_t v) {
+    uint8_t b[2] = {v & 0xff, v >> 8};
+    buf_put(buf, b, 2);
+}
+
+static void buf_put_u32(ReplayBuf *buf, uint32_t v) {
+    uint8_t b[4] = {v & 0xff, (v >> 8) & 0xff, (v >> 16) & 0xff, v >> 24};
+    buf_put(buf, b, 4);
+}
+
+static void buf_put_f32(ReplayBuf *buf, tk_float32_t v) { // 按位保存，保证逐位复现
+    uint32_t bits;
+    memcpy(&bits, &v, 4);
+    buf_put_u32(buf, bits);
+}
+
+static void buf_put_point(ReplayBuf *buf, const Point *p) {
+    buf_put_f32(buf, p->x);
+    buf_put_f32(buf, p->y);
+}
+
+static void buf_put_rect(ReplayBuf *buf, const Rectangle *r) {
+    buf_put_point(buf, &r->lefttop);
+    buf_put_point(buf, &r->righttop);
+    buf_put_point(buf, &r->rightbottom);
+    buf_put_point(buf, &r->leftbottom);
+}
+
+static const uint8_t *reader_take(ReplayReader *r, size_t n) {
+    static const uint8_t zeros[TANK_NAME_MAXLEN] = {0};
+    if (r->error || (r->pos + n > r->len)) {
+        r->error = 1;
+        return zeros;
+    }
+    r->pos += n;
+    return r->data + r->pos - n;
+}
+
+static uint8_t get_u8(ReplayReader *r) {
+    return reader_take(r, 1)[0];
+}
+
+static uint16_t get_u16(ReplayReader *r) {
+    const uint8_t *b = reader_take(r, 2);
+    return b[0] | (b[1] << 8);
+}
+
+static uint32_t get_u32(ReplayReader *r) {
+    const uint8_t *b = reader_take(r, 4);
+    return b[0] | (b[1] << 8) | (b[2] << 16) | ((uint32_t)b[3] << 24);
+}
+
+static tk_float32_t get_f32(ReplayReader *r) {
+    uint32_t bits = get_u32(r);
+    tk_float32_t v;
+    memcpy(&v, &bits, 4);
+    return v;
+}
+
+static Point get_point(ReplayReader *r) {
+    Point p;
+    p.x = get_f32(r);
+    p.y = get_f32(r);
+    return p;
+}
+
+static Rectangle get_rect(ReplayReader *r) {
+    Rectangle rect;
+    rect.lefttop = get_point(r);
+    rect.righttop = get_point(r);
+    rect.rightbottom = get_point(r);
+    rect.leftbottom = get_point(r);
+    return rect;
+}
+
+/*快照：模拟帧计数、随机数状态、暂停标记，以及每辆坦克和它的炮弹。
+  坦克与炮弹都是头插入链表的，这里逆序保存，恢复时顺序创建即可得到相同的链表顺序。
+  ID/句柄、爆炸粒子、插值历史只影响显示，不保存*/
+static void snapshot_game_state(GameState *gs, ReplayBuf *buf) {
+    Tank *tank = NULL;
+    Shell *shell = NULL;
+    tk_uint8_t shell_num = 0;
+
+    buf_put_u32(buf, gs->tick);
+    buf_put_u32(buf, gs->rng_state);
+    buf_put_u8(buf, gs->stop_game);
+    buf_put_u32(buf, gs->tank_num);
+    TAILQ_FOREACH_REVERSE(tank, &gs->tank_list, _tk_tanks_list, chain) {
+        buf_put(buf, tank->name, TANK_NAME_MAXLEN);
+        buf_put_u8(buf, tank->role);
+        buf_put_point(buf, &tank->position);
+        buf_put_f32(buf, tank->angle_deg);
+        buf_put_f32(buf, tank->speed);
+        buf_put_u16(buf, tank->health);
+        buf_put_u16(buf, tank->max_health);
+        buf_put_u16(buf, tank->score);
+        buf_put_u32(buf, tank->flags);
+        buf_put_u8(buf, tank->collision_flag);
+        buf_put_u8(buf, tank->dying_ticks);
+        buf_put_u8(buf, tank->max_shell_num);
+        buf_put_rect(buf, &tank->outline);
+        buf_put_rect(buf, &tank->practical_outline);
+        buf_put_u32(buf, tank->key_value_for_control.mask);
+        buf_put_u32(buf, (uint32_t)tank->current_grid.x);
+        buf_put_u32(buf, (uint32_t)tank->current_grid.y);
+        if (tank->steps_to_escape) {
+            for (int i = 0; i < STEPS_TO_ESCAPE_NUM; i++) {
+                buf_put_u32(buf, tank->steps_to_escape[i]);
+            }
+        }
+        if (tank->map_vis) {
+            for (int y = 0; y < VERTICAL_GRID_NUMBER; y++) {
+                for (int x = 0; x < HORIZON_GRID_NUMBER; x++) {
+                    buf_put_u32(buf, tank->map_vis[y][x]);
+                }
+            }
+        }
+        shell_num = 0;
+        TAILQ_FOREACH(shell, &tank->shell_list, chain) {
+            shell_num++;
+        }
+        buf_put_u8(buf, shell_num);
+        TAILQ_FOREACH_REVERSE(shell, &tank->shell_list, _tank_shells_list, chain) {
+            buf_put_point(buf, &shell->position);
+            buf_put_f32(buf, shell->angle_deg);
+            buf_put_f32(buf, shell->speed);
+            buf_put_u8(buf, shell->ttl);
+        }
+    }
+}
+
+static int restore_game_state(GameState *gs, ReplayReader *r) {
+    tk_uint32_t tank_num = 0;
+    tk_uint8_t shell_num = 0, role = 0;
+    char name[TANK_NAME_MAXLEN];
+    Tank *tank = NULL;
+    Shell *shell = NULL;
+    Point position;
+    tk_float32_t angle_deg = 0;
+
+    delete_all_tanks(gs);
+    gs->tick = get_u32(r);
+    gs->rng_state = get_u32(r);
+    gs->stop_game = get_u8(r);
+    tank_num = get_u32(r);
+    for (tk_uint32_t i = 0; (i < tank_num) && !r->error; i++) {
+        memcpy(name, reader_take(r, TANK_NAME_MAXLEN), TANK_NAME_MAXLEN);
+        name[TANK_NAME_MAXLEN - 1] = '\0';
+        role = get_u8(r);
+        position = get_point(r);
+        angle_deg = get_f32(r);
+        tank = create_tank(gs, (tk_uint8_t *)name, position, angle_deg, role);
+        if (!tank) {
+            return -1;
+        }
+        tank->speed = get_f32(r);
+        tank->health = get_u16(r);
+        tank->max_health = get_u16(r);
+        tank->score = get_u16(r);
+        tank->flags = get_u32(r);
+        tank->collision_flag = get_u8(r);
+        tank->dying_ticks = get_u8(r);
+        tank->max_shell_num = get_u8(r);
+        tank->outline = get_rect(r);
+        tank->practical_outline = get_rect(r);
+        tank->key_value_for_control.mask = get_u32(r);
+        tank->current_grid.x = (int)get_u32(r);
+        tank->current_grid.y = (int)get_u32(r);
+        if (tank->steps_to_escape) {
+            for (int j = 0; j < STEPS_TO_ESCAPE_NUM; j++) {
+                tank->steps_to_escape[j] = get_u32(r);
+            }
+        }
+        if (tank->map_vis) {
+            for (int y = 0; y < VERTICAL_GRID_NUMBER; y++) {
+                for (int x = 0; x < HORIZON_GRID_NUMBER; x++) {
+                    tank->map_vis[y][x] = get_u32(r);
+                }
+            }
+        }
+        shell_num = get_u8(r);
+        for (int j = 0; (j < shell_num) && !r->error; j++) {
+            shell = create_shell(tank);
+            if (!shell) {
+                return -1;
+            }
+            shell->position = get_point(r);
+            shell->angle_deg = get_f32(r);
+            shell->speed = get_f32(r);
+            shell->ttl = get_u8(r);
+            init_motion_history(&shell->motion, &shell->position, shell->angle_deg);
+        }
+    }
+    return r->error ? -1 : 0;
+}
+
+// FNV-1a
+static uint32_t hash_bytes(const uint8_t *data, size_t len) {
+    uint32_t hash = 2166136261u;
+    for (size_t i = 0; i < len; i++) {
+        hash ^= data[i];
+        hash *= 16777619u;
+    }
+    return hash;
+}
+
+uint32_t tk_game_state_hash(GameState *gs) {
+    ReplayBuf buf = {0};
+    uint32_t hash = 0;
+
+    snapshot_game_state(gs, &buf);
+    hash = hash_bytes(buf.data, buf.len);
+    free(buf.data);
+    return hash;
+}
+
+/*录制（一个进程只录制一局，即tk_replay_record_start()绑定的那一局，其他对局调用下列函数均为空操作）*/
+static FILE *tk_replay_out = NULL;
+static GameState *tk_replay_game = NULL;
+static uint32_t tk_replay_pending_ticks = 0; // 尚未写出的连续模拟帧
+static uint32_t tk_replay_recorded_ticks = 0;
+
+static void write_varint(FILE *fp, uint32_t v) {
+    while (v >= 0x80) {
+        fputc((v & 0x7f) | 0x80, fp);
+        v >>= 7;
+    }
+    fputc(v, fp);
+}
+
+static void flush_pending_ticks() {
+    if (tk_replay_pending_ticks) {
+        fputc(TK_REPLAY_REC_TICKS, tk_replay_out);
+        write_varint(tk_replay_out, tk_replay_pending_ticks);
+        tk_replay_pending_ticks = 0;
+    }
+}
+
+static void write_keyframe(GameState *gs) {
+    ReplayBuf buf = {0};
+    ReplayBuf len = {0};
+
+    buf_put_u32(&buf, tk_replay_recorded_ticks);
+    snapshot_game_state(gs, &buf);
+    buf_put_u32(&len, buf.len);
+    fputc(TK_REPLAY_REC_KEYFRAME, tk_replay_out);
+    fwrite(len.data, 1, len.len, tk_replay_out);
+    fwrite(buf.data, 1, buf.len, tk_replay_out);
+    free(len.data);
+    free(buf.data);
+}
+
+// 在游戏开始前（初始状态已建立、控制线程尚未运行）调用
+int tk_replay_record_start(GameState *gs, const char *path) {
+    ReplayBuf header = {0};
+
+    tk_replay_out = fopen(path, "wb");
+    if (!tk_replay_out) {
+        tk_debug("Error: failed to open replay file %s\n", path);
+        return -1;
+    }
+    buf_put(&header, TK_REPLAY_MAGIC, 4);
+    buf_put_u8(&header, TK_REPLAY_VERSION);
+    buf_put_u8(&header, HORIZON_GRID_NUMBER);
+    buf_put_u8(&header, VERTICAL_GRID_NUMBER);
+    buf_put_u8(&header, TK_TICK_MS);
+    buf_put_u32(&header, gs->maze_seed);
+    buf_put_u32(&header, gs->rng_seed);
+    fwrite(header.data, 1, header.len, tk_replay_out);
+    free(header.data);
+    tk_replay_pending_ticks = tk_replay_recorded_ticks = 0;
+    tk_replay_game = gs;
+    tk_debug("recording replay to %s\n", path);
+    return 0;
+}
+
+void tk_replay_record_event(GameState *gs, Event *event) {
+    if (!tk_replay_out || (gs != tk_replay_game)) return;
+    flush_pending_ticks();
+    fputc(TK_REPLAY_REC_EVENT, tk_replay_out);
+    fputc(event->type, tk_replay_out);
+    if ((event->type == EVENT_KEY_PRESS) || (event->type == EVENT_KEY_RELEASE)) {
+        fputc(event->data.key, tk_replay_out);
+    } else if (event->type == EVENT_PATH_SEARCH) {
+        fputc(event->data.path_search_request.end.x, tk_replay_out);
+        fputc(event->data.path_search_request.end.y, tk_replay_out);
+    }
+}
+
+// 在每个模拟帧执行完之后调用
+void tk_replay_record_tick(GameState *gs) {
+    if (!tk_replay_out || (gs != tk_replay_game)) return;
+    tk_replay_pending_ticks++;
+    tk_replay_recorded_ticks++;
+    if ((tk_replay_recorded_ticks % TK_REPLAY_KEYFRAME_TICKS) == 0) {
+        flush_pending_ticks();
+        write_keyframe(gs);
+    }
+}
+
+void tk_replay_record_stop() {
+    if (!tk_replay_out) return;
+    flush_pending_ticks();
+    fputc(TK_REPLAY_REC_END, tk_replay_out);
+    fclose(tk_replay_out);
+    tk_replay_out = NULL;
+    tk_replay_game = NULL;
+    tk_debug("replay recorded: %u ticks\n", tk_replay_recorded_ticks);
+}
+
+/*回放*/
+static int read_varint(FILE *fp, uint32_t *v) {
+    int c = 0, shift = 0;
+    *v = 0;
+    do {
+        if ((c = fgetc(fp)) == EOF || shift > 28) {
+            return -1;
+        }
+        *v |= (uint32_t)(c & 0x7f) << shift;
+        shift += 7;
+    } while (c & 0x80);
+    return 0;
+}
+
+// 读出关键帧记录体（调用者负责free）
+static uint8_t *read_keyframe(FILE *fp, uint32_t *len) {
+    uint8_t b[4];
+    uint8_t *data = NULL;
+
+    if (fread(b, 1, 4, fp) != 4) {
+        return NULL;
+    }
+    *len = b[0] | (b[1] << 8) | (b[2] << 16) | ((uint32_t)b[3] << 24);
+    data = malloc(*len ? *len : 1);
+    if (data && (fread(data, 1, *len, fp) != *len)) {
+        free(data);
+        return NULL;
+    }
+    return data;
+}
+
+// 读出一条事件记录
+static int read_event(FILE *fp, Event *event) {
+    int type = fgetc(fp);
+    if (type == EOF) {
+        return -1;
+    }
+    memset(event, 0, sizeof(*event));
+    event->type = type;
+    if ((type == EVENT_KEY_PRESS) || (type == EVENT_KEY_RELEASE)) {
+        event->data.key = fgetc(fp);
+    } else if (type == EVENT_PATH_SEARCH) {
+        event->data.path_search_request.end.x = fgetc(fp);
+        event->data.path_search_request.end.y = fgetc(fp);
+    }
+    return feof(fp) ? -1 : 0;
+}
+
+// 第一遍扫描：找到seek_tick之前（含）最近的关键帧在文件中的位置，找不到返回-1
+static long find_keyframe(FILE *fp, uint32_t seek_tick) {
+    long found = -1, pos = 0;
+    uint32_t n = 0, len = 0, ticks = 0;
+    uint8_t *data = NULL;
+    Event event;
+    int type = 0;
+
+    while ((type = fgetc(fp)) != EOF) {
+        if (type == TK_REPLAY_REC_TICKS) {
+            if (read_varint(fp, &n) != 0) break;
+            ticks += n;
+            if (ticks >= seek_tick) break;
+        } else if (type == TK_REPLAY_REC_EVENT) {
+            if (read_event(fp, &event) != 0) break;
+        } else if (type == TK_REPLAY_REC_KEYFRAME) {
+            pos = ftell(fp) - 1;
+            if (!(data = read_keyframe(fp, &len))) break;
+            free(data);
+            found = pos;
+        } else {
+            break;
+        }
+    }
+    return found;
+}
+
+int tk_replay_play(const char *path, uint32_t seek_tick) {
+    FILE *fp = NULL;
+    uint8_t header[16];
+    uint32_t maze_seed = 0, rng_seed = 0, n = 0, len = 0;
+    uint32_t ticks = 0, keyframes = 0, mismatches = 0;
+    uint64_t start_ns = 0, elapsed_ns = 0;
+    uint8_t *data = NULL;
+    ReplayBuf now = {0};
+    ReplayReader reader;
+    Event event;
+    GameState *gs = NULL;
+    EventLoopContext ctx = {.pipe_fds = {-1, -1}}; // 回放没有事件基，handle_event()只用到其中的对局
+    long keyframe_pos = -1;
+    int type = 0, ret = -1;
+
+    fp = fopen(path, "rb");
+    if (!fp) {
+        tk_debug("Error: failed to open replay file %s\n", path);
+        return -1;
+    }
+    if ((fread(header, 1, sizeof(header), fp) != sizeof(header)) || memcmp(header, TK_REPLAY_MAGIC, 4)) {
+        tk_debug("Error: %s is not a replay file\n", path);
+        goto out;
+    }
+    if ((header[4] != TK_REPLAY_VERSION) || (header[5] != HORIZON_GRID_NUMBER) || (header[6] != VERTICAL_GRID_NUMBER)
+        || (header[7] != TK_TICK_MS)) {
+        tk_debug("Error: replay %s(version %u, map %ux%u, tick %ums) doesn't match this build(version %u, map %ux%u, tick %ums)\n",
+            path, header[4], header[5], header[6], header[7], TK_REPLAY_VERSION, HORIZON_GRID_NUMBER, VERTICAL_GRID_NUMBER, TK_TICK_MS);
+        goto out;
+    }
+    maze_seed = header[8] | (header[9] << 8) | (header[10] << 16) | ((uint32_t)header[11] << 24);
+    rng_seed = header[12] | (header[13] << 8) | (header[14] << 16) | ((uint32_t)header[15] << 24);
+
+    gs = malloc(sizeof(GameState));
+    if (!gs) {
+        goto out;
+    }
+    ctx.game = gs;
+    if ((init_game_state(gs, maze_seed, rng_seed) != 0) || (start_new_game(gs) != 0)) {
+        goto cleanup;
+    }
+
+    if (seek_tick > 0) { // 从关键帧恢复，省去之前的模拟
+        keyframe_pos = find_keyframe(fp, seek_tick);
+        fseek(fp, (keyframe_pos >= 0) ? keyframe_pos : (long)sizeof(header), SEEK_SET);
+    }
+    start_ns = (seek_tick == 0) ? tk_get_monotonic_ns() : 0;
+    while ((type = fgetc(fp)) != EOF) {
+        if (type == TK_REPLAY_REC_TICKS) {
+            if (read_varint(fp, &n) != 0) break;
+            for (uint32_t i = 0; i < n; i++) {
+                game_state_tick(gs);
+                if (++ticks == seek_tick) {
+                    start_ns = tk_get_monotonic_ns();
+                }
+            }
+        } else if (type == TK_REPLAY_REC_EVENT) {
+            if (read_event(fp, &event) != 0) break;
+            handle_event(&ctx, &event);
+        } else if (type == TK_REPLAY_REC_KEYFRAME) {
+            if (!(data = read_keyframe(fp, &len))) break;
+            reader = (ReplayReader){data, len, 0, 0};
+            if (ftell(fp) - (long)len - 5 == keyframe_pos) { // 跳转的目标关键帧：恢复状态
+                ticks = get_u32(&reader);
+                if (restore_game_state(gs, &reader) != 0) {
+                    tk_debug("Error: corrupted keyframe at tick %u\n", ticks);
+                    free(data);
+                    goto cleanup;
+                }
+                tk_debug("seek: restored keyframe at tick %u\n", ticks);
+                if (ticks >= seek_tick) {
+                    start_ns = tk_get_monotonic_ns();
+                }
+            } else { // 途经的关键帧：与当前状态逐字节比对
+                now.len = 0;
+                buf_put_u32(&now, ticks);
+                snapshot_game_state(gs, &now);
+                keyframes++;
+                if ((now.len != len) || memcmp(now.data, data, len)) {
+                    mismatches++;
+                    tk_debug("Error: replay diverged before tick %u (state hash %08x, recorded %08x)\n", ticks,
+                        hash_bytes(now.data, now.len), hash_bytes(data, len));
+                }
+            }
+            free(data);
+        } else if (type == TK_REPLAY_REC_END) {
+            ret = 0;
+            break;
+        } else {
+            tk_debug("Error: unknown replay record type %d\n", type);
+            break;
+        }
+    }
+    if (ret != 0) {
+        tk_debug("Error: replay %s is truncated or corrupted after tick %u\n", path, ticks);
+    }
+    elapsed_ns = start_ns ? tk_get_monotonic_ns() - start_ns : 0;
+    tk_debug("replay finished: %u ticks (timed from tick %u) in %.3fms (%.1f ticks/s), %u keyframes checked, %u mismatches, "
+        "final state hash %08x\n", ticks, seek_tick, elapsed_ns / 1e6,
+        elapsed_ns ? (ticks - MIN(seek_tick, ticks)) * 1e9 / elapsed_ns : 0.0, keyframes, mismatches, tk_game_state_hash(gs));
+    if (mismatches) {
+        ret = -1;
+    }
+cleanup:
+    free(now.data);
+    cleanup_game_state(gs);
+    free(gs);
+out:
+    fclose(fp);
+    return ret;
+}
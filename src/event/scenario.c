@@ -0,0 +1,90 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "scenario.h"
+#include "headless.h"
+#include "game_state.h"
+#include "profiler.h"
+#include "tools.h"
+#include "debug.h"
+
+#define SCENARIO_REPORT_TIMES 10 // 运行过程中打印多少次阶段性统计
+
+static void count_alive_objects(GameState *gs, tk_uint32_t *tanks, tk_uint32_t *shells) {
+    Tank *tank = NULL;
+    Shell *shell = NULL;
+
+    *tanks = *shells = 0;
+    TAILQ_FOREACH(tank, &gs->tank_list, chain) {
+        if (TST_FLAG(tank, flags, TANK_ALIVE)) {
+            (*tanks)++;
+        }
+        TAILQ_FOREACH(shell, &tank->shell_list, chain) {
+            (*shells)++;
+        }
+    }
+}
+
+int tk_run_scenario(const ScenarioConfig *config) {
+    tk_histogram_t total, window;
+    tk_uint32_t tanks = 0, shells = 0, peak_shells = 0, over_budget = 0;
+    uint32_t report_every = 0;
+    uint64_t tick_start_ns = 0, tick_ns = 0, elapsed_ns = 0;
+    uint64_t budget_ns = (uint64_t)TK_TICK_MS * 1000000;
+    char title[16];
+    GameState *gs = NULL;
+    int ret = -1;
+
+    gs = tk_headless_game_create(config->seed, config->enemies + 1, 0); // 我的坦克加上所有敌人
+    if (!gs) {
+        return -1;
+    }
+    if (config->fire_interval) {
+        gs->muggle_shoot_interval = config->fire_interval;
+    }
+    if ((start_new_game(gs) != 0) || // 一辆我的坦克（原地不动）和muggle-0
+        ((config->enemies > 1) && (spawn_muggle_enemies(gs, config->enemies - 1) != 0))) {
+        goto out;
+    }
+    tk_debug("scenario: map %dx%d, %u enemies, fire every %lu ticks, run %u ticks(%us game time), seed %u\n",
+        HORIZON_GRID_NUMBER, VERTICAL_GRID_NUMBER, config->enemies, gs->muggle_shoot_interval,
+        config->duration, config->duration * TK_TICK_MS / 1000, config->seed);
+
+    tk_histogram_init(&total);
+    tk_histogram_init(&window);
+    report_every = (config->duration >= SCENARIO_REPORT_TIMES) ? (config->duration / SCENARIO_REPORT_TIMES) : 1;
+    tk_histogram_print_header("tick(us)");
+    printf(" %7s %7s\n", "tanks", "shells");
+    for (uint32_t i = 1; i <= config->duration; i++) {
+        tick_start_ns = tk_get_monotonic_ns();
+        game_state_tick(gs);
+        tick_ns = tk_get_monotonic_ns() - tick_start_ns;
+        tk_histogram_record(&total, tick_ns);
+        tk_histogram_record(&window, tick_ns);
+        if (tick_ns > budget_ns) {
+            over_budget++;
+        }
+        count_alive_objects(gs, &tanks, &shells); // 不计入模拟帧耗时
+        peak_shells = MAX(peak_shells, shells);
+        if (((i % report_every) == 0) || (i == config->duration)) { // 阶段性统计：观察实体数量变化对耗时的影响
+            snprintf(title, sizeof(title), "@%u", i);
+            tk_histogram_print_row(title, &window, 1000.0);
+            printf(" %7lu %7lu\n", tanks, shells);
+            tk_histogram_init(&window);
+        }
+    }
+    elapsed_ns = total.sum; // 只算模拟帧本身的耗时
+
+    tk_histogram_print_row("total", &total, 1000.0);
+    printf("\n");
+    tk_debug("scenario done: %u ticks in %.3fs (%.1f ticks/s, %.1fx realtime), %lu ticks over the %ums budget, "
+        "%lu tanks alive, peak shells %lu\n", config->duration, elapsed_ns / 1e9,
+        elapsed_ns ? config->duration * 1e9 / elapsed_ns : 0.0,
+        elapsed_ns ? (double)config->duration * TK_TICK_MS * 1e6 / elapsed_ns : 0.0,
+        over_budget, TK_TICK_MS, tanks, peak_shells);
+    ret = 0;
+
+out:
+    tk_headless_game_destroy(gs);
+    return ret;
+}
@@ -0,0 +1,217 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <errno.h>
+#include <pthread.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "bot_shm.h"
+#include "game_state.h"
+#include "tools.h"
+#include "debug.h"
+
+#define SHM_BOT_VIEW_TIMEOUT_MS 1000
+#define SHM_BOT_IDLE_LIMIT 5 // 连续这么多次等不到新视图（宿主停住或已退出）就放弃
+
+typedef struct {
+    uint32_t index;
+    pthread_t tid;
+    const ShmBotsConfig *config;
+    TkBotShmRegion *region;
+    TkBotSlot *slot;
+    TkBotWorldView *view;
+    uint32_t rng_state;
+    uint32_t held;
+    uint32_t hold_ticks;
+    // 结果
+    int ok;
+    int host_exited;
+    uint32_t slot_index;
+    uint32_t steps;
+    uint32_t deaths; // 看到自己的坦克由存活变为被击毁的次数
+    uint32_t fired;
+    uint64_t elapsed_ns;
+} ShmBot;
+
+static int claim_slot(ShmBot *bot) {
+    uint32_t owner = (uint32_t)syscall(SYS_gettid); // 宿主据此用kill(owner, 0)判断机器人是否还在
+    uint32_t expected = 0;
+
+    for (uint32_t i = 0; i < bot->region->slot_num; i++) {
+        expected = 0;
+        if (__atomic_compare_exchange_n(&bot->region->slots[i].owner, &expected, owner, 0, __ATOMIC_ACQ_REL, __ATOMIC_RELAXED)) {
+            bot->slot = &bot->region->slots[i];
+            bot->slot_index = i;
+            tk_bot_shm_submit(bot->region, bot->slot, 0, 0); // 清掉上一个机器人留下的按键，并通知宿主
+            return 0;
+        }
+    }
+    return -1;
+}
+
+static void release_slot(ShmBot *bot) {
+    __atomic_store_n(&bot->slot->owner, 0, __ATOMIC_RELEASE);
+    __atomic_add_fetch(&bot->region->input_bell, 1, __ATOMIC_RELEASE);
+    tk_bot_shm_wake(&bot->region->input_bell);
+}
+
+static const TkBotTankView* find_tank(const TkBotWorldView *view, uint32_t handle) {
+    for (uint32_t i = 0; i < view->tank_num; i++) {
+        if (view->tanks[i].handle == handle) {
+            return &view->tanks[i];
+        }
+    }
+    return NULL;
+}
+
+// 随机按住一组方向键若干帧（同lockstep.c），有敌方坦克大致位于炮口方向时开炮
+static uint32_t decide(ShmBot *bot, const TkBotTankView *me) {
+    static const uint32_t masks[] = {0, TK_KEY_W_ACTIVE, TK_KEY_W_ACTIVE, TK_KEY_S_ACTIVE, TK_KEY_A_ACTIVE, TK_KEY_D_ACTIVE,
+        TK_KEY_W_ACTIVE | TK_KEY_A_ACTIVE, TK_KEY_W_ACTIVE | TK_KEY_D_ACTIVE};
+    const TkBotWorldView *view = bot->view;
+    float dx = 0, dy = 0, bearing = 0, diff = 0;
+
+    if (bot->hold_ticks == 0) {
+        bot->held = masks[tk_rand_range(&bot->rng_state, 0, sizeof(masks) / sizeof(masks[0]) - 1)];
+        bot->hold_ticks = tk_rand_range(&bot->rng_state, 3, 12);
+    }
+    bot->hold_ticks--;
+    for (uint32_t i = 0; i < view->tank_num; i++) {
+        if ((view->tanks[i].handle == me->handle) || !view->tanks[i].alive) {
+            continue;
+        }
+        dx = view->tanks[i].x - me->x;
+        dy = view->tanks[i].y - me->y;
+        bearing = atan2f(dx, -dy) * 180 / M_PI; // 正北为0，顺时针（y轴向下）
+        diff = fabsf(fmodf(bearing - me->angle_deg + 540, 360) - 180);
+        if (diff < 5) {
+            bot->fired++;
+            return bot->held | TK_BOT_BUTTON_FIRE;
+        }
+    }
+    return bot->held;
+}
+
+static void* shm_bot_thread(void *arg) {
+    ShmBot *bot = (ShmBot *)arg;
+    const TkBotTankView *me = NULL;
+    uint32_t seq = 0, idle = 0, buttons = 0, was_alive = 0;
+    uint64_t start = 0;
+
+    if (claim_slot(bot) != 0) {
+        tk_debug("Error: bot %u found no free slot\n", bot->index);
+        return NULL;
+    }
+    start = tk_get_monotonic_ns();
+    while (bot->steps < bot->config->steps) {
+        if (!tk_bot_shm_read_view(bot->region, bot->view, &seq, SHM_BOT_VIEW_TIMEOUT_MS)) {
+            if (!__atomic_load_n(&bot->region->running, __ATOMIC_ACQUIRE)) {
+                bot->host_exited = 1;
+                break;
+            }
+            if (++idle >= SHM_BOT_IDLE_LIMIT) {
+                tk_debug("Error: bot %u got no new view in %ums\n", bot->index, SHM_BOT_IDLE_LIMIT * SHM_BOT_VIEW_TIMEOUT_MS);
+                break;
+            }
+            continue;
+        }
+        idle = 0;
+        me = find_tank(bot->view, __atomic_load_n(&bot->slot->tank_handle, __ATOMIC_ACQUIRE));
+        buttons = 0;
+        if (me && me->alive) {
+            buttons = decide(bot, me);
+        } else if (was_alive) {
+            bot->deaths++;
+        }
+        was_alive = me && me->alive;
+        tk_bot_shm_submit(bot->region, bot->slot, buttons, bot->view->tick);
+        bot->steps++;
+    }
+    bot->elapsed_ns = tk_get_monotonic_ns() - start;
+    bot->ok = (bot->steps == bot->config->steps) || bot->host_exited; // 宿主跑满自己的模拟帧数先退出也算正常结束
+    release_slot(bot);
+    return NULL;
+}
+
+int tk_run_shm_bots(const ShmBotsConfig *config) {
+    TkBotShmRegion *region = NULL;
+    ShmBot *bots = NULL;
+    struct stat st;
+    uint32_t started = 0, failed = 0;
+    uint64_t steps = 0, elapsed_ns = 0;
+    int fd = -1, ret = -1;
+
+    fd = shm_open(config->name, O_RDWR, 0);
+    if (fd < 0) {
+        tk_debug("Error: shm_open(%s) failed: %s, is the bot host running?\n", config->name, strerror(errno));
+        return -1;
+    }
+    if ((fstat(fd, &st) != 0) || (st.st_size < (off_t)sizeof(TkBotShmRegion))) {
+        tk_debug("Error: shm %s is smaller than expected(%zu B)\n", config->name, sizeof(TkBotShmRegion));
+        close(fd);
+        return -1;
+    }
+    region = mmap(NULL, sizeof(TkBotShmRegion), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd);
+    if (region == MAP_FAILED) {
+        tk_debug("Error: mmap(%s) failed: %s\n", config->name, strerror(errno));
+        return -1;
+    }
+    if ((region->magic != TK_BOT_SHM_MAGIC) || (region->version != TK_BOT_SHM_VERSION)) {
+        tk_debug("Error: shm %s is not a bot host region of version %d\n", config->name, TK_BOT_SHM_VERSION);
+        goto out;
+    }
+    if (config->bots > region->slot_num) {
+        tk_debug("Error: %u bots but the host only has %u slots\n", config->bots, region->slot_num);
+        goto out;
+    }
+    bots = calloc(config->bots, sizeof(ShmBot));
+    if (!bots) {
+        goto out;
+    }
+    tk_debug("shm bots: %u bots on %s, map %ux%u, %s, %u steps each\n", config->bots, config->name, region->map_horizon,
+        region->map_vertical, region->pace_ms ? "realtime host" : "step mode host", config->steps);
+    for (uint32_t i = 0; i < config->bots; i++) {
+        bots[i].index = i;
+        bots[i].config = config;
+        bots[i].region = region;
+        bots[i].rng_state = tk_rand_seed(config->seed + i);
+        bots[i].view = malloc(sizeof(TkBotWorldView));
+        if (!bots[i].view || (pthread_create(&bots[i].tid, NULL, shm_bot_thread, &bots[i]) != 0)) {
+            tk_debug("Error: failed to start bot %u\n", i);
+            break;
+        }
+        started++;
+    }
+    for (uint32_t i = 0; i < started; i++) {
+        pthread_join(bots[i].tid, NULL);
+    }
+
+    tk_log_flush();
+    printf("%4s %5s %8s %10s %7s %6s %6s\n", "bot", "slot", "steps", "steps/s", "deaths", "fired", "late");
+    for (uint32_t i = 0; i < config->bots; i++) {
+        ShmBot *bot = &bots[i];
+        if (!bot->ok) {
+            failed++;
+        }
+        steps += bot->steps;
+        elapsed_ns = MAX(elapsed_ns, bot->elapsed_ns);
+        printf("%4u %5u %8u %10.0f %7u %6u %6u%s\n", i, bot->slot_index, bot->steps, bot->elapsed_ns ? bot->steps * 1e9 / bot->elapsed_ns : 0.0,
+            bot->deaths, bot->fired, bot->slot ? bot->slot->late_ticks : 0, !bot->ok ? "  (failed)" : (bot->host_exited ? "  (host exited)" : ""));
+    }
+    tk_debug("shm bots done: %u/%u bots finished, %lu steps, %.0f steps/s in total\n", config->bots - failed, config->bots,
+        steps, elapsed_ns ? steps * 1e9 / elapsed_ns : 0.0);
+    ret = failed ? -1 : 0;
+
+out:
+    if (bots) {
+        for (uint32_t i = 0; i < config->bots; i++) {
+            free(bots[i].view);
+        }
+        free(bots);
+    }
+    munmap(region, sizeof(TkBotShmRegion));
+    return ret;
+}
@@ -0,0 +1,135 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include "net_snapshot.h"
+#include "headless.h"
+#include "game_state.h"
+#include "profiler.h"
+#include "tools.h"
+#include "debug.h"
+
+#define SNAPSHOT_BENCH_TARGET_BYTES 1024 // 64辆坦克时每帧的带宽目标
+#define SNAPSHOT_BENCH_POS_TOLERANCE (0.5f / TK_SNAPSHOT_POS_SCALE + 1e-3f)
+#define SNAPSHOT_BENCH_ANGLE_TOLERANCE (TK_SNAPSHOT_ANGLE_STEP / 2.0f + 1e-3f)
+
+static tk_float32_t angle_error(tk_float32_t deg, tk_uint8_t angle) {
+    tk_float32_t diff = fabsf(fmodf(deg - TK_SNAPSHOT_TO_DEG(angle), 360));
+    return MIN(diff, 360 - diff);
+}
+
+// 解码结果与真实世界状态的量化误差应在半个精度单位以内，返回超差的对象数
+static uint32_t check_quantization(GameState *gs, const Snapshot *snap) {
+    const SnapshotTank *st = NULL;
+    const SnapshotShell *ss = NULL;
+    Tank *tank = NULL;
+    Shell *shell = NULL;
+    uint32_t errors = 0, i = 0;
+
+    TAILQ_FOREACH(tank, &gs->tank_list, chain) {
+        st = tk_snapshot_find_tank(snap, tank->id);
+        if (!st || (fabsf(tank->position.x - TK_SNAPSHOT_TO_X(st->x)) > SNAPSHOT_BENCH_POS_TOLERANCE) ||
+            (fabsf(tank->position.y - TK_SNAPSHOT_TO_Y(st->y)) > SNAPSHOT_BENCH_POS_TOLERANCE) ||
+            (angle_error(tank->angle_deg, st->angle) > SNAPSHOT_BENCH_ANGLE_TOLERANCE)) {
+            errors++;
+            continue;
+        }
+        TAILQ_FOREACH(shell, &tank->shell_list, chain) {
+            for (i = 0, ss = NULL; i < st->shell_num; i++) {
+                if (snap->shells[st->shell_start + i].id == shell->id) {
+                    ss = &snap->shells[st->shell_start + i];
+                    break;
+                }
+            }
+            if (!ss || (fabsf(shell->position.x - TK_SNAPSHOT_TO_X(ss->x)) > SNAPSHOT_BENCH_POS_TOLERANCE) ||
+                (fabsf(shell->position.y - TK_SNAPSHOT_TO_Y(ss->y)) > SNAPSHOT_BENCH_POS_TOLERANCE) ||
+                (angle_error(shell->angle_deg, ss->angle) > SNAPSHOT_BENCH_ANGLE_TOLERANCE) || (ss->ttl != shell->ttl)) {
+                errors++;
+            }
+        }
+    }
+    return errors;
+}
+
+int tk_run_snapshot_bench(const SnapshotBenchConfig *config) {
+    static uint8_t buf[TK_SNAPSHOT_MAX_BYTES];
+    tk_histogram_t delta_bytes, full_bytes;
+    Snapshot *history = NULL, *decoded = NULL, *snap = NULL, *baseline = NULL;
+    GameState *gs = NULL;
+    uint64_t encode_ns = 0, decode_ns = 0, start_ns = 0;
+    uint32_t mismatches = 0, quant_errors = 0, peak_shells = 0;
+    int len = 0, ret = -1;
+
+    if (config->ack_delay >= TK_SNAPSHOT_HISTORY) {
+        tk_debug("Error: ack delay must be less than %d ticks\n", TK_SNAPSHOT_HISTORY);
+        return -1;
+    }
+    history = malloc(sizeof(Snapshot) * TK_SNAPSHOT_HISTORY);
+    decoded = malloc(sizeof(Snapshot));
+    if (!history || !decoded) {
+        goto out;
+    }
+    gs = tk_headless_game_create(config->seed, config->tanks, config->tanks);
+    if (!gs) {
+        goto out;
+    }
+    tk_histogram_init(&delta_bytes);
+    tk_histogram_init(&full_bytes);
+    tk_debug("snapshot bench: map %dx%d, %u tanks, ack delay %u ticks, run %u ticks, seed %u\n", HORIZON_GRID_NUMBER,
+        VERTICAL_GRID_NUMBER, config->tanks, config->ack_delay, config->duration, config->seed);
+
+    for (uint32_t i = 0; i < config->duration; i++) {
+        // 被击毁的坦克删除后补充新坦克，保持坦克数量（同时覆盖差分编码中坦克的增删）
+        if ((gs->tank_num < config->tanks) && (spawn_muggle_enemies(gs, config->tanks - gs->tank_num) != 0)) {
+            goto out;
+        }
+        game_state_tick(gs);
+        snap = &history[gs->tick % TK_SNAPSHOT_HISTORY];
+        if (tk_snapshot_capture(snap, gs) != 0) {
+            goto out;
+        }
+        peak_shells = MAX(peak_shells, snap->shell_num);
+        // 对端刚确认到ack_delay帧之前的快照（开局头几帧还没有确认，发送完整快照）
+        baseline = (config->ack_delay && (i >= config->ack_delay)) ? &history[(gs->tick - config->ack_delay) % TK_SNAPSHOT_HISTORY] : NULL;
+
+        start_ns = tk_get_monotonic_ns();
+        len = tk_snapshot_encode(snap, baseline, buf, sizeof(buf));
+        encode_ns += tk_get_monotonic_ns() - start_ns;
+        if (len < 0) {
+            goto out;
+        }
+        tk_histogram_record(&delta_bytes, len);
+        start_ns = tk_get_monotonic_ns();
+        if ((tk_snapshot_decode(buf, len, baseline, decoded) != 0) || !tk_snapshot_equal(snap, decoded)) {
+            mismatches++;
+        }
+        decode_ns += tk_get_monotonic_ns() - start_ns;
+        quant_errors += check_quantization(gs, decoded);
+
+        len = tk_snapshot_encode(snap, NULL, buf, sizeof(buf));
+        if (len < 0) {
+            goto out;
+        }
+        tk_histogram_record(&full_bytes, len);
+    }
+
+    tk_histogram_print_header("bytes");
+    printf("\n");
+    tk_histogram_print_row("delta", &delta_bytes, 1);
+    printf("\n");
+    tk_histogram_print_row("full", &full_bytes, 1);
+    printf("\n");
+    tk_debug("snapshot bench done: %u round-trip mismatches, %u quantization errors, peak shells %lu, %lu tanks respawned, "
+        "encode %.1fus/tick, decode %.1fus/tick, p99 %lu bytes/tick(%s the %d bytes target)\n", mismatches, quant_errors,
+        (unsigned long)peak_shells, gs->muggles_spawned - config->tanks,
+        config->duration ? encode_ns / 1000.0 / config->duration : 0.0, config->duration ? decode_ns / 1000.0 / config->duration : 0.0,
+        (unsigned long)tk_histogram_percentile(&delta_bytes, 99),
+        (tk_histogram_percentile(&delta_bytes, 99) < SNAPSHOT_BENCH_TARGET_BYTES) ? "within" : "over", SNAPSHOT_BENCH_TARGET_BYTES);
+    ret = (mismatches || quant_errors) ? -1 : 0;
+
+out:
+    tk_headless_game_destroy(gs);
+    free(decoded);
+    free(history);
+    return ret;
+}
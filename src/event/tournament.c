@@ -0,0 +1,310 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/wait.h>
+#include "tournament.h"
+#include "headless.h"
+#include "game_state.h"
+#include "tools.h"
+#include "debug.h"
+
+#define TOURNAMENT_OUTCOME_ERROR   0
+#define TOURNAMENT_OUTCOME_WIN     1
+#define TOURNAMENT_OUTCOME_DRAW    2 // 最后几辆坦克在同一帧被击毁
+#define TOURNAMENT_OUTCOME_TIMEOUT 3
+
+static const char *tk_tournament_outcomes[] = {"error", "win", "draw", "timeout"};
+
+// 一局的结果，位于主进程与工作进程共享的内存中，每个工作进程只写分给自己的那些
+typedef struct {
+    uint32_t config;
+    uint32_t seed;
+    uint32_t ticks;
+    uint32_t shots;
+    uint32_t hits;
+    uint32_t survivors;
+    uint8_t outcome;
+    char winner[TANK_NAME_MAXLEN];
+} TournamentResult;
+
+static void set_config_defaults(TournamentConfig *config) {
+    memset(config, 0, sizeof(*config));
+    config->seed_from = config->seed_to = 1;
+    config->tanks = TOURNAMENT_DEFAULT_TANKS;
+    config->shell_speed = SHELL_INIT_SPEED;
+    config->shell_ttl = DEFAULT_TANK_SHELL_COLLISION_MAX_NUM;
+    config->fire_interval = MUGGLE_SHOOT_INTERVAL_TICKS;
+    config->max_ticks = TOURNAMENT_DEFAULT_MAX_TICKS;
+}
+
+// 解析一行配置，成功返回0
+static int parse_config_line(char *line, TournamentConfig *config) {
+    char *token = NULL, *saveptr = NULL, *value = NULL;
+
+    set_config_defaults(config);
+    for (token = strtok_r(line, " \t\r\n", &saveptr); token; token = strtok_r(NULL, " \t\r\n", &saveptr)) {
+        value = strchr(token, '=');
+        if (!value) {
+            return -1;
+        }
+        *value++ = '\0';
+        if (!strcmp(token, "seeds")) {
+            if (sscanf(value, "%u-%u", &config->seed_from, &config->seed_to) == 1) {
+                config->seed_to = config->seed_from;
+            }
+        } else if (!strcmp(token, "tanks")) {
+            config->tanks = strtoul(value, NULL, 10);
+        } else if (!strcmp(token, "shell_speed")) {
+            config->shell_speed = strtof(value, NULL);
+        } else if (!strcmp(token, "shell_ttl")) {
+            config->shell_ttl = strtoul(value, NULL, 10);
+        } else if (!strcmp(token, "fire_interval")) {
+            config->fire_interval = strtoul(value, NULL, 10);
+        } else if (!strcmp(token, "max_ticks")) {
+            config->max_ticks = strtoul(value, NULL, 10);
+        } else {
+            return -1;
+        }
+    }
+    if ((config->seed_to < config->seed_from) || (config->tanks < 2) || (config->tanks > DEFAULT_TANK_MAX_NUM)
+        || (config->shell_speed <= 0) || (config->shell_speed > 10) || (config->shell_ttl == 0) || (config->shell_ttl > 255)
+        || (config->fire_interval == 0) || (config->max_ticks == 0)) {
+        return -1;
+    }
+    return 0;
+}
+
+// 读取配置文件，返回配置组数，出错返回-1
+static int load_configs(const char *path, TournamentConfig *configs) {
+    char line[256];
+    char *p = NULL;
+    int num = 0, lineno = 0;
+    FILE *fp = fopen(path, "r");
+
+    if (!fp) {
+        tk_debug("Error: failed to open tournament spec %s\n", path);
+        return -1;
+    }
+    while (fgets(line, sizeof(line), fp)) {
+        lineno++;
+        for (p = line; (*p == ' ') || (*p == '\t'); p++);
+        if ((*p == '#') || (*p == '\n') || (*p == '\r') || (*p == '\0')) {
+            continue;
+        }
+        if (num >= TOURNAMENT_MAX_CONFIGS) {
+            tk_debug("Error: too many configs in %s (max %d)\n", path, TOURNAMENT_MAX_CONFIGS);
+            num = -1;
+            break;
+        }
+        if (parse_config_line(p, &configs[num]) != 0) {
+            tk_debug("Error: invalid config at %s:%d\n", path, lineno);
+            num = -1;
+            break;
+        }
+        num++;
+    }
+    fclose(fp);
+    return num;
+}
+
+static tk_uint32_t count_alive_tanks(GameState *gs, Tank **last) {
+    Tank *tank = NULL;
+    tk_uint32_t alive = 0;
+
+    TAILQ_FOREACH(tank, &gs->tank_list, chain) {
+        if (TST_FLAG(tank, flags, TANK_ALIVE)) {
+            alive++;
+            *last = tank;
+        }
+    }
+    return alive;
+}
+
+// 进行一局对战（时间压缩：模拟帧之间不等待）
+static void play_match(GameState *gs, const TournamentConfig *config, TournamentResult *result) {
+    Tank *last = NULL;
+    tk_uint32_t alive = 0;
+
+    if (tk_headless_game_init(gs, result->seed, config->tanks, 0) != 0) {
+        goto out;
+    }
+    gs->muggle_shoot_interval = config->fire_interval;
+    gs->shell_speed = config->shell_speed;
+    gs->enemy_shell_ttl = config->shell_ttl;
+    if (spawn_muggle_enemies(gs, config->tanks) != 0) {
+        goto out;
+    }
+    alive = config->tanks;
+    while ((gs->tick < config->max_ticks) && (alive > 1)) {
+        game_state_tick(gs);
+        alive = count_alive_tanks(gs, &last);
+    }
+    result->ticks = gs->tick;
+    result->shots = gs->shots;
+    result->hits = gs->hits;
+    result->survivors = alive;
+    if (alive == 1) {
+        result->outcome = TOURNAMENT_OUTCOME_WIN;
+        strlcpy(result->winner, (char *)last->name, sizeof(result->winner));
+    } else {
+        result->outcome = (alive == 0) ? TOURNAMENT_OUTCOME_DRAW : TOURNAMENT_OUTCOME_TIMEOUT;
+    }
+out:
+    cleanup_game_state(gs);
+}
+
+// 工作进程：第worker局起每隔jobs局取一局，使各进程分到的配置组合大致相同
+static void tournament_worker(uint32_t worker, uint32_t jobs, const TournamentConfig *configs,
+    TournamentResult *results, uint32_t total) {
+    GameState *gs = malloc(sizeof(GameState));
+
+    if (!gs) {
+        _exit(1);
+    }
+    for (uint32_t i = worker; i < total; i += jobs) {
+        play_match(gs, &configs[results[i].config], &results[i]);
+    }
+    free(gs);
+    fflush(NULL);
+    _exit(0);
+}
+
+static void write_csv(FILE *fp, const TournamentConfig *configs, const TournamentResult *results, uint32_t total) {
+    const TournamentConfig *config = NULL;
+    const TournamentResult *result = NULL;
+
+    fprintf(fp, "config,seed,tanks,shell_speed,shell_ttl,fire_interval,outcome,winner,ticks,game_seconds,shots,hits,survivors\n");
+    for (uint32_t i = 0; i < total; i++) {
+        result = &results[i];
+        config = &configs[result->config];
+        fprintf(fp, "%u,%u,%u,%g,%u,%u,%s,%s,%u,%.1f,%u,%u,%u\n", result->config, result->seed, config->tanks,
+            config->shell_speed, config->shell_ttl, config->fire_interval, tk_tournament_outcomes[result->outcome],
+            result->winner, result->ticks, result->ticks * TK_TICK_MS / 1000.0, result->shots, result->hits,
+            result->survivors);
+    }
+}
+
+// 按配置组打印汇总：平均时长、平局/超时数、命中率
+static void print_summary(const TournamentConfig *configs, int config_num, const TournamentResult *results, uint32_t total) {
+    uint64_t ticks = 0, shots = 0, hits = 0;
+    uint32_t matches = 0, counts[4];
+
+    printf("%6s %7s %6s %6s %6s %6s %6s %7s %6s %8s %8s\n", "config", "matches", "tanks", "speed", "ttl", "fire", "error",
+        "timeout", "draw", "mean(s)", "hit rate");
+    for (int c = 0; c < config_num; c++) {
+        ticks = shots = hits = 0;
+        matches = 0;
+        memset(counts, 0, sizeof(counts));
+        for (uint32_t i = 0; i < total; i++) {
+            if (results[i].config != (uint32_t)c) {
+                continue;
+            }
+            matches++;
+            counts[results[i].outcome]++;
+            ticks += results[i].ticks;
+            shots += results[i].shots;
+            hits += results[i].hits;
+        }
+        printf("%6d %7u %6u %6g %6u %6u %6u %7u %6u %8.1f %7.1f%%\n", c, matches, configs[c].tanks, configs[c].shell_speed,
+            configs[c].shell_ttl, configs[c].fire_interval, counts[TOURNAMENT_OUTCOME_ERROR],
+            counts[TOURNAMENT_OUTCOME_TIMEOUT], counts[TOURNAMENT_OUTCOME_DRAW],
+            matches ? ticks * TK_TICK_MS / 1000.0 / matches : 0.0, shots ? hits * 100.0 / shots : 0.0);
+    }
+}
+
+int tk_run_tournament(const char *spec_path, uint32_t jobs, const char *csv_path) {
+    TournamentConfig *configs = NULL;
+    TournamentResult *results = NULL;
+    pid_t *pids = NULL;
+    FILE *fp = NULL;
+    size_t results_bytes = 0;
+    uint32_t total = 0, next = 0, started = 0, failed = 0;
+    uint64_t start_ns = 0, elapsed_ns = 0;
+    int config_num = 0, status = 0, ret = -1;
+
+    configs = malloc(sizeof(TournamentConfig) * TOURNAMENT_MAX_CONFIGS);
+    if (!configs) {
+        return -1;
+    }
+    config_num = load_configs(spec_path, configs);
+    if (config_num <= 0) {
+        tk_debug("Error: no valid config in %s\n", spec_path);
+        goto out;
+    }
+    for (int c = 0; c < config_num; c++) {
+        total += configs[c].seed_to - configs[c].seed_from + 1;
+    }
+    if (jobs == 0) {
+        jobs = sysconf(_SC_NPROCESSORS_ONLN);
+    }
+    jobs = MAX(MIN(jobs, total), 1);
+    results_bytes = sizeof(TournamentResult) * total;
+    results = mmap(NULL, results_bytes, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+    if (results == MAP_FAILED) {
+        results = NULL;
+        tk_debug("Error: mmap %zu bytes for %u results failed\n", results_bytes, total);
+        goto out;
+    }
+    for (int c = 0; c < config_num; c++) { // 结果在共享内存中按配置组、种子顺序排列，输出的CSV与进程数无关
+        for (uint32_t seed = configs[c].seed_from; ; seed++) {
+            results[next].config = c;
+            results[next].seed = seed;
+            next++;
+            if (seed == configs[c].seed_to) {
+                break;
+            }
+        }
+    }
+    pids = malloc(sizeof(pid_t) * jobs);
+    if (!pids) {
+        goto out;
+    }
+
+    tk_debug("tournament: %d configs, %u matches on %u processes, map %dx%d\n", config_num, total, jobs,
+        HORIZON_GRID_NUMBER, VERTICAL_GRID_NUMBER);
+    fflush(NULL); // 避免子进程继承尚未输出的缓冲
+    start_ns = tk_get_monotonic_ns();
+    for (uint32_t w = 0; w < jobs; w++) {
+        pids[w] = fork();
+        if (pids[w] == 0) {
+            tournament_worker(w, jobs, configs, results, total);
+        } else if (pids[w] < 0) {
+            tk_debug("Error: fork worker %u failed\n", w);
+            break;
+        }
+        started++;
+    }
+    for (uint32_t w = 0; w < started; w++) {
+        if ((waitpid(pids[w], &status, 0) < 0) || !WIFEXITED(status) || (WEXITSTATUS(status) != 0)) {
+            tk_debug("Error: tournament worker %u(pid %d) failed\n", w, (int)pids[w]);
+        }
+    }
+    elapsed_ns = tk_get_monotonic_ns() - start_ns;
+
+    for (uint32_t i = 0; i < total; i++) {
+        if (results[i].outcome == TOURNAMENT_OUTCOME_ERROR) {
+            failed++;
+        }
+    }
+    fp = fopen(csv_path, "w");
+    if (!fp) {
+        tk_debug("Error: failed to open %s\n", csv_path);
+        goto out;
+    }
+    write_csv(fp, configs, results, total);
+    fclose(fp);
+    print_summary(configs, config_num, results, total);
+    tk_debug("tournament done: %u matches in %.3fs (%.0f matches/min), %u failed, results written to %s\n", total,
+        elapsed_ns / 1e9, elapsed_ns ? total * 60e9 / elapsed_ns : 0.0, failed, csv_path);
+    ret = failed ? -1 : 0;
+
+out:
+    free(pids);
+    if (results) {
+        munmap(results, results_bytes);
+    }
+    free(configs);
+    return ret;
+}
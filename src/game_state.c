@@ -4,81 +4,48 @@
 #include <bsd/string.h>
 #include <math.h>
 #include "tools.h"
+#include "fixed_math.h"
+#include "profiler.h"
 #include <stdbool.h>
 
 /*山与海辞别岁晚，石与月共祝春欢*/
 
-IDPool* tk_idpool = NULL;
 GameState tk_shared_game_state;
-MazePathBFSearchManager tk_bfs_search_manager;
 
 Point tk_maze_offset = {20,20}; // 默认生成的地图左上角为(0,0)，导致地图位于窗口最左上角不太美观，整体将地图往右下移动一段偏移距离
 
 extern Grid get_grid_by_tank_position(Point *pos);
 
-void init_spinlock(pthread_spinlock_t *spinlock) {
-    pthread_spin_init(spinlock, PTHREAD_PROCESS_PRIVATE);
-}
-
-void lock(pthread_spinlock_t *spinlock) {
-    pthread_spin_lock(spinlock);
-}
-
-void unlock(pthread_spinlock_t *spinlock) {
-    pthread_spin_unlock(spinlock);
-}
-
-void destroy_spinlock(pthread_spinlock_t *spinlock) {
-    pthread_spin_destroy(spinlock);
-}
-
-int init_idpool() {
-    tk_idpool = id_pool_create(ID_POOL_SIZE);
-    if (!tk_idpool) {
-        return -1;
-    }
-    return 0;
-}
-
-void cleanup_idpool() {
-     if (tk_idpool) {
-        id_pool_destroy(tk_idpool);
-        tk_idpool = NULL;
-    }
-}
-
 // 随机获取一个网格的中心位置
-Point get_random_grid_pos() {
-    return (Point){random_range(0, HORIZON_GRID_NUMBER-1) * GRID_SIZE + tk_maze_offset.x + (GRID_SIZE/2), 
-        random_range(0, VERTICAL_GRID_NUMBER-1) * GRID_SIZE + tk_maze_offset.y + (GRID_SIZE/2)};
+Point get_random_grid_pos(GameState *gs) {
+    return (Point){game_random_range(gs, 0, HORIZON_GRID_NUMBER-1) * GRID_SIZE + tk_maze_offset.x + (GRID_SIZE/2), 
+        game_random_range(gs, 0, VERTICAL_GRID_NUMBER-1) * GRID_SIZE + tk_maze_offset.y + (GRID_SIZE/2)};
 }
 
 // 随机获取一个网格的中心位置（且尽力确保该位置没有被其他坦克所占用）
-Point get_random_grid_pos_for_tank() {
+Point get_random_grid_pos_for_tank(GameState *gs) {
     int i = 0;
     Point p;
     Tank *tank = NULL;
-    Grid grid1, grid2;
-    int generate_success = 1;
+    Grid grid;
+    tk_uint8_t occupied[MAX_GRID_ID]; // 先遍历一次坦克链表标记已被占用的网格，之后每次尝试只需查表（坦克很多时不再是尝试次数*坦克数）
 
-    for (i=0; i<300; i++) { // try generate 300(MAX) times
-        p = get_random_grid_pos();
-        grid1 = get_grid_by_tank_position(&p);
-        generate_success = 1;
-
-        TAILQ_FOREACH(tank, &tk_shared_game_state.tank_list, chain) {
-            grid2 = get_grid_by_tank_position(&tank->position);
-            if (grid_id(&grid1) == grid_id(&grid2)) {
-                generate_success = 0;
-                break;
-            }
+    memset(occupied, 0, sizeof(occupied));
+    TAILQ_FOREACH(tank, &gs->tank_list, chain) {
+        grid = get_grid_by_tank_position(&tank->position);
+        if (is_grid_valid(&grid)) {
+            occupied[grid_id(&grid)] = 1;
         }
-        if (generate_success == 1) {
+    }
+    for (i=0; i<300; i++) { // try generate 300(MAX) times
+        p = get_random_grid_pos(gs);
+        grid = get_grid_by_tank_position(&p);
+        if (!occupied[grid_id(&grid)]) {
             return p;
         }
     }
 
-    //return (Point){0, 0}; // generate fail
+    //return (Point){0, 0}; // generate fail（坦克数超过网格数时必然如此，只能与其他坦克共用网格）
     return p;
 }
 
@@ -100,33 +67,44 @@ tk_float32_t calc_corrected_angle_deg(tk_float32_t angle_deg) { // see handle_ke
     return corrected_angle_deg;
 }
 
-Tank* create_tank(tk_uint8_t *name, Point pos, tk_float32_t angle_deg, tk_uint8_t role) {
+// 不经过碰撞检测直接把坦克放到pos（出生、预测回滚到权威状态），同时重置轮廓与插值历史，否则碰撞检测与渲染插值仍用旧位置
+void place_tank(Tank *tank, Point pos, tk_float32_t angle_deg) {
+    tank->position = pos;
+    tank->angle_deg = angle_deg;
+    calculate_tank_outline(&tank->position, TANK_LENGTH, TANK_WIDTH+4, calc_corrected_angle_deg(tank->angle_deg), &tank->practical_outline); // see handle_key()
+    init_motion_history(&tank->motion, &tank->position, tank->angle_deg);
+}
+
+// 坦克槽位：Tank之后依次是傻瓜敌人的脱困步骤与访问权重矩阵（玩家坦克不用），整个坦克都在对局的槽位里，检查点才能一次拷贝
+#define TANK_SLOT_STEPS_OFFSET   sizeof(Tank)
+#define TANK_SLOT_MAP_VIS_OFFSET (TANK_SLOT_STEPS_OFFSET + sizeof(tk_uint32_t) * STEPS_TO_ESCAPE_NUM)
+#define TANK_SLOT_SIZE           (TANK_SLOT_MAP_VIS_OFFSET + sizeof(tk_uint32_t) * VERTICAL_GRID_NUMBER * HORIZON_GRID_NUMBER)
+
+Tank* create_tank(GameState *gs, tk_uint8_t *name, Point pos, tk_float32_t angle_deg, tk_uint8_t role) {
     Tank *tank = NULL;
-    Tank *t = NULL;
-    tk_uint8_t tank_num = 0;
     int map_vis_bytes = 0;
 
-    TAILQ_FOREACH(t, &tk_shared_game_state.tank_list, chain) {
-        tank_num++;
-    }
-    if (tank_num >= DEFAULT_TANK_MAX_NUM) {
-        tk_debug("Error: create tank(%s) failed for current tank num %u already >= DEFAULT_TANK_MAX_NUM(%u)\n", 
-            name, tank_num, DEFAULT_TANK_MAX_NUM);
+    if (gs->tank_num >= gs->max_tank_num) {
+        tk_debug("Error: create tank(%s) failed for current tank num %lu already >= max tank num(%lu)\n", 
+            name, gs->tank_num, gs->max_tank_num);
         return NULL;
     }
-    if (tk_shared_game_state.my_tank && (TANK_ROLE_SELF == role)) {
-        tk_debug("Error: create my tank(%s) failed for it(%s) already exists\n", name, tk_shared_game_state.my_tank->name);
+    if (gs->my_tank && (TANK_ROLE_SELF == role)) {
+        tk_debug("Error: create my tank(%s) failed for it(%s) already exists\n", name, gs->my_tank->name);
         return NULL;
     }
 
-    tank = malloc(sizeof(Tank));
+    tank = tk_slab_alloc(&gs->tank_slab);
     if (!tank) {
+        tk_debug("Error: %s no free tank slot(%zu in use)\n", __func__, gs->tank_slab.used);
         goto error;
     }
     memset(tank, 0, sizeof(Tank));
 
     strlcpy(tank->name, name, sizeof(tank->name));
-    tank->id = id_pool_allocate(tk_idpool);
+    tank->game = gs;
+    tank->handle = id_pool_allocate_handle(gs->idpool, tank);
+    tank->id = HANDLE2ID(tank->handle);
     if (!tank->id) {
         tk_debug("Error: %s id_pool_allocate failed\n", __func__);
         goto error;
@@ -136,17 +114,10 @@ Tank* create_tank(tk_uint8_t *name, Point pos, tk_float32_t angle_deg, tk_uint8_
         tank->steps_to_escape = NULL;
         tank->map_vis = NULL;
     } else if (TANK_ROLE_ENEMY_MUGGLE == tank->role) {
-        tank->steps_to_escape = malloc(sizeof(tk_uint32_t) * STEPS_TO_ESCAPE_NUM);
-        if (!tank->steps_to_escape) {
-            goto error;
-        }
+        tank->steps_to_escape = (tk_uint32_t *)((tk_uint8_t *)tank + TANK_SLOT_STEPS_OFFSET);
         memset(tank->steps_to_escape, 0, sizeof(tk_uint32_t) * STEPS_TO_ESCAPE_NUM);
         map_vis_bytes = VERTICAL_GRID_NUMBER * sizeof(*tank->map_vis);
-        tank->map_vis = malloc(map_vis_bytes);
-        if (!tank->map_vis) {
-            goto error;
-        }
-        tk_debug("malloc %d(B) for tank(%s)->map_vis, items %d\n", map_vis_bytes, tank->name, map_vis_bytes/sizeof(tk_uint32_t));
+        tank->map_vis = (void *)((tk_uint8_t *)tank + TANK_SLOT_MAP_VIS_OFFSET);
 #define CLEAN_TANK_MAP_VIS(tank) \
 do{ \
     if (tank->map_vis) { \
@@ -155,39 +126,32 @@ do{ \
 }while(0)
         CLEAN_TANK_MAP_VIS(tank);
     }
-    tank->position = pos;
-    tank->angle_deg = angle_deg;
     SET_FLAG(tank, flags, TANK_ALIVE);
     // tank->basic_color = (void *)((TANK_ROLE_SELF == tank->role) ? ID2COLORPTR(TK_BLUE) : ID2COLORPTR(TK_RED));
-    tank->health = tank->max_health = (TANK_ROLE_SELF == tank->role) ? 500 : 250;
+    tank->health = tank->max_health = TANK_ROLE_IS_PLAYER(tank->role) ? 500 : 250;
     tank->speed = TANK_INIT_SPEED;
     tank->max_shell_num = DEFAULT_TANK_SHELLS_MAX_NUM;
     tank->current_grid = (Grid){-1, -1};
-    calculate_tank_outline(&tank->position, TANK_LENGTH, TANK_WIDTH+4, calc_corrected_angle_deg(tank->angle_deg), &tank->practical_outline); // see handle_key()
+    place_tank(tank, pos, angle_deg);
     TAILQ_INIT(&tank->shell_list);
+    tk_lock_init(&tank->spinlock, "tank shell_list", TK_LOCK_SPIN); // 必须在挂到tank_list上（GUI线程可见）之前初始化
 
     if (TANK_ROLE_SELF == tank->role) {
-        tk_shared_game_state.my_tank = tank;
+        gs->my_tank = tank;
     }
-    lock(&tk_shared_game_state.spinlock);
-    TAILQ_INSERT_HEAD(&tk_shared_game_state.tank_list, tank, chain);
-    unlock(&tk_shared_game_state.spinlock);
+    lock(&gs->spinlock);
+    TAILQ_INSERT_HEAD(&gs->tank_list, tank, chain);
+    gs->tank_num++;
+    unlock(&gs->spinlock);
 
-    init_spinlock(&tank->spinlock);
-    tk_debug("create a tank(name:%s, id:%lu, total size:%luB, ExplodeEffect's size: %luB) %p success, total tank num %u\n", 
-        tank->name, tank->id, sizeof(Tank), sizeof(tank->explode_effect), tank, tank_num+1);
+    tk_debug_internal(DEBUG_OBJECT_LIFECYCLE, "create a tank(name:%s, id:%lu, total size:%luB, ExplodeEffect's size: %luB) %p success, total tank num %lu\n", 
+        tank->name, tank->id, sizeof(Tank), sizeof(tank->explode_effect), tank, gs->tank_num);
     return tank;
 
 error:
     tk_debug("Error: create tank %s failed\n", name);
-    if (tank->map_vis) {
-        free(tank->map_vis);
-    }
-    if (tank->steps_to_escape) {
-        free(tank->steps_to_escape);
-    }
     if (tank) {
-        free(tank);
+        tk_slab_free(&gs->tank_slab, tank);
     }
     return NULL;
 }
@@ -196,24 +160,21 @@ void delete_tank(Tank *tank, int dereference) {
     Shell *shell = NULL;
     Shell *tmp = NULL;
     tk_uint8_t shell_num = 0;
-    Tank *t1 = NULL, *t2 = NULL;
+    GameState *gs = NULL;
 
     if (!tank) {
         return;
     }
+    gs = tank->game;
     if (TANK_ROLE_SELF == tank->role) {
-        tk_shared_game_state.my_tank = NULL;
+        gs->my_tank = NULL;
     }
-    if (dereference) {
-        TAILQ_FOREACH_SAFE(t1, &tk_shared_game_state.tank_list, chain, t2) {
-            if (t1 != tank) {
-                continue;
-            }
-            lock(&tk_shared_game_state.spinlock);
-            TAILQ_REMOVE(&tk_shared_game_state.tank_list, t1, chain);
-            unlock(&tk_shared_game_state.spinlock);
-        }
+    lock(&gs->spinlock);
+    if (dereference) { // create_tank()返回的坦克一定已挂在tank_list上，直接摘除即可，无需遍历查找
+        TAILQ_REMOVE(&gs->tank_list, tank, chain);
     }
+    gs->tank_num--; // 不需要dereference的调用者（delete_all_tanks()）已自行将其从tank_list摘除
+    unlock(&gs->spinlock);
     TAILQ_FOREACH_SAFE(shell, &tank->shell_list, chain, tmp) {
         lock(&tank->spinlock);
         TAILQ_REMOVE(&tank->shell_list, shell, chain);
@@ -221,65 +182,352 @@ void delete_tank(Tank *tank, int dereference) {
         delete_shell(shell, 0);
         shell_num++;
     }
-    tk_debug("tank(%p, id:%lu) %s(flags:%lu, score:%u, health:%u) is deleted, and free %u shells\n", 
+    tk_debug_internal(DEBUG_OBJECT_LIFECYCLE, "tank(%p, id:%lu) %s(flags:%lu, score:%u, health:%u) is deleted, and free %u shells\n", 
         tank, (tank)->id, (tank)->name, (tank)->flags, (tank)->score, (tank)->health, shell_num);
-    id_pool_release(tk_idpool, tank->id);
+    id_pool_release_handle(gs->idpool, tank->handle);
     tank->id = 0;
-    destroy_spinlock(&tank->spinlock);
-    if (tank->map_vis) {
-        free(tank->map_vis);
+    tank->handle = 0;
+    tk_lock_destroy(&tank->spinlock);
+    tank->map_vis = NULL;
+    tank->steps_to_escape = NULL;
+    tk_slab_free(&gs->tank_slab, tank);
+}
+
+// 根据句柄查找坦克，坦克已被删除（即使其ID已被新对象复用）时返回NULL
+Tank* get_tank_by_handle(GameState *gs, id_handle_t handle) {
+    return (Tank *)id_pool_lookup(gs->idpool, handle);
+}
+
+Shell* get_shell_by_handle(GameState *gs, id_handle_t handle) {
+    return (Shell *)id_pool_lookup(gs->idpool, handle);
+}
+
+void init_motion_history(MotionHistory *motion, const Point *position, tk_float32_t angle_deg) {
+    motion->prev_position = *position;
+    motion->prev_angle_deg = angle_deg;
+    motion->prev_ns = motion->curr_ns = tk_get_monotonic_ns();
+}
+
+// 在实体位置/角度即将改变前调用，记录改变前的状态（position、angle_deg为当前即将被覆盖的值）
+void record_motion(MotionHistory *motion, const Point *position, tk_float32_t angle_deg) {
+    uint64_t now = tk_get_monotonic_ns();
+
+    if (now - motion->curr_ns < MOTION_MERGE_NS) {
+        return;
     }
-    if (tank->steps_to_escape) {
-        free(tank->steps_to_escape);
+    motion->prev_position = *position;
+    motion->prev_angle_deg = angle_deg;
+    motion->prev_ns = MAX(motion->curr_ns, now - MOTION_MAX_STEP_NS);
+    motion->curr_ns = now;
+}
+
+/*计算绘制用的位置与角度：渲染比模拟滞后一步，在[prev_ns, curr_ns]这一步的跨度内从上一状态平滑过渡到当前状态，
+  移动刚发生时(alpha=0)画的是上一状态，与之前画面衔接，过了一个步长(alpha=1)之后画的就是当前状态*/
+void get_interpolated_motion(MotionHistory *motion, const Point *position, tk_float32_t angle_deg, 
+    Point *out_position, tk_float32_t *out_angle_deg) {
+#ifdef ENABLE_RENDER_INTERPOLATION
+    uint64_t now = tk_get_monotonic_ns();
+    uint64_t curr_ns = motion->curr_ns;
+    uint64_t span = curr_ns - motion->prev_ns;
+    tk_float32_t alpha = 1;
+    tk_float32_t delta = 0;
+
+    if ((span > 0) && (now < curr_ns + span)) {
+        alpha = (now <= curr_ns) ? 0 : (tk_float32_t)(now - curr_ns) / span;
+    }
+    out_position->x = motion->prev_position.x + (position->x - motion->prev_position.x) * alpha;
+    out_position->y = motion->prev_position.y + (position->y - motion->prev_position.y) * alpha;
+    delta = angle_deg - motion->prev_angle_deg; // 沿较短方向旋转，例如从355°到5°是顺时针转10°
+    if (delta > 180) {
+        delta -= 360;
+    } else if (delta < -180) {
+        delta += 360;
+    }
+    *out_angle_deg = motion->prev_angle_deg + delta * alpha;
+    if (*out_angle_deg < 0) {
+        *out_angle_deg += 360;
+    } else if (*out_angle_deg >= 360) {
+        *out_angle_deg -= 360;
     }
-    free(tank);
+#else
+    *out_position = *position;
+    *out_angle_deg = angle_deg;
+#endif
 }
 
-void init_game_state() {
-    memset(&tk_shared_game_state, 0, sizeof(tk_shared_game_state));
-    TAILQ_INIT(&tk_shared_game_state.tank_list);
-    maze_generate(&tk_shared_game_state.maze);
-    print_maze_walls(&tk_shared_game_state.maze);
-    tk_shared_game_state.blocks = get_block_positions(&tk_shared_game_state.maze, &tk_shared_game_state.blocks_num);
-    // for (int i=0; i<tk_shared_game_state.blocks_num; i++) {
-    //     printf("[(%f,%f),(%f,%f)], ", tk_shared_game_state.blocks[i].start.x, tk_shared_game_state.blocks[i].start.y, 
-    //         tk_shared_game_state.blocks[i].end.x, tk_shared_game_state.blocks[i].end.y);
+// 同样的两个种子（加上同样的输入序列，见replay.c）可以复现同一局游戏。成功返回0，失败时已申请的资源由cleanup_game_state()释放
+int init_game_state(GameState *gs, uint32_t maze_seed, uint32_t rng_seed) {
+    memset(gs, 0, sizeof(*gs));
+    TAILQ_INIT(&gs->tank_list);
+    gs->max_tank_num = DEFAULT_TANK_MAX_NUM;
+    gs->muggle_shoot_interval = MUGGLE_SHOOT_INTERVAL_TICKS;
+    gs->shell_speed = SHELL_INIT_SPEED;
+    gs->my_shell_ttl = MY_SHELL_COLLISION_MAX_NUM;
+    gs->enemy_shell_ttl = DEFAULT_TANK_SHELL_COLLISION_MAX_NUM;
+    gs->maze_seed = maze_seed;
+    gs->rng_seed = rng_seed;
+    gs->rng_state = tk_rand_seed(rng_seed);
+    tk_lock_init(&gs->spinlock, "tank_list", TK_LOCK_ADAPTIVE); // GUI线程在整个渲染过程中持有
+    {
+        gs->bfs.maze = &(gs->maze);
+        gs->bfs.bfs_search = bfs_shortest_path_search;
+        tk_lock_init(&(gs->bfs.spinlock), "bfs result", TK_LOCK_ADAPTIVE);
+    }
+    maze_generate(&gs->maze, maze_seed);
+    if (DEBUG_OBJECT_LIFECYCLE) { // 批量运行（压力测试、多局并行、锦标赛）关闭对象日志时，也不再逐局打印地图
+        tk_debug("maze seed %u, rng seed %u\n", maze_seed, rng_seed);
+        print_maze_walls(&gs->maze);
+    }
+    gs->blocks = get_block_positions(&gs->maze, &gs->blocks_num);
+    // for (int i=0; i<gs->blocks_num; i++) {
+    //     printf("[(%f,%f),(%f,%f)], ", gs->blocks[i].start.x, gs->blocks[i].start.y, 
+    //         gs->blocks[i].end.x, gs->blocks[i].end.y);
     //     printf("\n");
     // }
-    init_spinlock(&tk_shared_game_state.spinlock);
-    {
-        tk_bfs_search_manager.maze = &(tk_shared_game_state.maze);
-        tk_bfs_search_manager.bfs_search = bfs_shortest_path_search;
-        init_spinlock(&(tk_bfs_search_manager.spinlock));
+    gs->idpool = id_pool_create(ID_POOL_SIZE);
+    if (!gs->idpool || !gs->blocks || (tk_slab_init(&gs->tank_slab, TANK_SLOT_SIZE, GAME_MAX_TANKS) != 0) ||
+        (tk_slab_init(&gs->shell_slab, sizeof(Shell), GAME_MAX_SHELLS) != 0)) {
+        tk_debug("Error: %s failed\n", __func__);
+        return -1;
     }
+    return 0;
 }
 
-void delete_all_tanks() {
+void delete_all_tanks(GameState *gs) {
     Tank *tank = NULL;
     Tank *tmp = NULL;
-    tk_uint8_t tank_num = 0;
+    tk_uint32_t tank_num = 0;
 
-    TAILQ_FOREACH_SAFE(tank, &tk_shared_game_state.tank_list, chain, tmp) {
-        lock(&tk_shared_game_state.spinlock);
-        TAILQ_REMOVE(&tk_shared_game_state.tank_list, tank, chain);
-        unlock(&tk_shared_game_state.spinlock);
+    TAILQ_FOREACH_SAFE(tank, &gs->tank_list, chain, tmp) {
+        lock(&gs->spinlock);
+        TAILQ_REMOVE(&gs->tank_list, tank, chain);
+        unlock(&gs->spinlock);
         delete_tank(tank, 0);
         tank_num++;
     }
-    tk_debug("total %u tanks are all freed\n", tank_num);
+    tk_debug_internal(DEBUG_OBJECT_LIFECYCLE, "total %lu tanks are all freed\n", tank_num);
+}
+
+// 开始一局新游戏（也用于重开一局）：一辆我的坦克和一辆傻瓜敌人。
+// 只由推进该局的线程调用（游戏开始前则由主线程调用），GUI线程首次绘制时再为坦克设置颜色
+int start_new_game(GameState *gs) {
+    delete_all_tanks(gs);
+    gs->tick = 0;
+    gs->stop_game = 0;
+    gs->shots = gs->hits = 0;
+    gs->muggles_spawned = 0;
+    create_tank(gs, "yangdai", get_random_grid_pos_for_tank(gs), 300, TANK_ROLE_SELF);
+    spawn_muggle_enemies(gs, 1);
+    if (!gs->my_tank) {
+        return -1;
+    }
+    return 0;
+}
+
+// 在随机位置、以随机朝向创建n个傻瓜敌人，依次命名为muggle-0、muggle-1……（重开一局时从0开始）。
+// 无GUI模式开局生成敌人、被击毁后补充都用它，坦克数量达到max_tank_num等原因创建失败时返回-1
+int spawn_muggle_enemies(GameState *gs, tk_uint32_t n) {
+    char name[TANK_NAME_MAXLEN];
+
+    for (tk_uint32_t i = 0; i < n; i++) {
+        snprintf(name, sizeof(name), "muggle-%lu", gs->muggles_spawned++);
+        if (!create_tank(gs, (tk_uint8_t *)name, get_random_grid_pos_for_tank(gs), game_random_range(gs, 0, 360), TANK_ROLE_ENEMY_MUGGLE)) {
+            return -1;
+        }
+    }
+    return 0;
 }
 
-void cleanup_game_state() {
-    delete_all_tanks();
-    if (tk_shared_game_state.blocks) {
-        free(tk_shared_game_state.blocks);
+// 生命值归零的坦克进入DYING状态，经过TANK_DYING_TICKS个模拟帧后转为DEAD（下一帧由update_muggle_enemy_position()删除）。
+// 状态迁移只发生在模拟帧内，不依赖GUI爆炸动画的进度，回放时结果才能一致
+static void update_dying_tanks(GameState *gs) {
+    Tank *tank = NULL;
+
+    TAILQ_FOREACH(tank, &gs->tank_list, chain) {
+        if (TST_FLAG(tank, flags, TANK_ALIVE) && (tank->health <= 0)) {
+            CLR_FLAG(tank, flags, TANK_ALIVE);
+            SET_FLAG(tank, flags, TANK_DYING);
+            tank->dying_ticks = TANK_DYING_TICKS;
+        } else if (TST_FLAG(tank, flags, TANK_DYING)) {
+            if (tank->dying_ticks > 0) {
+                tank->dying_ticks--;
+            }
+            if (tank->dying_ticks == 0) {
+                CLR_FLAG(tank, flags, TANK_DYING);
+                SET_FLAG(tank, flags, TANK_DEAD);
+            }
+        }
     }
-    tk_shared_game_state.blocks_num = 0;
+}
+
+#ifdef ENABLE_LAG_COMPENSATION
+// 在帧末记录所有坦克的轮廓（与随后广播的世界快照是同一时刻的状态）
+static void record_tank_rewind(GameState *gs) {
+    TankRewindRecord *record = NULL;
+    Tank *tank = NULL;
+
+    TAILQ_FOREACH(tank, &gs->tank_list, chain) {
+        record = &tank->rewind[gs->tick % TK_REWIND_TICKS];
+        record->tick = gs->tick;
+        record->position = tank->position;
+        record->practical_outline = tank->practical_outline;
+    }
+}
+
+// 查询坦克在第tick帧末的轮廓，超出回退窗口或坦克当时还不存在返回NULL
+const TankRewindRecord* tank_rewind_record(const Tank *tank, tk_uint32_t tick) {
+    const TankRewindRecord *record = &tank->rewind[tick % TK_REWIND_TICKS];
+    return (record->tick == tick) ? record : NULL;
+}
+#endif
+
+// 推进一个模拟帧（控制线程定时器每TK_TICK_MS毫秒调用一次，回放时由回放器直接调用）
+void game_state_tick(GameState *gs) {
+    TK_PROFILE_SCOPE(TK_PHASE_TICK);
+    gs->tick++;
+    update_muggle_enemy_position(gs);
+    update_all_shell_movement_position(gs);
+    update_dying_tanks(gs);
+#ifdef ENABLE_LAG_COMPENSATION
+    record_tank_rewind(gs);
+#endif
+}
+
+void cleanup_game_state(GameState *gs) {
+    delete_all_tanks(gs);
+    if (gs->blocks) {
+        free(gs->blocks);
+        gs->blocks = NULL;
+    }
+    gs->blocks_num = 0;
+    if (gs->idpool) {
+        id_pool_destroy(gs->idpool);
+        gs->idpool = NULL;
+    }
+    tk_slab_destroy(&gs->tank_slab);
+    tk_slab_destroy(&gs->shell_slab);
     {
-        tk_bfs_search_manager.maze = NULL;
-        destroy_spinlock(&(tk_bfs_search_manager.spinlock));
+        gs->bfs.maze = NULL;
+        tk_lock_destroy(&(gs->bfs.spinlock));
     }
-    destroy_spinlock(&tk_shared_game_state.spinlock);
+    tk_lock_destroy(&gs->spinlock);
+}
+
+// 检查点开头的对局标量状态，其后依次是坦克槽位、炮弹槽位（各自已启用的部分）与ID池
+typedef struct {
+    struct _tk_tanks_list tank_list;
+    Tank *my_tank;
+    tk_uint32_t tank_num;
+    tk_uint32_t max_tank_num;
+    tk_uint32_t muggle_shoot_interval;
+    tk_float32_t shell_speed;
+    tk_uint8_t my_shell_ttl;
+    tk_uint8_t enemy_shell_ttl;
+    tk_uint32_t shots;
+    tk_uint32_t hits;
+    tk_uint32_t muggles_spawned;
+    tk_uint32_t game_time;
+    tk_uint32_t tick;
+    uint32_t rng_seed;
+    uint32_t rng_state;
+    TkSlab tank_slab;  // 槽位的元数据（base用于校验对局是否已被重建）
+    TkSlab shell_slab;
+} GameCheckpointHeader;
+
+// 保存对局的完整模拟状态，cp首次使用前清零，之后可反复保存（缓冲区按需扩大后复用）。由推进该局的线程调用
+int game_checkpoint_save(GameState *gs, GameCheckpoint *cp) {
+    GameCheckpointHeader *header = NULL;
+    size_t tank_bytes = 0, shell_bytes = 0, size = 0;
+    tk_uint8_t *data = NULL;
+
+    lock(&gs->spinlock); // GUI线程持有该锁绘制时会给坦克的炮弹链表上锁，保存下来的锁状态必须是未上锁
+    tank_bytes = tk_slab_bytes_in_use(&gs->tank_slab);
+    shell_bytes = tk_slab_bytes_in_use(&gs->shell_slab);
+    size = sizeof(GameCheckpointHeader) + tank_bytes + shell_bytes + id_pool_checkpoint_size(gs->idpool);
+    if (size > cp->capacity) {
+        data = realloc(cp->data, size);
+        if (!data) {
+            unlock(&gs->spinlock);
+            tk_debug("Error: %s malloc %zu(B) failed\n", __func__, size);
+            return -1;
+        }
+        cp->data = data;
+        cp->capacity = size;
+    }
+    header = (GameCheckpointHeader *)cp->data;
+    header->tank_list = gs->tank_list;
+    header->my_tank = gs->my_tank;
+    header->tank_num = gs->tank_num;
+    header->max_tank_num = gs->max_tank_num;
+    header->muggle_shoot_interval = gs->muggle_shoot_interval;
+    header->shell_speed = gs->shell_speed;
+    header->my_shell_ttl = gs->my_shell_ttl;
+    header->enemy_shell_ttl = gs->enemy_shell_ttl;
+    header->shots = gs->shots;
+    header->hits = gs->hits;
+    header->muggles_spawned = gs->muggles_spawned;
+    header->game_time = gs->game_time;
+    header->tick = gs->tick;
+    header->rng_seed = gs->rng_seed;
+    header->rng_state = gs->rng_state;
+    header->tank_slab = gs->tank_slab;
+    header->shell_slab = gs->shell_slab;
+    data = cp->data + sizeof(GameCheckpointHeader);
+    memcpy(data, gs->tank_slab.base, tank_bytes);
+    memcpy(data + tank_bytes, gs->shell_slab.base, shell_bytes);
+    id_pool_checkpoint_save(gs->idpool, data + tank_bytes + shell_bytes);
+    unlock(&gs->spinlock);
+    cp->game = gs;
+    cp->maze_seed = gs->maze_seed;
+    cp->size = size;
+    return 0;
+}
+
+// 回滚到检查点保存时的状态（可多次恢复同一个检查点），检查点不属于该局（或该局已重建）时返回-1且不做任何修改
+int game_checkpoint_restore(GameState *gs, const GameCheckpoint *cp) {
+    const GameCheckpointHeader *header = (const GameCheckpointHeader *)cp->data;
+    const tk_uint8_t *data = NULL;
+    size_t tank_bytes = 0, shell_bytes = 0;
+
+    if (!cp->size || (cp->game != gs) || (cp->maze_seed != gs->maze_seed) ||
+        (header->tank_slab.base != gs->tank_slab.base) || (header->shell_slab.base != gs->shell_slab.base)) {
+        tk_debug("Error: %s checkpoint does not belong to this game\n", __func__);
+        return -1;
+    }
+    tank_bytes = tk_slab_bytes_in_use(&header->tank_slab);
+    shell_bytes = tk_slab_bytes_in_use(&header->shell_slab);
+    data = cp->data + sizeof(GameCheckpointHeader);
+    lock(&gs->spinlock);
+    if (id_pool_checkpoint_restore(gs->idpool, data + tank_bytes + shell_bytes) != 0) {
+        unlock(&gs->spinlock);
+        return -1;
+    }
+    memcpy(gs->tank_slab.base, data, tank_bytes);
+    memcpy(gs->shell_slab.base, data + tank_bytes, shell_bytes);
+    gs->tank_slab = header->tank_slab;
+    gs->shell_slab = header->shell_slab;
+    gs->tank_list = header->tank_list;
+    gs->my_tank = header->my_tank;
+    gs->tank_num = header->tank_num;
+    gs->max_tank_num = header->max_tank_num;
+    gs->muggle_shoot_interval = header->muggle_shoot_interval;
+    gs->shell_speed = header->shell_speed;
+    gs->my_shell_ttl = header->my_shell_ttl;
+    gs->enemy_shell_ttl = header->enemy_shell_ttl;
+    gs->shots = header->shots;
+    gs->hits = header->hits;
+    gs->muggles_spawned = header->muggles_spawned;
+    gs->game_time = header->game_time;
+    gs->tick = header->tick;
+    gs->rng_seed = header->rng_seed;
+    gs->rng_state = header->rng_state;
+    unlock(&gs->spinlock);
+    return 0;
+}
+
+void game_checkpoint_free(GameCheckpoint *cp) {
+    free(cp->data);
+    memset(cp, 0, sizeof(*cp));
 }
 
 Point get_line_center(const Point *p1, const Point *p2) {
@@ -303,12 +551,19 @@ Point move_point(Point start, tk_float32_t direction, tk_float32_t distance) {
         direction -= 360;
     }
 
+    Point end;
+#ifdef ENABLE_FIXED_POINT_MATH
+    tk_fixed_t direction_fx = tk_fixed_from_float(direction);
+    tk_fixed_t distance_fx = tk_fixed_from_float(distance);
+    end.x = tk_fixed_to_float(tk_fixed_from_float(start.x) + tk_fixed_mul(distance_fx, tk_fixed_cos_deg(direction_fx)));
+    end.y = tk_fixed_to_float(tk_fixed_from_float(start.y) - tk_fixed_mul(distance_fx, tk_fixed_sin_deg(direction_fx)));
+#else
 	// 将角度转换为弧度
     tk_float32_t direction_rad = direction * M_PI / 180.0f;
     // 计算新坐标
-    Point end;
     end.x = start.x + distance * cos(direction_rad);
     end.y = start.y - distance * sin(direction_rad);
+#endif
     return end;
 }
 
@@ -337,7 +592,9 @@ Point rotate_point(const Point *point, tk_float32_t angle, const Point *pivot) {
 
 // 计算坦克实体的轮廓边界
 void calculate_tank_outline(const Point *center, tk_float32_t width, tk_float32_t height, tk_float32_t angle_deg, Rectangle *rect) {
+#ifndef ENABLE_FIXED_POINT_MATH
     tk_float32_t angle = angle_deg * (M_PI / 180.0f);  // 将角度转换为弧度
+#endif
     uint8_t i = 0;
     // 未旋转时矩形的四个顶点坐标
     Point points[4] = {
@@ -348,10 +605,24 @@ void calculate_tank_outline(const Point *center, tk_float32_t width, tk_float32_
     }; //+6是炮管延伸出来的长度
 	Point *new_points = (Point *)rect;
 
+#ifdef ENABLE_FIXED_POINT_MATH
+    // 同rotate_point()，旋转矩阵在定点数下计算
+    tk_fixed_t cos_angle = tk_fixed_cos_deg(tk_fixed_from_float(angle_deg));
+    tk_fixed_t sin_angle = tk_fixed_sin_deg(tk_fixed_from_float(angle_deg));
+    tk_fixed_t cx = tk_fixed_from_float(center->x), cy = tk_fixed_from_float(center->y);
+    tk_fixed_t dx = 0, dy = 0;
+    for (i = 0; i < 4; i++) {
+        dx = tk_fixed_from_float(points[i].x) - cx;
+        dy = tk_fixed_from_float(points[i].y) - cy;
+        new_points[i].x = tk_fixed_to_float(cx + tk_fixed_mul(dx, cos_angle) - tk_fixed_mul(dy, sin_angle));
+        new_points[i].y = tk_fixed_to_float(cy + tk_fixed_mul(dx, sin_angle) + tk_fixed_mul(dy, cos_angle));
+    }
+#else
     // 旋转每个顶点
     for (i = 0; i < 4; i++) {
         new_points[i] = rotate_point(&(points[i]), angle, center);
     }
+#endif
 }
 
 Grid get_grid_by_tank_position(Point *pos) {
@@ -405,6 +676,10 @@ int is_tank_near_grid_center(Tank *tank, Grid *grid) {
 
 // 计算斜率，角度输入范围 0~360（正北为0°，顺时针增加）
 double calculate_slope(double theta_degrees) {
+#ifdef ENABLE_FIXED_POINT_MATH
+    tk_fixed_t slope = tk_fixed_tan_deg(TK_FIXED_FROM_INT(90) - tk_fixed_from_float(theta_degrees));
+    return (slope == TK_FIXED_INFINITY) ? INFINITY : tk_fixed_to_double(slope);
+#else
     // 转换为数学标准角度（正东为0°，逆时针增加）
     double alpha_degrees = 90.0 - theta_degrees;
 
@@ -423,6 +698,7 @@ double calculate_slope(double theta_degrees) {
     }
 
     return slope;
+#endif
 }
 /*
 int main() {
@@ -462,7 +738,7 @@ void get_ray_intersection_dot_with_grid(Ray_Intersection_Dot_Info *info) {
         } else {
             g.x = info->current_grid.x;
             g.y = info->current_grid.y-1;
-            if (is_two_grids_connected(&tk_shared_game_state.maze, &info->current_grid, &g)) { // 当前网格与上一层网格之间打通，射线射入上一层网格中
+            if (is_two_grids_connected(info->maze, &info->current_grid, &g)) { // 当前网格与上一层网格之间打通，射线射入上一层网格中
                 info->next_grid = g;
             } else { // 当前网格与上一层网格之间未打通，垂直反射
                 info->next_grid = info->current_grid;
@@ -481,7 +757,7 @@ void get_ray_intersection_dot_with_grid(Ray_Intersection_Dot_Info *info) {
         } else {
             g.x = info->current_grid.x+1;
             g.y = info->current_grid.y;
-            if (is_two_grids_connected(&tk_shared_game_state.maze, &info->current_grid, &g)) { // 当前网格与右侧网格之间打通，射线射入右侧网格中
+            if (is_two_grids_connected(info->maze, &info->current_grid, &g)) { // 当前网格与右侧网格之间打通，射线射入右侧网格中
                 info->next_grid = g;
             } else { // 当前网格与右侧网格之间未打通，水平反射
                 info->next_grid = info->current_grid;
@@ -500,7 +776,7 @@ void get_ray_intersection_dot_with_grid(Ray_Intersection_Dot_Info *info) {
         } else {
             g.x = info->current_grid.x;
             g.y = info->current_grid.y+1;
-            if (is_two_grids_connected(&tk_shared_game_state.maze, &info->current_grid, &g)) { // 当前网格与下一层网格之间打通，射线射入下一层网格中
+            if (is_two_grids_connected(info->maze, &info->current_grid, &g)) { // 当前网格与下一层网格之间打通，射线射入下一层网格中
                 info->next_grid = g;
             } else { // 当前网格与下一层网格之间未打通，垂直反射
                 info->next_grid = info->current_grid;
@@ -519,7 +795,7 @@ void get_ray_intersection_dot_with_grid(Ray_Intersection_Dot_Info *info) {
         } else {
             g.x = info->current_grid.x-1;
             g.y = info->current_grid.y;
-            if (is_two_grids_connected(&tk_shared_game_state.maze, &info->current_grid, &g)) { // 当前网格与左侧网格之间打通，射线射入左侧网格中
+            if (is_two_grids_connected(info->maze, &info->current_grid, &g)) { // 当前网格与左侧网格之间打通，射线射入左侧网格中
                 info->next_grid = g;
             } else { // 当前网格与左侧网格之间未打通，水平反射
                 info->next_grid = info->current_grid;
@@ -541,7 +817,7 @@ void get_ray_intersection_dot_with_grid(Ray_Intersection_Dot_Info *info) {
                 } else {
                     g.x = info->current_grid.x;
                     g.y = info->current_grid.y-1;
-                    if (is_two_grids_connected(&tk_shared_game_state.maze, &info->current_grid, &g)) { // 当前网格与上一层网格之间打通，射线射入上一层网格中
+                    if (is_two_grids_connected(info->maze, &info->current_grid, &g)) { // 当前网格与上一层网格之间打通，射线射入上一层网格中
                         info->next_grid = g;
                     } else { // 当前网格与上一层网格之间未打通，镜面反射
                         info->next_grid = info->current_grid;
@@ -558,7 +834,7 @@ void get_ray_intersection_dot_with_grid(Ray_Intersection_Dot_Info *info) {
                 } else {
                     g.x = info->current_grid.x+1;
                     g.y = info->current_grid.y;
-                    if (is_two_grids_connected(&tk_shared_game_state.maze, &info->current_grid, &g)) { // 当前网格与右侧网格之间打通，射线射入右侧网格中
+                    if (is_two_grids_connected(info->maze, &info->current_grid, &g)) { // 当前网格与右侧网格之间打通，射线射入右侧网格中
                         info->next_grid = g;
                     } else { // 当前网格与右侧网格之间未打通，镜面反射
                         info->next_grid = info->current_grid;
@@ -574,14 +850,14 @@ void get_ray_intersection_dot_with_grid(Ray_Intersection_Dot_Info *info) {
                 } else {
                     g.x = info->current_grid.x;
                     g.y = info->current_grid.y-1;
-                    connect1 = is_two_grids_connected(&tk_shared_game_state.maze, &info->current_grid, &g);
+                    connect1 = is_two_grids_connected(info->maze, &info->current_grid, &g);
                 }
                 if ((info->current_grid.x+1) == HORIZON_GRID_NUMBER) {
                     connect2 = 0;
                 } else {
                     g.x = info->current_grid.x+1;
                     g.y = info->current_grid.y;
-                    connect2 = is_two_grids_connected(&tk_shared_game_state.maze, &info->current_grid, &g);
+                    connect2 = is_two_grids_connected(info->maze, &info->current_grid, &g);
                 }
                 if (!connect1 || !connect2) { // 右上角两边存在至少一堵墙，则终止，否则直接射入右上角对角相连的网格
                     info->terminate_flag = 1;
@@ -604,7 +880,7 @@ void get_ray_intersection_dot_with_grid(Ray_Intersection_Dot_Info *info) {
                 } else {
                     g.x = info->current_grid.x;
                     g.y = info->current_grid.y+1;
-                    if (is_two_grids_connected(&tk_shared_game_state.maze, &info->current_grid, &g)) { // 当前网格与下一层网格之间打通，射线射入下一层网格中
+                    if (is_two_grids_connected(info->maze, &info->current_grid, &g)) { // 当前网格与下一层网格之间打通，射线射入下一层网格中
                         info->next_grid = g;
                     } else { // 当前网格与下一层网格之间未打通，镜面反射
                         info->next_grid = info->current_grid;
@@ -621,7 +897,7 @@ void get_ray_intersection_dot_with_grid(Ray_Intersection_Dot_Info *info) {
                 } else {
                     g.x = info->current_grid.x+1;
                     g.y = info->current_grid.y;
-                    if (is_two_grids_connected(&tk_shared_game_state.maze, &info->current_grid, &g)) { // 当前网格与右侧网格之间打通，射线射入右侧网格中
+                    if (is_two_grids_connected(info->maze, &info->current_grid, &g)) { // 当前网格与右侧网格之间打通，射线射入右侧网格中
                         info->next_grid = g;
                     } else { // 当前网格与右侧网格之间未打通，镜面反射
                         info->next_grid = info->current_grid;
@@ -637,14 +913,14 @@ void get_ray_intersection_dot_with_grid(Ray_Intersection_Dot_Info *info) {
                 } else {
                     g.x = info->current_grid.x;
                     g.y = info->current_grid.y+1;
-                    connect1 = is_two_grids_connected(&tk_shared_game_state.maze, &info->current_grid, &g);
+                    connect1 = is_two_grids_connected(info->maze, &info->current_grid, &g);
                 }
                 if ((info->current_grid.x+1) == HORIZON_GRID_NUMBER) {
                     connect2 = 0;
                 } else {
                     g.x = info->current_grid.x+1;
                     g.y = info->current_grid.y;
-                    connect2 = is_two_grids_connected(&tk_shared_game_state.maze, &info->current_grid, &g);
+                    connect2 = is_two_grids_connected(info->maze, &info->current_grid, &g);
                 }
                 if (!connect1 || !connect2) { // 右下角两边存在至少一堵墙，则终止，否则直接射入右下角对角相连的网格
                     info->terminate_flag = 1;
@@ -667,7 +943,7 @@ void get_ray_intersection_dot_with_grid(Ray_Intersection_Dot_Info *info) {
                 } else {
                     g.x = info->current_grid.x;
                     g.y = info->current_grid.y+1;
-                    if (is_two_grids_connected(&tk_shared_game_state.maze, &info->current_grid, &g)) { // 当前网格与下一层网格之间打通，射线射入下一层网格中
+                    if (is_two_grids_connected(info->maze, &info->current_grid, &g)) { // 当前网格与下一层网格之间打通，射线射入下一层网格中
                         info->next_grid = g;
                     } else { // 当前网格与下一层网格之间未打通，镜面反射
                         info->next_grid = info->current_grid;
@@ -684,7 +960,7 @@ void get_ray_intersection_dot_with_grid(Ray_Intersection_Dot_Info *info) {
                 } else {
                     g.x = info->current_grid.x-1;
                     g.y = info->current_grid.y;
-                    if (is_two_grids_connected(&tk_shared_game_state.maze, &info->current_grid, &g)) { // 当前网格与左侧网格之间打通，射线射入左侧网格中
+                    if (is_two_grids_connected(info->maze, &info->current_grid, &g)) { // 当前网格与左侧网格之间打通，射线射入左侧网格中
                         info->next_grid = g;
                     } else { // 当前网格与左侧网格之间未打通，镜面反射
                         info->next_grid = info->current_grid;
@@ -700,14 +976,14 @@ void get_ray_intersection_dot_with_grid(Ray_Intersection_Dot_Info *info) {
                 } else {
                     g.x = info->current_grid.x;
                     g.y = info->current_grid.y+1;
-                    connect1 = is_two_grids_connected(&tk_shared_game_state.maze, &info->current_grid, &g);
+                    connect1 = is_two_grids_connected(info->maze, &info->current_grid, &g);
                 }
                 if (info->current_grid.x == 0) {
                     connect2 = 0;
                 } else {
                     g.x = info->current_grid.x-1;
                     g.y = info->current_grid.y;
-                    connect2 = is_two_grids_connected(&tk_shared_game_state.maze, &info->current_grid, &g);
+                    connect2 = is_two_grids_connected(info->maze, &info->current_grid, &g);
                 }
                 if (!connect1 || !connect2) { // 左下角两边存在至少一堵墙，则终止，否则直接射入左下角对角相连的网格
                     info->terminate_flag = 1;
@@ -730,7 +1006,7 @@ void get_ray_intersection_dot_with_grid(Ray_Intersection_Dot_Info *info) {
                 } else {
                     g.x = info->current_grid.x;
                     g.y = info->current_grid.y-1;
-                    if (is_two_grids_connected(&tk_shared_game_state.maze, &info->current_grid, &g)) { // 当前网格与上一层网格之间打通，射线射入上一层网格中
+                    if (is_two_grids_connected(info->maze, &info->current_grid, &g)) { // 当前网格与上一层网格之间打通，射线射入上一层网格中
                         info->next_grid = g;
                     } else { // 当前网格与上一层网格之间未打通，镜面反射
                         info->next_grid = info->current_grid;
@@ -747,7 +1023,7 @@ void get_ray_intersection_dot_with_grid(Ray_Intersection_Dot_Info *info) {
                 } else {
                     g.x = info->current_grid.x-1;
                     g.y = info->current_grid.y;
-                    if (is_two_grids_connected(&tk_shared_game_state.maze, &info->current_grid, &g)) { // 当前网格与左侧网格之间打通，射线射入左侧网格中
+                    if (is_two_grids_connected(info->maze, &info->current_grid, &g)) { // 当前网格与左侧网格之间打通，射线射入左侧网格中
                         info->next_grid = g;
                     } else { // 当前网格与左侧网格之间未打通，镜面反射
                         info->next_grid = info->current_grid;
@@ -763,14 +1039,14 @@ void get_ray_intersection_dot_with_grid(Ray_Intersection_Dot_Info *info) {
                 } else {
                     g.x = info->current_grid.x;
                     g.y = info->current_grid.y-1;
-                    connect1 = is_two_grids_connected(&tk_shared_game_state.maze, &info->current_grid, &g);
+                    connect1 = is_two_grids_connected(info->maze, &info->current_grid, &g);
                 }
                 if (info->current_grid.x == 0) {
                     connect2 = 0;
                 } else {
                     g.x = info->current_grid.x-1;
                     g.y = info->current_grid.y;
-                    connect2 = is_two_grids_connected(&tk_shared_game_state.maze, &info->current_grid, &g);
+                    connect2 = is_two_grids_connected(info->maze, &info->current_grid, &g);
                 }
                 if (!connect1 || !connect2) { // 左上角两边存在至少一堵墙，则终止，否则直接射入左上角对角相连的网格
                     info->terminate_flag = 1;
@@ -806,7 +1082,7 @@ int get_point_position_with_line(Point *C, Point *line_A, Point *line_B) {
 }
 
 // 判断两个位置之间是否穿过墙壁（1：穿过墙壁存在碰撞，0：反之未穿过墙壁无碰撞）
-static int is_two_pos_transfer_through_wall(Point *pos1, Point *pos2) {
+static int is_two_pos_transfer_through_wall(Maze *maze, Point *pos1, Point *pos2) {
     Grid grid1 = get_grid_by_tank_position(pos1);
     Grid grid2 = get_grid_by_tank_position(pos2);
     Grid grid3, grid4;
@@ -823,7 +1099,7 @@ static int is_two_pos_transfer_through_wall(Point *pos1, Point *pos2) {
     if (MAZE_SAME_GRID == relationship) { // 必无碰撞
         return 0;
     } else if (MAZE_ADJACENT_GRID == relationship) { // 两个网格相邻并之间打通，则与墙壁必无碰撞，否则必碰撞
-        if (is_two_grids_connected(&tk_shared_game_state.maze, &grid1, &grid2)) {
+        if (is_two_grids_connected(maze, &grid1, &grid2)) {
             return 0;
         }
         return 1;
@@ -845,23 +1121,23 @@ static int is_two_pos_transfer_through_wall(Point *pos1, Point *pos2) {
             dot0 = get_pos_by_grid(&grid1, 3);
             t = get_point_position_with_line(&dot0, pos1, pos2);
             if (t == DOT_LEFT_OF_LINE) { // dot0在线pos1-pos2的上方
-                if (!is_two_grids_connected(&tk_shared_game_state.maze, &grid1, &grid4) 
-                    || !is_two_grids_connected(&tk_shared_game_state.maze, &grid2, &grid4)) {
+                if (!is_two_grids_connected(maze, &grid1, &grid4) 
+                    || !is_two_grids_connected(maze, &grid2, &grid4)) {
                     tk_debug_internal(DEBUG_TANK_COLLISION, ">1 | dot0(%f,%f), pos1(%f,%f), pos2(%f,%f), %d, %d, grid1:(%d,%d), grid2:(%d,%d), grid3:(%d,%d), grid4:(%d,%d)\n", 
                         POS(dot0), POSPTR(pos1), POSPTR(pos2), 
-                        is_two_grids_connected(&tk_shared_game_state.maze, &grid1, &grid4), 
-                        is_two_grids_connected(&tk_shared_game_state.maze, &grid2, &grid4), 
+                        is_two_grids_connected(maze, &grid1, &grid4), 
+                        is_two_grids_connected(maze, &grid2, &grid4), 
                         grid1.x, grid1.y, grid2.x, grid2.y, grid3.x, grid3.y, grid4.x, grid4.y);
                     return 1;
                 }
                 return 0;
             } else if (t == DOT_RIGHT_OF_LINE) { // dot0在线pos1-pos2的下方
-                if (!is_two_grids_connected(&tk_shared_game_state.maze, &grid1, &grid3) 
-                    || !is_two_grids_connected(&tk_shared_game_state.maze, &grid2, &grid3)) {
+                if (!is_two_grids_connected(maze, &grid1, &grid3) 
+                    || !is_two_grids_connected(maze, &grid2, &grid3)) {
                     tk_debug_internal(DEBUG_TANK_COLLISION, ">2 | dot0(%f,%f), pos1(%f,%f), pos2(%f,%f), %d, %d, grid1:(%d,%d), grid2:(%d,%d), grid3:(%d,%d), grid4:(%d,%d)\n", 
                         POS(dot0), POSPTR(pos1), POSPTR(pos2), 
-                        is_two_grids_connected(&tk_shared_game_state.maze, &grid1, &grid3), 
-                        is_two_grids_connected(&tk_shared_game_state.maze, &grid2, &grid3), 
+                        is_two_grids_connected(maze, &grid1, &grid3), 
+                        is_two_grids_connected(maze, &grid2, &grid3), 
                         grid1.x, grid1.y, grid2.x, grid2.y, grid3.x, grid3.y, grid4.x, grid4.y);
                     return 1;
                 }
@@ -886,23 +1162,23 @@ static int is_two_pos_transfer_through_wall(Point *pos1, Point *pos2) {
             dot0 = get_pos_by_grid(&grid3, 3);
             t = get_point_position_with_line(&dot0, pos1, pos2);
             if (t == DOT_LEFT_OF_LINE) { // dot0在线pos1-pos2的下方
-                if (!is_two_grids_connected(&tk_shared_game_state.maze, &grid1, &grid3) 
-                    || !is_two_grids_connected(&tk_shared_game_state.maze, &grid2, &grid3)) {
+                if (!is_two_grids_connected(maze, &grid1, &grid3) 
+                    || !is_two_grids_connected(maze, &grid2, &grid3)) {
                     tk_debug_internal(DEBUG_TANK_COLLISION, ">3 | dot0(%f,%f), pos1(%f,%f), pos2(%f,%f), %d, %d, grid1:(%d,%d), grid2:(%d,%d), grid3:(%d,%d), grid4:(%d,%d)\n", 
                         POS(dot0), POSPTR(pos1), POSPTR(pos2), 
-                        is_two_grids_connected(&tk_shared_game_state.maze, &grid1, &grid3), 
-                        is_two_grids_connected(&tk_shared_game_state.maze, &grid2, &grid3), 
+                        is_two_grids_connected(maze, &grid1, &grid3), 
+                        is_two_grids_connected(maze, &grid2, &grid3), 
                         grid1.x, grid1.y, grid2.x, grid2.y, grid3.x, grid3.y, grid4.x, grid4.y);
                     return 1;
                 }
                 return 0;
             } else if (t == DOT_RIGHT_OF_LINE) { // dot0在线pos1-pos2的上方
-                if (!is_two_grids_connected(&tk_shared_game_state.maze, &grid1, &grid4) 
-                    || !is_two_grids_connected(&tk_shared_game_state.maze, &grid2, &grid4)) {
+                if (!is_two_grids_connected(maze, &grid1, &grid4) 
+                    || !is_two_grids_connected(maze, &grid2, &grid4)) {
                     tk_debug_internal(DEBUG_TANK_COLLISION, ">4 | dot0(%f,%f), pos1(%f,%f), pos2(%f,%f), %d, %d, grid1:(%d,%d), grid2:(%d,%d), grid3:(%d,%d), grid4:(%d,%d)\n", 
                         POS(dot0), POSPTR(pos1), POSPTR(pos2), 
-                        is_two_grids_connected(&tk_shared_game_state.maze, &grid1, &grid4), 
-                        is_two_grids_connected(&tk_shared_game_state.maze, &grid2, &grid4), 
+                        is_two_grids_connected(maze, &grid1, &grid4), 
+                        is_two_grids_connected(maze, &grid2, &grid4), 
                         grid1.x, grid1.y, grid2.x, grid2.y, grid3.x, grid3.y, grid4.x, grid4.y);
                     return 1;
                 }
@@ -928,6 +1204,7 @@ void handle_key(Tank *tank, KeyValue *key_value) {
 
     if (!tank || !key_value) return;
     if ((key_value->mask) == 0) return;
+    TK_PROFILE_SCOPE(TK_PHASE_TANK_MOVE);
     Point new_position = tank->position;
     tk_float32_t new_angle_deg = tank->angle_deg;
 
@@ -984,20 +1261,21 @@ void handle_key(Tank *tank, KeyValue *key_value) {
 
     tank->collision_flag &= 0xF0;
     CLR_FLAG(tank, collision_flag, COLLISION_WITH_TANK);
-    if (is_two_pos_transfer_through_wall(&outline.righttop, &outline.rightbottom)) {
+    if (is_two_pos_transfer_through_wall(&tank->game->maze, &outline.righttop, &outline.rightbottom)) {
         tk_debug_internal(DEBUG_TANK_COLLISION, "前方发生碰撞\n");
         SET_FLAG(tank, collision_flag, COLLISION_FRONT);
-    } else if (is_two_pos_transfer_through_wall(&outline.lefttop, &outline.righttop)) {
+    } else if (is_two_pos_transfer_through_wall(&tank->game->maze, &outline.lefttop, &outline.righttop)) {
         tk_debug_internal(DEBUG_TANK_COLLISION, "左侧发生碰撞\n");
         SET_FLAG(tank, collision_flag, COLLISION_LEFT);
-    } else if (is_two_pos_transfer_through_wall(&outline.rightbottom, &outline.leftbottom)) {
+    } else if (is_two_pos_transfer_through_wall(&tank->game->maze, &outline.rightbottom, &outline.leftbottom)) {
         tk_debug_internal(DEBUG_TANK_COLLISION, "右侧发生碰撞\n");
         SET_FLAG(tank, collision_flag, COLLISION_RIGHT);
-    } else if (is_two_pos_transfer_through_wall(&outline.leftbottom, &outline.lefttop)) {
+    } else if (is_two_pos_transfer_through_wall(&tank->game->maze, &outline.leftbottom, &outline.lefttop)) {
         tk_debug_internal(DEBUG_TANK_COLLISION, "后方发生碰撞\n");
         SET_FLAG(tank, collision_flag, COLLISION_BACK);
     } else { // 未与墙壁发生碰撞
         if (!is_my_tank_collide_with_other_tanks(tank, &outline)) { //未与地图上的其他坦克发生碰撞
+            record_motion(&tank->motion, &tank->position, tank->angle_deg);
             tank->position = new_position;
             tank->angle_deg = new_angle_deg;
             tank->practical_outline = outline;
@@ -1009,67 +1287,89 @@ void handle_key(Tank *tank, KeyValue *key_value) {
 }
 
 tk_uint8_t get_max_shell_collision_num(Tank *tank) {
-    if (TANK_ROLE_SELF == tank->role) {
-        return MY_SHELL_COLLISION_MAX_NUM;
+    if (TANK_ROLE_IS_PLAYER(tank->role)) {
+        return tank->game->my_shell_ttl;
     }
-    return DEFAULT_TANK_SHELL_COLLISION_MAX_NUM;
+    return tank->game->enemy_shell_ttl;
 }
 
-Shell* create_shell_for_tank(Tank *tank) {
-    if (!tank) return NULL;
-    if ((tank->health <= 0) || !TST_FLAG(tank, flags, TANK_ALIVE)) return NULL;
-
+// 在坦克炮口处创建一枚炮弹并挂到坦克的炮弹链表上（不检查坦克能否开炮，见create_shell_for_tank()）
+Shell* create_shell(Tank *tank) {
     Shell *shell = NULL;
-    tk_uint8_t shell_num = 0;
-    TAILQ_FOREACH(shell, &tank->shell_list, chain) {
-        shell_num++;
-    }
-    if (shell_num >= tank->max_shell_num) {
-        tk_debug("Warn: can't create more shells(%u>=MAX/%u) for tank(%s)\n", shell_num, tank->max_shell_num, tank->name);
-        SET_FLAG(tank, flags, TANK_FORBID_SHOOT);
-        return NULL;
-    }
-    CLR_FLAG(tank, flags, TANK_FORBID_SHOOT);
 
-    shell = malloc(sizeof(Shell));
+    shell = tk_slab_alloc(&tank->game->shell_slab);
     if (!shell) {
+        tk_debug("Error: %s no free shell slot(%zu in use)\n", __func__, tank->game->shell_slab.used);
         goto error;
     }
-    memset(shell, 0, sizeof(shell));
+    memset(shell, 0, sizeof(Shell));
 
-    shell->id = id_pool_allocate(tk_idpool);
+    shell->handle = id_pool_allocate_handle(tank->game->idpool, shell);
+    shell->id = HANDLE2ID(shell->handle);
     if (!shell->id) {
         tk_debug("Error: %s id_pool_allocate failed\n", __func__);
         goto error;
     }
     shell->position = get_line_center(&tank->practical_outline.righttop, &tank->practical_outline.rightbottom);
     shell->angle_deg = tank->angle_deg;
-    shell->speed = SHELL_INIT_SPEED;
+    init_motion_history(&shell->motion, &shell->position, shell->angle_deg);
+    shell->speed = tank->game->shell_speed;
     shell->tank_owner = (void*)tank;
+    shell->game = tank->game;
+    shell->owner_handle = tank->handle;
     shell->ttl = get_max_shell_collision_num(tank);
+#ifdef ENABLE_LAG_COMPENSATION
+    if (tank->view_tick && (tank->view_tick < tank->game->tick)) {
+        shell->rewind_ticks = MIN(tank->game->tick - tank->view_tick, TK_REWIND_TICKS - 1);
+    }
+#endif
     lock(&tank->spinlock);
     TAILQ_INSERT_HEAD(&tank->shell_list, shell, chain);
     unlock(&tank->spinlock);
-    shell_num += 1;
-    tk_debug("create a shell(id:%lu) %p at (%f,%f) for tank(%s) success, the tank now has %u shells\n", shell->id, shell, 
-        POS(shell->position), tank->name, shell_num);
-    if (shell_num >= tank->max_shell_num) {
-        SET_FLAG(tank, flags, TANK_FORBID_SHOOT);
-    }
     return shell;
 error:
     tk_debug("Error: create shell for tank(%s) failed\n", tank->name);
     if (shell) {
-        free(shell);
+        tk_slab_free(&tank->game->shell_slab, shell);
     }
     return NULL;
 }
 
+Shell* create_shell_for_tank(Tank *tank) {
+    if (!tank) return NULL;
+    if ((tank->health <= 0) || !TST_FLAG(tank, flags, TANK_ALIVE)) return NULL;
+
+    Shell *shell = NULL;
+    tk_uint8_t shell_num = 0;
+    TAILQ_FOREACH(shell, &tank->shell_list, chain) {
+        shell_num++;
+    }
+    if (shell_num >= tank->max_shell_num) {
+        tk_debug_internal(DEBUG_OBJECT_LIFECYCLE, "Warn: can't create more shells(%u>=MAX/%u) for tank(%s)\n", shell_num, tank->max_shell_num, tank->name);
+        SET_FLAG(tank, flags, TANK_FORBID_SHOOT);
+        return NULL;
+    }
+    CLR_FLAG(tank, flags, TANK_FORBID_SHOOT);
+
+    shell = create_shell(tank);
+    if (!shell) {
+        return NULL;
+    }
+    tank->game->shots++;
+    shell_num += 1;
+    tk_debug_internal(DEBUG_OBJECT_LIFECYCLE, "create a shell(id:%lu) %p at (%f,%f) for tank(%s) success, the tank now has %u shells\n", shell->id, shell, 
+        POS(shell->position), tank->name, shell_num);
+    if (shell_num >= tank->max_shell_num) {
+        SET_FLAG(tank, flags, TANK_FORBID_SHOOT);
+    }
+    return shell;
+}
+
 void delete_shell(Shell *shell, int dereference) {
     if (!shell) return;
 
     Shell *s = NULL, *t = NULL;
-    tk_debug("shell(%p, id:%lu) of tank(%s) is deleted\n", shell, shell->id, ((Tank*)(shell->tank_owner))->name);
+    tk_debug_internal(DEBUG_OBJECT_LIFECYCLE, "shell(%p, id:%lu) of tank(%s) is deleted\n", shell, shell->id, ((Tank*)(shell->tank_owner))->name);
     if (dereference) {
         TAILQ_FOREACH_SAFE(s, &((Tank*)(shell->tank_owner))->shell_list, chain, t) {
             if (s != shell) {
@@ -1081,12 +1381,17 @@ void delete_shell(Shell *shell, int dereference) {
         }
     }
     shell->tank_owner = NULL;
-    id_pool_release(tk_idpool, shell->id);
+    id_pool_release_handle(shell->game->idpool, shell->handle);
     shell->id = 0;
-    free(shell);
+    shell->handle = 0;
+    tk_slab_free(&shell->game->shell_slab, shell);
 }
 
 double calculate_tan(double angle_degrees) {
+#ifdef ENABLE_FIXED_POINT_MATH
+    tk_fixed_t tan_val = tk_fixed_tan_deg(tk_fixed_from_float(angle_degrees));
+    return (tan_val == TK_FIXED_INFINITY) ? INFINITY : tk_fixed_to_double(tan_val);
+#else
     angle_degrees = fmod(angle_degrees, 360);  // 确保角度在 0~360 范围内
     if (angle_degrees == 90.0 || angle_degrees == 270.0) {
         printf("tan(%.1f°) is undefined (infinity)\n", angle_degrees);
@@ -1094,6 +1399,7 @@ double calculate_tan(double angle_degrees) {
     }
     double angle_radians = angle_degrees * (M_PI / 180.0);
     return tan(angle_radians);
+#endif
 }
 /*int main() {
     double angles[] = {0, 30, 45, 60, 90, 180, 270, 360};
@@ -1108,7 +1414,62 @@ double calculate_tan(double angle_degrees) {
 
 #define SHELL_COLLISION_EPSILON 0.1
 int is_equal_double(double a, double b, double epsilon) {
+#ifdef ENABLE_FIXED_POINT_MATH
+    return llabs((int64_t)tk_fixed_from_float(a) - tk_fixed_from_float(b)) < tk_fixed_from_float(epsilon);
+#else
     return fabs(a - b) < epsilon;
+#endif
+}
+
+#ifdef ENABLE_FIXED_POINT_MATH
+typedef tk_fixed_t shell_slope_t; // 定点模式下炮弹轨迹的斜率全程是定点数，不经过double
+#define SHELL_SLOPE_DOUBLE(k) tk_fixed_to_double(k)
+
+static shell_slope_t shell_slope(tk_float32_t angle_deg) {
+    return tk_fixed_tan_deg(TK_FIXED_FROM_INT(90) - tk_fixed_from_float(angle_deg));
+}
+
+/*与水平方向相差不到约0.0009°的轨迹定点斜率为0，与竖直方向相差不到约0.002°的斜率饱和，都无法按斜率求与墙壁的交点，
+  update_one_shell_movement_position()把它们当作水平/竖直方向的炮弹处理*/
+static tk_float32_t shell_dispatch_angle_deg(tk_float32_t angle_deg) {
+    shell_slope_t k = 0;
+
+    if ((angle_deg <= 0) || (angle_deg >= 360) || (angle_deg == 90) || (angle_deg == 180) || (angle_deg == 270)) {
+        return angle_deg;
+    }
+    k = shell_slope(angle_deg);
+    if (k == 0) {
+        return (angle_deg < 180) ? 90 : 270;
+    } else if ((k == TK_FIXED_INFINITY) || (k == -TK_FIXED_INFINITY)) {
+        return ((angle_deg > 90) && (angle_deg < 270)) ? 180 : 0;
+    }
+    return angle_deg;
+}
+#else
+typedef double shell_slope_t;
+#define SHELL_SLOPE_DOUBLE(k) (k)
+#define shell_slope(angle_deg) calculate_slope(angle_deg)
+#define shell_dispatch_angle_deg(angle_deg) (angle_deg)
+#endif
+
+/*炮弹轨迹（过点pos、斜率为k的直线k·x + y - (k·x0 + y0) = 0）与水平墙壁y=wall_x的交点横坐标，
+  以及与垂直墙壁x=wall_y的交点纵坐标。k不为0，定点模式下也不饱和（见shell_dispatch_angle_deg()）*/
+static tk_float32_t shell_line_x_at(shell_slope_t k, const Point *pos, tk_float32_t wall_x) {
+#ifdef ENABLE_FIXED_POINT_MATH
+    int64_t c = (int64_t)tk_fixed_from_float(pos->y) * TK_FIXED_ONE + (int64_t)k * tk_fixed_from_float(pos->x); // Q32.32
+    return (tk_float32_t)tk_fixed_to_double((c - (int64_t)tk_fixed_from_float(wall_x) * TK_FIXED_ONE) / k);
+#else
+    return ((pos->y + k*pos->x) - wall_x) / k;
+#endif
+}
+
+static tk_float32_t shell_line_y_at(shell_slope_t k, const Point *pos, tk_float32_t wall_y) {
+#ifdef ENABLE_FIXED_POINT_MATH
+    int64_t c = (int64_t)tk_fixed_from_float(pos->y) * TK_FIXED_ONE + (int64_t)k * tk_fixed_from_float(pos->x); // Q32.32
+    return (tk_float32_t)tk_fixed_to_double((c - (int64_t)k * tk_fixed_from_float(wall_y)) >> TK_FIXED_SHIFT);
+#else
+    return (pos->y + k*pos->x) - k*wall_y;
+#endif
 }
 
 /*判断某位置是否在网格的边框线上，上下浮动范围_float，返回0表示不在边框上，返回1表示在上方边框线，2表示右，3表示下，4表示左*/
@@ -1154,7 +1515,8 @@ void update_one_shell_movement_position(Shell *shell, int need_to_detect_collisi
     tk_uint8_t collide_wall_y = 0; // 是否与垂直墙壁发生碰撞
     Tank *tank = NULL;
     tk_uint16_t blood_loss = 0;
-    double k = 0;
+    shell_slope_t k = 0;
+    tk_float32_t dir_deg = 0; // 据此选择按哪个方向处理碰撞
     tk_float32_t x = 0, y = 0;
     Grid t;
     tk_uint8_t pos_flag = 0;
@@ -1166,14 +1528,15 @@ void update_one_shell_movement_position(Shell *shell, int need_to_detect_collisi
     new_pos = move_point(shell->position, shell->angle_deg, shell->speed);
     next_grid = current_grid = get_grid_by_shell_position(&shell->position);
     new_angle_deg = shell->angle_deg;
+    dir_deg = shell_dispatch_angle_deg(shell->angle_deg);
     // goto out;
 
-    if (shell->angle_deg == 0) { // 前进方向为上（正北）
+    if (dir_deg == 0) { // 前进方向为上（正北）
         p = get_pos_by_grid(&current_grid, 0);
         wall_x = p.y;
         if ((new_pos.y-FINETUNE_SHELL_RADIUS_LENGTH) <= wall_x) { // 可能与上方墙壁发生碰撞，之所以是可能，是因为还未判断上方是否真的存在墙壁
             next_grid.y -= 1;
-            if ((next_grid.y < 0) || (!is_two_grids_connected(&tk_shared_game_state.maze, &current_grid, &next_grid))) { // 上方存在墙壁
+            if ((next_grid.y < 0) || (!is_two_grids_connected(&shell->game->maze, &current_grid, &next_grid))) { // 上方存在墙壁
                 new_pos.y = wall_x + FINETUNE_SHELL_RADIUS_LENGTH;
                 new_angle_deg = 180; // 反弹方向
             } else {
@@ -1181,7 +1544,7 @@ void update_one_shell_movement_position(Shell *shell, int need_to_detect_collisi
                 if (TST_FLAG2(pos_flag, POS_AT_LEFT_BORDER)) {
                     if (current_grid.x > 0) {
                         t = (Grid){current_grid.x-1, next_grid.y};
-                        if (!is_two_grids_connected(&tk_shared_game_state.maze, &next_grid, &t)) {
+                        if (!is_two_grids_connected(&shell->game->maze, &next_grid, &t)) {
                             new_pos.y = wall_x + FINETUNE_SHELL_RADIUS_LENGTH;
                             new_angle_deg = 180; // 反弹方向
                         }
@@ -1189,7 +1552,7 @@ void update_one_shell_movement_position(Shell *shell, int need_to_detect_collisi
                 } else if (TST_FLAG2(pos_flag, POS_AT_RIGHT_BORDER)) {
                     if (current_grid.x < (HORIZON_GRID_NUMBER-1)) {
                         t = (Grid){current_grid.x+1, next_grid.y};
-                        if (!is_two_grids_connected(&tk_shared_game_state.maze, &next_grid, &t)) {
+                        if (!is_two_grids_connected(&shell->game->maze, &next_grid, &t)) {
                             new_pos.y = wall_x + FINETUNE_SHELL_RADIUS_LENGTH;
                             new_angle_deg = 180; // 反弹方向
                         }
@@ -1201,12 +1564,12 @@ void update_one_shell_movement_position(Shell *shell, int need_to_detect_collisi
         } else {
             goto out;
         }
-    } else if (shell->angle_deg == 90) {
+    } else if (dir_deg == 90) {
         p = get_pos_by_grid(&current_grid, 1);
         wall_y = p.x;
         if ((new_pos.x+FINETUNE_SHELL_RADIUS_LENGTH) >= wall_y) {
             next_grid.x += 1;
-            if ((next_grid.x >= HORIZON_GRID_NUMBER) || (!is_two_grids_connected(&tk_shared_game_state.maze, &current_grid, &next_grid))) {
+            if ((next_grid.x >= HORIZON_GRID_NUMBER) || (!is_two_grids_connected(&shell->game->maze, &current_grid, &next_grid))) {
                 new_pos.x = wall_y - FINETUNE_SHELL_RADIUS_LENGTH;
                 new_angle_deg = 270;
             } else {
@@ -1214,7 +1577,7 @@ void update_one_shell_movement_position(Shell *shell, int need_to_detect_collisi
                 if (TST_FLAG2(pos_flag, POS_AT_TOP_BORDER)) {
                     if (current_grid.y > 0) {
                         t = (Grid){next_grid.x, current_grid.y-1};
-                        if (!is_two_grids_connected(&tk_shared_game_state.maze, &next_grid, &t)) {
+                        if (!is_two_grids_connected(&shell->game->maze, &next_grid, &t)) {
                             new_pos.x = wall_y - FINETUNE_SHELL_RADIUS_LENGTH;
                             new_angle_deg = 270;
                         }
@@ -1222,7 +1585,7 @@ void update_one_shell_movement_position(Shell *shell, int need_to_detect_collisi
                 } else if (TST_FLAG2(pos_flag, POS_AT_BOTTOM_BORDER)) {
                     if (current_grid.y < (VERTICAL_GRID_NUMBER-1)) {
                         t = (Grid){next_grid.x, current_grid.y+1};
-                        if (!is_two_grids_connected(&tk_shared_game_state.maze, &next_grid, &t)) {
+                        if (!is_two_grids_connected(&shell->game->maze, &next_grid, &t)) {
                             new_pos.x = wall_y - FINETUNE_SHELL_RADIUS_LENGTH;
                             new_angle_deg = 270;
                         }
@@ -1234,12 +1597,12 @@ void update_one_shell_movement_position(Shell *shell, int need_to_detect_collisi
         } else {
             goto out;
         }
-    } else if (shell->angle_deg == 180) {
+    } else if (dir_deg == 180) {
         p = get_pos_by_grid(&current_grid, 3);
         wall_x = p.y;
         if ((new_pos.y+FINETUNE_SHELL_RADIUS_LENGTH) >= wall_x) {
             next_grid.y += 1;
-            if ((next_grid.y >= VERTICAL_GRID_NUMBER) || (!is_two_grids_connected(&tk_shared_game_state.maze, &current_grid, &next_grid))) {
+            if ((next_grid.y >= VERTICAL_GRID_NUMBER) || (!is_two_grids_connected(&shell->game->maze, &current_grid, &next_grid))) {
                 new_pos.y = wall_x - FINETUNE_SHELL_RADIUS_LENGTH;
                 new_angle_deg = 0;
             } else {
@@ -1247,7 +1610,7 @@ void update_one_shell_movement_position(Shell *shell, int need_to_detect_collisi
                 if (TST_FLAG2(pos_flag, POS_AT_LEFT_BORDER)) {
                     if (current_grid.x > 0) {
                         t = (Grid){current_grid.x-1, next_grid.y};
-                        if (!is_two_grids_connected(&tk_shared_game_state.maze, &next_grid, &t)) {
+                        if (!is_two_grids_connected(&shell->game->maze, &next_grid, &t)) {
                             new_pos.y = wall_x - FINETUNE_SHELL_RADIUS_LENGTH;
                             new_angle_deg = 0;
                         }
@@ -1255,7 +1618,7 @@ void update_one_shell_movement_position(Shell *shell, int need_to_detect_collisi
                 } else if (TST_FLAG2(pos_flag, POS_AT_RIGHT_BORDER)) {
                     if (current_grid.x < (HORIZON_GRID_NUMBER-1)) {
                         t = (Grid){current_grid.x+1, next_grid.y};
-                        if (!is_two_grids_connected(&tk_shared_game_state.maze, &next_grid, &t)) {
+                        if (!is_two_grids_connected(&shell->game->maze, &next_grid, &t)) {
                             new_pos.y = wall_x - FINETUNE_SHELL_RADIUS_LENGTH;
                             new_angle_deg = 0;
                         }
@@ -1267,12 +1630,12 @@ void update_one_shell_movement_position(Shell *shell, int need_to_detect_collisi
         } else {
             goto out;
         }
-    } else if (shell->angle_deg == 270) {
+    } else if (dir_deg == 270) {
         p = get_pos_by_grid(&current_grid, 2);
         wall_y = p.x;
         if ((new_pos.x-FINETUNE_SHELL_RADIUS_LENGTH) <= wall_y) {
             next_grid.x -= 1;
-            if ((next_grid.x < 0) || (!is_two_grids_connected(&tk_shared_game_state.maze, &current_grid, &next_grid))) {
+            if ((next_grid.x < 0) || (!is_two_grids_connected(&shell->game->maze, &current_grid, &next_grid))) {
                 new_pos.x = wall_y + FINETUNE_SHELL_RADIUS_LENGTH;
                 new_angle_deg = 90;
             } else {
@@ -1280,7 +1643,7 @@ void update_one_shell_movement_position(Shell *shell, int need_to_detect_collisi
                 if (TST_FLAG2(pos_flag, POS_AT_TOP_BORDER)) {
                     if (current_grid.y > 0) {
                         t = (Grid){next_grid.x, current_grid.y-1};
-                        if (!is_two_grids_connected(&tk_shared_game_state.maze, &next_grid, &t)) {
+                        if (!is_two_grids_connected(&shell->game->maze, &next_grid, &t)) {
                             new_pos.x = wall_y + FINETUNE_SHELL_RADIUS_LENGTH;
                             new_angle_deg = 90;
                         }
@@ -1288,7 +1651,7 @@ void update_one_shell_movement_position(Shell *shell, int need_to_detect_collisi
                 } else if (TST_FLAG2(pos_flag, POS_AT_BOTTOM_BORDER)) {
                     if (current_grid.y < (VERTICAL_GRID_NUMBER-1)) {
                         t = (Grid){next_grid.x, current_grid.y+1};
-                        if (!is_two_grids_connected(&tk_shared_game_state.maze, &next_grid, &t)) {
+                        if (!is_two_grids_connected(&shell->game->maze, &next_grid, &t)) {
                             new_pos.x = wall_y + FINETUNE_SHELL_RADIUS_LENGTH;
                             new_angle_deg = 90;
                         }
@@ -1301,14 +1664,14 @@ void update_one_shell_movement_position(Shell *shell, int need_to_detect_collisi
             goto out;
         }
     } else {
-        if ((shell->angle_deg > 0) && (shell->angle_deg < 90)) { // 前进方向为右上角
+        if ((dir_deg > 0) && (dir_deg < 90)) { // 前进方向为右上角
             p = get_pos_by_grid(&current_grid, 1);
             wall_x = p.y;
             wall_y = p.x;
             collide_wall_x = 0; // 是否碰撞上墙壁
             if ((new_pos.y-FINETUNE_SHELL_RADIUS_LENGTH) <= wall_x) {
                 next_grid.y -= 1;
-                if ((next_grid.y < 0) || (!is_two_grids_connected(&tk_shared_game_state.maze, &current_grid, &next_grid))) {
+                if ((next_grid.y < 0) || (!is_two_grids_connected(&shell->game->maze, &current_grid, &next_grid))) {
                     collide_wall_x = 1;
                 }
             }
@@ -1316,26 +1679,26 @@ void update_one_shell_movement_position(Shell *shell, int need_to_detect_collisi
             collide_wall_y = 0; // 是否碰撞右墙壁
             if ((new_pos.x+FINETUNE_SHELL_RADIUS_LENGTH) >= wall_y) {
                 next_grid.x += 1;
-                if ((next_grid.x >= HORIZON_GRID_NUMBER) || (!is_two_grids_connected(&tk_shared_game_state.maze, &current_grid, &next_grid))) {
+                if ((next_grid.x >= HORIZON_GRID_NUMBER) || (!is_two_grids_connected(&shell->game->maze, &current_grid, &next_grid))) {
                     collide_wall_y = 1;
                 }
             }
             /*特殊情况*/
             if (!collide_wall_x && !collide_wall_y) {
                 if (((new_pos.x+FINETUNE_SHELL_RADIUS_LENGTH) >= wall_y) && (new_pos.y-FINETUNE_SHELL_RADIUS_LENGTH) <= wall_x) {
-                    tk_uint8_t hit_opposite_wall_x = !is_two_grids_connected(&tk_shared_game_state.maze, 
+                    tk_uint8_t hit_opposite_wall_x = !is_two_grids_connected(&shell->game->maze, 
                         &(Grid){current_grid.x+1, current_grid.y}, &(Grid){current_grid.x+1, current_grid.y-1});
-                    tk_uint8_t hit_opposite_wall_y = !is_two_grids_connected(&tk_shared_game_state.maze, 
+                    tk_uint8_t hit_opposite_wall_y = !is_two_grids_connected(&shell->game->maze, 
                         &(Grid){current_grid.x, current_grid.y-1}, &(Grid){current_grid.x+1, current_grid.y-1});
                     if (!hit_opposite_wall_x && !hit_opposite_wall_y) {
                         goto out;
                     }
-                    k = calculate_slope(shell->angle_deg); //k·x + y - (k·x0 + y0) = 0
+                    k = shell_slope(shell->angle_deg); //k·x + y - (k·x0 + y0) = 0
                     tk_debug_internal(DEBUG_SHELL_COLLISION, "特殊碰撞检测1：k=%f(%u,%u), pos(%f,%f), wallxy(%f,%f)\n", 
-                        k, hit_opposite_wall_x, hit_opposite_wall_y, POS(shell->position), wall_x, wall_y);
+                        SHELL_SLOPE_DOUBLE(k), hit_opposite_wall_x, hit_opposite_wall_y, POS(shell->position), wall_x, wall_y);
                     f0 = f1 = 0;
                     if (hit_opposite_wall_x) { //opposite_wall_x存在的意思
-                        x = ((shell->position.y + k*shell->position.x) - wall_x) / k;
+                        x = shell_line_x_at(k, &shell->position, wall_x);
                         if (is_equal_double(x, wall_y, SHELL_COLLISION_EPSILON)) {
                             f0 = 1;
                             tk_debug_internal(DEBUG_SHELL_COLLISION, "特殊碰撞1：x=%f\n", x);
@@ -1363,7 +1726,7 @@ void update_one_shell_movement_position(Shell *shell, int need_to_detect_collisi
                         }
                     }
                     if (hit_opposite_wall_y) { //opposite_wall_y存在的意思
-                        y = (shell->position.y + k*shell->position.x) - k*wall_y;
+                        y = shell_line_y_at(k, &shell->position, wall_y);
                         if (is_equal_double(y, wall_x, SHELL_COLLISION_EPSILON)) {
                             f1 = 1;
                             tk_debug_internal(DEBUG_SHELL_COLLISION, "特殊碰撞1：y=%f\n", y);
@@ -1439,14 +1802,14 @@ void update_one_shell_movement_position(Shell *shell, int need_to_detect_collisi
             } else { // 无碰撞
                 goto out;
             }
-        } else if ((shell->angle_deg > 90) && (shell->angle_deg < 180)) {
+        } else if ((dir_deg > 90) && (dir_deg < 180)) {
             p = get_pos_by_grid(&current_grid, 3);
             wall_x = p.y;
             wall_y = p.x;
             collide_wall_x = 0;
             if ((new_pos.y+FINETUNE_SHELL_RADIUS_LENGTH) >= wall_x) {
                 next_grid.y += 1;
-                if ((next_grid.y >= VERTICAL_GRID_NUMBER) || (!is_two_grids_connected(&tk_shared_game_state.maze, &current_grid, &next_grid))) {
+                if ((next_grid.y >= VERTICAL_GRID_NUMBER) || (!is_two_grids_connected(&shell->game->maze, &current_grid, &next_grid))) {
                     collide_wall_x = 1;
                 }
             }
@@ -1454,26 +1817,26 @@ void update_one_shell_movement_position(Shell *shell, int need_to_detect_collisi
             collide_wall_y = 0;
             if ((new_pos.x+FINETUNE_SHELL_RADIUS_LENGTH) >= wall_y) {
                 next_grid.x += 1;
-                if ((next_grid.x >= HORIZON_GRID_NUMBER) || (!is_two_grids_connected(&tk_shared_game_state.maze, &current_grid, &next_grid))) {
+                if ((next_grid.x >= HORIZON_GRID_NUMBER) || (!is_two_grids_connected(&shell->game->maze, &current_grid, &next_grid))) {
                     collide_wall_y = 1;
                 }
             }
             /*特殊情况*/
             if (!collide_wall_x && !collide_wall_y) {
                 if (((new_pos.x+FINETUNE_SHELL_RADIUS_LENGTH) >= wall_y) && (new_pos.y+FINETUNE_SHELL_RADIUS_LENGTH) >= wall_x) {
-                    tk_uint8_t hit_opposite_wall_x = !is_two_grids_connected(&tk_shared_game_state.maze, 
+                    tk_uint8_t hit_opposite_wall_x = !is_two_grids_connected(&shell->game->maze, 
                         &(Grid){current_grid.x+1, current_grid.y}, &(Grid){current_grid.x+1, current_grid.y+1});
-                    tk_uint8_t hit_opposite_wall_y = !is_two_grids_connected(&tk_shared_game_state.maze, 
+                    tk_uint8_t hit_opposite_wall_y = !is_two_grids_connected(&shell->game->maze, 
                         &(Grid){current_grid.x, current_grid.y+1}, &(Grid){current_grid.x+1, current_grid.y+1});
                     if (!hit_opposite_wall_x && !hit_opposite_wall_y) {
                         goto out;
                     }
-                    k = calculate_slope(shell->angle_deg); //k·x + y - (k·x0 + y0) = 0
+                    k = shell_slope(shell->angle_deg); //k·x + y - (k·x0 + y0) = 0
                     tk_debug_internal(DEBUG_SHELL_COLLISION, "特殊碰撞检测2：k=%f(%u,%u), pos(%f,%f), wallxy(%f,%f)\n", 
-                        k, hit_opposite_wall_x, hit_opposite_wall_y, POS(shell->position), wall_x, wall_y);
+                        SHELL_SLOPE_DOUBLE(k), hit_opposite_wall_x, hit_opposite_wall_y, POS(shell->position), wall_x, wall_y);
                     f0 = f1 = 0;
                     if (hit_opposite_wall_x) {
-                        x = ((shell->position.y + k*shell->position.x) - wall_x) / k;
+                        x = shell_line_x_at(k, &shell->position, wall_x);
                         if (is_equal_double(x, wall_y, SHELL_COLLISION_EPSILON)) {
                             f0 = 1;
                             tk_debug_internal(DEBUG_SHELL_COLLISION, "特殊碰撞1：x=%f\n", x);
@@ -1501,7 +1864,7 @@ void update_one_shell_movement_position(Shell *shell, int need_to_detect_collisi
                         }
                     }
                     if (hit_opposite_wall_y) {
-                        y = (shell->position.y + k*shell->position.x) - k*wall_y;
+                        y = shell_line_y_at(k, &shell->position, wall_y);
                         if (is_equal_double(y, wall_x, SHELL_COLLISION_EPSILON)) {
                             f1 = 1;
                             tk_debug_internal(DEBUG_SHELL_COLLISION, "特殊碰撞1：y=%f\n", y);
@@ -1577,14 +1940,14 @@ void update_one_shell_movement_position(Shell *shell, int need_to_detect_collisi
             } else {
                 goto out;
             }
-        } else if ((shell->angle_deg > 180) && (shell->angle_deg < 270)) {
+        } else if ((dir_deg > 180) && (dir_deg < 270)) {
             p = get_pos_by_grid(&current_grid, 2);
             wall_x = p.y;
             wall_y = p.x;
             collide_wall_x = 0;
             if ((new_pos.y+FINETUNE_SHELL_RADIUS_LENGTH) >= wall_x) {
                 next_grid.y += 1;
-                if ((next_grid.y >= VERTICAL_GRID_NUMBER) || (!is_two_grids_connected(&tk_shared_game_state.maze, &current_grid, &next_grid))) {
+                if ((next_grid.y >= VERTICAL_GRID_NUMBER) || (!is_two_grids_connected(&shell->game->maze, &current_grid, &next_grid))) {
                     collide_wall_x = 1;
                 }
             }
@@ -1592,26 +1955,26 @@ void update_one_shell_movement_position(Shell *shell, int need_to_detect_collisi
             collide_wall_y = 0;
             if ((new_pos.x-FINETUNE_SHELL_RADIUS_LENGTH) <= wall_y) {
                 next_grid.x -= 1;
-                if ((next_grid.x < 0) || (!is_two_grids_connected(&tk_shared_game_state.maze, &current_grid, &next_grid))) {
+                if ((next_grid.x < 0) || (!is_two_grids_connected(&shell->game->maze, &current_grid, &next_grid))) {
                     collide_wall_y = 1;
                 }
             }
             /*特殊情况*/
             if (!collide_wall_x && !collide_wall_y) {
                 if (((new_pos.x-FINETUNE_SHELL_RADIUS_LENGTH) <= wall_y) && (new_pos.y+FINETUNE_SHELL_RADIUS_LENGTH) >= wall_x) {
-                    tk_uint8_t hit_opposite_wall_x = !is_two_grids_connected(&tk_shared_game_state.maze, 
+                    tk_uint8_t hit_opposite_wall_x = !is_two_grids_connected(&shell->game->maze, 
                         &(Grid){current_grid.x-1, current_grid.y}, &(Grid){current_grid.x-1, current_grid.y+1});
-                    tk_uint8_t hit_opposite_wall_y = !is_two_grids_connected(&tk_shared_game_state.maze, 
+                    tk_uint8_t hit_opposite_wall_y = !is_two_grids_connected(&shell->game->maze, 
                         &(Grid){current_grid.x, current_grid.y+1}, &(Grid){current_grid.x-1, current_grid.y+1});
                     if (!hit_opposite_wall_x && !hit_opposite_wall_y) {
                         goto out;
                     }
-                    k = calculate_slope(shell->angle_deg); //k·x + y - (k·x0 + y0) = 0
+                    k = shell_slope(shell->angle_deg); //k·x + y - (k·x0 + y0) = 0
                     tk_debug_internal(DEBUG_SHELL_COLLISION, "特殊碰撞检测3：k=%f(%u,%u), pos(%f,%f), wallxy(%f,%f)\n", 
-                        k, hit_opposite_wall_x, hit_opposite_wall_y, POS(shell->position), wall_x, wall_y);
+                        SHELL_SLOPE_DOUBLE(k), hit_opposite_wall_x, hit_opposite_wall_y, POS(shell->position), wall_x, wall_y);
                     f0 = f1 = 0;
                     if (hit_opposite_wall_x) {
-                        x = ((shell->position.y + k*shell->position.x) - wall_x) / k;
+                        x = shell_line_x_at(k, &shell->position, wall_x);
                         if (is_equal_double(x, wall_y, SHELL_COLLISION_EPSILON)) {
                             f0 = 1;
                             tk_debug_internal(DEBUG_SHELL_COLLISION, "特殊碰撞1：x=%f\n", x);
@@ -1639,7 +2002,7 @@ void update_one_shell_movement_position(Shell *shell, int need_to_detect_collisi
                         }
                     }
                     if (hit_opposite_wall_y) {
-                        y = (shell->position.y + k*shell->position.x) - k*wall_y;
+                        y = shell_line_y_at(k, &shell->position, wall_y);
                         if (is_equal_double(y, wall_x, SHELL_COLLISION_EPSILON)) {
                             f1 = 1;
                             tk_debug_internal(DEBUG_SHELL_COLLISION, "特殊碰撞1：y=%f\n", y);
@@ -1715,14 +2078,14 @@ void update_one_shell_movement_position(Shell *shell, int need_to_detect_collisi
             } else {
                 goto out;
             }
-        } else if ((shell->angle_deg > 270) && (shell->angle_deg < 360)) {
+        } else if ((dir_deg > 270) && (dir_deg < 360)) {
             p = get_pos_by_grid(&current_grid, 0);
             wall_x = p.y;
             wall_y = p.x;
             collide_wall_x = 0;
             if ((new_pos.y-FINETUNE_SHELL_RADIUS_LENGTH) <= wall_x) {
                 next_grid.y -= 1;
-                if ((next_grid.y < 0) || (!is_two_grids_connected(&tk_shared_game_state.maze, &current_grid, &next_grid))) {
+                if ((next_grid.y < 0) || (!is_two_grids_connected(&shell->game->maze, &current_grid, &next_grid))) {
                     collide_wall_x = 1;
                 }
             }
@@ -1730,26 +2093,26 @@ void update_one_shell_movement_position(Shell *shell, int need_to_detect_collisi
             collide_wall_y = 0;
             if ((new_pos.x-FINETUNE_SHELL_RADIUS_LENGTH) <= wall_y) {
                 next_grid.x -= 1;
-                if ((next_grid.x < 0) || (!is_two_grids_connected(&tk_shared_game_state.maze, &current_grid, &next_grid))) {
+                if ((next_grid.x < 0) || (!is_two_grids_connected(&shell->game->maze, &current_grid, &next_grid))) {
                     collide_wall_y = 1;
                 }
             }
             /*特殊情况*/
             if (!collide_wall_x && !collide_wall_y) {
                 if (((new_pos.x-FINETUNE_SHELL_RADIUS_LENGTH) <= wall_y) && (new_pos.y-FINETUNE_SHELL_RADIUS_LENGTH) <= wall_x) {
-                    tk_uint8_t hit_opposite_wall_x = !is_two_grids_connected(&tk_shared_game_state.maze, 
+                    tk_uint8_t hit_opposite_wall_x = !is_two_grids_connected(&shell->game->maze, 
                         &(Grid){current_grid.x-1, current_grid.y}, &(Grid){current_grid.x-1, current_grid.y-1});
-                    tk_uint8_t hit_opposite_wall_y = !is_two_grids_connected(&tk_shared_game_state.maze, 
+                    tk_uint8_t hit_opposite_wall_y = !is_two_grids_connected(&shell->game->maze, 
                         &(Grid){current_grid.x, current_grid.y-1}, &(Grid){current_grid.x-1, current_grid.y-1});
                     if (!hit_opposite_wall_x && !hit_opposite_wall_y) {
                         goto out;
                     }
-                    k = calculate_slope(shell->angle_deg); //k·x + y - (k·x0 + y0) = 0
+                    k = shell_slope(shell->angle_deg); //k·x + y - (k·x0 + y0) = 0
                     tk_debug_internal(DEBUG_SHELL_COLLISION, "特殊碰撞检测4：k=%f(%u,%u), pos(%f,%f), wallxy(%f,%f)\n", 
-                        k, hit_opposite_wall_x, hit_opposite_wall_y, POS(shell->position), wall_x, wall_y);
+                        SHELL_SLOPE_DOUBLE(k), hit_opposite_wall_x, hit_opposite_wall_y, POS(shell->position), wall_x, wall_y);
                     f0 = f1 = 0;
                     if (hit_opposite_wall_x) {
-                        x = ((shell->position.y + k*shell->position.x) - wall_x) / k;
+                        x = shell_line_x_at(k, &shell->position, wall_x);
                         if (is_equal_double(x, wall_y, SHELL_COLLISION_EPSILON)) {
                             f0 = 1;
                             tk_debug_internal(DEBUG_SHELL_COLLISION, "特殊碰撞1：x=%f\n", x);
@@ -1777,7 +2140,7 @@ void update_one_shell_movement_position(Shell *shell, int need_to_detect_collisi
                         }
                     }
                     if (hit_opposite_wall_y) {
-                        y = (shell->position.y + k*shell->position.x) - k*wall_y;
+                        y = shell_line_y_at(k, &shell->position, wall_y);
                         if (is_equal_double(y, wall_x, SHELL_COLLISION_EPSILON)) {
                             f1 = 1;
                             tk_debug_internal(DEBUG_SHELL_COLLISION, "特殊碰撞1：y=%f\n", y);
@@ -1872,13 +2235,14 @@ out: // 没有发生碰撞反弹直接out
                 tank->health = 0;
             }
             shell->ttl = 0;
+            shell->game->hits++;
             SET_FLAG(tank, flags, TANK_IS_HIT_BY_ENEMY);
             if (tank->health <= 0) {
-                tk_debug("坦克(%s)被%s的炮弹(ID:%u)击毁！\n", tank->name, ((Tank *)(shell->tank_owner))->name, shell->id);
+                tk_debug_internal(DEBUG_OBJECT_LIFECYCLE, "坦克(%s)被%s的炮弹(ID:%u)击毁！\n", tank->name, ((Tank *)(shell->tank_owner))->name, shell->id);
                 // delete_tank(tank, 1); //此时还不能立即destroy/free被击毁的坦克，因为爆炸特效的绘制需要一些时间，因此
                 // 需要依赖定时器延迟删除坦克，当前是放在update_muggle_enemy_position()中去完成deaded坦克的删除释放
             } else {
-                tk_debug("%s的炮弹(ID:%u)击中了坦克%s(掉血%u,剩余血量%u)\n", ((Tank *)(shell->tank_owner))->name, shell->id, tank->name, blood_loss, tank->health);
+                tk_debug_internal(DEBUG_OBJECT_LIFECYCLE, "%s的炮弹(ID:%u)击中了坦克%s(掉血%u,剩余血量%u)\n", ((Tank *)(shell->tank_owner))->name, shell->id, tank->name, blood_loss, tank->health);
             }
             return;
         }
@@ -1905,14 +2269,16 @@ int is_near(float x1, float y1, float x2, float y2) {
 #endif
 
 // 更新炮弹移动状态
-void update_all_shell_movement_position() {
+void update_all_shell_movement_position(GameState *gs) {
     Tank *tank = NULL, *tt = NULL;
     Shell *shell = NULL, *ts = NULL;
     Point old_pos;
+    TK_PROFILE_SCOPE(TK_PHASE_SHELL_PHYSICS);
 
-    TAILQ_FOREACH_SAFE(tank, &tk_shared_game_state.tank_list, chain, tt) {
+    TAILQ_FOREACH_SAFE(tank, &gs->tank_list, chain, tt) {
         TAILQ_FOREACH_SAFE(shell, &tank->shell_list, chain, ts) {
             old_pos = shell->position;
+            record_motion(&shell->motion, &shell->position, shell->angle_deg);
             update_one_shell_movement_position(shell, 1);
             tk_debug_internal(DEBUG_CONTROL_THREAD_DETAIL, "shell %lu(tank %lu) move from (%f,%f) to (%f,%f)\n", 
                 shell->id, tank->id, POS(old_pos), POS(shell->position));
@@ -1961,7 +2327,7 @@ int get_movable_direction(Tank *tank, int no_backtracking) {
     if (grid.y > 0) {
         next.x = grid.x;
         next.y = grid.y - 1;
-        if (is_two_grids_connected(&tk_shared_game_state.maze, &grid, &next)) {
+        if (is_two_grids_connected(&tank->game->maze, &grid, &next)) {
             if ((no_backtracking && (from_dir != 1)) || (!no_backtracking)) {
                 option[option_num++] = 1;
             }
@@ -1970,7 +2336,7 @@ int get_movable_direction(Tank *tank, int no_backtracking) {
     if ((grid.y + 1) < VERTICAL_GRID_NUMBER) {
         next.x = grid.x;
         next.y = grid.y + 1;
-        if (is_two_grids_connected(&tk_shared_game_state.maze, &grid, &next)) {
+        if (is_two_grids_connected(&tank->game->maze, &grid, &next)) {
             if ((no_backtracking && (from_dir != 2)) || (!no_backtracking)) {
                 option[option_num++] = 2;
             }
@@ -1979,7 +2345,7 @@ int get_movable_direction(Tank *tank, int no_backtracking) {
     if (grid.x > 0) {
         next.x = grid.x - 1;
         next.y = grid.y;
-        if (is_two_grids_connected(&tk_shared_game_state.maze, &grid, &next)) {
+        if (is_two_grids_connected(&tank->game->maze, &grid, &next)) {
             if ((no_backtracking && (from_dir != 3)) || (!no_backtracking)) {
                 option[option_num++] = 3;
             }
@@ -1988,7 +2354,7 @@ int get_movable_direction(Tank *tank, int no_backtracking) {
     if ((grid.x + 1) < HORIZON_GRID_NUMBER) {
         next.x = grid.x + 1;
         next.y = grid.y;
-        if (is_two_grids_connected(&tk_shared_game_state.maze, &grid, &next)) {
+        if (is_two_grids_connected(&tank->game->maze, &grid, &next)) {
             if ((no_backtracking && (from_dir != 4)) || (!no_backtracking)) {
                 option[option_num++] = 4;
             }
@@ -2027,7 +2393,7 @@ int get_movable_direction(Tank *tank, int no_backtracking) {
         tk_debug_internal(DEBUG_ENEMY_MUGGLE_TANK, "get_movable_direction %d(weight:%u)\n", option[min_map_vis_ind], min_map_vis_val);
         return option[min_map_vis_ind];
     }
-    return option[random_range(0, option_num-1)];
+    return option[game_random_range(tank->game, 0, option_num-1)];
 }
 
 void save_steps_to_escape(Tank *tank, int index, int num, int direction) {
@@ -2055,7 +2421,7 @@ void reset_rotation_direction_for_tank(Tank *tank, int index) {
             movable_direction = get_movable_direction(tank, 0);
         }
         if (!movable_direction) {
-            tank->steps_to_escape[index] = (random_range(6, 24) << 4) | (MOVE_RIGHT);
+            tank->steps_to_escape[index] = (game_random_range(tank->game, 6, 24) << 4) | (MOVE_RIGHT);
         } else {
             if (movable_direction == 1) {
                 if (tank->angle_deg > 180) {
@@ -2115,14 +2481,15 @@ void reset_rotation_direction_for_tank(Tank *tank, int index) {
 }
 
 // 傻瓜坦克随机自由移动并发射炮弹
-void update_muggle_enemy_position() {
+void update_muggle_enemy_position(GameState *gs) {
     Tank *tank = NULL, *tt = NULL;
     tk_float32_t new_angle_deg = 0;
     int i = 0;
     Grid grid;
     int index = 0;
+    TK_PROFILE_SCOPE(TK_PHASE_AI);
 
-    TAILQ_FOREACH_SAFE(tank, &tk_shared_game_state.tank_list, chain, tt) {
+    TAILQ_FOREACH_SAFE(tank, &gs->tank_list, chain, tt) {
         if ((tank->health <= 0) || !TST_FLAG(tank, flags, TANK_ALIVE)) {
             if (TST_FLAG(tank, flags, TANK_DEAD)) {
                 delete_tank(tank, 1);
@@ -2137,7 +2504,7 @@ void update_muggle_enemy_position() {
                 for (i=0; i<STEPS_TO_ESCAPE_NUM; i++) {
                     tank->steps_to_escape[i] = 0;
                 }
-                tank->steps_to_escape[0] = (random_range(3, 6) << 4) | (MOVE_BACK);
+                tank->steps_to_escape[0] = (game_random_range(gs, 3, 6) << 4) | (MOVE_BACK);
                 tk_debug_internal(DEBUG_ENEMY_MUGGLE_TANK, "计划向后%d步\n", tank->steps_to_escape[0] >> 4);
                 reset_rotation_direction_for_tank(tank, 1);
                 /*本次先向后退一步*/
@@ -2147,10 +2514,10 @@ void update_muggle_enemy_position() {
                 tank->steps_to_escape[0] = (((tank->steps_to_escape[0] >> 4) - 1) << 4) | (MOVE_BACK);
                 handle_key(tank, &(tank->key_value_for_control));
                 if (((tank->collision_flag << 4) != 0) || (TST_FLAG(tank, collision_flag, COLLISION_WITH_TANK))) { // 向后遇阻，重新调整脱困方案
-                    if (random_range(0,1) == 1) {
-                        tank->steps_to_escape[0] = (random_range(3, 6) << 4) | (MOVE_RIGHT);
+                    if (game_random_range(gs, 0,1) == 1) {
+                        tank->steps_to_escape[0] = (game_random_range(gs, 3, 6) << 4) | (MOVE_RIGHT);
                     } else {
-                        tank->steps_to_escape[0] = (random_range(3, 6) << 4) | (MOVE_LEFT);
+                        tank->steps_to_escape[0] = (game_random_range(gs, 3, 6) << 4) | (MOVE_LEFT);
                     }
                 }
             } else {
@@ -2207,7 +2574,7 @@ void update_muggle_enemy_position() {
                 tank->key_value_for_control.mask = 0;
                 SET_FLAG(&(tank->key_value_for_control), mask, TK_KEY_W_ACTIVE); // 默认向前移动
                 handle_key(tank, &(tank->key_value_for_control));
-                if ((tk_shared_game_state.game_time % 20) == 0) { // 定期发射炮弹
+                if ((gs->tick % gs->muggle_shoot_interval) == 0) { // 定期发射炮弹
                     create_shell_for_tank(tank);
                 }
     iter_next_tank:
@@ -2356,7 +2723,50 @@ tk_float32_t overlap_amount(tk_float32_t min1, tk_float32_t max1, tk_float32_t m
 /**
  * 使用分离轴定理检测两个矩形是否碰撞
  */
+#ifdef ENABLE_FIXED_POINT_MATH
+typedef struct {
+    tk_fixed_t x, y;
+} FixedPoint;
+
+static void rectangle_to_fixed(const Rectangle *rect, FixedPoint points[4]) {
+    const Point *p = (const Point *)rect;
+    for (int i = 0; i < 4; i++) {
+        points[i] = (FixedPoint){tk_fixed_from_float(p[i].x), tk_fixed_from_float(p[i].y)};
+    }
+}
+
+// 定点数投影（Q32.32）。只比较投影区间是否重叠，分离轴不需要归一化
+static void project_polygon_fixed(const FixedPoint *axis, const FixedPoint points[4], int64_t *min, int64_t *max) {
+    int64_t p = 0;
+
+    *min = *max = (int64_t)axis->x * points[0].x + (int64_t)axis->y * points[0].y;
+    for (int i = 1; i < 4; i++) {
+        p = (int64_t)axis->x * points[i].x + (int64_t)axis->y * points[i].y;
+        *min = MIN(*min, p);
+        *max = MAX(*max, p);
+    }
+}
+#endif
+
 bool is_rectangle_collision(const Rectangle* r1, const Rectangle* r2) {
+#ifdef ENABLE_FIXED_POINT_MATH
+    FixedPoint p1[4], p2[4], axis;
+    const FixedPoint *edge_points[4][2] = {{&p1[0], &p1[1]}, {&p1[1], &p1[2]}, {&p2[0], &p2[1]}, {&p2[1], &p2[2]}};
+    int64_t min1, max1, min2, max2;
+
+    rectangle_to_fixed(r1, p1);
+    rectangle_to_fixed(r2, p2);
+    for (int i = 0; i < 4; i++) {
+        // 边的法线作为分离轴（坐标差不超过地图尺寸，Q16.16表示的点积不会溢出int64）
+        axis = (FixedPoint){-(edge_points[i][1]->y - edge_points[i][0]->y), edge_points[i][1]->x - edge_points[i][0]->x};
+        project_polygon_fixed(&axis, p1, &min1, &max1);
+        project_polygon_fixed(&axis, p2, &min2, &max2);
+        if ((max1 < min2) || (max2 < min1)) {
+            return false;
+        }
+    }
+    return true;
+#else
     // 定义矩形的四条边向量（实际只需要两个不平行的边）
     Vector2 edges[4];
     
@@ -2387,6 +2797,7 @@ bool is_rectangle_collision(const Rectangle* r1, const Rectangle* r2) {
     
     // 如果所有轴上的投影都重叠，则矩形相交
     return true;
+#endif
 }
 
 bool is_two_tanks_collision(Tank *my_tank, Rectangle *newest_outline, Tank *other_tank) {
@@ -2405,7 +2816,8 @@ bool is_two_tanks_collision(Tank *my_tank, Rectangle *newest_outline, Tank *othe
 /*坦克是否与其他坦克发生碰撞*/
 bool is_my_tank_collide_with_other_tanks(Tank *my_tank, Rectangle *newest_outline) {
     Tank *other_tank= NULL;
-    TAILQ_FOREACH(other_tank, &tk_shared_game_state.tank_list, chain) {
+    TK_PROFILE_SCOPE(TK_PHASE_COLLISION);
+    TAILQ_FOREACH(other_tank, &my_tank->game->tank_list, chain) {
         if (other_tank == my_tank) {
             continue;
         }
@@ -2429,17 +2841,18 @@ void calculate_shell_outline(const Point *center, Rectangle *rect) {
     points[3] = (Point){center->x - (SHELL_RADIUS_LENGTH/2), center->y + (SHELL_RADIUS_LENGTH/2)};
 }
 
-bool is_shell_and_tank_collision(Shell *shell, Rectangle *shell_outline, Tank *tank) {
+bool is_shell_and_tank_collision(Shell *shell, Rectangle *shell_outline, const Point *tank_position, const Rectangle *tank_outline) {
+    Point position = *tank_position;
     Grid shell_grid = get_grid_by_tank_position(&shell->position);
-    Grid tank_grid = get_grid_by_tank_position(&tank->position);
+    Grid tank_grid = get_grid_by_tank_position(&position);
 
     if ((abs(shell_grid.x - tank_grid.x) >= 2) || (abs(shell_grid.y - tank_grid.y) >= 2)) {
         return false;
     }
-    if (!is_rectangle_collision_projection(shell_outline, &tank->practical_outline)) {
+    if (!is_rectangle_collision_projection(shell_outline, tank_outline)) {
         return false;
     }
-    return is_rectangle_collision(shell_outline, &tank->practical_outline);
+    return is_rectangle_collision(shell_outline, tank_outline);
 }
 
 /*炮弹是否与其他坦克发生碰撞，函数返回发生碰撞的其他人坦克*/
@@ -2447,16 +2860,31 @@ Tank* is_my_shell_collide_with_other_tanks(Shell *shell) {
     Tank *other_tank= NULL;
     Tank *my_tank = (Tank *)(shell->tank_owner);
     Rectangle shell_outline;
+    const Point *tank_position = NULL;
+    const Rectangle *tank_outline = NULL;
+#ifdef ENABLE_LAG_COMPENSATION
+    const TankRewindRecord *record = NULL;
+#endif
+    TK_PROFILE_SCOPE(TK_PHASE_COLLISION);
 
     calculate_shell_outline(&shell->position, &shell_outline);
-    TAILQ_FOREACH(other_tank, &tk_shared_game_state.tank_list, chain) {
+    TAILQ_FOREACH(other_tank, &shell->game->tank_list, chain) {
         if (other_tank == my_tank) { //如果自己的炮弹打到自己，不掉血，直接穿过？合理吗这样设定~
             continue;
         }
         if ((other_tank->health <= 0) || !TST_FLAG(other_tank, flags, TANK_ALIVE)) {
             continue;
         }
-        if (is_shell_and_tank_collision(shell, &shell_outline, other_tank)) {
+        tank_position = &other_tank->position;
+        tank_outline = &other_tank->practical_outline;
+#ifdef ENABLE_LAG_COMPENSATION
+        // 射击者看到的是rewind_ticks帧之前的其他坦克（没有那一帧的记录则说明坦克是之后才出现的，按当前轮廓判定）
+        if (shell->rewind_ticks && (record = tank_rewind_record(other_tank, shell->game->tick - shell->rewind_ticks))) {
+            tank_position = &record->position;
+            tank_outline = &record->practical_outline;
+        }
+#endif
+        if (is_shell_and_tank_collision(shell, &shell_outline, tank_position, tank_outline)) {
             tk_debug_internal(DEBUG_SHELL_COLLISION, "炮弹(%s's %u shell)检测到与坦克(%s)在位置(%f,%f)发生了碰撞！\n", 
                 my_tank->name, shell->id, other_tank->name, POS(shell->position));
             return other_tank;
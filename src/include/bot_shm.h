@@ -0,0 +1,176 @@
+#ifndef __BOT_SHM_H__
+    #define __BOT_SHM_H__
+
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/syscall.h>
+#include <linux/futex.h>
+
+/*外部AI进程接口（POSIX共享内存，只用于本机）：模拟进程（宿主）创建名为name的共享内存区，其中有最新一帧的精简世界视图
+  与每个机器人一个的输入槽位，机器人进程映射同一块内存即可读状态、写按键，不经过套接字与序列化。
+  区域布局即下面的TkBotShmRegion（宿主与机器人须用同一份头文件、同一种ABI编译），不依赖游戏的其他头文件。
+  同步（Linux futex，两个等待字都在共享内存里，跨进程有效，因此不能用FUTEX_*_PRIVATE）：
+    view_seq    视图的序列锁，宿主写视图前后各加1（奇数表示正在写）并唤醒所有等待者；机器人在它上面等待新的一帧，
+                读视图前后比较序列号，不一致则重读
+    input_bell  输入门铃，机器人写完输入后加1并唤醒宿主；宿主等待本帧所有已接入机器人的input_tick都等于当前帧
+  接入：机器人将某个槽位的owner从0原子地改为自己的线程ID，退出时改回0；宿主发现机器人进程已不存在时代为释放。
+  宿主为每个已接入的槽位创建一辆TANK_ROLE_EXTERNAL坦克（被击毁后重生），槽位释放后坦克随之离场。
+  步进模式（pace_ms为0）：每帧发布视图后等待所有已接入机器人的输入再推进下一帧，模拟速度只受机器人与模拟本身的耗时限制，
+  适合训练；没有机器人接入时宿主暂停。超过TK_BOT_SHM_STEP_TIMEOUT_MS仍未到齐则沿用其上一次的按键并计为超时。
+  实时模式（pace_ms>0）：每pace_ms毫秒推进一帧，只采样各槽位当时的按键，不等待*/
+#define TK_BOT_SHM_MAGIC 0x42334b54 // "TK3B"
+#define TK_BOT_SHM_VERSION 1
+#define TK_BOT_SHM_DEFAULT_NAME "/tank3-bots"
+#define TK_BOT_SHM_MAX_BOTS   32
+#define TK_BOT_SHM_MAX_TANKS  256  // 视图容量，超出部分不可见（truncated置1）
+#define TK_BOT_SHM_MAX_SHELLS 1024
+#define TK_BOT_SHM_STEP_TIMEOUT_MS 1000
+#define TK_BOT_SHM_WRITE_SPIN_LIMIT 1000 // 读到写了一半的视图时先自旋这么多次，仍未写完（宿主被调度走或已崩溃）就在view_seq上等待
+#define TK_BOT_BUTTON_FIRE 0x10 // buttons低四位同KeyValue.mask（按住的方向键，每帧执行一次handle_key()）
+
+typedef struct {
+    uint32_t handle;  // 坦克句柄（见idpool.h），坦克重生后句柄不同
+    float x;
+    float y;
+    float angle_deg;  // 正北为0，顺时针
+    uint16_t health;
+    uint8_t role;     // TANK_ROLE_*
+    uint8_t alive;
+} TkBotTankView;
+
+typedef struct {
+    uint32_t owner_handle;
+    float x;
+    float y;
+    float angle_deg;
+} TkBotShellView;
+
+typedef struct {
+    uint32_t tick;
+    uint32_t tank_num;
+    uint32_t shell_num;
+    uint32_t truncated;
+    TkBotTankView tanks[TK_BOT_SHM_MAX_TANKS];
+    TkBotShellView shells[TK_BOT_SHM_MAX_SHELLS];
+} TkBotWorldView;
+
+typedef struct {
+    uint32_t owner;       // 机器人写：接入的线程ID，0表示空闲
+    uint32_t tank_handle; // 宿主写：该槽位的坦克，0表示还没有（或正等待重生）
+    uint32_t buttons;     // 机器人写：按键
+    uint32_t input_tick;  // 机器人写：buttons是针对哪一帧视图给出的（先写buttons，再以release语义写它）
+    uint32_t late_ticks;  // 宿主写：步进模式下该机器人超时的帧数
+} __attribute__((aligned(64))) TkBotSlot; // 各槽位独占缓存行
+
+typedef struct {
+    uint32_t magic;
+    uint32_t version;
+    uint32_t map_horizon; // 地图网格数与网格边长，机器人据此把坐标换算为网格
+    uint32_t map_vertical;
+    uint32_t grid_size;
+    uint32_t tick_ms;     // 每个模拟帧代表的游戏时间
+    uint32_t maze_seed;   // 用同一个种子调用maze_generate()可在本地得到同一张地图
+    uint32_t slot_num;
+    uint32_t pace_ms;
+    uint32_t running;     // 宿主退出前置0并唤醒所有机器人
+    uint32_t view_seq __attribute__((aligned(64)));
+    uint32_t input_bell __attribute__((aligned(64)));
+    TkBotWorldView view __attribute__((aligned(64)));
+    TkBotSlot slots[TK_BOT_SHM_MAX_BOTS];
+} TkBotShmRegion;
+
+#if defined(__x86_64__) || defined(__i386__)
+#define tk_bot_shm_cpu_relax() __builtin_ia32_pause()
+#elif defined(__aarch64__)
+#define tk_bot_shm_cpu_relax() __asm__ __volatile__("yield" ::: "memory")
+#else
+#define tk_bot_shm_cpu_relax() do {} while (0)
+#endif
+
+// 等待*addr不再等于val（或超时、被信号打断），返回后由调用者重新检查条件
+static inline void tk_bot_shm_wait(uint32_t *addr, uint32_t val, uint32_t timeout_ms) {
+    struct timespec ts = {timeout_ms / 1000, (timeout_ms % 1000) * 1000000L};
+    syscall(SYS_futex, addr, FUTEX_WAIT, val, &ts, NULL, 0);
+}
+
+static inline void tk_bot_shm_wake(uint32_t *addr) {
+    syscall(SYS_futex, addr, FUTEX_WAKE, INT32_MAX, NULL, NULL, 0);
+}
+
+// 读取序列号不同于*seq的一帧视图（没有则最多等待timeout_ms），读到返回1并更新*seq；没有新视图或宿主已退出返回0
+static inline int tk_bot_shm_read_view(TkBotShmRegion *region, TkBotWorldView *view, uint32_t *seq, uint32_t timeout_ms) {
+    uint32_t s1 = 0, s2 = 0, spins = 0;
+
+    for (;;) {
+        s1 = __atomic_load_n(&region->view_seq, __ATOMIC_ACQUIRE);
+        if (!__atomic_load_n(&region->running, __ATOMIC_ACQUIRE)) {
+            return 0;
+        }
+        if (s1 == *seq) {
+            tk_bot_shm_wait(&region->view_seq, s1, timeout_ms);
+            if (__atomic_load_n(&region->view_seq, __ATOMIC_ACQUIRE) == s1) {
+                return 0;
+            }
+            continue;
+        }
+        if (s1 & 1) { // 宿主正在写
+            if (++spins < TK_BOT_SHM_WRITE_SPIN_LIMIT) {
+                tk_bot_shm_cpu_relax();
+                continue;
+            }
+            spins = 0;
+            tk_bot_shm_wait(&region->view_seq, s1, timeout_ms);
+            if (__atomic_load_n(&region->view_seq, __ATOMIC_ACQUIRE) == s1) {
+                return 0;
+            }
+            continue;
+        }
+        memcpy(view, &region->view, offsetof(TkBotWorldView, tanks));
+        if ((view->tank_num > TK_BOT_SHM_MAX_TANKS) || (view->shell_num > TK_BOT_SHM_MAX_SHELLS)) {
+            continue; // 读到了写了一半的计数
+        }
+        memcpy(view->tanks, region->view.tanks, view->tank_num * sizeof(TkBotTankView));
+        memcpy(view->shells, region->view.shells, view->shell_num * sizeof(TkBotShellView));
+        __atomic_thread_fence(__ATOMIC_ACQUIRE);
+        s2 = __atomic_load_n(&region->view_seq, __ATOMIC_RELAXED);
+        if (s1 == s2) {
+            *seq = s1;
+            return 1;
+        }
+    }
+}
+
+// 机器人写完一个槽位的按键后调用
+static inline void tk_bot_shm_submit(TkBotShmRegion *region, TkBotSlot *slot, uint32_t buttons, uint32_t tick) {
+    __atomic_store_n(&slot->buttons, buttons, __ATOMIC_RELAXED);
+    __atomic_store_n(&slot->input_tick, tick, __ATOMIC_RELEASE);
+    __atomic_add_fetch(&region->input_bell, 1, __ATOMIC_RELEASE);
+    tk_bot_shm_wake(&region->input_bell);
+}
+
+/*宿主：无GUI地运行一局游戏，通过共享内存把坦克交给外部机器人进程操控*/
+typedef struct {
+    const char *name;  // 共享内存对象名（shm_open()），以'/'开头
+    uint32_t slots;    // 机器人槽位数，不超过TK_BOT_SHM_MAX_BOTS
+    uint32_t enemies;  // 傻瓜敌人数量（被击毁后补充）
+    uint32_t duration; // 模拟帧，0表示一直运行直到收到SIGINT
+    uint32_t pace_ms;  // 0为步进模式，否则为实时模式的帧间隔
+    uint32_t seed;
+} BotHostConfig;
+
+extern int tk_run_bot_host(const BotHostConfig *config);
+
+/*示例机器人：bots个线程各自接入一个槽位，随机按住方向键、偶尔开炮，跑满steps步（或宿主退出）后打印每秒步数*/
+typedef struct {
+    const char *name;
+    uint32_t bots;
+    uint32_t steps;
+    uint32_t seed;
+} ShmBotsConfig;
+
+extern int tk_run_shm_bots(const ShmBotsConfig *config);
+
+#endif
@@ -2,6 +2,7 @@
     #define __DEBUG_H__
 
 #include <stdio.h>
+#include <stdint.h>
 
 // 定义宏替换printf
 // #define tk_debug(format, ...) \
@@ -14,8 +15,35 @@
 #define DEBUG_SHELL_COLLISION 0
 #define DEBUG_GUI_THREAD_DETAIL 0
 #define DEBUG_ENEMY_MUGGLE_TANK 0
+#define DEBUG_BFS_SEARCH_PATH 0 // 打印BFS搜索到的最短路径
+extern int tk_debug_object_lifecycle; // 坦克/炮弹的创建、删除与命中日志，默认打开。这是运行时开关，压力测试场景（见scenario.c）会将其关闭
+#define DEBUG_OBJECT_LIFECYCLE tk_debug_object_lifecycle
 
-extern void tk_debug_internal(int control, const char *format, ...);
+#define ENABLE_ASYNC_LOG // 异步日志：调用线程只把二进制记录（时间戳、格式串指针、打包的参数）放入本线程的无锁环形缓冲区，
+                         // 由后台线程格式化并输出到终端。注释掉该宏则所有日志都在调用线程同步输出
+#define TK_LOG_RATE_LIMIT 100 // 同一调用点每秒最多输出的日志条数，超出的丢弃，并在该调用点的下一条日志中注明丢弃了多少条
+
+// 调用点状态（每个tk_debug调用点一个静态实例），用于限速
+typedef struct {
+    uint64_t window_start_ns;
+    uint32_t count;
+    uint32_t suppressed;
+} tk_log_site_t;
+
+extern void tk_log_write(tk_log_site_t *site, const char *format, ...);
+extern void tk_log_start();
+extern void tk_log_flush();
+extern void tk_log_stop();
+
+/*control为编译期常量0（各DEBUG_*开关关闭）时，整条语句连同参数求值都会被编译器消除；也可以是运行时开关（如DEBUG_OBJECT_LIFECYCLE）。
+  format必须是字符串字面量：异步输出时只保存其指针*/
+#define tk_debug_internal(control, format, ...) \
+    do { \
+        if (control) { \
+            static tk_log_site_t __tk_log_site; \
+            tk_log_write(&__tk_log_site, format, ##__VA_ARGS__); \
+        } \
+    } while (0)
 #define tk_debug(format, ...) tk_debug_internal(1, format, ##__VA_ARGS__)
 extern void reset_debug_prefix(char *prefix);
 
@@ -4,16 +4,44 @@
 #include <event2/event.h>
 #include <event2/util.h>  // 用于 evutil_make_socket_nonblocking
 #include "event_queue.h"
+#include "game_state.h"
 
 // #define ENABLE_EVENT_PRIORITY // 启用优先级可能会导致处于最低优先级的定时器事件迟迟得不到响应，因此不建议启用
 
-extern EventQueue tk_event_queue;
+/*一局游戏的事件循环上下文：推进哪一局（game）、在哪个事件基上推进（base），以及该局的定时器与事件队列。
+  GUI对局（tk_event_loop）独占一个事件基，并用管道接收GUI线程入队的事件；
+  match_runner.c中一个工作线程的事件基上挂着多局游戏的定时器，这些对局没有GUI，也就没有管道*/
+typedef struct {
+    GameState *game;
+    struct event_base *base;
+    tk_uint8_t owns_base;       // base由init_event_loop()创建，cleanup时一并释放（同时创建管道）
+    int pipe_fds[2];            // 用于线程通信的管道（控制线程读端，GUI线程写端）
+    struct event *pipe_event;   // 管道事件（检测到管道读事件，会从queue中取出具体的键盘等事件进行handle处理）
+    struct event *timer_event;  // 定时器事件（每TK_TICK_MS推进一个模拟帧。如果启用ENABLE_EVENT_PRIORITY，则定时器事件优先级定义为最低）
+    EventQueue queue;           // 坦克事件队列（GUI线程入队，控制线程出队）
+    int writer_connected;       // 记录写端连接状态
+    int timer_removed;          // 暂停期间定时器已从事件基中移除
+    tk_uint32_t tick_limit;     // 推进到该模拟帧数后删除定时器（对局结束），0表示不限
+    tk_uint32_t late_ticks;     // 相邻两次定时器回调的间隔超过TK_LATE_TICK_MS的次数（事件基过载）
+    uint64_t last_tick_ns;
+    void (*on_tick)(void *ctx);   // 每个模拟帧之后调用（如网络服务器广播世界状态）
+    void (*on_finish)(void *ctx); // 达到tick_limit时调用（在事件基所在线程）
+    void *user_data;
+} EventLoopContext;
 
-extern int init_event_loop();
-extern void cleanup_event_loop();
-extern void run_event_loop();
-// extern void stop_event_loop();
-extern void notify_event_loop();
-extern void close_write_end_of_pipe();
+#define TK_LATE_TICK_MS (TK_TICK_MS * 3 / 2)
 
-#endif
\ No newline at end of file
+extern EventLoopContext tk_event_loop; // GUI对局的控制线程事件循环
+
+// base为NULL时创建自己的事件基和管道；否则把该局的定时器挂到给定的事件基上（不创建管道）
+extern int init_event_loop(EventLoopContext *ctx, GameState *game, struct event_base *base);
+extern void cleanup_event_loop(EventLoopContext *ctx);
+extern void run_event_loop(EventLoopContext *ctx);
+extern void stop_event_loop(EventLoopContext *ctx);
+extern void notify_event_loop(EventLoopContext *ctx);
+extern void close_write_end_of_pipe(EventLoopContext *ctx);
+extern void handle_event(EventLoopContext *ctx, Event* event);
+extern int update_key_value(KeyValue *key_value, Event *event);
+extern void handle_tank_key_event(Tank *tank, Event *event);
+
+#endif
@@ -13,7 +13,8 @@ typedef enum {
     EVENT_QUIT,
     EVENT_GAME_STOP,  // 游戏暂停（控制线程停止碰撞检测等逻辑处理）
     EVENT_GAME_START, // 游戏开始
-    EVENT_PATH_SEARCH // 地图路径搜索请求（请求数据为路径终点，起点是我的坦克当前位置）
+    EVENT_PATH_SEARCH, // 地图路径搜索请求（请求数据为路径终点，起点是我的坦克当前位置）
+    EVENT_GAME_RESTART // 重开一局（坦克的创建与删除都由控制线程完成）
 } EventType;
 
 // 按键码枚举
@@ -37,6 +38,7 @@ typedef struct {
 // 事件节点结构
 typedef struct _Event {
     EventType type;
+    tk_uint32_t id; // 入队时分配的序号，用于跟踪事件从GUI线程到控制线程的流向（见trace.h）
     union {
         KeyCode key;
         MazePathSearchRequest path_search_request;
@@ -0,0 +1,46 @@
+#ifndef __FIXED_MATH_H__
+    #define __FIXED_MATH_H__
+
+#include <stdint.h>
+#include <math.h>
+#include "global.h"
+
+/*Q16.16定点数学：模拟中的坐标、速度、角度仍以tk_float32_t保存（GUI、快照、录像照旧读写），但在`make FIXED=1`
+  （定义ENABLE_FIXED_POINT_MATH）时，移动、旋转、炮弹反弹与分离轴碰撞检测的运算都转成定点整数完成，三角函数查常量表，
+  不再经过libm与浮点乘加（编译器可能合并为FMA）。浮点数与定点数之间的转换只有乘除2的幂与取整，坐标、角度本身的累加
+  仍是float运算，两者都只在编译器遵守IEEE语义时逐位确定：优化级别、-march、-ffp-contract、x87浮点不影响结果
+  （`make determinism FIXED=1`以DETERMINISM_OPTS中的各组选项验证），-ffast-math等放宽浮点语义的选项则不作保证。
+  两种模式的模拟结果不同，录像与锁步对端需用同一模式*/
+typedef int32_t tk_fixed_t;
+
+#define TK_FIXED_SHIFT 16
+#define TK_FIXED_ONE   (1 << TK_FIXED_SHIFT)
+#define TK_FIXED_FROM_INT(n) ((tk_fixed_t)((n) * TK_FIXED_ONE))
+#define TK_FIXED_INFINITY INT32_MAX // tk_fixed_tan_deg()在90°、270°的返回值
+
+static inline tk_fixed_t tk_fixed_from_float(tk_float32_t v) { // 乘2^16是精确的，lrintf()按默认的就近舍入取整
+    return (tk_fixed_t)lrintf(v * (tk_float32_t)TK_FIXED_ONE);
+}
+
+static inline tk_float32_t tk_fixed_to_float(tk_fixed_t v) {
+    return (tk_float32_t)v * (1.0f / TK_FIXED_ONE);
+}
+
+static inline double tk_fixed_to_double(int64_t v) { // 精确转换（定点数的中间结果可能超出float的有效位数）
+    return (double)v / TK_FIXED_ONE;
+}
+
+static inline tk_fixed_t tk_fixed_mul(tk_fixed_t a, tk_fixed_t b) {
+    return (tk_fixed_t)(((int64_t)a * b) >> TK_FIXED_SHIFT);
+}
+
+static inline tk_fixed_t tk_fixed_div(tk_fixed_t a, tk_fixed_t b) {
+    return (tk_fixed_t)(((int64_t)a * TK_FIXED_ONE) / b);
+}
+
+// 角度（度，任意范围）的正弦/余弦，整数度查表，小数部分线性插值
+extern tk_fixed_t tk_fixed_sin_deg(tk_fixed_t deg);
+extern tk_fixed_t tk_fixed_cos_deg(tk_fixed_t deg);
+extern tk_fixed_t tk_fixed_tan_deg(tk_fixed_t deg);
+
+#endif
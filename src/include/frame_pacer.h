@@ -0,0 +1,33 @@
+#ifndef __FRAME_PACER_H__
+    #define __FRAME_PACER_H__
+
+#include <stdint.h>
+#include "global.h"
+
+// 帧调度器：按绝对截止时间睡眠到下一帧，睡眠时长 = 帧预算 - 本帧实际耗时（事件处理+渲染），不会因负载累积漂移
+typedef struct {
+    tk_uint32_t target_fps;
+    uint64_t frame_ns;          // 每帧预算
+    uint64_t next_deadline_ns;  // 下一帧开始的绝对时间（CLOCK_MONOTONIC）
+    uint64_t frame_start_ns;
+    uint64_t last_frame_cost_ns; // 上一帧实际耗时（不含睡眠）
+    uint64_t max_frame_cost_ns;
+    uint64_t total_frame_cost_ns;
+    uint64_t start_ns;
+    unsigned long frames;
+    unsigned long missed_frames; // 耗时超出预算、错过截止时间的帧数
+    uint64_t idle_start_ns;      // 进入空闲模式（不渲染）的时间，0表示未空闲
+    uint64_t idle_ns;            // 累计空闲时长，不计入平均帧率
+    tk_uint8_t vsync;           // 由SDL_RenderPresent()等待垂直同步，调度器只做统计不再睡眠
+} FramePacer;
+
+extern void frame_pacer_init(FramePacer *pacer, tk_uint32_t target_fps, tk_uint8_t vsync);
+extern void frame_pacer_set_target_fps(FramePacer *pacer, tk_uint32_t target_fps);
+extern void frame_pacer_begin_frame(FramePacer *pacer);
+extern void frame_pacer_end_frame(FramePacer *pacer);
+extern void frame_pacer_pause(FramePacer *pacer);
+extern void frame_pacer_resume(FramePacer *pacer);
+extern uint64_t frame_pacer_elapsed_ms(FramePacer *pacer);
+extern void frame_pacer_print_stats(FramePacer *pacer);
+
+#endif
@@ -6,7 +6,10 @@
 #include "queue.h"
 #include "debug.h"
 #include "maze.h"
+#include "tools.h"
+#include "slab.h"
 #include <pthread.h>
+#include <stdbool.h>
 
 // 2D向量结构
 typedef struct __attribute__((packed)) {
@@ -53,18 +56,45 @@ typedef struct {
 #define PARTICLE_MAX_LIFE 50 // 粒子最大存活帧
     ExplodeParticle particles[MAX_PARTICLES]; //爆炸粒子集合
     int active_count;      // 当前激活粒子数
+    tk_uint8_t triggered;  // 是否已触发过爆炸（只由GUI线程读写）
 } ExplodeEffect;
 
+#define ENABLE_RENDER_INTERPOLATION // 渲染时在实体的上一次与本次模拟状态之间插值，模拟可以低频运行而画面依旧平滑
+// 实体最近两次模拟状态（由控制线程在每次移动前记录，GUI线程据此插值绘制）
+typedef struct {
+#define MOTION_MERGE_NS    (2ULL * 1000000)   // 同一模拟帧内的多次移动合并为一步
+#define MOTION_MAX_STEP_NS (100ULL * 1000000) // 插值跨度上限（约等于一个模拟帧），静止后再次移动时不会拖得太慢
+    Point prev_position;
+    tk_float32_t prev_angle_deg;
+    uint64_t prev_ns;
+    uint64_t curr_ns; // 最近一次移动的时间，当前状态即实体的position/angle_deg
+} MotionHistory;
+
+#define ENABLE_LAG_COMPENSATION // 命中判定回退到射击者所见的那一帧（网络对战中客户端看到的世界总是落后于服务器）
+// 坦克最近TK_REWIND_TICKS个模拟帧的轮廓（每帧末尾按tick取模覆盖写入，内嵌在坦克结构中，不需要额外分配内存）
+#define TK_REWIND_TICKS 16 // 可回退的模拟帧数（1.6秒），射击者的延迟超出部分不再补偿
+typedef struct {
+    tk_uint32_t tick; // 记录时的模拟帧，与查询的帧不同说明该槽位已过期或从未写入
+    Point position;
+    Rectangle practical_outline;
+} TankRewindRecord;
+
 // 炮弹结构
 typedef struct _Shell {
     tk_uint32_t id; // 对象id，游戏内可创建的对象资源是有限的，从资源分配角度，alloc id失败意味着游戏资源耗尽
-    // tk_uint32_t owner_id;  // 发射者ID
+    id_handle_t handle; // 带代数的id句柄，见get_shell_by_handle()
+    id_handle_t owner_handle;  // 发射者句柄，发射者可能先于炮弹被销毁，通过get_tank_by_handle()校验
     void *tank_owner; // 发射者
 #define SHELL_RADIUS_LENGTH 3 // 炮弹半径
     Point position;
     tk_float32_t angle_deg; // 运动方向（同Tank->angle_deg）
     tk_float32_t speed;     // 移动速度
 #define SHELL_INIT_SPEED 9  // <=10
+    MotionHistory motion;
+    struct _GameState *game; // 所属对局
+#ifdef ENABLE_LAG_COMPENSATION
+    tk_uint32_t rewind_ticks; // 发射时射击者落后于服务器的模拟帧数，命中判定使用(tick-rewind_ticks)帧时其他坦克的轮廓
+#endif
     tk_uint8_t ttl; // 碰撞墙壁的次数，达到阈值(SHELL_COLLISION_MAX_NUM)则湮灭
 #define MY_SHELL_COLLISION_MAX_NUM 6 // TTL
 #define DEFAULT_TANK_SHELL_COLLISION_MAX_NUM 3
@@ -74,23 +104,28 @@ typedef struct _Shell {
 // 坦克结构
 typedef struct _Tank {
     tk_uint32_t id;
+    id_handle_t handle; // 带代数的id句柄，见get_tank_by_handle()
+    struct _GameState *game; // 所属对局，以坦克/炮弹为入参的函数由此找到地图、坦克链表、ID池等
 #define TANK_NAME_MAXLEN 32
     tk_uint8_t name[TANK_NAME_MAXLEN];
     Point position;     //坦克中心点
 #define TANK_LENGTH 29
 #define TANK_WIDTH  23
     tk_float32_t angle_deg; // 朝向角度
+    MotionHistory motion;
     tk_float32_t speed; // 移动速度
 #define TANK_INIT_SPEED 4
     tk_uint16_t health; // 生命值（要摧毁一辆坦克只需要将health减小到0）
     tk_uint16_t max_health;
     tk_uint16_t score;  // 分数
 #define TANK_ALIVE 0x00000001
-#define TANK_DYING 0x00000002
+#define TANK_DYING 0x00000002 // 生命值归零后进入DYING（播放爆炸效果），TANK_DYING_TICKS个模拟帧后转为DEAD，随后被删除
 #define TANK_DEAD  0x00000004
 #define TANK_FORBID_SHOOT 0x00000008
 #define TANK_HAS_DECIDE_NEW_DIR_FOR_MUGGLE_ENEMY 0x00000100
 #define TANK_IS_HIT_BY_ENEMY 0x00000200 // 如果坦克被击中则置上此标记用于播放坦克被击中的音效
+#define TANK_FLAGS_MASK (TANK_ALIVE | TANK_DYING | TANK_DEAD | TANK_FORBID_SHOOT | TANK_HAS_DECIDE_NEW_DIR_FOR_MUGGLE_ENEMY | \
+    TANK_IS_HIT_BY_ENEMY) // 新增标记须同时加到这里，快照编码据此检查位宽（见net_snapshot.c）
     tk_uint32_t flags;
 #define COLLISION_FRONT 0x01
 #define COLLISION_BACK  0x02
@@ -102,12 +137,22 @@ typedef struct _Tank {
     ExplodeEffect explode_effect; //爆炸效果
 #define TANK_ROLE_SELF  0
 #define TANK_ROLE_ENEMY_MUGGLE 1  // 傻瓜敌人
+#define TANK_ROLE_REMOTE 2 // 由网络客户端操控的玩家坦克（见net_server.c）
+#define TANK_ROLE_EXTERNAL 3 // 由本机的外部AI进程经共享内存操控的坦克（见bot_shm.h）
+#define TANK_ROLE_NUM 4 // 新增角色须同时修改，快照编码据此检查位宽（见net_snapshot.c）
+#define TANK_ROLE_IS_PLAYER(role) (((role) == TANK_ROLE_SELF) || ((role) == TANK_ROLE_REMOTE) || ((role) == TANK_ROLE_EXTERNAL))
     tk_uint8_t role;
+#define TANK_DYING_TICKS (PARTICLE_MAX_LIFE * RENDER_FPS_MS / TK_TICK_MS) // 与爆炸粒子的最长寿命相当
+    tk_uint8_t dying_ticks; // 处于DYING状态的剩余模拟帧数
 #define DEFAULT_TANK_SHELLS_MAX_NUM 4
     tk_uint8_t max_shell_num;
     Rectangle outline; // 坦克轮廓边界（简化为矩形），用于碰撞检测，某一帧中，其可能已经侵入墙体
     Rectangle practical_outline; // 实际的轮廓边界，未发生碰撞的轮廓
-    pthread_spinlock_t spinlock; // 理论上控制线程修改tank对象内容与GUI线程访问读取tank对象内容需要上锁保证正确，为了减小性能影响，此处我们暂用于保护对tank->shell_list的安全访问
+#ifdef ENABLE_LAG_COMPENSATION
+    TankRewindRecord rewind[TK_REWIND_TICKS]; // 历史轮廓，见tank_rewind_record()
+    tk_uint32_t view_tick; // 操控者（网络客户端）最近看到的模拟帧，0表示与服务器同步（本地玩家、傻瓜敌人）
+#endif
+    tk_lock_t spinlock; // 理论上控制线程修改tank对象内容与GUI线程访问读取tank对象内容需要上锁保证正确，为了减小性能影响，此处我们暂用于保护对tank->shell_list的安全访问
     KeyValue key_value_for_control;
     /*start(for muggle enemy)*/
 #define STEPS_TO_ESCAPE_NUM 6
@@ -125,26 +170,66 @@ typedef struct _Tank {
 
 extern Point tk_maze_offset;
 
-// 游戏状态结构
-typedef struct {
+/*游戏状态结构（一局游戏）：对局内的一切（坦克、地图、ID池、路径搜索、随机数发生器）都挂在这里，
+  游戏逻辑函数显式地接收GameState（或经由坦克/炮弹的game指针找到它），不再依赖进程级单例，
+  因此一个进程可以同时运行多局互不相干的游戏（见match_runner.c）。每局游戏同一时刻只能由一个线程推进*/
+typedef struct _GameState {
 #define DEFAULT_TANK_MAX_NUM 8
     TAILQ_HEAD(_tk_tanks_list, _Tank) tank_list;
+    tk_uint32_t tank_num;     // tank_list中的坦克数量（创建/删除时维护，避免每次遍历链表计数）
+    tk_uint32_t max_tank_num; // 坦克数量上限，默认DEFAULT_TANK_MAX_NUM，压力测试场景（见scenario.c）按需调大
+    tk_uint32_t muggle_shoot_interval; // 傻瓜敌人发射炮弹的间隔（模拟帧），默认MUGGLE_SHOOT_INTERVAL_TICKS
+    tk_float32_t shell_speed;  // 炮弹速度，默认SHELL_INIT_SPEED（平衡性测试见tournament.c）
+    tk_uint8_t my_shell_ttl;   // 我的炮弹可反弹次数，默认MY_SHELL_COLLISION_MAX_NUM
+    tk_uint8_t enemy_shell_ttl; // 其他坦克的炮弹可反弹次数，默认DEFAULT_TANK_SHELL_COLLISION_MAX_NUM
+    tk_uint32_t shots;         // 本局发射的炮弹总数
+    tk_uint32_t hits;          // 本局炮弹命中坦克的次数
+    tk_uint32_t muggles_spawned; // 本局创建过的傻瓜敌人数量（spawn_muggle_enemies()据此命名）
     Tank *my_tank;
     Maze maze; // 迷宫地图
     Block* blocks;          // 地图墙壁集合
     tk_uint16_t blocks_num; // 地图墙壁数量
-    tk_uint32_t game_time;  // 游戏时间（帧）
+    tk_uint32_t game_time;  // 游戏时间（逻辑帧，每RENDER_FPS_MS毫秒加1，与实际渲染帧率无关）
+    tk_uint32_t tick;       // 模拟帧计数（控制线程每TK_TICK_MS毫秒推进一次，重开一局时清零），游戏逻辑只依赖它而不依赖game_time
+    uint32_t maze_seed;     // 地图种子
+    uint32_t rng_seed;      // 游戏逻辑随机数种子
+    uint32_t rng_state;     // 游戏逻辑随机数发生器状态（见game_random_range()），与rand()（GUI线程的爆炸粒子在用）互不干扰
+    IDPool *idpool;         // 本局坦克、炮弹的ID池
+#define GAME_MAX_TANKS  8192                  // 每局坦克槽位数（预留的虚拟地址空间，见slab.h）
+#define GAME_MAX_SHELLS (GAME_MAX_TANKS * 8)
+    TkSlab tank_slab;  // 坦克（连同傻瓜敌人的脱困步骤、访问权重矩阵）所在的槽位
+    TkSlab shell_slab; // 炮弹所在的槽位
+    MazePathBFSearchManager bfs; // 我的坦克的路径搜索（控制线程计算，GUI线程绘制结果）
     // tk_uint8_t game_over;  // 游戏是否结束
-    pthread_spinlock_t spinlock; // 参考tank->spinlock，此锁则是用于保护对tk_shared_game_state.tank_list的安全访问
+    tk_lock_t spinlock; // 参考tank->spinlock，此锁则是用于保护对tk_shared_game_state.tank_list的安全访问（自适应锁，见tk_lock.h）
     tk_uint8_t stop_game; // 是否暂停游戏
 } GameState;
 
-extern GameState tk_shared_game_state;
+extern GameState tk_shared_game_state; // GUI进程里唯一的一局游戏（GUI线程绘制，控制线程推进）
+
+#define mytankptr (tk_shared_game_state.my_tank) // 仅供GUI线程使用，游戏逻辑中用gs->my_tank
+// 生成[m,n]之间的随机整数（使用对局自己的随机数发生器，给定种子即可完整复现一局游戏，见replay.c）
+#define game_random_range(gs, m, n) tk_rand_range(&(gs)->rng_state, (m), (n))
+#define RENDER_FPS_MS 50 // 逻辑帧间隔（毫秒），实际渲染帧率由帧调度器控制，见TK_TARGET_FPS
+#define TK_TICK_MS (RENDER_FPS_MS*2) // 模拟帧间隔（毫秒），控制线程定时器周期
+#define MUGGLE_SHOOT_INTERVAL_TICKS (1000 / TK_TICK_MS) // 傻瓜敌人每秒发射一枚炮弹
 
-#define mytankptr (tk_shared_game_state.my_tank)
-#define RENDER_FPS_MS 50
+/*对局检查点（回滚联机、AI推演"假如……"）：坦克、炮弹都在对局自己的槽位里（地址不变），检查点就是把两个槽位
+  已启用的部分、ID池的各个数组以及对局的标量状态（模拟帧、随机数发生器、统计、链表头）依次memcpy到一块连续缓冲区，
+  恢复时原样拷贝回去，对象之间的裸指针（链表、shell->tank_owner、gs->my_tank）无需修正。
+  因此检查点只能恢复到保存它的那一局（同一个GameState、同一张地图），不能用来复制对局；
+  保存之后才创建的对象在恢复后不复存在，持有其指针的一方应改用句柄（恢复后get_*_by_handle()返回NULL）。
+  不包含GUI线程维护的路径搜索结果（gs->bfs）与暂停状态*/
+typedef struct {
+    GameState *game; // 保存时的对局
+    uint32_t maze_seed;
+    tk_uint8_t *data;
+    size_t size;     // data中有效的字节数
+    size_t capacity; // data的容量，再次保存到同一个检查点时复用
+} GameCheckpoint;
 
 typedef struct {
+    Maze *maze; // 所在地图
     Point start_point; // pos起点
     Grid current_grid; // 当前pos所处网格
     tk_float32_t angle_deg; // 射线方向角度（正北:=0）
@@ -183,16 +268,23 @@ static void print_key_value(KeyValue *v) {
     printf("\n");
 }
 
-extern int init_idpool();
-extern void cleanup_idpool();
-
-extern void init_game_state();
-extern void delete_all_tanks();
-extern void cleanup_game_state();
-extern Tank* create_tank(tk_uint8_t *name, Point pos, tk_float32_t angle_deg, tk_uint8_t role);
+extern int init_game_state(GameState *gs, uint32_t maze_seed, uint32_t rng_seed);
+extern void delete_all_tanks(GameState *gs);
+extern void cleanup_game_state(GameState *gs);
+extern int start_new_game(GameState *gs);
+extern int spawn_muggle_enemies(GameState *gs, tk_uint32_t n);
+extern void game_state_tick(GameState *gs);
+extern Tank* create_tank(GameState *gs, tk_uint8_t *name, Point pos, tk_float32_t angle_deg, tk_uint8_t role);
 extern void delete_tank(Tank *tank, int dereference);
-extern Point get_random_grid_pos();
-extern Point get_random_grid_pos_for_tank();
+extern void place_tank(Tank *tank, Point pos, tk_float32_t angle_deg);
+extern Tank* get_tank_by_handle(GameState *gs, id_handle_t handle);
+extern void init_motion_history(MotionHistory *motion, const Point *position, tk_float32_t angle_deg);
+extern void record_motion(MotionHistory *motion, const Point *position, tk_float32_t angle_deg);
+extern void get_interpolated_motion(MotionHistory *motion, const Point *position, tk_float32_t angle_deg, 
+    Point *out_position, tk_float32_t *out_angle_deg);
+extern Shell* get_shell_by_handle(GameState *gs, id_handle_t handle);
+extern Point get_random_grid_pos(GameState *gs);
+extern Point get_random_grid_pos_for_tank(GameState *gs);
 
 extern void handle_key(Tank *tank, KeyValue *key_value);
 
@@ -200,12 +292,21 @@ extern Point get_line_center(const Point *p1, const Point *p2);
 extern Point rotate_point(const Point *point, tk_float32_t angle, const Point *pivot);
 extern void get_ray_intersection_dot_with_grid(Ray_Intersection_Dot_Info *info);
 extern Grid get_grid_by_tank_position(Point *pos);
+extern void calculate_tank_outline(const Point *center, tk_float32_t width, tk_float32_t height, tk_float32_t angle_deg, Rectangle *rect);
+extern bool is_rectangle_collision(const Rectangle* r1, const Rectangle* r2);
+extern bool is_rectangle_collision_projection(const Rectangle* r1, const Rectangle* r2);
+#ifdef ENABLE_LAG_COMPENSATION
+extern const TankRewindRecord* tank_rewind_record(const Tank *tank, tk_uint32_t tick);
+#endif
+extern Shell* create_shell(Tank *tank);
 extern Shell* create_shell_for_tank(Tank *tank);
 extern void delete_shell(Shell *shell, int dereference);
-extern void update_all_shell_movement_position();
-extern void update_muggle_enemy_position();
+extern void update_one_shell_movement_position(Shell *shell, int need_to_detect_collision_with_tank);
+extern void update_all_shell_movement_position(GameState *gs);
+extern void update_muggle_enemy_position(GameState *gs);
+extern int game_checkpoint_save(GameState *gs, GameCheckpoint *cp);
+extern int game_checkpoint_restore(GameState *gs, const GameCheckpoint *cp);
+extern void game_checkpoint_free(GameCheckpoint *cp);
 
-extern void lock(pthread_spinlock_t *spinlock);
-extern void unlock(pthread_spinlock_t *spinlock);
 
 #endif
\ No newline at end of file
@@ -10,6 +10,18 @@
 #include <unistd.h>  // 提供 getpid() 等声明
 #include "sdl_text.h"
 #include "sdl_button.h"
+#include "frame_pacer.h"
+
+#define TK_TARGET_FPS 60  // 渲染目标帧率（如60/120/144），可通过环境变量TK_FPS覆盖
+#define TK_RENDER_VSYNC 0 // 是否开启垂直同步（开启后帧率跟随显示器刷新率），可通过环境变量TK_VSYNC=1覆盖
+
+/*空闲模式：游戏暂停时GUI线程不再按帧率渲染，而是阻塞在SDL_WaitEventTimeout上，
+  只在按钮悬停/点击等变化时在缓存的画面上重绘按钮；控制线程同时移除游戏定时器（见event_loop.c）*/
+#define TK_PAUSE_ON_FOCUS_LOST 1   // 窗口失去焦点时自动暂停（进入空闲模式），重新获得焦点时自动继续
+#define TK_GUI_IDLE_WAIT_MS    250 // 空闲时等待事件的超时，超时后按需刷新控制线程异步更新的画面（如路径搜索结果）
+// tk_gui_stop_game的取值（按位组合，非0即暂停）
+#define TK_GUI_PAUSED_BY_USER  0x01
+#define TK_GUI_PAUSED_BY_FOCUS 0x02
 
 typedef struct {
     Mix_Chunk* sound;
@@ -29,6 +41,7 @@ typedef struct {
 
 extern KeyValue tk_key_value;
 extern TankMusic tk_music;
+extern FramePacer tk_frame_pacer;
 
 // 颜色定义
 // 定义颜色枚举
@@ -94,9 +107,9 @@ extern void gui_init_tank(Tank *tank);
 extern void gui_init_all_tank();
 
 extern void notify_control_thread_exit();
+extern void notify_control_thread_restart();
 // extern void send_key_to_control_thread(int key_type, int key_value);
 extern void gui_main_loop();
-extern int init_simple_game_tanks();
 extern int init_game_buttons();
 
 #endif
\ No newline at end of file
@@ -12,14 +12,35 @@ typedef struct hashtbl_link_ {
 #define OBJ2LINK(hashtbl, obj)	((hashtbl_link_t *)(((char *)obj) + hashtbl->obj_offset))
 #define LINK2OBJ(hashtbl, link) ((void *)(((char *)link) - hashtbl->obj_offset))
 
+#define HASHTBL_MAX_LOG_SIZE 24 /*auto_grow时桶数组最多增长到2^24*/
+#define HASHTBL_REHASH_STEP  4  /*渐进式rehash时，每次insert/remove最多迁移的旧桶数（find不迁移，不修改表）*/
+
 typedef struct hashtbl_ {
 	unsigned char log_size;
 	unsigned char auto_grow;
 	unsigned short obj_offset;
 	int num_items;
 	hashtbl_link_t **tbl;
+	/*渐进式rehash：扩容后旧桶数组暂时保留，下标>=rehash_idx的旧桶尚未迁移到tbl中*/
+	hashtbl_link_t **old_tbl;
+	unsigned char old_log_size;
+	unsigned char traversing; /*遍历期间暂停迁移，避免回调中remove导致元素被漏掉或重复访问*/
+	tk_uint32_t rehash_idx;
+	unsigned int grow_num;
 } hashtbl_t;
 
+/*负载统计，由hashtbl_get_stats()填充*/
+typedef struct hashtbl_stats_ {
+	int num_items;
+	tk_uint32_t bucket_num;      /*当前（新）桶数组大小*/
+	tk_uint32_t used_bucket_num; /*非空桶数（含尚未迁移的旧桶）*/
+	tk_uint32_t max_chain_len;
+	float load_factor;           /*num_items/bucket_num*/
+	float avg_chain_len;         /*非空桶的平均链长，即命中查找的期望比较次数量级*/
+	unsigned char rehashing;
+	unsigned int grow_num;
+} hashtbl_stats_t;
+
 typedef int (*hashtbl_comp_func)(void *item, void *target_obj);
 typedef int (*hashtbl_comp_func2)(void *item, void *target_obj, void *arg);
 typedef int (*hashtbl_traverse_func)(void *item, void *arg);
@@ -28,11 +49,13 @@ typedef int (*hashtbl_traverse_func2)(void *item);
 extern hashtbl_t* hashtbl_init(int log_size, int obj_offset, int auto_grow);
 extern int hashtbl_insert(hashtbl_t *tbl, int key, void *obj);
 extern int hashtbl_remove(hashtbl_t *tbl, int key, void *obj);
+/*hashtbl_find()是只读的：多个线程可以同时查找，只要没有线程在insert/remove/reset*/
 extern void *hashtbl_find(hashtbl_t *hashtbl, void *target_obj, int key, hashtbl_comp_func func);
 extern int hashtbl_destroy(hashtbl_t *tbl);
 extern int hashtbl_reset(hashtbl_t *tbl);
 extern int hashtbl_traverse_each(hashtbl_t *hashtbl, hashtbl_traverse_func func, void *arg);
 extern int hashtbl_free_all_objects(hashtbl_t *hashtbl, hashtbl_traverse_func func, void *args); 
 extern int hashtbl_traverse_each_safe(hashtbl_t *hashtbl, hashtbl_traverse_func func, void *args);
+extern void hashtbl_get_stats(hashtbl_t *hashtbl, hashtbl_stats_t *stats);
 
 #endif
\ No newline at end of file
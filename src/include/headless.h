@@ -0,0 +1,27 @@
+#ifndef __HEADLESS_H__
+    #define __HEADLESS_H__
+
+#include <stdint.h>
+#include "global.h"
+#include "game_state.h"
+
+/*无GUI模式（压力测试、多局并行、锦标赛、服务器、各种自测）的公共骨架：
+  main()在调用各模式的tk_run_*()前后分别调用tk_headless_begin()/tk_headless_end()，统一处理对象日志开关、
+  多线程日志与结束时的耗时/锁统计报告；各模式用tk_headless_game_*()建立与释放对局，自己只负责推进与汇总本模式的统计*/
+#define TK_HEADLESS_QUIET_OBJECTS 0x01 // 关闭坦克、炮弹的创建/删除日志（以及逐局打印地图），成千上万条日志会淹没统计结果、干扰计时
+#define TK_HEADLESS_THREADED_LOG  0x02 // 模式内有多个线程同时输出日志（见tk_log_start()）
+#define TK_HEADLESS_PROFILE       0x04 // 结束时打印各阶段耗时（见profiler.h）
+#define TK_HEADLESS_LOCK_STATS    0x08 // 结束时打印锁统计（见tk_lock.h）
+
+extern void tk_headless_begin(tk_uint8_t flags);
+// 传入tk_run_*()的返回值并原样返回
+extern int tk_headless_end(tk_uint8_t flags, int ret);
+
+// 按种子初始化一局无GUI的游戏（地图种子seed，游戏逻辑种子由seed+1派生），坦克上限max_tank_num，并生成enemies个傻瓜敌人。
+// 失败返回-1，已申请的资源同样由cleanup_game_state()释放
+extern int tk_headless_game_init(GameState *gs, uint32_t seed, tk_uint32_t max_tank_num, tk_uint32_t enemies);
+// 同上，对局在堆上，失败返回NULL
+extern GameState* tk_headless_game_create(uint32_t seed, tk_uint32_t max_tank_num, tk_uint32_t enemies);
+extern void tk_headless_game_destroy(GameState *gs);
+
+#endif
@@ -4,20 +4,38 @@
 #include <stdint.h>
 #include <stddef.h>
 
-#define ID_POOL_SIZE 1024  // 最大ID数量，可根据需要调整
+#define ID_POOL_SIZE 1024  // 初始ID数量（ID池满时自动扩容）
+#define ID_POOL_INDEX_BITS 20
+#define ID_POOL_MAX_SIZE ((1 << ID_POOL_INDEX_BITS) - 1) // 扩容上限，ID必须能放进句柄的低ID_POOL_INDEX_BITS位
+
+/*句柄 = 代数(generation)<<ID_POOL_INDEX_BITS | ID。ID释放后其代数加1，旧句柄随即失效，
+  因此持有句柄的一方可以通过id_pool_lookup()判断对象是否已被销毁（哪怕ID已被复用），0永远不是合法句柄*/
+typedef uint32_t id_handle_t;
+#define HANDLE2ID(handle)  ((int)((handle) & ID_POOL_MAX_SIZE))
+#define HANDLE2GEN(handle) ((uint32_t)(handle) >> ID_POOL_INDEX_BITS)
+#define MAKE_HANDLE(id, gen) ((id_handle_t)(((uint32_t)(gen) << ID_POOL_INDEX_BITS) | (uint32_t)(id)))
 
 typedef struct {
-    uint32_t *bitmap;       // bitmap数组
-    size_t size;            // ID池大小(实际可用的ID数量)
-    size_t last_alloc_pos;  // 上次分配位置，用于优化搜索
-    int max_id;             // 最大ID值
+    uint64_t *bitmap;       // 一级bitmap，置1表示该ID已分配
+    uint64_t *summary;      // 二级bitmap，置1表示对应的bitmap word已满（分配时据此直接跳到有空位的word）
+    uint16_t *generation;   // 每个ID的代数（只用低12位）
+    void **objects;         // 每个ID关联的对象，供句柄查找
+    size_t size;            // ID池当前大小(实际可用的ID数量)
+    size_t used;            // 已分配的ID数量
+    int max_id;             // 当前最大ID值
 } IDPool;
 
 extern IDPool* id_pool_create(size_t max_id);
 extern void id_pool_destroy(IDPool *pool);
 extern int id_pool_allocate(IDPool *pool);
 extern void id_pool_release(IDPool *pool, int id);
+extern id_handle_t id_pool_allocate_handle(IDPool *pool, void *obj);
+extern void id_pool_release_handle(IDPool *pool, id_handle_t handle);
+extern void *id_pool_lookup(IDPool *pool, id_handle_t handle);
 extern void id_pool_print(IDPool *pool);
+extern size_t id_pool_checkpoint_size(const IDPool *pool);
+extern void id_pool_checkpoint_save(const IDPool *pool, void *buf);
+extern int id_pool_checkpoint_restore(IDPool *pool, const void *buf);
 #define print_id_pool id_pool_print
 
-#endif
\ No newline at end of file
+#endif
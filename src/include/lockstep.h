@@ -0,0 +1,37 @@
+#ifndef __LOCKSTEP_H__
+    #define __LOCKSTEP_H__
+
+#include <stdint.h>
+#include "global.h"
+
+/*确定性锁步联机：对端之间只交换每个模拟帧的输入，每个对端用同样的种子各自运行完全相同的模拟（游戏逻辑只依赖
+  模拟帧与对局自己的随机数发生器，见replay.c），因此带宽与坦克、炮弹数量无关。
+  - 输入延迟：本地在第T帧结束后产生第T+input_delay帧的输入并发给所有对端，网络时延被这段缓冲吸收
+  - 缺少输入即停顿：第T帧必须等到所有对端第T帧的输入到齐才推进（不预测、不跳过），超过LOCKSTEP_STALL_TIMEOUT_MS视为断线
+  - 失步检测：每条输入附带发送方第T帧结束时的状态哈希（见tk_game_state_hash()），与本地同一帧的哈希比对，不一致即失步
+  消息（定长，小端，任意字节流套接字）：tick u32 | buttons u8 | hash u32
+    buttons：低四位同KeyValue.mask（按住的方向键，每帧执行一次handle_key()），LOCKSTEP_BUTTON_FIRE为开炮
+    hash：发送方第tick-input_delay帧结束时的状态哈希
+  自测：进程内PEERS个线程各运行一个对端（各自一局游戏，一辆由脚本操控的坦克），两两之间用socketpair连接*/
+#define LOCKSTEP_MAX_PEERS 8
+#define LOCKSTEP_MAX_INPUT_DELAY 16
+#define LOCKSTEP_DEFAULT_INPUT_DELAY 2
+#define LOCKSTEP_WINDOW 64 // 输入与哈希的环形缓冲（按tick取模），对端之间最多相差2*input_delay帧
+#define LOCKSTEP_STALL_TIMEOUT_MS 5000
+#define LOCKSTEP_MSG_BYTES 9
+#define LOCKSTEP_BUTTON_FIRE 0x10
+
+typedef struct {
+    uint32_t peers;
+    uint32_t enemies;     // 傻瓜敌人数量（被击毁后补充，保持战场上的炮弹数量）
+    uint32_t duration;    // 模拟帧
+    uint32_t input_delay; // 模拟帧，1~LOCKSTEP_MAX_INPUT_DELAY
+    uint32_t jitter_ms;   // 每个对端每帧随机停顿[0, jitter_ms]毫秒，模拟步调不一致的对端，触发停顿等待
+    uint32_t desync_tick; // >0时最后一个对端在该帧人为改动自己的坦克，验证失步检测
+    uint32_t seed;
+} LockstepConfig;
+
+// 运行锁步自测，所有对端跑完且最终状态哈希一致返回0（指定desync_tick时，恰好在该帧检测到失步返回0）
+extern int tk_run_lockstep(const LockstepConfig *config);
+
+#endif
@@ -0,0 +1,25 @@
+#ifndef __MATCH_RUNNER_H__
+    #define __MATCH_RUNNER_H__
+
+#include <stdint.h>
+#include "global.h"
+
+/*多局并行：一个进程内同时运行多局无GUI的游戏，用于观察单进程能承载多少局实时对局。
+  每个工作线程一个libevent事件基，分到该线程的每一局各有一个TK_TICK_MS周期的定时器，按真实时间推进到duration帧结束。
+  每局的种子为seed+序号，同一局的最终状态哈希与线程数无关（对局之间不共享任何状态）*/
+typedef struct {
+    uint32_t matches;       // 对局数
+    uint32_t threads;       // 工作线程数，0表示与对局数相同（但不超过MATCH_RUNNER_MAX_THREADS）
+    uint32_t enemies;       // 每局傻瓜敌人数量
+    uint32_t fire_interval; // 敌人发射炮弹的间隔（模拟帧），0表示使用默认值
+    uint32_t duration;      // 每局运行的模拟帧数
+    uint32_t seed;
+} MatchRunnerConfig;
+
+#define MATCH_RUNNER_MAX_THREADS 64
+#define MATCH_RUNNER_DEFAULT_ENEMIES 4
+
+// 运行全部对局直至结束，打印每局结果与汇总，全部成功返回0
+extern int tk_run_matches(const MatchRunnerConfig *config);
+
+#endif
@@ -2,11 +2,16 @@
     #define __MAZE_H__
 
 #include "global.h"
-#include <pthread.h>
+#include "tk_lock.h"
+#include <stdint.h>
 
 // 定义常量
+#ifndef HORIZON_GRID_NUMBER // 可在编译时通过-D覆盖（make bench据此测量不同尺寸地图）
 #define HORIZON_GRID_NUMBER 8
+#endif
+#ifndef VERTICAL_GRID_NUMBER
 #define VERTICAL_GRID_NUMBER 7
+#endif
 #define GRID_SIZE 80 // 网格数以及网格尺寸的设置是根据窗口大小来的（见gui_tank.c#init_gui()）
 #define MAX_GRID_ID (HORIZON_GRID_NUMBER * VERTICAL_GRID_NUMBER)
 
@@ -30,8 +35,9 @@ typedef struct {
 
 // 迷宫结构体
 typedef struct {
-    int map[MAX_GRID_ID][MAX_GRID_ID];
-    int vis[HORIZON_GRID_NUMBER][VERTICAL_GRID_NUMBER];
+    tk_uint8_t open[MAX_GRID_ID]; // 每个网格四个方向是否打通，按位存储（第i位对应maze.c中方向数组的第i个方向），
+                                  // 取代原先MAX_GRID_ID*MAX_GRID_ID的邻接矩阵，大地图下内存从平方级降为线性
+    tk_uint8_t vis[HORIZON_GRID_NUMBER][VERTICAL_GRID_NUMBER];
 } Maze;
 
 // 获取墙壁位置
@@ -58,7 +64,7 @@ typedef struct {
     tk_uint16_t rear;  //rear游标用于指示放入bfs_queue中的有效元素的末尾位置
     void (*bfs_search)(void*); //入参就是当前Manager管理器对象
     tk_uint8_t success; //搜索是否成功标记
-    pthread_spinlock_t spinlock; //GUI线程访问搜索结果以及控制线程计算搜索路径可能并行，需要加锁
+    tk_lock_t spinlock; //GUI线程访问搜索结果以及控制线程计算搜索路径可能并行，需要加锁
 } MazePathBFSearchManager;
 
 #if 0
@@ -86,7 +92,7 @@ typedef struct {
 #endif
 
 extern void maze_init(Maze* maze);
-extern void maze_generate(Maze* maze);
+extern void maze_generate(Maze* maze, uint32_t seed);
 extern Block* get_block_positions(Maze* maze, tk_uint16_t* block_count);
 extern void print_maze_walls(Maze* maze);
 extern int grid_id(Grid *g);
@@ -0,0 +1,67 @@
+#ifndef __NET_PREDICT_H__
+    #define __NET_PREDICT_H__
+
+#include <stdint.h>
+#include "global.h"
+#include "game_state.h"
+#include "event_queue.h"
+#include "net_snapshot.h"
+
+/*客户端预测与服务器校正：客户端在本地GameState（与服务器同一张地图，只有自己一辆坦克）上维护一份预测的坦克，
+  本地输入立即经handle_key()作用到它上面（画面上的输入延迟只有一帧，与往返时延无关），同时带上序号发给服务器并记入输入历史。
+  收到权威状态时（附带服务器已处理到的输入序号），先看该输入之后的预测状态量化后是否与权威状态一致：一致则预测正确，什么都不用做
+  （本地保留未量化的精确状态，与服务器的浮点运算逐步相同）；不一致才把预测的坦克重置为权威状态，再重放所有尚未被确认的输入。
+  只预测自己坦克的移动与转向：其他坦克、炮弹直接使用权威状态，与其他坦克的碰撞以服务器为准（由校正消除差异）*/
+#define TK_PREDICT_HISTORY 256         // 未确认输入的上限（每逻辑帧一两条输入，足够覆盖数秒的往返时延）
+#define TK_PREDICT_CORRECTION_PX 0.5f  // 重放后位置偏移超过该值（或角度不同）计为一次预测错误
+
+typedef struct {
+    tk_uint32_t seq;
+    tk_uint32_t mask;  // 执行该输入后的方向键状态
+    tk_uint8_t moves;  // 是否执行handle_key()
+    tk_uint8_t has_state; // 执行时是否有预测的坦克
+    Point position;    // 执行该输入后预测的坦克状态
+    tk_float32_t angle_deg;
+} PredictedInput;
+
+typedef struct {
+    GameState *game;   // 本地模拟
+    Tank *tank;        // 预测的坦克，NULL表示还没有（或已失去）权威状态
+    tk_uint32_t tank_id;
+    KeyValue key_value;       // 最新输入后的方向键状态
+    tk_uint32_t acked_mask;   // 服务器处理完acked_seq后的方向键状态
+    tk_uint8_t acked_has_state;
+    Point acked_position;     // 处理完acked_seq后预测的坦克状态，与权威状态比对
+    tk_float32_t acked_angle_deg;
+    tk_uint32_t next_seq;     // 下一条输入的序号，从1开始
+    tk_uint32_t acked_seq;    // 服务器已处理的最后一条输入
+    PredictedInput inputs[TK_PREDICT_HISTORY]; // 按seq取模存放，(acked_seq, next_seq)之间为未确认输入
+    tk_uint32_t reconciles;
+    tk_uint32_t rewinds;      // 预测与权威状态不一致、重置并重放的次数
+    tk_uint32_t corrections;
+    tk_uint32_t replayed;
+    tk_float32_t max_correction_px;
+} Predictor;
+
+// maze_seed来自WELCOME
+extern int tk_predict_init(Predictor *p, uint32_t maze_seed);
+extern void tk_predict_cleanup(Predictor *p);
+// 服务器分配了新坦克（加入或重生），丢弃旧的预测，等待下一帧权威状态
+extern void tk_predict_set_tank(Predictor *p, tk_uint32_t tank_id);
+// 记录一条本地输入并立即作用到预测的坦克上，返回随输入发送给服务器的序号
+extern tk_uint32_t tk_predict_input(Predictor *p, EventType type, KeyCode key);
+// 收到权威状态：acked_seq为服务器生成该快照前处理的最后一条输入
+extern void tk_predict_reconcile(Predictor *p, tk_uint32_t acked_seq, const Snapshot *snap);
+
+/*预测自测：在进程内用人为延迟的信道连接一个服务器端GameState与一个预测客户端，按逻辑帧推进脚本化输入，
+  统计有/无预测时输入到画面的延迟、预测错误与校正幅度，最后停止输入等待所有输入被确认，预测必须与权威状态一致*/
+typedef struct {
+    uint32_t rtt_ms;
+    uint32_t enemies;
+    uint32_t duration; // 模拟帧
+    uint32_t seed;
+} PredictBenchConfig;
+
+extern int tk_run_predict_bench(const PredictBenchConfig *config);
+
+#endif
@@ -0,0 +1,59 @@
+#ifndef __NET_PROTOCOL_H__
+    #define __NET_PROTOCOL_H__
+
+#include <stdint.h>
+#include <event2/buffer.h>
+#include <event2/bufferevent.h>
+#include "global.h"
+#include "game_state.h"
+
+/*客户端与权威服务器之间的TCP协议。每条消息：长度u16（不含消息头）| 类型u8 | 数据，多字节整数均为小端。
+  客户端 -> 服务器：
+    TK_NET_MSG_HELLO    协议版本u8 | 名字[TANK_NAME_MAXLEN]      连接后先发送，服务器为其创建一辆坦克
+    TK_NET_MSG_INPUT    事件类型u8 | 按键u8 | 输入序号u32        与本地GUI线程发给控制线程的按键事件相同：
+                                                                按住按键时客户端每个逻辑帧（RENDER_FPS_MS）重发一次；
+                                                                坦克已被击毁时发送EVENT_GAME_RESTART重生。序号从1递增，用于客户端预测（见net_predict.h）
+    TK_NET_MSG_ACK      模拟帧u32                                 确认已收到并解码该帧世界状态，服务器此后以它为基准差分编码
+  服务器 -> 客户端：
+    TK_NET_MSG_WELCOME  协议版本u8 | 地图宽u8 | 地图高u8 | 模拟帧间隔u8(ms) | maze_seed u32 | 坦克ID u32 | 当前帧u32
+                        客户端用maze_seed在本地生成同一张地图
+    TK_NET_MSG_STATE    已处理的输入序号u32 | 量化、差分编码的世界状态快照（格式见net_snapshot.h）  每个模拟帧之后发送一次，
+                        基准为该客户端最近确认的一帧（还没有确认或确认太旧时发送完整快照）
+    TK_NET_MSG_REJECT   原因u8                                  服务器已满或协议版本不符，随后断开*/
+#define TK_NET_VERSION 3
+#define TK_NET_DEFAULT_PORT 7777
+#define TK_NET_HEADER_LEN 3
+#define TK_NET_MAX_PAYLOAD 65535
+
+#define TK_NET_MSG_HELLO   1
+#define TK_NET_MSG_INPUT   2
+#define TK_NET_MSG_ACK     3
+#define TK_NET_MSG_WELCOME 16
+#define TK_NET_MSG_STATE   17
+#define TK_NET_MSG_REJECT  18
+
+#define TK_NET_REJECT_FULL    1
+#define TK_NET_REJECT_VERSION 2
+
+// 只读游标，越界后error置1，之后读出的都是0（同replay.c）
+typedef struct {
+    const uint8_t *data;
+    uint32_t len;
+    uint32_t pos;
+    int error;
+} NetReader;
+
+extern void tk_net_put_u8(struct evbuffer *buf, uint8_t v);
+extern void tk_net_put_u16(struct evbuffer *buf, uint16_t v);
+extern void tk_net_put_u32(struct evbuffer *buf, uint32_t v);
+extern uint8_t tk_net_get_u8(NetReader *r);
+extern uint16_t tk_net_get_u16(NetReader *r);
+extern uint32_t tk_net_get_u32(NetReader *r);
+
+// 给payload加上消息头后追加到out（payload被清空），payload过长返回-1
+extern int tk_net_frame_message(struct evbuffer *out, uint8_t type, struct evbuffer *payload);
+// 从输入缓冲中取出一条完整消息的数据到payload（至少TK_NET_MAX_PAYLOAD字节）。
+// 取出返回1，数据还不完整返回0
+extern int tk_net_read_message(struct evbuffer *in, uint8_t *type, uint8_t *payload, uint16_t *len);
+
+#endif
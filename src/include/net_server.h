@@ -0,0 +1,35 @@
+#ifndef __NET_SERVER_H__
+    #define __NET_SERVER_H__
+
+#include <stdint.h>
+#include "global.h"
+
+/*权威服务器：无GUI地运行一局游戏，在本机回环地址上监听TCP连接（libevent bufferevent）。
+  每个客户端对应一辆TANK_ROLE_REMOTE坦克，客户端只发送按键，服务器推进模拟并在每个模拟帧之后向所有客户端广播世界状态，
+  协议见net_protocol.h。所有连接与定时器都在同一个事件基上，服务器是单线程的*/
+typedef struct {
+    uint16_t port;
+    uint32_t enemies;  // 傻瓜敌人数量
+    uint32_t duration; // 运行的模拟帧数，0表示一直运行直到收到SIGINT
+    uint32_t seed;
+} NetServerConfig;
+
+#define TK_NET_MAX_CLIENTS 16
+#define TK_NET_MAX_PENDING_BYTES (64 * 1024) // 客户端的发送缓冲超过该值时跳过本帧广播（慢客户端不拖累服务器）
+
+extern int tk_run_net_server(const NetServerConfig *config);
+
+/*回环测试客户端：在一个事件基上同时连接bots个客户端，各自随机按键、开火、被击毁后重生，
+  并逐条校验收到的世界状态，收到duration帧后断开，打印接收统计*/
+typedef struct {
+    const char *address; // HOST:PORT
+    uint32_t bots;
+    uint32_t duration;
+    uint32_t seed;
+} NetBotsConfig;
+
+#define TK_NET_DEFAULT_ADDRESS "127.0.0.1:7777"
+
+extern int tk_run_net_bots(const NetBotsConfig *config);
+
+#endif
@@ -0,0 +1,84 @@
+#ifndef __NET_SNAPSHOT_H__
+    #define __NET_SNAPSHOT_H__
+
+#include <stdint.h>
+#include "global.h"
+#include "game_state.h"
+
+/*世界状态快照编解码：先把坦克与炮弹量化（坐标为1/TK_SNAPSHOT_POS_SCALE像素的定点数，按地图尺寸决定位宽；角度以5°为一档），
+  再相对于对端已确认（ACK）的基准快照做差分，最后按位打包。坦克与炮弹都按ID升序排列，基准快照中有而当前快照中没有的对象即视为已删除。
+  位流（低位在前）：
+    模拟帧32 | 有基准1 [| 与基准相差的帧数EG0] | 坦克数EG4 | 每辆坦克：ID间隔EG2 [| 在基准中1] |
+      在基准中：x差分 | y差分 | 角度(变1 [| 7]) | 血量(变1 [| 16]) | 标记(变1 [| 32])
+      新坦克：  角色2 | x | y | 角度7 | 血量16 | 标记32
+      炮弹数EG0 | 每枚炮弹：ID间隔EG3 [| 在基准中1] | 同上的坐标与角度 | ttl(变1 [| 8])（新炮弹为完整的x | y | 角度7 | ttl8）
+    坐标差分：没变0 | 变了1 | 小差分0 + 之字形差分EG3，或大差分1 + 完整坐标
+  EGk为k阶指数哥伦布编码，小数值只占几位*/
+#define TK_SNAPSHOT_MAX_TANKS  256
+#define TK_SNAPSHOT_MAX_SHELLS 1024
+#define TK_SNAPSHOT_MAX_BYTES  (16 * 1024) // 编码后的上限（完整快照的最坏情况）
+#define TK_SNAPSHOT_HISTORY    32 // 发送端保留的历史快照数，确认的基准比当前帧落后更多时退化为发送完整快照
+#define TK_SNAPSHOT_POS_SCALE  8  // 坐标精度1/8像素
+#define TK_SNAPSHOT_ANGLE_STEP 5  // 角度精度（度）
+
+// 量化坐标相对于地图左上角（tk_maze_offset）
+#define TK_SNAPSHOT_TO_X(v)   ((tk_float32_t)(v) / TK_SNAPSHOT_POS_SCALE + tk_maze_offset.x)
+#define TK_SNAPSHOT_TO_Y(v)   ((tk_float32_t)(v) / TK_SNAPSHOT_POS_SCALE + tk_maze_offset.y)
+#define TK_SNAPSHOT_TO_DEG(a) ((tk_float32_t)(a) * TK_SNAPSHOT_ANGLE_STEP)
+
+typedef struct {
+    tk_uint32_t id;
+    tk_uint8_t role;
+    tk_uint8_t angle; // 0~71，乘以TK_SNAPSHOT_ANGLE_STEP为角度
+    tk_uint16_t health;
+    tk_uint32_t x;    // 相对于地图左上角、乘以TK_SNAPSHOT_POS_SCALE的坐标
+    tk_uint32_t y;
+    tk_uint32_t flags;
+    tk_uint16_t shell_start; // 该坦克的炮弹在Snapshot.shells中的起始下标
+    tk_uint16_t shell_num;
+} SnapshotTank;
+
+typedef struct {
+    tk_uint32_t id;
+    tk_uint32_t x;
+    tk_uint32_t y;
+    tk_uint8_t angle;
+    tk_uint8_t ttl;
+} SnapshotShell;
+
+typedef struct {
+    tk_uint32_t tick;
+    tk_uint16_t tank_num;
+    tk_uint16_t shell_num;
+    SnapshotTank tanks[TK_SNAPSHOT_MAX_TANKS];   // 按ID升序
+    SnapshotShell shells[TK_SNAPSHOT_MAX_SHELLS]; // 按坦克分段，段内按ID升序
+} Snapshot;
+
+extern tk_uint32_t tk_snapshot_quantize_x(tk_float32_t x);
+extern tk_uint32_t tk_snapshot_quantize_y(tk_float32_t y);
+extern tk_uint8_t tk_snapshot_quantize_angle(tk_float32_t deg);
+// 量化当前世界状态，坦克或炮弹超出容量返回-1
+extern int tk_snapshot_capture(Snapshot *snap, GameState *gs);
+// 编码snap，baseline为NULL时编码完整快照。返回写入out的字节数，out放不下返回-1
+extern int tk_snapshot_encode(const Snapshot *snap, const Snapshot *baseline, uint8_t *out, uint32_t cap);
+// 读出编码数据的模拟帧与所依赖的基准帧：依赖基准返回1，完整快照返回0，数据错误返回-1
+extern int tk_snapshot_peek(const uint8_t *data, uint32_t len, uint32_t *tick, uint32_t *baseline_tick);
+// 解码到out，baseline必须是编码时所用的基准快照（完整快照传NULL），数据错误或基准不符返回-1
+extern int tk_snapshot_decode(const uint8_t *data, uint32_t len, const Snapshot *baseline, Snapshot *out);
+extern int tk_snapshot_equal(const Snapshot *a, const Snapshot *b);
+extern const SnapshotTank *tk_snapshot_find_tank(const Snapshot *snap, tk_uint32_t id);
+
+/*编解码自测与带宽基准：无GUI地运行脚本化对局（傻瓜敌人，被击毁后补充新坦克以维持数量），每帧量化并以ack_delay帧之前的快照为基准差分编码，
+  解码后与原快照逐字段比对，并检查量化误差，最后打印每帧字节数的分布*/
+typedef struct {
+    uint32_t tanks;
+    uint32_t duration;
+    uint32_t ack_delay; // 模拟确认延迟（模拟帧），0表示每帧都发送完整快照
+    uint32_t seed;
+} SnapshotBenchConfig;
+
+#define SNAPSHOT_BENCH_DEFAULT_ACK_DELAY 3 // 约300ms往返
+
+extern int tk_run_snapshot_bench(const SnapshotBenchConfig *config);
+
+#endif
@@ -0,0 +1,41 @@
+#ifndef __OAHASHTBL_H__
+    #define __OAHASHTBL_H__
+
+#include "global.h"
+#include "hashtbl.h"
+
+/*开放寻址哈希表（SwissTable风格）：
+  每个槽位1字节控制字节（空/已删除/哈希值高7位），控制字节16个一组，查找时一次比较一整组（有SSE2时用SIMD），
+  key和对象指针内联存放在槽位数组中，探测过程不再追逐链表指针。接口与hashtbl保持一致（除了不需要侵入式的link字段），
+  同一个key允许存放多个对象（由find的比较函数区分）*/
+
+#define OAHASHTBL_GROUP_WIDTH 16
+#define OAHASHTBL_MIN_LOG_SIZE 4 /*容量至少一组*/
+#define OAHASHTBL_MAX_LOG_SIZE 24
+
+typedef struct oahashtbl_slot_ {
+	int key;
+	void *obj;
+} oahashtbl_slot_t;
+
+typedef struct oahashtbl_ {
+	unsigned char log_size;
+	int num_items;
+	int growth_left;           /*在触发扩容/整理前还能占用的空槽数（负载上限7/8，墓碑也占额度）*/
+	tk_int8_t *ctrl;           /*capacity + GROUP_WIDTH 个控制字节，末尾一组是开头一组的镜像，便于越界读取整组*/
+	oahashtbl_slot_t *slots;
+	unsigned int grow_num;
+} oahashtbl_t;
+
+extern oahashtbl_t* oahashtbl_init(int log_size);
+extern int oahashtbl_insert(oahashtbl_t *hashtbl, int key, void *obj);
+extern int oahashtbl_remove(oahashtbl_t *hashtbl, int key, void *obj);
+extern void *oahashtbl_find(oahashtbl_t *hashtbl, void *target_obj, int key, hashtbl_comp_func func);
+extern int oahashtbl_destroy(oahashtbl_t *hashtbl);
+extern int oahashtbl_reset(oahashtbl_t *hashtbl);
+extern int oahashtbl_traverse_each(oahashtbl_t *hashtbl, hashtbl_traverse_func func, void *arg);
+extern int oahashtbl_free_all_objects(oahashtbl_t *hashtbl, hashtbl_traverse_func func, void *args);
+/*回调中允许oahashtbl_remove()当前对象（删除只打墓碑，不移动槽位），但不允许insert（可能扩容）*/
+extern int oahashtbl_traverse_each_safe(oahashtbl_t *hashtbl, hashtbl_traverse_func func, void *args);
+
+#endif
@@ -0,0 +1,71 @@
+#ifndef __PROFILER_H__
+    #define __PROFILER_H__
+
+#include <stdint.h>
+#include "global.h"
+
+#define ENABLE_PHASE_PROFILER // 分阶段耗时统计，注释掉该宏则所有计时代码在编译期被移除
+
+// 对数-线性分桶直方图（类似HdrHistogram）：按2的幂分组，每组再等分TK_HIST_SUB_BUCKETS份，相对误差不超过1/TK_HIST_SUB_BUCKETS。
+// 单写者无锁：只有所属线程写入，读者（退出时打印）容忍读到略旧的计数
+typedef struct {
+#define TK_HIST_SUB_BUCKET_BITS 4
+#define TK_HIST_SUB_BUCKETS (1 << TK_HIST_SUB_BUCKET_BITS)
+#define TK_HIST_GROUPS 40 // 覆盖到约2^43ns，足够
+#define TK_HIST_BUCKETS (TK_HIST_GROUPS * TK_HIST_SUB_BUCKETS)
+    uint32_t counts[TK_HIST_BUCKETS];
+    uint64_t total_count;
+    uint64_t sum;
+    uint64_t min;
+    uint64_t max;
+} tk_histogram_t;
+
+extern void tk_histogram_init(tk_histogram_t *hist);
+extern void tk_histogram_record(tk_histogram_t *hist, uint64_t value);
+extern void tk_histogram_record_atomic(tk_histogram_t *hist, uint64_t value);
+extern void tk_histogram_merge(tk_histogram_t *dst, const tk_histogram_t *src);
+extern uint64_t tk_histogram_percentile(const tk_histogram_t *hist, double percentile);
+// 按统一的列（次数、均值、p50、p90、p99、p99.9、最大值）打印表头与一行分布，数值除以scale（如纳秒转微秒传1000）。
+// 都不换行，调用者可以在行尾追加自己的列
+extern void tk_histogram_print_header(const char *title);
+extern void tk_histogram_print_row(const char *title, const tk_histogram_t *hist, double scale);
+
+// 计时阶段
+typedef enum {
+    TK_PHASE_TICK,          // 控制线程一次定时更新（下面几个阶段的总和）
+    TK_PHASE_AI,            // 傻瓜敌人决策与移动
+    TK_PHASE_TANK_MOVE,     // 坦克移动（handle_key）
+    TK_PHASE_SHELL_PHYSICS, // 炮弹运动与反弹
+    TK_PHASE_COLLISION,     // 坦克/炮弹与坦克的碰撞检测
+    TK_PHASE_EVENT_DRAIN,   // 控制线程取出并处理GUI线程发来的事件
+    TK_PHASE_FRAME,         // GUI线程一帧（不含帧间睡眠）
+    TK_PHASE_SCENE_BUILD,   // 场景绘制命令提交
+    TK_PHASE_PRESENT,       // SDL_RenderPresent
+    TK_PHASE_NUM
+} tk_phase_t;
+
+#ifdef ENABLE_PHASE_PROFILER
+typedef struct {
+    tk_phase_t phase;
+    uint64_t start_ns;
+    int traced; // 开始时跟踪已打开（见trace.h），各阶段同时作为时间线上的区间
+} tk_profile_scope_t;
+
+extern tk_profile_scope_t tk_profile_scope_begin(tk_phase_t phase);
+extern void tk_profile_scope_end(tk_profile_scope_t *scope);
+extern void tk_profiler_record(tk_phase_t phase, uint64_t ns);
+extern void tk_profiler_report();
+
+#define TK_PROFILE_CONCAT_(a, b) a##b
+#define TK_PROFILE_CONCAT(a, b) TK_PROFILE_CONCAT_(a, b)
+// 统计从此处到所在作用域结束的耗时（利用cleanup属性，return/break/goto离开作用域时同样会记录）
+#define TK_PROFILE_SCOPE(phase) \
+    tk_profile_scope_t TK_PROFILE_CONCAT(__tk_profile_scope_, __LINE__) \
+        __attribute__((cleanup(tk_profile_scope_end))) = tk_profile_scope_begin(phase)
+#else
+#define TK_PROFILE_SCOPE(phase) do {} while (0)
+#define tk_profiler_record(phase, ns) do {} while (0)
+#define tk_profiler_report() do {} while (0)
+#endif
+
+#endif
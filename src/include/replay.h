@@ -0,0 +1,39 @@
+#ifndef __REPLAY_H__
+    #define __REPLAY_H__
+
+#include <stdint.h>
+#include "global.h"
+#include "event_queue.h"
+#include "game_state.h"
+
+/*对局录像：记录交给handle_event()的每个事件和每个模拟帧，加上地图种子与随机数种子，即可脱离GUI逐位复现整局游戏。
+  文件格式（多字节整数均为小端）：
+    文件头：magic "TKRP" | version u8 | 地图宽u8 | 地图高u8 | 模拟帧间隔u8(ms) | maze_seed u32 | rng_seed u32
+    记录：类型u8 + 数据
+      TK_REPLAY_REC_TICKS     varint n              连续n个模拟帧
+      TK_REPLAY_REC_EVENT     事件类型u8 + 事件数据    按键u8，路径搜索终点x/y各u8，其他事件无数据
+      TK_REPLAY_REC_KEYFRAME  u32 len + 快照          每TK_REPLAY_KEYFRAME_TICKS帧一个完整状态快照，用于跳转与一致性校验
+      TK_REPLAY_REC_END*/
+#define TK_REPLAY_MAGIC "TKRP"
+#define TK_REPLAY_VERSION 2 // v2：快照中的坦克数量由u8改为u32
+#define TK_REPLAY_KEYFRAME_TICKS 300 // 约30秒一个关键帧
+
+#define TK_REPLAY_REC_TICKS    1
+#define TK_REPLAY_REC_EVENT    2
+#define TK_REPLAY_REC_KEYFRAME 3
+#define TK_REPLAY_REC_END      4
+
+// 录制（推进该局的线程调用，未开启录制或不是被录制的那一局时均为空操作）
+extern int tk_replay_record_start(GameState *gs, const char *path);
+extern void tk_replay_record_event(GameState *gs, Event *event);
+extern void tk_replay_record_tick(GameState *gs);
+extern void tk_replay_record_stop();
+
+// 无GUI回放：从seek_tick（录像开始后的第几个模拟帧）之前最近的关键帧恢复状态，快进到seek_tick后计时回放至结束，
+// 途经的关键帧逐一与当前状态比对。回放成功且没有出现不一致返回0
+extern int tk_replay_play(const char *path, uint32_t seek_tick);
+
+// 当前游戏状态的哈希（不含ID/句柄等与逻辑无关的字段）
+extern uint32_t tk_game_state_hash(GameState *gs);
+
+#endif
@@ -0,0 +1,21 @@
+#ifndef __SCENARIO_H__
+    #define __SCENARIO_H__
+
+#include <stdint.h>
+#include "global.h"
+
+/*压力测试场景：无GUI地生成一局有大量傻瓜敌人的游戏，按模拟帧推进固定时长，统计每个模拟帧的耗时分布，
+  用于观察游戏逻辑在成百上千辆坦克下的扩展性。地图尺寸是编译期常量，通过`make MAP=64x56`调整*/
+typedef struct {
+    uint32_t enemies;       // 傻瓜敌人数量
+    uint32_t fire_interval; // 敌人发射炮弹的间隔（模拟帧），0表示使用默认值MUGGLE_SHOOT_INTERVAL_TICKS
+    uint32_t duration;      // 运行的模拟帧数
+    uint32_t seed;          // 地图与游戏逻辑的随机数种子
+} ScenarioConfig;
+
+#define SCENARIO_DEFAULT_DURATION 600 // 默认运行60秒游戏时间（以TK_TICK_MS=100计）
+
+// 运行压力测试场景，结束时打印模拟帧耗时的百分位数汇总，成功返回0
+extern int tk_run_scenario(const ScenarioConfig *config);
+
+#endif
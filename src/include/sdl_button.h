@@ -32,7 +32,7 @@ typedef struct _Button {
 extern Button* create_button(int x, int y, int w, int h, int text_offset_x, int text_offset_y, 
                 const char* text, void (*onClick)(void*, void*), void* callbackData);
 extern void render_all_buttons(SDL_Renderer* renderer) ;
-extern void handle_click_event_for_all_buttons(SDL_Event* event);
+extern int handle_click_event_for_all_buttons(SDL_Event* event);
 extern void cleanup_all_buttons();
 
 #endif
\ No newline at end of file
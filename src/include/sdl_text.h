@@ -4,8 +4,12 @@
 #include <SDL2/SDL.h>
 #include <SDL2/SDL_ttf.h>
 #include "hashtbl.h"
+#include "queue.h"
 
 #define FONT_CACHE_BASED_ON_HASH // 若不定义该宏，则使用基于数组的缓存表，性能较差(体现倒也不明显)，建议使用哈希表实现缓存表
+#define TEXT_RENDER_BASED_ON_GLYPH_ATLAS // 动态文本（角度数值、坦克名称、按钮文字）走字形图集绘制，预热之后不再调用TTF渲染、也不再创建纹理
+/*文本绘制的分工：定义了上面的宏时，draw_text_with_cache()（游戏内所有文本）只走字形图集；文本纹理缓存（带内存预算的LRU）
+  只服务于需要整段纹理的render_text_with_cache()调用者，以及不定义该宏时draw_text_with_cache()的后备实现*/
 
 // 文本缓存项结构
 typedef struct _TextCacheItem {
@@ -17,15 +21,53 @@ typedef struct _TextCacheItem {
 #ifdef FONT_CACHE_BASED_ON_HASH
     tk_uint32_t hashkey;
     hashtbl_link_t hashlink;
+    TAILQ_ENTRY(_TextCacheItem) lrulink; // 链表头是最近使用的，链表尾是最久未使用的（优先淘汰）
+    size_t bytes; // 纹理占用的显存大小估算（w*h*4）
 #endif
 } TextCacheItem;
 
+#define DEFAULT_TEXT_CACHE_BUDGET_BYTES (4*1024*1024) // 文本纹理缓存的默认内存预算
+
+// 文本缓存统计
+typedef struct {
+    unsigned int hits;
+    unsigned int misses;
+    unsigned int evictions;
+    unsigned int items;
+    size_t bytes;
+    size_t budget_bytes;
+} TextCacheStats;
+
 // 字体缓存结构
 typedef struct {
     int size;
     TTF_Font* font;
 } FontCacheItem;
 
+// 字形图集中的单个字形
+typedef struct _GlyphInfo {
+    tk_uint32_t codepoint;
+    SDL_Rect rect;    // 字形位图在图集纹理中的位置
+    int advance;      // 绘制完该字形后笔触横向前进的距离
+    tk_uint8_t loaded;
+    hashtbl_link_t hashlink; // 仅非ASCII字形（如按钮上的中文）放入哈希表
+} GlyphInfo;
+
+// 字形图集：每种字号一张纹理，字形按行（shelf）依次排布，用到哪个字形才光栅化哪个
+typedef struct {
+#define GLYPH_ATLAS_WIDTH  512
+#define GLYPH_ATLAS_HEIGHT 512
+#define GLYPH_ATLAS_PADDING 1 // 字形之间留白，避免纹理采样时串色
+    int font_size; // 同文本缓存，以TTF_FontHeight()作为字号标识
+    SDL_Texture* texture;
+    int pen_x;
+    int pen_y;
+    int row_height;
+    GlyphInfo ascii[128];
+    hashtbl_t* glyph_hashtbl;
+    unsigned int reset_num; // 图集写满后被清空重建的次数
+} GlyphAtlas;
+
 extern int init_ttf();
 extern void cleanup_ttf();
 
@@ -38,6 +80,8 @@ extern SDL_Texture* _render_text(SDL_Renderer* renderer,
 #define render_cached_text render_text_with_cache
 extern void clear_text_cache();
 #define clear_cached_text clear_text_cache
+extern void set_text_cache_budget(size_t budget_bytes);
+extern void get_text_cache_stats(TextCacheStats* stats);
 
 //not recommended start
 #define render_text(renderer, font, text, color) _render_text(renderer, font, text, color, 0)
@@ -46,6 +90,18 @@ extern void clear_text_cache();
 
 extern void draw_text(SDL_Renderer* renderer, SDL_Texture* texture, int x, int y);
 
+extern int draw_atlas_text(SDL_Renderer* renderer, TTF_Font* font, const char* text, SDL_Color color, int x, int y);
+extern void clear_glyph_atlas();
+
+// 渲染并绘制一段（频繁变化的）文本，调用者无需关心纹理的生命周期
+#ifdef TEXT_RENDER_BASED_ON_GLYPH_ATLAS
+#define draw_text_with_cache(renderer, font, text, color, x, y) \
+    draw_atlas_text(renderer, font, text, color, x, y)
+#else
+#define draw_text_with_cache(renderer, font, text, color, x, y) \
+    draw_text(renderer, render_text_with_cache(renderer, font, text, color), x, y)
+#endif
+
 extern void print_text_cache();
 extern void get_text_size(TTF_Font* font, const char* text, int* width, int* height);
 
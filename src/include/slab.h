@@ -0,0 +1,27 @@
+#ifndef __SLAB_H__
+    #define __SLAB_H__
+
+#include <stddef.h>
+#include <stdint.h>
+
+/*定长槽位分配器：启动时一次性预留capacity个槽位的虚拟地址空间（mmap，MAP_NORESERVE），槽位地址终生不变，
+  只有真正用到的页才占用物理内存。槽位按下标从低到高启用，释放的槽位挂到空闲链表上优先复用，
+  因此[0, high_water)这段连续内存就包含了全部存活对象——对象之间的裸指针在原地整段拷贝回来后依然有效，
+  对局检查点（见game_checkpoint_save()）据此只需memcpy，不需要逐个对象序列化*/
+typedef struct {
+    uint8_t *base;
+    size_t slot_size;  // 按64字节对齐
+    size_t capacity;   // 槽位数上限，用满后分配失败
+    size_t high_water; // 启用过的槽位数
+    size_t free_head;  // 空闲链表（槽位下标+1，0表示空），链表指针存放在空闲槽位的开头
+    size_t used;       // 已分配的槽位数
+} TkSlab;
+
+#define tk_slab_bytes_in_use(slab) ((slab)->high_water * (slab)->slot_size)
+
+extern int tk_slab_init(TkSlab *slab, size_t slot_size, size_t capacity);
+extern void tk_slab_destroy(TkSlab *slab);
+extern void* tk_slab_alloc(TkSlab *slab);
+extern void tk_slab_free(TkSlab *slab, void *slot);
+
+#endif
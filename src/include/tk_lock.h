@@ -0,0 +1,49 @@
+#ifndef __TK_LOCK_H__
+    #define __TK_LOCK_H__
+
+#include <stdint.h>
+#include "global.h"
+
+// 锁统计（`make LOCK_STATS=1`定义ENABLE_LOCK_STATS）：获取次数、争用次数、等待/持有耗时直方图、争用时的持有者。
+// 默认关闭，统计代码在编译期被移除，加锁/解锁路径上不多读时钟
+
+/*两种锁共用同一个状态字（0未上锁，1已上锁，2已上锁且可能有线程在futex上等待），可按锁实例分别选择：
+  TK_LOCK_SPIN      一直自旋，适合临界区很短的锁（如tank->shell_list）
+  TK_LOCK_ADAPTIVE  先自旋TK_LOCK_SPIN_LIMIT次，仍拿不到就在futex上睡眠，由释放者唤醒。
+                    GUI线程持有整个渲染过程的锁（tank_list、BFS结果）用它，控制线程不会因此空转一整个核*/
+typedef enum {
+    TK_LOCK_SPIN,
+    TK_LOCK_ADAPTIVE
+} tk_lock_kind_t;
+
+#define TK_LOCK_SPIN_LIMIT 200
+
+#ifdef ENABLE_LOCK_STATS
+// 同名的锁共用一份统计（例如所有坦克的shell_list锁）
+typedef struct _tk_lock_stats tk_lock_stats_t;
+#endif
+
+typedef struct {
+    int state;
+    tk_lock_kind_t kind;
+    const char *name; // 字符串字面量，也用作跟踪（trace.h）中锁等待区间的名字
+#ifdef ENABLE_LOCK_STATS
+    tk_lock_stats_t *stats;
+    int holder_tid;          // 当前持有者线程ID
+    const char *holder_site; // 当前持有者加锁所在的函数
+    uint64_t acquired_ns;
+#endif
+} tk_lock_t;
+
+#define TK_LOCK_INITIALIZER(lock_name, lock_kind) { .state = 0, .kind = (lock_kind), .name = (lock_name) }
+
+extern void tk_lock_init(tk_lock_t *l, const char *name, tk_lock_kind_t kind);
+extern void tk_lock_destroy(tk_lock_t *l);
+extern void tk_lock_acquire(tk_lock_t *l, const char *site);
+extern void tk_lock_release(tk_lock_t *l);
+extern void tk_lock_report();
+
+#define lock(l) tk_lock_acquire((l), __func__)
+#define unlock(l) tk_lock_release(l)
+
+#endif
@@ -2,10 +2,14 @@
     #define __TOOLS_H__
 
 #include <stddef.h>
+#include <stdint.h>
 
 extern char* get_absolute_path(char *relative_path);
 extern char* uint_to_str(unsigned int num);
-extern int random_range(int m, int n);
+extern uint32_t tk_rand_r(uint32_t *state);
+extern uint32_t tk_rand_seed(uint32_t seed);
+extern int tk_rand_range(uint32_t *state, int m, int n);
 extern size_t strlcpy(char *dst, const char *src, size_t size);
+extern uint64_t tk_get_monotonic_ns();
 
 #endif
\ No newline at end of file
@@ -0,0 +1,30 @@
+#ifndef __TOURNAMENT_H__
+    #define __TOURNAMENT_H__
+
+#include <stdint.h>
+#include "global.h"
+
+/*AI对战锦标赛：按配置文件批量进行傻瓜坦克之间的无GUI对局，用于平衡性扫描（炮弹速度、反弹次数、开火间隔等）。
+  每局不等待定时器，连续推进模拟帧直到只剩一辆（或没有）存活的坦克，或达到帧数上限。
+  主进程为每个CPU核心fork一个工作进程，结果写入共享内存，全部结束后由主进程汇总输出CSV。
+  配置文件每行一组配置（#开头为注释），由空格分隔的key=value组成，未给出的取默认值：
+    seeds=1-500 tanks=2 shell_speed=9 shell_ttl=3 fire_interval=10 max_ticks=6000*/
+typedef struct {
+    uint32_t seed_from;      // 种子范围[seed_from, seed_to]，每个种子一局
+    uint32_t seed_to;
+    uint32_t tanks;          // 每局傻瓜坦克数量
+    tk_float32_t shell_speed; // 炮弹速度（<=10，否则可能穿墙），默认SHELL_INIT_SPEED
+    uint32_t shell_ttl;      // 炮弹可反弹次数，默认DEFAULT_TANK_SHELL_COLLISION_MAX_NUM
+    uint32_t fire_interval;  // 开火间隔（模拟帧），默认MUGGLE_SHOOT_INTERVAL_TICKS
+    uint32_t max_ticks;      // 每局模拟帧数上限，超过则判为超时
+} TournamentConfig;
+
+#define TOURNAMENT_MAX_CONFIGS 256
+#define TOURNAMENT_DEFAULT_TANKS 2
+#define TOURNAMENT_DEFAULT_MAX_TICKS 6000 // 10分钟游戏时间（以TK_TICK_MS=100计）
+#define TOURNAMENT_DEFAULT_CSV "tournament.csv"
+
+// 运行配置文件中的全部对局，jobs为工作进程数（0表示CPU核心数），结果写到csv_path。全部对局都完成返回0
+extern int tk_run_tournament(const char *spec_path, uint32_t jobs, const char *csv_path);
+
+#endif
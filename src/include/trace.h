@@ -0,0 +1,68 @@
+#ifndef __TRACE_H__
+    #define __TRACE_H__
+
+#include <stdint.h>
+#include "global.h"
+
+/*时间线跟踪：记录各线程的区间（开始/结束）、瞬时事件以及跨线程的事件流（GUI线程入队 -> 控制线程出队），
+  导出为Chrome trace-event JSON，可在chrome://tracing或https://ui.perfetto.dev中查看。
+  运行时开关（游戏中按F9开始/停止，停止时写出文件），关闭时每个埋点只多一次读取和分支。
+  每个线程写自己的缓冲区，无锁；缓冲区写满后丢弃后续事件*/
+#define TK_TRACE_DEFAULT_PATH "tk_trace.json"
+#define TK_TRACE_BUF_EVENTS (1 << 18) // 每个线程最多记录的事件数（每个32字节）
+
+#define TK_TRACE_PH_BEGIN    'B'
+#define TK_TRACE_PH_END      'E'
+#define TK_TRACE_PH_COMPLETE 'X' // arg为持续时间（ns）
+#define TK_TRACE_PH_INSTANT  'i' // arg为事件ID
+#define TK_TRACE_PH_FLOW_START 's' // arg为流ID，与同ID的FLOW_END连成箭头
+#define TK_TRACE_PH_FLOW_END   'f'
+
+extern int tk_trace_enabled;
+#define TK_TRACE_ON() __builtin_expect(__atomic_load_n(&tk_trace_enabled, __ATOMIC_RELAXED), 0)
+
+// name必须是字符串字面量（只保存指针）；ts_ns为0表示取当前时间
+extern void tk_trace_event(char ph, const char *name, uint64_t ts_ns, uint64_t arg, uint16_t aux);
+extern void tk_trace_thread_name(const char *name);
+extern void tk_trace_set_output(const char *path);
+extern void tk_trace_start();
+extern int tk_trace_stop(); // 停止并写出文件，成功返回0
+extern void tk_trace_toggle();
+
+#define TK_TRACE_INSTANT(name, id, aux) \
+    do { if (TK_TRACE_ON()) tk_trace_event(TK_TRACE_PH_INSTANT, name, 0, id, aux); } while (0)
+#define TK_TRACE_FLOW_START(name, id) \
+    do { if (TK_TRACE_ON()) tk_trace_event(TK_TRACE_PH_FLOW_START, name, 0, id, 0); } while (0)
+#define TK_TRACE_FLOW_END(name, id) \
+    do { if (TK_TRACE_ON()) tk_trace_event(TK_TRACE_PH_FLOW_END, name, 0, id, 0); } while (0)
+#define TK_TRACE_COMPLETE(name, start_ns, dur_ns) \
+    do { if (TK_TRACE_ON()) tk_trace_event(TK_TRACE_PH_COMPLETE, name, start_ns, dur_ns, 0); } while (0)
+
+// 区间：开始时若跟踪已打开则记录开始，离开作用域时记录结束（开始没记录则结束也不记录，保证配对）
+typedef struct {
+    const char *name;
+    int started;
+} tk_trace_scope_t;
+
+static inline tk_trace_scope_t tk_trace_scope_begin(const char *name) {
+    tk_trace_scope_t scope = {name, 0};
+    if (TK_TRACE_ON()) {
+        tk_trace_event(TK_TRACE_PH_BEGIN, name, 0, 0, 0);
+        scope.started = 1;
+    }
+    return scope;
+}
+
+static inline void tk_trace_scope_end(tk_trace_scope_t *scope) {
+    if (scope->started) {
+        tk_trace_event(TK_TRACE_PH_END, scope->name, 0, 0, 0);
+    }
+}
+
+#define TK_TRACE_CONCAT_(a, b) a##b
+#define TK_TRACE_CONCAT(a, b) TK_TRACE_CONCAT_(a, b)
+#define TK_TRACE_SCOPE(name) \
+    tk_trace_scope_t TK_TRACE_CONCAT(__tk_trace_scope_, __LINE__) \
+        __attribute__((cleanup(tk_trace_scope_end))) = tk_trace_scope_begin(name)
+
+#endif
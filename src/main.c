@@ -6,6 +6,21 @@
 #include "debug.h"
 #include <sched.h>
 #include "tools.h"
+#include "profiler.h"
+#include "replay.h"
+#include "scenario.h"
+#include "match_runner.h"
+#include "tournament.h"
+#include "net_server.h"
+#include "net_protocol.h"
+#include "net_snapshot.h"
+#include "net_predict.h"
+#include "lockstep.h"
+#include "bot_shm.h"
+#include "headless.h"
+#include "trace.h"
+#include "tk_lock.h"
+#include <string.h>
 
 // #define RUN_ON_MULTI_CORE // 设置了反而效果不好，因为明面上我只有三个线程（含主线程），但实际
 // 一些三方库隐含创建了多线程，因此本游戏实际涉及>3个线程，设置RUN_ON_MULTI_CORE会使得线程集中于两个核心上，
@@ -26,6 +41,7 @@ void pin_thread_to_cpu(pthread_t thread, int cpu_id) {
 
 void* gui_thread(void* arg) {
     reset_debug_prefix("gui");
+    tk_trace_thread_name("gui");
     // int ret = -1;
     tk_debug("GUI thread started...\n");
     // 确认游戏资源是否存在
@@ -44,13 +60,6 @@ void* gui_thread(void* arg) {
     if (init_ttf() != 0) {
         goto out;
     }
-    if (init_idpool() != 0) {
-        goto out;
-    }
-    init_game_state();
-    if (init_simple_game_tanks() != 0) { // 初始化一局简单游戏的坦克对象
-        goto out;
-    }
     if (init_game_buttons() != 0) {
         goto out;
     }
@@ -61,8 +70,6 @@ void* gui_thread(void* arg) {
 
 out:
     cleanup_all_buttons();
-    cleanup_game_state();
-    cleanup_idpool();
     cleanup_ttf();
     cleanup_music();
     cleanup_gui();
@@ -74,24 +81,212 @@ out:
 // 控制线程函数
 void* control_thread(void* arg) {
     reset_debug_prefix("control");
-
-    // 初始化libevent
-    if (init_event_loop() != 0) {
-        return NULL;
-    }
+    tk_trace_thread_name("control");
 
     tk_debug("Control thread main loop started...\n");
     // 事件主循环将持续运行，直至调用stop_event_loop()来退出循环
-    run_event_loop();
-
-    // 清理事件相关资源
-    cleanup_event_loop();
+    run_event_loop(&tk_event_loop); // 事件相关资源由主线程在两个线程都结束后清理
     tk_debug("Control thread exit success!\n");
     return NULL;
 }
 
-int main() {
+static void usage(const char *prog) {
+    printf("usage: %s [--seed N] [--record FILE] [--trace FILE]   --trace从开局起跟踪时间线，游戏中按F9停止并写出（再按F9重新开始）\n"
+           "       %s --replay FILE [--seek TICK]   无GUI回放录像（可配合perf等工具反复剖析）\n"
+           "       %s --scenario ENEMIES [--fire-interval TICKS] [--duration TICKS] [--seed N]\n"
+           "                                        无GUI压力测试：大量傻瓜敌人对战，统计模拟帧耗时分布\n"
+           "       %s --matches N [--threads T] [--enemies E] [--fire-interval TICKS] [--duration TICKS] [--seed N]\n"
+           "                                        无GUI多局并行：T个线程按真实时间同时推进N局游戏\n"
+           "       %s --tournament SPEC [--jobs N] [--csv FILE]\n"
+           "                                        AI对战锦标赛：按配置文件（格式见tournament.h）多进程批量对局，结果输出为CSV\n"
+           "       %s --serve PORT [--enemies E] [--duration TICKS] [--seed N]\n"
+           "                                        无GUI权威服务器：监听127.0.0.1:PORT，每个客户端操控一辆坦克（协议见net_protocol.h）\n"
+           "       %s --net-bots N [--connect HOST:PORT] [--duration STATES] [--seed N]\n"
+           "                                        回环测试：N个机器人客户端连接服务器随机操作，校验并统计收到的世界状态\n"
+           "       %s --snapshot-bench TANKS [--ack-delay TICKS] [--duration TICKS] [--seed N]\n"
+           "                                        世界状态快照编解码自测与带宽统计（格式见net_snapshot.h）\n"
+           "       %s --predict-bench RTT_MS [--enemies E] [--duration TICKS] [--seed N]\n"
+           "                                        客户端预测自测：模拟往返时延下的输入延迟与校正统计（见net_predict.h）\n"
+           "       %s --lockstep PEERS [--enemies E] [--input-delay TICKS] [--jitter MS] [--desync-at TICK] [--duration TICKS] [--seed N]\n"
+           "                                        锁步联机自测：进程内多个对端只交换输入、各自模拟并校验状态哈希（见lockstep.h）\n"
+           "       %s --bot-host SLOTS [--shm NAME] [--enemies E] [--pace MS] [--duration TICKS] [--seed N]\n"
+           "                                        外部AI宿主：经共享内存把坦克交给本机其他进程操控，--pace 0为步进模式（见bot_shm.h）\n"
+           "       %s --shm-bots N [--shm NAME] [--duration STEPS] [--seed N]\n"
+           "                                        示例机器人进程：N个机器人接入宿主随机操作，统计每秒步数\n",
+           prog, prog, prog, prog, prog, prog, prog, prog, prog, prog, prog, prog);
+}
+
+int main(int argc, char *argv[]) {
+    const char *record_path = NULL, *replay_path = NULL, *trace_path = NULL;
+    const char *tournament_path = NULL, *csv_path = TOURNAMENT_DEFAULT_CSV;
+    uint32_t jobs = 0;
+    uint32_t seed = (uint32_t)time(NULL) ^ (uint32_t)getpid();
+    uint32_t seek_tick = 0;
+    ScenarioConfig scenario = {0, 0, SCENARIO_DEFAULT_DURATION, 0};
+    MatchRunnerConfig runner = {0, 0, MATCH_RUNNER_DEFAULT_ENEMIES, 0, SCENARIO_DEFAULT_DURATION, 0};
+    NetServerConfig server = {0, 0, 0, 0};
+    NetBotsConfig net_bots = {TK_NET_DEFAULT_ADDRESS, 0, SCENARIO_DEFAULT_DURATION, 0};
+    SnapshotBenchConfig snapshot_bench = {0, SCENARIO_DEFAULT_DURATION, SNAPSHOT_BENCH_DEFAULT_ACK_DELAY, 0};
+    PredictBenchConfig predict_bench = {0, 0, SCENARIO_DEFAULT_DURATION, 0};
+    int predict = 0; // RTT为0也是合法的测试条件
+    LockstepConfig lockstep = {0, 0, SCENARIO_DEFAULT_DURATION, LOCKSTEP_DEFAULT_INPUT_DELAY, 0, 0, 0};
+    BotHostConfig bot_host = {TK_BOT_SHM_DEFAULT_NAME, 0, 0, SCENARIO_DEFAULT_DURATION, 0, 0};
+    ShmBotsConfig shm_bots = {TK_BOT_SHM_DEFAULT_NAME, 0, SCENARIO_DEFAULT_DURATION, 0};
+    tk_uint8_t flags = 0; // 无GUI模式的公共处理（见headless.h）
+    int ret = 0;
+
     reset_debug_prefix("main");
+    for (int i = 1; i < argc; i++) {
+        if ((i + 1) >= argc) {
+            usage(argv[0]);
+            return -1;
+        } else if (!strcmp(argv[i], "--seed")) {
+            seed = strtoul(argv[++i], NULL, 10);
+        } else if (!strcmp(argv[i], "--record")) {
+            record_path = argv[++i];
+        } else if (!strcmp(argv[i], "--trace")) {
+            trace_path = argv[++i];
+        } else if (!strcmp(argv[i], "--replay")) {
+            replay_path = argv[++i];
+        } else if (!strcmp(argv[i], "--seek")) {
+            seek_tick = strtoul(argv[++i], NULL, 10);
+        } else if (!strcmp(argv[i], "--scenario")) {
+            scenario.enemies = strtoul(argv[++i], NULL, 10);
+        } else if (!strcmp(argv[i], "--fire-interval")) {
+            scenario.fire_interval = runner.fire_interval = strtoul(argv[++i], NULL, 10);
+        } else if (!strcmp(argv[i], "--duration")) {
+            scenario.duration = runner.duration = server.duration = net_bots.duration = snapshot_bench.duration = predict_bench.duration =
+                lockstep.duration = bot_host.duration = shm_bots.steps = strtoul(argv[++i], NULL, 10);
+        } else if (!strcmp(argv[i], "--matches")) {
+            runner.matches = strtoul(argv[++i], NULL, 10);
+        } else if (!strcmp(argv[i], "--threads")) {
+            runner.threads = strtoul(argv[++i], NULL, 10);
+        } else if (!strcmp(argv[i], "--enemies")) {
+            runner.enemies = server.enemies = predict_bench.enemies = lockstep.enemies = bot_host.enemies = strtoul(argv[++i], NULL, 10);
+        } else if (!strcmp(argv[i], "--tournament")) {
+            tournament_path = argv[++i];
+        } else if (!strcmp(argv[i], "--jobs")) {
+            jobs = strtoul(argv[++i], NULL, 10);
+        } else if (!strcmp(argv[i], "--csv")) {
+            csv_path = argv[++i];
+        } else if (!strcmp(argv[i], "--serve")) {
+            server.port = strtoul(argv[++i], NULL, 10);
+        } else if (!strcmp(argv[i], "--net-bots")) {
+            net_bots.bots = strtoul(argv[++i], NULL, 10);
+        } else if (!strcmp(argv[i], "--connect")) {
+            net_bots.address = argv[++i];
+        } else if (!strcmp(argv[i], "--snapshot-bench")) {
+            snapshot_bench.tanks = strtoul(argv[++i], NULL, 10);
+        } else if (!strcmp(argv[i], "--ack-delay")) {
+            snapshot_bench.ack_delay = strtoul(argv[++i], NULL, 10);
+        } else if (!strcmp(argv[i], "--predict-bench")) {
+            predict_bench.rtt_ms = strtoul(argv[++i], NULL, 10);
+            predict = 1;
+        } else if (!strcmp(argv[i], "--lockstep")) {
+            lockstep.peers = strtoul(argv[++i], NULL, 10);
+        } else if (!strcmp(argv[i], "--input-delay")) {
+            lockstep.input_delay = strtoul(argv[++i], NULL, 10);
+        } else if (!strcmp(argv[i], "--jitter")) {
+            lockstep.jitter_ms = strtoul(argv[++i], NULL, 10);
+        } else if (!strcmp(argv[i], "--desync-at")) {
+            lockstep.desync_tick = strtoul(argv[++i], NULL, 10);
+        } else if (!strcmp(argv[i], "--bot-host")) {
+            bot_host.slots = strtoul(argv[++i], NULL, 10);
+        } else if (!strcmp(argv[i], "--shm")) {
+            bot_host.name = shm_bots.name = argv[++i];
+        } else if (!strcmp(argv[i], "--pace")) {
+            bot_host.pace_ms = strtoul(argv[++i], NULL, 10);
+        } else if (!strcmp(argv[i], "--shm-bots")) {
+            shm_bots.bots = strtoul(argv[++i], NULL, 10);
+        } else {
+            usage(argv[0]);
+            return -1;
+        }
+    }
+    if (replay_path) {
+        flags = TK_HEADLESS_PROFILE | TK_HEADLESS_LOCK_STATS;
+        tk_headless_begin(flags);
+        return tk_headless_end(flags, tk_replay_play(replay_path, seek_tick));
+    }
+    if (scenario.enemies > 0) {
+        scenario.seed = seed;
+        flags = TK_HEADLESS_QUIET_OBJECTS | TK_HEADLESS_PROFILE | TK_HEADLESS_LOCK_STATS;
+        tk_headless_begin(flags);
+        return tk_headless_end(flags, tk_run_scenario(&scenario));
+    }
+    if (tournament_path) {
+        tk_headless_begin(TK_HEADLESS_QUIET_OBJECTS); // 每局都打印地图与创建/删除日志会淹没输出
+        return tk_headless_end(TK_HEADLESS_QUIET_OBJECTS, tk_run_tournament(tournament_path, jobs, csv_path));
+    }
+    if (server.port > 0) {
+        server.seed = seed;
+        flags = TK_HEADLESS_QUIET_OBJECTS | TK_HEADLESS_PROFILE; // 客户端反复被击毁、重生，创建/删除日志会淹没连接日志
+        tk_headless_begin(flags);
+        return tk_headless_end(flags, tk_run_net_server(&server));
+    }
+    if (net_bots.bots > 0) {
+        net_bots.seed = seed;
+        tk_headless_begin(TK_HEADLESS_QUIET_OBJECTS); // 每个机器人的预测都有一份本地GameState
+        return tk_headless_end(TK_HEADLESS_QUIET_OBJECTS, tk_run_net_bots(&net_bots));
+    }
+    if (snapshot_bench.tanks > 0) {
+        snapshot_bench.seed = seed;
+        tk_headless_begin(TK_HEADLESS_QUIET_OBJECTS);
+        return tk_headless_end(TK_HEADLESS_QUIET_OBJECTS, tk_run_snapshot_bench(&snapshot_bench));
+    }
+    if (predict) {
+        predict_bench.seed = seed;
+        tk_headless_begin(TK_HEADLESS_QUIET_OBJECTS);
+        return tk_headless_end(TK_HEADLESS_QUIET_OBJECTS, tk_run_predict_bench(&predict_bench));
+    }
+    if (lockstep.peers > 0) {
+        lockstep.seed = seed;
+        flags = TK_HEADLESS_QUIET_OBJECTS | TK_HEADLESS_THREADED_LOG; // 多个对端线程同时输出日志
+        tk_headless_begin(flags);
+        return tk_headless_end(flags, tk_run_lockstep(&lockstep));
+    }
+    if (bot_host.slots > 0) {
+        bot_host.seed = seed;
+        flags = TK_HEADLESS_QUIET_OBJECTS | TK_HEADLESS_PROFILE; // 机器人坦克反复被击毁、重生
+        tk_headless_begin(flags);
+        return tk_headless_end(flags, tk_run_bot_host(&bot_host));
+    }
+    if (shm_bots.bots > 0) {
+        shm_bots.seed = seed;
+        tk_headless_begin(TK_HEADLESS_THREADED_LOG); // 多个机器人线程同时输出日志
+        return tk_headless_end(TK_HEADLESS_THREADED_LOG, tk_run_shm_bots(&shm_bots));
+    }
+    if (runner.matches > 0) {
+        runner.seed = seed;
+        flags = TK_HEADLESS_QUIET_OBJECTS | TK_HEADLESS_THREADED_LOG | TK_HEADLESS_PROFILE | TK_HEADLESS_LOCK_STATS;
+        tk_headless_begin(flags);
+        return tk_headless_end(flags, tk_run_matches(&runner));
+    }
+
+    // 游戏状态在两个线程启动前建立，之后只由控制线程修改，录像从这里开始
+    if (init_game_state(&tk_shared_game_state, seed, tk_rand_seed(seed + 1)) != 0) {
+        ret = -1;
+        goto out;
+    }
+    if (start_new_game(&tk_shared_game_state) != 0) { // 初始化一局简单游戏的坦克对象
+        ret = -1;
+        goto out;
+    }
+    if (record_path && (tk_replay_record_start(&tk_shared_game_state, record_path) != 0)) {
+        ret = -1;
+        goto out;
+    }
+    // 控制线程的事件循环（事件基、管道、事件队列）也在GUI线程启动前建立，GUI线程一开始就可以入队事件
+    if (init_event_loop(&tk_event_loop, &tk_shared_game_state, NULL) != 0) {
+        ret = -1;
+        goto out;
+    }
+
+    tk_log_start(); // 游戏过程中日志交由后台线程输出，调用线程不再阻塞于终端I/O
+    if (trace_path) {
+        tk_trace_set_output(trace_path);
+        tk_trace_start();
+    }
 
     // 创建线程
     pthread_t control_tid, gui_tid;
@@ -103,7 +298,8 @@ int main() {
     if (pthread_create(&control_tid, NULL, control_thread, NULL) != 0) {
 #endif
         tk_debug("Error: failed to create Control thread\n");
-        return -1;
+        ret = -1;
+        goto out;
     }
 #if defined(RUN_ON_MULTI_CORE)
     if (pthread_create(&gui_tid, NULL, gui_thread, &cpu2) != 0) {
@@ -115,7 +311,8 @@ int main() {
         // 可能无法停止控制线程事件主循环，所以应当使用管道或其他线程间通信方式通知控制线程自己调用stop_event_loop()来结束事件循环
         notify_control_thread_exit();
         pthread_join(control_tid, NULL);
-        return -1;
+        ret = -1;
+        goto out;
     }
     // 设置 CPU 亲和性（通过 ps -eLo pid,tid,psr,cmd | grep tank.exe 观察效果）
 #if defined(RUN_ON_MULTI_CORE)
@@ -127,6 +324,15 @@ int main() {
     // 等待线程结束
     pthread_join(control_tid, NULL);
     pthread_join(gui_tid, NULL);
+    tk_trace_stop(); // 退出时仍在跟踪则写出文件
+    tk_log_stop();
     tk_debug("game over(%us)!\n", ((tk_shared_game_state.game_time * RENDER_FPS_MS) / 1000));
-    return 0;
+    tk_profiler_report();
+    tk_lock_report();
+out:
+    tk_log_stop();
+    tk_replay_record_stop();
+    cleanup_event_loop(&tk_event_loop);
+    cleanup_game_state(&tk_shared_game_state);
+    return ret;
 }
\ No newline at end of file
@@ -1,38 +1,76 @@
 #include <pthread.h>
 #include <stdarg.h>
+#include <stdlib.h>
 #include <string.h>
+#include <ctype.h>
+#include <time.h>
 #include <sys/syscall.h>  // 获取更短的线程ID
 #include <unistd.h>       // 提供 SYS_gettid 和 pid_t 的定义
+#include "global.h"
 #include "debug.h"
+#include "tools.h"
 
 #define DEBUG_BUF_SIZE 1024
 
+int tk_debug_object_lifecycle = 1;
+
 // 线程局部存储的前缀缓冲
 static __thread char prefix_buf[64] = {0};
 // 线程本地存储的完整输出缓冲区
 static __thread char output_buf[DEBUG_BUF_SIZE];
 
-void tk_debug_internal(int control, const char *format, ...) {
-    if (!control) return;
-    // 初始化线程本地前缀（每个线程只执行一次）
+// 初始化线程本地前缀（每个线程只执行一次）
+static void init_debug_prefix() {
     if (prefix_buf[0] == '\0') {
         pid_t tid = syscall(SYS_gettid);  // 获取内核级线程ID
         snprintf(prefix_buf, sizeof(prefix_buf), "[T-%d] ", tid);
     }
+}
 
-    va_list args;
-    va_start(args, format);
+// 限速：每个调用点每秒最多TK_LOG_RATE_LIMIT条，返回0表示本条应丢弃。新时间窗口的第一条日志通过suppressed带出上个窗口丢弃的条数。
+// 多个线程共用同一调用点时计数可能有少许误差，无伤大雅
+static int tk_log_rate_limit(tk_log_site_t *site, uint64_t now_ns, uint32_t *suppressed) {
+    uint64_t window_start_ns = __atomic_load_n(&site->window_start_ns, __ATOMIC_RELAXED);
+
+    *suppressed = 0;
+    if ((window_start_ns == 0) || (now_ns - window_start_ns >= 1000000000ULL)) {
+        __atomic_store_n(&site->window_start_ns, now_ns, __ATOMIC_RELAXED);
+        __atomic_store_n(&site->count, 0, __ATOMIC_RELAXED);
+        *suppressed = __atomic_exchange_n(&site->suppressed, 0, __ATOMIC_RELAXED);
+    }
+    if (__atomic_add_fetch(&site->count, 1, __ATOMIC_RELAXED) > TK_LOG_RATE_LIMIT) {
+        __atomic_add_fetch(&site->suppressed, 1, __ATOMIC_RELAXED);
+        return 0;
+    }
+    return 1;
+}
 
+// 在日志末尾（换行符之前）注明丢弃的条数
+static void append_suppressed(char *out, size_t size, uint32_t suppressed) {
+    size_t len = strlen(out);
+    int newline = 0;
+
+    if (suppressed == 0) {
+        return;
+    }
+    if ((len > 0) && (out[len - 1] == '\n')) {
+        out[--len] = '\0';
+        newline = 1;
+    }
+    snprintf(out + len, size - len, " [%u similar messages suppressed]%s", suppressed, newline ? "\n" : "");
+}
+
+static void tk_log_write_sync(uint32_t suppressed, const char *format, va_list args) {
+    init_debug_prefix();
     // 合并前缀和用户内容到输出缓冲区
     size_t prefix_len = strlen(prefix_buf);
     strncpy(output_buf, prefix_buf, prefix_len);
     output_buf[DEBUG_BUF_SIZE - 1] = '\0';
     // 追加格式化内容
-    vsnprintf(output_buf + prefix_len, 
-              DEBUG_BUF_SIZE - prefix_len - 1, 
+    vsnprintf(output_buf + prefix_len,
+              DEBUG_BUF_SIZE - prefix_len - 1,
               format, args);
-
-    va_end(args);
+    append_suppressed(output_buf, DEBUG_BUF_SIZE, suppressed);
 
     // 一次性输出完整内容
     fputs(output_buf, stdout);
@@ -41,7 +79,387 @@ void tk_debug_internal(int control, const char *format, ...) {
     fflush(stdout);
 }
 
+#ifdef ENABLE_ASYNC_LOG
+#define TK_LOG_RING_SLOTS 1024 // 每个线程的环形缓冲区槽位数（2的幂），写满后新日志被丢弃而不是阻塞调用线程
+#define TK_LOG_ARGS_BYTES 232  // 每条记录打包参数的空间，字符串参数超出部分被截断
+
+typedef struct {
+    uint64_t ts_ns;     // 写入时间，写日志线程按它归并各线程的日志
+    const char *format; // 格式串（字面量，只保存指针）
+    uint32_t suppressed;
+    uint16_t args_len;
+    uint8_t args[TK_LOG_ARGS_BYTES];
+} LogRecord;
+
+// 单生产者（所属线程）单消费者（写日志线程）无锁环形缓冲区，首次使用时挂到全局链表上，之后一直保留
+typedef struct _LogRing {
+    LogRecord slots[TK_LOG_RING_SLOTS];
+    uint32_t tail __attribute__((aligned(64))); // 生产者写入位置
+    uint64_t dropped; // 缓冲区满而丢弃的条数
+    uint32_t head __attribute__((aligned(64))); // 消费者读取位置
+    uint64_t dropped_reported;
+    char prefix[64];
+    struct _LogRing *next;
+} LogRing;
+
+static LogRing *tk_log_rings = NULL;
+static __thread LogRing *tk_my_log_ring = NULL;
+static pthread_t tk_log_writer_tid;
+static int tk_log_running = 0;
+static int tk_log_stopping = 0;
+static uint32_t tk_log_writer_rounds = 0; // 写日志线程每完成一轮（取空所有缓冲区并fflush）加1，供tk_log_flush()等待
+
+static LogRing *get_log_ring() {
+    LogRing *ring = tk_my_log_ring;
+    LogRing *head = NULL;
+
+    if (ring) {
+        return ring;
+    }
+    ring = aligned_alloc(64, sizeof(LogRing));
+    if (!ring) {
+        return NULL;
+    }
+    memset(ring, 0, sizeof(LogRing));
+    init_debug_prefix();
+    strlcpy(ring->prefix, prefix_buf, sizeof(ring->prefix));
+    head = __atomic_load_n(&tk_log_rings, __ATOMIC_ACQUIRE);
+    do {
+        ring->next = head;
+    } while (!__atomic_compare_exchange_n(&tk_log_rings, &head, ring, 1, __ATOMIC_RELEASE, __ATOMIC_ACQUIRE));
+    tk_my_log_ring = ring;
+    return ring;
+}
+
+// 格式串中的一个转换说明
+typedef struct {
+    char conv;      // 转换字符
+    char length[3]; // 长度修饰符（hh/h/l/ll/z/j/t/L）
+    int stars;      // 宽度/精度中'*'的个数，各消耗一个int参数
+} FmtSpec;
+
+// 解析p（指向'%'之后）处的转换说明，返回说明结束的位置
+static const char *parse_fmt_spec(const char *p, FmtSpec *spec) {
+    int n = 0;
+
+    memset(spec, 0, sizeof(*spec));
+    while (*p && strchr("-+ #0'", *p)) p++;
+    if (*p == '*') {
+        spec->stars++;
+        p++;
+    }
+    while (isdigit((unsigned char)*p)) p++;
+    if (*p == '.') {
+        p++;
+        if (*p == '*') {
+            spec->stars++;
+            p++;
+        }
+        while (isdigit((unsigned char)*p)) p++;
+    }
+    while (*p && strchr("hlzjtL", *p) && (n < 2)) {
+        spec->length[n++] = *p++;
+    }
+    if (*p) {
+        spec->conv = *p++;
+    }
+    return p;
+}
+
+// 是否是64位整数参数（LP64下l/ll/z/j/t都是8字节）
+#define FMT_SPEC_WIDE(spec) ((spec)->length[0] && strchr("lzjt", (spec)->length[0]))
+
+/*按格式串把可变参数打包：整数、浮点数、指针各占8字节，字符串为u16长度+内容（不含'\\0'）。
+  写日志线程按同一格式串解包，因此不需要额外的类型标记。遇到不支持的转换或空间不足时停止打包，输出时以"..."结尾*/
+static uint16_t pack_log_args(uint8_t *args, const char *format, va_list ap) {
+    const char *p = format;
+    FmtSpec spec;
+    uint16_t len = 0;
+    uint64_t v = 0;
+    double d = 0;
+    const char *s = NULL;
+    uint16_t slen = 0;
+
+#define PACK_8(value) do { if (len + 8 > TK_LOG_ARGS_BYTES) return len; memcpy(args + len, &(value), 8); len += 8; } while (0)
+    while (*p) {
+        if (*p++ != '%') {
+            continue;
+        }
+        p = parse_fmt_spec(p, &spec);
+        for (int i = 0; i < spec.stars; i++) {
+            v = (uint64_t)(int64_t)va_arg(ap, int);
+            PACK_8(v);
+        }
+        switch (spec.conv) {
+        case '%':
+            break;
+        case 'd': case 'i':
+            v = FMT_SPEC_WIDE(&spec) ? (uint64_t)va_arg(ap, long) : (uint64_t)(int64_t)va_arg(ap, int);
+            PACK_8(v);
+            break;
+        case 'u': case 'x': case 'X': case 'o': case 'c':
+            v = FMT_SPEC_WIDE(&spec) ? (uint64_t)va_arg(ap, unsigned long) : (uint64_t)va_arg(ap, unsigned int);
+            PACK_8(v);
+            break;
+        case 'f': case 'F': case 'e': case 'E': case 'g': case 'G': case 'a': case 'A':
+            if (spec.length[0] == 'L') {
+                return len;
+            }
+            d = va_arg(ap, double);
+            PACK_8(d);
+            break;
+        case 'p':
+            v = (uint64_t)(uintptr_t)va_arg(ap, void *);
+            PACK_8(v);
+            break;
+        case 's':
+            s = va_arg(ap, const char *);
+            if (!s) {
+                s = "(null)";
+            }
+            if (len + 2 > TK_LOG_ARGS_BYTES) {
+                return len;
+            }
+            slen = strnlen(s, TK_LOG_ARGS_BYTES - len - 2);
+            memcpy(args + len, &slen, 2);
+            memcpy(args + len + 2, s, slen);
+            len += 2 + slen;
+            break;
+        default: // %n等
+            return len;
+        }
+    }
+#undef PACK_8
+    return len;
+}
+
+// 解包并格式化一条记录，返回输出长度
+static size_t render_log_record(const LogRecord *rec, char *out, size_t size) {
+    const char *p = rec->format, *spec_start = NULL;
+    const uint8_t *args = rec->args, *end = rec->args + rec->args_len;
+    char spec_buf[64], str[TK_LOG_ARGS_BYTES + 1];
+    size_t len = 0, spec_len = 0;
+    FmtSpec spec;
+    uint64_t v = 0;
+    double d = 0;
+    uint16_t slen = 0;
+    int n = 0;
+
+#define OUT_LEFT (len < size ? size - len : 0)
+#define UNPACK_8(value) do { if (args + 8 > end) goto truncated; memcpy(&(value), args, 8); args += 8; } while (0)
+    while (*p && (len + 1 < size)) {
+        if (*p != '%') {
+            out[len++] = *p++;
+            continue;
+        }
+        spec_start = p++;
+        p = parse_fmt_spec(p, &spec);
+        // 重建单个转换说明，'*'替换为实际的宽度/精度
+        spec_len = 0;
+        for (const char *q = spec_start; (q < p) && (spec_len + 12 < sizeof(spec_buf)); q++) {
+            if (*q == '*') {
+                UNPACK_8(v);
+                spec_len += snprintf(spec_buf + spec_len, sizeof(spec_buf) - spec_len, "%d", (int)(int64_t)v);
+            } else {
+                spec_buf[spec_len++] = *q;
+            }
+        }
+        spec_buf[spec_len] = '\0';
+        n = 0;
+        switch (spec.conv) {
+        case '%':
+            n = snprintf(out + len, OUT_LEFT, "%%");
+            break;
+        case 'd': case 'i':
+            UNPACK_8(v);
+            n = FMT_SPEC_WIDE(&spec) ? snprintf(out + len, OUT_LEFT, spec_buf, (long)v) : snprintf(out + len, OUT_LEFT, spec_buf, (int)v);
+            break;
+        case 'u': case 'x': case 'X': case 'o': case 'c':
+            UNPACK_8(v);
+            n = FMT_SPEC_WIDE(&spec) ? snprintf(out + len, OUT_LEFT, spec_buf, (unsigned long)v) :
+                snprintf(out + len, OUT_LEFT, spec_buf, (unsigned int)v);
+            break;
+        case 'f': case 'F': case 'e': case 'E': case 'g': case 'G': case 'a': case 'A':
+            UNPACK_8(d);
+            n = snprintf(out + len, OUT_LEFT, spec_buf, d);
+            break;
+        case 'p':
+            UNPACK_8(v);
+            n = snprintf(out + len, OUT_LEFT, spec_buf, (void *)(uintptr_t)v);
+            break;
+        case 's':
+            if (args + 2 > end) goto truncated;
+            memcpy(&slen, args, 2);
+            if (args + 2 + slen > end) goto truncated;
+            memcpy(str, args + 2, slen);
+            str[slen] = '\0';
+            args += 2 + slen;
+            n = snprintf(out + len, OUT_LEFT, spec_buf, str);
+            break;
+        default:
+            goto truncated;
+        }
+        len += (n > 0) ? (size_t)n : 0;
+    }
+    goto done;
+
+truncated:
+    len += snprintf(out + MIN(len, size - 1), OUT_LEFT, "...\n");
+done:
+    len = MIN(len, size - 1);
+    out[len] = '\0';
+#undef UNPACK_8
+#undef OUT_LEFT
+    return len;
+}
+
+// 按时间戳归并输出所有线程缓冲区中的日志，返回输出的条数
+static int drain_log_rings() {
+    LogRing *ring = NULL, *oldest = NULL;
+    LogRecord *rec = NULL;
+    char buf[DEBUG_BUF_SIZE];
+    size_t prefix_len = 0;
+    uint64_t dropped = 0;
+    int drained = 0;
+
+    for (;;) {
+        oldest = NULL;
+        for (ring = __atomic_load_n(&tk_log_rings, __ATOMIC_ACQUIRE); ring; ring = ring->next) {
+            if (ring->head == __atomic_load_n(&ring->tail, __ATOMIC_ACQUIRE)) {
+                continue;
+            }
+            if (!oldest || (ring->slots[ring->head & (TK_LOG_RING_SLOTS - 1)].ts_ns
+                < oldest->slots[oldest->head & (TK_LOG_RING_SLOTS - 1)].ts_ns)) {
+                oldest = ring;
+            }
+        }
+        if (!oldest) {
+            break;
+        }
+        rec = &oldest->slots[oldest->head & (TK_LOG_RING_SLOTS - 1)];
+        prefix_len = strlcpy(buf, oldest->prefix, sizeof(buf));
+        render_log_record(rec, buf + prefix_len, sizeof(buf) - prefix_len);
+        append_suppressed(buf, sizeof(buf), rec->suppressed);
+        fputs(buf, stdout);
+        __atomic_store_n(&oldest->head, oldest->head + 1, __ATOMIC_RELEASE);
+        drained++;
+    }
+    for (ring = __atomic_load_n(&tk_log_rings, __ATOMIC_ACQUIRE); ring; ring = ring->next) {
+        dropped = __atomic_load_n(&ring->dropped, __ATOMIC_RELAXED);
+        if (dropped != ring->dropped_reported) {
+            printf("%sWarn: log buffer full, %lu records dropped\n", ring->prefix, (unsigned long)(dropped - ring->dropped_reported));
+            ring->dropped_reported = dropped;
+            drained++;
+        }
+    }
+    if (drained) {
+        fflush(stdout);
+    }
+    return drained;
+}
+
+static void *log_writer_thread(void *arg) {
+    struct timespec idle = {0, 1000000}; // 没有日志时睡眠1ms
+
+    while (!__atomic_load_n(&tk_log_stopping, __ATOMIC_ACQUIRE)) {
+        if (!drain_log_rings()) {
+            nanosleep(&idle, NULL);
+        }
+        __atomic_add_fetch(&tk_log_writer_rounds, 1, __ATOMIC_RELEASE);
+    }
+    drain_log_rings();
+    return NULL;
+}
+
+// 启动写日志线程，此后tk_debug只写缓冲区
+void tk_log_start() {
+    if (tk_log_running) {
+        return;
+    }
+    tk_log_stopping = 0;
+    if (pthread_create(&tk_log_writer_tid, NULL, log_writer_thread, NULL) != 0) {
+        tk_debug("Error: failed to create log writer thread, logging stays synchronous\n");
+        return;
+    }
+    __atomic_store_n(&tk_log_running, 1, __ATOMIC_RELEASE);
+}
+
+// 等待此前写入缓冲区的日志全部输出（之后直接printf的内容不会与之乱序）
+void tk_log_flush() {
+    LogRing *ring = NULL;
+    uint32_t rounds = 0;
+    struct timespec wait = {0, 200000};
+
+    if (!__atomic_load_n(&tk_log_running, __ATOMIC_ACQUIRE)) {
+        return;
+    }
+    for (ring = __atomic_load_n(&tk_log_rings, __ATOMIC_ACQUIRE); ring; ring = ring->next) {
+        while (__atomic_load_n(&ring->head, __ATOMIC_ACQUIRE) != __atomic_load_n(&ring->tail, __ATOMIC_ACQUIRE)) {
+            nanosleep(&wait, NULL);
+        }
+    }
+    // 最后一条可能已取出但还没fflush，再等写日志线程完整地走完一轮
+    rounds = __atomic_load_n(&tk_log_writer_rounds, __ATOMIC_ACQUIRE);
+    while (__atomic_load_n(&tk_log_writer_rounds, __ATOMIC_ACQUIRE) - rounds < 2) {
+        nanosleep(&wait, NULL);
+    }
+}
+
+// 输出剩余日志并结束写日志线程，此后tk_debug回到同步输出。应在其他线程都已退出后调用
+void tk_log_stop() {
+    if (!tk_log_running) {
+        return;
+    }
+    __atomic_store_n(&tk_log_running, 0, __ATOMIC_RELEASE);
+    __atomic_store_n(&tk_log_stopping, 1, __ATOMIC_RELEASE);
+    pthread_join(tk_log_writer_tid, NULL);
+}
+#else
+void tk_log_start() {}
+void tk_log_flush() {}
+void tk_log_stop() {}
+#endif
+
+void tk_log_write(tk_log_site_t *site, const char *format, ...) {
+    uint64_t now_ns = tk_get_monotonic_ns();
+    uint32_t suppressed = 0;
+    va_list args;
+
+    if (!tk_log_rate_limit(site, now_ns, &suppressed)) {
+        return;
+    }
+    va_start(args, format);
+#ifdef ENABLE_ASYNC_LOG
+    LogRing *ring = NULL;
+    LogRecord *rec = NULL;
+    uint32_t tail = 0;
+
+    if (__atomic_load_n(&tk_log_running, __ATOMIC_ACQUIRE) && (ring = get_log_ring())) {
+        tail = ring->tail;
+        if (tail - __atomic_load_n(&ring->head, __ATOMIC_ACQUIRE) >= TK_LOG_RING_SLOTS) { // 缓冲区已满，丢弃而不阻塞
+            __atomic_add_fetch(&ring->dropped, 1, __ATOMIC_RELAXED);
+        } else {
+            rec = &ring->slots[tail & (TK_LOG_RING_SLOTS - 1)];
+            rec->ts_ns = now_ns;
+            rec->format = format;
+            rec->suppressed = suppressed;
+            rec->args_len = pack_log_args(rec->args, format, args);
+            __atomic_store_n(&ring->tail, tail + 1, __ATOMIC_RELEASE);
+        }
+        va_end(args);
+        return;
+    }
+#endif
+    tk_log_write_sync(suppressed, format, args);
+    va_end(args);
+}
+
 // 可选操作，重置线程前缀打印标识字符串
 void reset_debug_prefix(char *prefix) {
     snprintf(prefix_buf, sizeof(prefix_buf), "[T-%s] ", prefix);
-}
\ No newline at end of file
+#ifdef ENABLE_ASYNC_LOG
+    if (tk_my_log_ring) {
+        strlcpy(tk_my_log_ring->prefix, prefix_buf, sizeof(tk_my_log_ring->prefix));
+    }
+#endif
+}
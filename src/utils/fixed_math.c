@@ -0,0 +1,59 @@
+#include "fixed_math.h"
+
+#define DEG_360 TK_FIXED_FROM_INT(360)
+
+// round(sin(i°) * 65536)，i=0~90。常量表而不是启动时用sin()生成，避免依赖libm的实现
+static const tk_fixed_t tk_fixed_sin_table[91] = {
+    0, 1144, 2287, 3430, 4572, 5712, 6850, 7987, 9121, 10252,
+    11380, 12505, 13626, 14742, 15855, 16962, 18064, 19161, 20252, 21336,
+    22415, 23486, 24550, 25607, 26656, 27697, 28729, 29753, 30767, 31772,
+    32768, 33754, 34729, 35693, 36647, 37590, 38521, 39441, 40348, 41243,
+    42126, 42995, 43852, 44695, 45525, 46341, 47143, 47930, 48703, 49461,
+    50203, 50931, 51643, 52339, 53020, 53684, 54332, 54963, 55578, 56175,
+    56756, 57319, 57865, 58393, 58903, 59396, 59870, 60326, 60764, 61183,
+    61584, 61966, 62328, 62672, 62997, 63303, 63589, 63856, 64104, 64332,
+    64540, 64729, 64898, 65048, 65177, 65287, 65376, 65446, 65496, 65526,
+    65536,
+};
+
+// deg∈[0°,90°]
+static tk_fixed_t sin_first_quadrant(tk_fixed_t deg) {
+    int32_t index = deg >> TK_FIXED_SHIFT;
+    int32_t frac = deg & (TK_FIXED_ONE - 1);
+    tk_fixed_t lo = tk_fixed_sin_table[index];
+
+    if (frac == 0) {
+        return lo;
+    }
+    return lo + (tk_fixed_t)(((int64_t)(tk_fixed_sin_table[index + 1] - lo) * frac) >> TK_FIXED_SHIFT);
+}
+
+tk_fixed_t tk_fixed_sin_deg(tk_fixed_t deg) {
+    deg %= DEG_360;
+    if (deg < 0) {
+        deg += DEG_360;
+    }
+    if (deg <= TK_FIXED_FROM_INT(90)) {
+        return sin_first_quadrant(deg);
+    } else if (deg <= TK_FIXED_FROM_INT(180)) {
+        return sin_first_quadrant(TK_FIXED_FROM_INT(180) - deg);
+    } else if (deg <= TK_FIXED_FROM_INT(270)) {
+        return -sin_first_quadrant(deg - TK_FIXED_FROM_INT(180));
+    }
+    return -sin_first_quadrant(DEG_360 - deg);
+}
+
+tk_fixed_t tk_fixed_cos_deg(tk_fixed_t deg) {
+    return tk_fixed_sin_deg((deg % DEG_360) + TK_FIXED_FROM_INT(90));
+}
+
+tk_fixed_t tk_fixed_tan_deg(tk_fixed_t deg) {
+    tk_fixed_t c = tk_fixed_cos_deg(deg);
+    int64_t t = 0;
+
+    if (c == 0) {
+        return TK_FIXED_INFINITY;
+    }
+    t = ((int64_t)tk_fixed_sin_deg(deg) * TK_FIXED_ONE) / c;
+    return (t > INT32_MAX) ? INT32_MAX : ((t < -INT32_MAX) ? -INT32_MAX : (tk_fixed_t)t); // 接近90°时饱和
+}
@@ -0,0 +1,93 @@
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#include <errno.h>
+#include "frame_pacer.h"
+#include "tools.h"
+#include "debug.h"
+
+void frame_pacer_init(FramePacer *pacer, tk_uint32_t target_fps, tk_uint8_t vsync) {
+    memset(pacer, 0, sizeof(*pacer));
+    pacer->vsync = vsync;
+    frame_pacer_set_target_fps(pacer, target_fps);
+    pacer->start_ns = tk_get_monotonic_ns();
+    pacer->next_deadline_ns = pacer->start_ns + pacer->frame_ns;
+}
+
+void frame_pacer_set_target_fps(FramePacer *pacer, tk_uint32_t target_fps) {
+    if (target_fps == 0) {
+        target_fps = 60;
+    }
+    pacer->target_fps = target_fps;
+    pacer->frame_ns = 1000000000ULL / target_fps;
+}
+
+void frame_pacer_begin_frame(FramePacer *pacer) {
+    pacer->frame_start_ns = tk_get_monotonic_ns();
+}
+
+static void sleep_until_ns(uint64_t deadline_ns) {
+    struct timespec ts;
+    ts.tv_sec = deadline_ns / 1000000000ULL;
+    ts.tv_nsec = deadline_ns % 1000000000ULL;
+    while (clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &ts, NULL) == EINTR) {
+    }
+}
+
+// 结束一帧：统计本帧耗时，睡眠到下一帧的截止时间。若已错过截止时间则计为丢帧，并从当前时间重新对齐，不追帧
+void frame_pacer_end_frame(FramePacer *pacer) {
+    uint64_t now = tk_get_monotonic_ns();
+
+    pacer->last_frame_cost_ns = now - pacer->frame_start_ns;
+    pacer->total_frame_cost_ns += pacer->last_frame_cost_ns;
+    pacer->max_frame_cost_ns = MAX(pacer->max_frame_cost_ns, pacer->last_frame_cost_ns);
+    pacer->frames++;
+
+    if (pacer->vsync) { // 节奏由显示器刷新率决定，这里只统计明显超出预算（掉了至少半帧）的帧
+        if (pacer->last_frame_cost_ns > pacer->frame_ns + pacer->frame_ns / 2) {
+            pacer->missed_frames++;
+        }
+        return;
+    }
+    if (now > pacer->next_deadline_ns) {
+        pacer->missed_frames++;
+        pacer->next_deadline_ns = now + pacer->frame_ns;
+        return;
+    }
+    sleep_until_ns(pacer->next_deadline_ns);
+    pacer->next_deadline_ns += pacer->frame_ns;
+}
+
+// 空闲模式（暂停/失去焦点）期间不调用begin/end，恢复时从当前时间重新对齐截止时间，空闲时长不算丢帧
+void frame_pacer_pause(FramePacer *pacer) {
+    if (!pacer->idle_start_ns) {
+        pacer->idle_start_ns = tk_get_monotonic_ns();
+    }
+}
+
+void frame_pacer_resume(FramePacer *pacer) {
+    uint64_t now = tk_get_monotonic_ns();
+
+    if (pacer->idle_start_ns) {
+        pacer->idle_ns += now - pacer->idle_start_ns;
+        pacer->idle_start_ns = 0;
+    }
+    pacer->next_deadline_ns = now + pacer->frame_ns;
+}
+
+// 渲染时长（不含空闲时长）
+uint64_t frame_pacer_elapsed_ms(FramePacer *pacer) {
+    uint64_t now = tk_get_monotonic_ns();
+    uint64_t idle_ns = pacer->idle_ns + (pacer->idle_start_ns ? now - pacer->idle_start_ns : 0);
+
+    return (now - pacer->start_ns - idle_ns) / 1000000ULL;
+}
+
+void frame_pacer_print_stats(FramePacer *pacer) {
+    uint64_t elapsed_ms = frame_pacer_elapsed_ms(pacer);
+    uint64_t idle_ms = (pacer->idle_ns + (pacer->idle_start_ns ? tk_get_monotonic_ns() - pacer->idle_start_ns : 0)) / 1000000ULL;
+    tk_debug("frame pacer: target %luFPS%s, %lu frames in %lums (avg %.1fFPS, idle %lums), missed %lu, frame cost avg %.2fms max %.2fms\n",
+        pacer->target_fps, pacer->vsync ? "(vsync)" : "", pacer->frames, (unsigned long)elapsed_ms,
+        elapsed_ms ? pacer->frames * 1000.0 / elapsed_ms : 0.0, (unsigned long)idle_ms, pacer->missed_frames,
+        pacer->frames ? pacer->total_frame_cost_ns / 1e6 / pacer->frames : 0.0, pacer->max_frame_cost_ns / 1e6);
+}
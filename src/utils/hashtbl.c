@@ -31,36 +31,121 @@ hashtbl_t *hashtbl_init(int log_size, int obj_offset, int auto_grow)
 	hashtbl->auto_grow = (auto_grow) ? 1 : 0;
 	hashtbl->obj_offset = obj_offset;
 	hashtbl->num_items = 0;
+	hashtbl->old_tbl = NULL;
+	hashtbl->old_log_size = 0;
+	hashtbl->traversing = 0;
+	hashtbl->rehash_idx = 0;
+	hashtbl->grow_num = 0;
 
 	return hashtbl;
 }
 
-int hashtbl_insert(hashtbl_t *hashtbl, int key, void *obj)
+/*返回key所在桶的链表头指针的地址：旧桶尚未迁移时元素仍在旧桶中，否则在新桶中*/
+static hashtbl_link_t **hashtbl_bucket(hashtbl_t *hashtbl, int key)
 {
-	int idx = key & ((1 << hashtbl->log_size) - 1);
-	hashtbl_link_t *head = hashtbl->tbl[idx];
-	hashtbl_link_t *link = OBJ2LINK(hashtbl, obj);
+	tk_uint32_t old_idx;
+
+	if (hashtbl->old_tbl) {
+		old_idx = key & ((1 << hashtbl->old_log_size) - 1);
+		if (old_idx >= hashtbl->rehash_idx)
+			return &hashtbl->old_tbl[old_idx];
+	}
+	return &hashtbl->tbl[key & ((1 << hashtbl->log_size) - 1)];
+}
+
+static void hashtbl_link_push(hashtbl_link_t **bucket, hashtbl_link_t *link)
+{
+	hashtbl_link_t *head = *bucket;
 
 	link->next = head;
 	if (head)
 		head->prev = link;
 	link->prev = NULL;
+	*bucket = link;
+}
+
+/*迁移最多steps个旧桶（空桶也计数，但允许多跳过一些空桶），全部迁移完成后释放旧桶数组*/
+static void hashtbl_rehash_step(hashtbl_t *hashtbl, int steps)
+{
+	tk_uint32_t old_bucket_num;
+	int empty_visits = steps * 10;
+	hashtbl_link_t *link, *next;
+
+	if (!hashtbl->old_tbl || hashtbl->traversing)
+		return;
+
+	old_bucket_num = (1 << hashtbl->old_log_size);
+	while (steps > 0 && hashtbl->rehash_idx < old_bucket_num) {
+		link = hashtbl->old_tbl[hashtbl->rehash_idx];
+		if (!link) {
+			hashtbl->rehash_idx++;
+			if (--empty_visits <= 0)
+				break;
+			continue;
+		}
+		while (link) {
+			next = link->next;
+			hashtbl_link_push(&hashtbl->tbl[link->hash_value & ((1 << hashtbl->log_size) - 1)], link);
+			link = next;
+		}
+		hashtbl->old_tbl[hashtbl->rehash_idx++] = NULL;
+		steps--;
+	}
+
+	if (hashtbl->rehash_idx >= old_bucket_num) {
+		free(hashtbl->old_tbl);
+		hashtbl->old_tbl = NULL;
+		hashtbl->rehash_idx = 0;
+	}
+}
+
+/*负载因子超过1时桶数组翻倍，旧桶在后续操作中逐步迁移，单次操作的耗时始终有上界*/
+static void hashtbl_try_grow(hashtbl_t *hashtbl)
+{
+	hashtbl_link_t **new_tbl;
+	int new_log_size = hashtbl->log_size + 1;
+
+	if (!hashtbl->auto_grow || hashtbl->old_tbl || hashtbl->traversing)
+		return;
+	if (hashtbl->num_items <= (1 << hashtbl->log_size) || new_log_size > HASHTBL_MAX_LOG_SIZE)
+		return;
+
+	new_tbl = (hashtbl_link_t **)calloc((size_t)1 << new_log_size, sizeof(hashtbl_link_t *));
+	if (!new_tbl)
+		return; /*扩容失败不影响正确性，只是链变长*/
+
+	hashtbl->old_tbl = hashtbl->tbl;
+	hashtbl->old_log_size = hashtbl->log_size;
+	hashtbl->rehash_idx = 0;
+	hashtbl->tbl = new_tbl;
+	hashtbl->log_size = new_log_size;
+	hashtbl->grow_num++;
+}
+
+int hashtbl_insert(hashtbl_t *hashtbl, int key, void *obj)
+{
+	hashtbl_link_t *link = OBJ2LINK(hashtbl, obj);
+
+	hashtbl_rehash_step(hashtbl, HASHTBL_REHASH_STEP);
 	link->hash_value = key;
-	hashtbl->tbl[idx] = link;
+	hashtbl_link_push(hashtbl_bucket(hashtbl, key), link);
 	hashtbl->num_items++;
+	hashtbl_try_grow(hashtbl);
 
 	return 0;
 }
 
 int hashtbl_remove(hashtbl_t *hashtbl, int key, void *obj)
 {
-	int idx = key & ((1 << hashtbl->log_size) - 1);
-	hashtbl_link_t *head = hashtbl->tbl[idx];
+	hashtbl_link_t **bucket;
 	hashtbl_link_t *link = OBJ2LINK(hashtbl, obj);
 	hashtbl_link_t *iter;
 
+	hashtbl_rehash_step(hashtbl, HASHTBL_REHASH_STEP);
+	bucket = hashtbl_bucket(hashtbl, key);
+
 	/*Check if it's in hash table*/
-	for (iter = head; iter; iter = iter->next) {
+	for (iter = *bucket; iter; iter = iter->next) {
 		if (iter == link)
 			break;
 	}
@@ -73,8 +158,8 @@ int hashtbl_remove(hashtbl_t *hashtbl, int key, void *obj)
 	if (link->prev) {
 		link->prev->next = link->next;
 	}
-	if (link == head) {
-		hashtbl->tbl[idx] = link->next;
+	if (link == *bucket) {
+		*bucket = link->next;
 	}
 
 	link->next = link->prev = NULL;
@@ -84,11 +169,10 @@ int hashtbl_remove(hashtbl_t *hashtbl, int key, void *obj)
 
 void *hashtbl_find(hashtbl_t *hashtbl, void *target_obj, int key, hashtbl_comp_func func)
 {
-	int idx = key & ((1 << hashtbl->log_size) - 1);
-	hashtbl_link_t *head = hashtbl->tbl[idx];
 	hashtbl_link_t *iter;
 
-	for (iter = head; iter; iter = iter->next) {
+	/*只读：不做rehash迁移，旧桶由insert/remove逐步迁移*/
+	for (iter = *hashtbl_bucket(hashtbl, key); iter; iter = iter->next) {
 		if (iter->hash_value != key)
 			continue;
 		if ((func)(LINK2OBJ(hashtbl, iter), target_obj))
@@ -97,19 +181,15 @@ void *hashtbl_find(hashtbl_t *hashtbl, void *target_obj, int key, hashtbl_comp_f
 	return NULL;
 }
 
-int hashtbl_free_all_objects(hashtbl_t *hashtbl, hashtbl_traverse_func func, void *args)
+static void hashtbl_free_bucket_array(hashtbl_t *hashtbl, hashtbl_link_t **tbl, tk_uint32_t start,
+	tk_uint32_t bucket_num, hashtbl_traverse_func func, void *args)
 {
-	if (NULL == hashtbl || (hashtbl->num_items == 0)) {
-		return 0;
-	}
-
 	hashtbl_link_t *head = NULL;
 	hashtbl_link_t *next = NULL;
-	tk_uint32_t bucket_num = (1 << hashtbl->log_size);
 	tk_uint32_t i = 0;
 
-	for (i = 0; i < bucket_num; i++) {
-		head = hashtbl->tbl[i];
+	for (i = start; i < bucket_num; i++) {
+		head = tbl[i];
 		if (NULL == head) {
 			continue;
 		}
@@ -121,8 +201,31 @@ int hashtbl_free_all_objects(hashtbl_t *hashtbl, hashtbl_traverse_func func, voi
 			}
 			head = next;
 		}
-		hashtbl->tbl[i] = NULL;
+		tbl[i] = NULL;
+	}
+}
+
+static void hashtbl_drop_old_tbl(hashtbl_t *hashtbl)
+{
+	free(hashtbl->old_tbl);
+	hashtbl->old_tbl = NULL;
+	hashtbl->rehash_idx = 0;
+}
+
+int hashtbl_free_all_objects(hashtbl_t *hashtbl, hashtbl_traverse_func func, void *args)
+{
+	if (NULL == hashtbl || (hashtbl->num_items == 0)) {
+		return 0;
+	}
+
+	hashtbl->traversing++;
+	if (hashtbl->old_tbl) {
+		hashtbl_free_bucket_array(hashtbl, hashtbl->old_tbl, hashtbl->rehash_idx,
+			(1 << hashtbl->old_log_size), func, args);
 	}
+	hashtbl_free_bucket_array(hashtbl, hashtbl->tbl, 0, (1 << hashtbl->log_size), func, args);
+	hashtbl->traversing--;
+	hashtbl_drop_old_tbl(hashtbl);
 
 	hashtbl->num_items = 0;
 
@@ -131,6 +234,7 @@ int hashtbl_free_all_objects(hashtbl_t *hashtbl, hashtbl_traverse_func func, voi
 
 int hashtbl_destroy(hashtbl_t *hashtbl)
 {
+	free(hashtbl->old_tbl);
 	free(hashtbl->tbl);
 	free(hashtbl);
 	return 0;
@@ -138,64 +242,132 @@ int hashtbl_destroy(hashtbl_t *hashtbl)
 
 int hashtbl_reset(hashtbl_t *hashtbl)
 {
+	hashtbl_drop_old_tbl(hashtbl);
 	memset(hashtbl->tbl, 0, sizeof(hashtbl_link_t *) * (1 << hashtbl->log_size));
 	hashtbl->num_items = 0;
 	return 0;
 }
 
-int hashtbl_traverse_each(hashtbl_t *hashtbl, hashtbl_traverse_func func, void *args)
+static int hashtbl_traverse_bucket_array(hashtbl_t *hashtbl, hashtbl_link_t **tbl, tk_uint32_t start,
+	tk_uint32_t bucket_num, hashtbl_traverse_func func, void *args)
 {
-	if (NULL == hashtbl || NULL == func || (hashtbl->num_items == 0)) {
-		return 0;
-	}
-
 	hashtbl_link_t *head = NULL;
 	hashtbl_link_t *iter = NULL;
-	tk_uint32_t bucket_num = (1 << hashtbl->log_size);
 	tk_uint32_t i = 0;
 
-	for (i = 0; i < bucket_num; i++) {
-		head = hashtbl->tbl[i];
+	for (i = start; i < bucket_num; i++) {
+		head = tbl[i];
 		if (NULL == head) {
 			continue;
 		}
 
 		for (iter = head; iter; iter = iter->next) {
-			if (func) {
-				if ((func)(LINK2OBJ(hashtbl, iter), args))
-					return -1;
-			}
+			if ((func)(LINK2OBJ(hashtbl, iter), args))
+				return -1;
 		}
 	}
-
 	return 0;
 }
 
-int hashtbl_traverse_each_safe(hashtbl_t *hashtbl, hashtbl_traverse_func func, void *args)
+int hashtbl_traverse_each(hashtbl_t *hashtbl, hashtbl_traverse_func func, void *args)
 {
+	int ret = 0;
+
 	if (NULL == hashtbl || NULL == func || (hashtbl->num_items == 0)) {
 		return 0;
 	}
 
+	hashtbl->traversing++;
+	if (hashtbl->old_tbl) {
+		ret = hashtbl_traverse_bucket_array(hashtbl, hashtbl->old_tbl, hashtbl->rehash_idx,
+			(1 << hashtbl->old_log_size), func, args);
+	}
+	if (0 == ret) {
+		ret = hashtbl_traverse_bucket_array(hashtbl, hashtbl->tbl, 0, (1 << hashtbl->log_size), func, args);
+	}
+	hashtbl->traversing--;
+
+	return ret;
+}
+
+static void hashtbl_traverse_bucket_array_safe(hashtbl_t *hashtbl, hashtbl_link_t **tbl, tk_uint32_t start,
+	tk_uint32_t bucket_num, hashtbl_traverse_func func, void *args)
+{
 	hashtbl_link_t *head = NULL;
 	hashtbl_link_t *next = NULL;
-	tk_uint32_t bucket_num = (1 << hashtbl->log_size);
 	tk_uint32_t i = 0;
 
-	for (i = 0; i < bucket_num; i++) {
-		head = hashtbl->tbl[i];
+	for (i = start; i < bucket_num; i++) {
+		head = tbl[i];
 		if (NULL == head) {
 			continue;
 		}
 
 		while (head) {
 			next = head->next;
-			if (func) {
-				(func)(LINK2OBJ(hashtbl, head), args);
-			}
+			(func)(LINK2OBJ(hashtbl, head), args);
 			head = next;
 		}
 	}
+}
+
+int hashtbl_traverse_each_safe(hashtbl_t *hashtbl, hashtbl_traverse_func func, void *args)
+{
+	if (NULL == hashtbl || NULL == func || (hashtbl->num_items == 0)) {
+		return 0;
+	}
+
+	hashtbl->traversing++;
+	if (hashtbl->old_tbl) {
+		hashtbl_traverse_bucket_array_safe(hashtbl, hashtbl->old_tbl, hashtbl->rehash_idx,
+			(1 << hashtbl->old_log_size), func, args);
+	}
+	hashtbl_traverse_bucket_array_safe(hashtbl, hashtbl->tbl, 0, (1 << hashtbl->log_size), func, args);
+	hashtbl->traversing--;
 
 	return 0;
-}
\ No newline at end of file
+}
+
+static void hashtbl_collect_chain_stats(hashtbl_link_t **tbl, tk_uint32_t start, tk_uint32_t bucket_num,
+	hashtbl_stats_t *stats)
+{
+	hashtbl_link_t *iter = NULL;
+	tk_uint32_t i = 0, len = 0;
+
+	for (i = start; i < bucket_num; i++) {
+		if (NULL == tbl[i]) {
+			continue;
+		}
+		len = 0;
+		for (iter = tbl[i]; iter; iter = iter->next) {
+			len++;
+		}
+		stats->used_bucket_num++;
+		stats->max_chain_len = MAX(stats->max_chain_len, len);
+	}
+}
+
+/*统计负载情况（需遍历所有桶，仅用于调试输出，不要在热路径中调用）*/
+void hashtbl_get_stats(hashtbl_t *hashtbl, hashtbl_stats_t *stats)
+{
+	if (NULL == stats) {
+		return;
+	}
+	memset(stats, 0, sizeof(*stats));
+	if (NULL == hashtbl) {
+		return;
+	}
+
+	stats->num_items = hashtbl->num_items;
+	stats->bucket_num = (1 << hashtbl->log_size);
+	stats->rehashing = (hashtbl->old_tbl != NULL);
+	stats->grow_num = hashtbl->grow_num;
+	stats->load_factor = (float)hashtbl->num_items / stats->bucket_num;
+	if (hashtbl->old_tbl) {
+		hashtbl_collect_chain_stats(hashtbl->old_tbl, hashtbl->rehash_idx, (1 << hashtbl->old_log_size), stats);
+	}
+	hashtbl_collect_chain_stats(hashtbl->tbl, 0, stats->bucket_num, stats);
+	if (stats->used_bucket_num) {
+		stats->avg_chain_len = (float)hashtbl->num_items / stats->used_bucket_num;
+	}
+}
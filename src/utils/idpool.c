@@ -2,29 +2,72 @@
 #include <stdlib.h>
 #include <string.h>
 #include <limits.h>
+#include "global.h"
 #include "idpool.h"
 #include "debug.h"
 
-#define BITS_PER_WORD (sizeof(uint32_t) * CHAR_BIT)
+#define BITS_PER_WORD (sizeof(uint64_t) * CHAR_BIT)
 #define MIN_ID 1           // 最小ID值
+#define GENERATION_MASK ((1 << (32 - ID_POOL_INDEX_BITS)) - 1)
+#define ID_POOL_MAX_CAPACITY (ID_POOL_MAX_SIZE / BITS_PER_WORD * BITS_PER_WORD)
 
-// 初始化ID池
+#define BITMAP_WORDS(size) ((size) / BITS_PER_WORD)
+#define SUMMARY_WORDS(size) ((BITMAP_WORDS(size) + BITS_PER_WORD - 1) / BITS_PER_WORD)
+
+// 根据一级bitmap重建二级bitmap（仅在创建/扩容时调用），不存在的bitmap word视为已满
+static void id_pool_rebuild_summary(IDPool *pool) {
+    size_t words = BITMAP_WORDS(pool->size);
+    size_t i = 0;
+
+    memset(pool->summary, 0xFF, SUMMARY_WORDS(pool->size) * sizeof(uint64_t));
+    for (i = 0; i < words; i++) {
+        if (pool->bitmap[i] != UINT64_MAX) {
+            pool->summary[i / BITS_PER_WORD] &= ~(1ULL << (i % BITS_PER_WORD));
+        }
+    }
+}
+
+// 将ID池扩容到new_size（BITS_PER_WORD的整数倍），已分配的ID及其代数保持不变
+static int id_pool_resize(IDPool *pool, size_t new_size) {
+    size_t old_size = pool->size;
+    uint64_t *bitmap = NULL, *summary = NULL;
+    uint16_t *generation = NULL;
+    void **objects = NULL;
+
+    bitmap = realloc(pool->bitmap, BITMAP_WORDS(new_size) * sizeof(uint64_t));
+    if (bitmap) pool->bitmap = bitmap;
+    summary = realloc(pool->summary, SUMMARY_WORDS(new_size) * sizeof(uint64_t));
+    if (summary) pool->summary = summary;
+    generation = realloc(pool->generation, new_size * sizeof(uint16_t));
+    if (generation) pool->generation = generation;
+    objects = realloc(pool->objects, new_size * sizeof(void *));
+    if (objects) pool->objects = objects;
+    if (!bitmap || !summary || !generation || !objects) {
+        return -1; // 已经realloc成功的数组比原来大，保持pool->size不变即可，不影响使用
+    }
+
+    memset(pool->bitmap + BITMAP_WORDS(old_size), 0, (BITMAP_WORDS(new_size) - BITMAP_WORDS(old_size)) * sizeof(uint64_t));
+    memset(pool->generation + old_size, 0, (new_size - old_size) * sizeof(uint16_t));
+    memset(pool->objects + old_size, 0, (new_size - old_size) * sizeof(void *));
+    pool->size = new_size;
+    pool->max_id = new_size - MIN_ID + 1;
+    id_pool_rebuild_summary(pool);
+    return 0;
+}
+
+// 初始化ID池(大小向上取整到64的倍数)
 IDPool* id_pool_create(size_t max_id) {
     if (max_id < MIN_ID) max_id = MIN_ID;
     
     IDPool *pool = (IDPool*)malloc(sizeof(IDPool));
     if (!pool) return NULL;
-    
-    pool->max_id = max_id;
-    pool->size = max_id - MIN_ID + 1;  // 实际需要管理的ID范围
-    pool->last_alloc_pos = 0;
-    
-    // 计算需要的bitmap数组大小
-    size_t bitmap_size = (pool->size + BITS_PER_WORD - 1) / BITS_PER_WORD;
-    pool->bitmap = (uint32_t*)calloc(bitmap_size, sizeof(uint32_t));
-    
-    if (!pool->bitmap) {
-        free(pool);
+    memset(pool, 0, sizeof(*pool));
+
+    size_t size = max_id - MIN_ID + 1;  // 实际需要管理的ID范围
+    size = (size + BITS_PER_WORD - 1) / BITS_PER_WORD * BITS_PER_WORD;
+    size = MIN(size, ID_POOL_MAX_CAPACITY);
+    if (id_pool_resize(pool, size) != 0) {
+        id_pool_destroy(pool);
         return NULL;
     }
     
@@ -35,67 +78,148 @@ IDPool* id_pool_create(size_t max_id) {
 void id_pool_destroy(IDPool *pool) {
     if (pool) {
         free(pool->bitmap);
+        free(pool->summary);
+        free(pool->generation);
+        free(pool->objects);
         free(pool);
     }
 }
 
-// 分配一个ID (返回值为MIN_ID到max_id)
+// 分配一个ID (返回值为MIN_ID到max_id)，优先复用最小的空闲ID。通过二级bitmap直接定位有空位的word，word内用ctz取空位
 int id_pool_allocate(IDPool *pool) {
     if (!pool) return 0;  // 返回0表示失败
-    
-    size_t bitmap_size = (pool->size + BITS_PER_WORD - 1) / BITS_PER_WORD;
-    size_t start_word = pool->last_alloc_pos / BITS_PER_WORD;
-    
-    // 从上次分配位置开始查找空闲ID
-    for (size_t i = 0; i < bitmap_size; i++) {
-        size_t word_idx = (start_word + i) % bitmap_size;
-        uint32_t word = pool->bitmap[word_idx];
-        
-        // 如果当前word有空闲位
-        if (word != UINT32_MAX) {
-            // 查找第一个为0的位
-            for (size_t bit = 0; bit < BITS_PER_WORD; bit++) {
-                size_t pos = word_idx * BITS_PER_WORD + bit;
-                if (pos >= pool->size) break;  // 超出范围
-                
-                if (!(word & (1 << bit))) {
-                    pool->bitmap[word_idx] |= (1 << bit);
-                    pool->last_alloc_pos = pos;
-                    return (int)(pos + MIN_ID);  // 转换为实际ID
-                }
-            }
+
+    size_t summary_words = 0;
+    size_t i = 0, word_idx = 0, pos = 0;
+
+retry:
+    summary_words = SUMMARY_WORDS(pool->size);
+    for (i = 0; i < summary_words; i++) {
+        if (pool->summary[i] == UINT64_MAX) {
+            continue;
+        }
+        word_idx = i * BITS_PER_WORD + __builtin_ctzll(~pool->summary[i]);
+        pos = word_idx * BITS_PER_WORD + __builtin_ctzll(~pool->bitmap[word_idx]);
+        pool->bitmap[word_idx] |= (1ULL << (pos % BITS_PER_WORD));
+        if (pool->bitmap[word_idx] == UINT64_MAX) {
+            pool->summary[i] |= (1ULL << (word_idx % BITS_PER_WORD));
         }
+        pool->used++;
+        return (int)(pos + MIN_ID);  // 转换为实际ID
+    }
+
+    // ID池已满，扩容一倍后重试
+    if ((pool->size < ID_POOL_MAX_CAPACITY) && (id_pool_resize(pool, MIN(pool->size * 2, ID_POOL_MAX_CAPACITY)) == 0)) {
+        tk_debug("ID pool grows to %zu\n", pool->size);
+        goto retry;
     }
-    
     return 0;  // 没有可用ID
 }
 
-// 释放一个ID
+// 释放一个ID，其代数加1使之前的句柄失效
 void id_pool_release(IDPool *pool, int id) {
     if (!pool || id < MIN_ID || id > pool->max_id) return;
     
     size_t pos = (size_t)(id - MIN_ID);
     size_t word_idx = pos / BITS_PER_WORD;
-    size_t bit = pos % BITS_PER_WORD;
-    
-    pool->bitmap[word_idx] &= ~(1 << bit);
+    uint64_t bit = 1ULL << (pos % BITS_PER_WORD);
+
+    if (!(pool->bitmap[word_idx] & bit)) {
+        return; // 重复释放
+    }
+    pool->bitmap[word_idx] &= ~bit;
+    pool->summary[word_idx / BITS_PER_WORD] &= ~(1ULL << (word_idx % BITS_PER_WORD));
+    pool->generation[pos] = (pool->generation[pos] + 1) & GENERATION_MASK;
+    pool->objects[pos] = NULL;
+    pool->used--;
+}
+
+// 分配一个ID并关联对象，返回带代数的句柄（0表示失败）
+id_handle_t id_pool_allocate_handle(IDPool *pool, void *obj) {
+    int id = id_pool_allocate(pool);
+    if (!id) return 0;
+
+    pool->objects[id - MIN_ID] = obj;
+    return MAKE_HANDLE(id, pool->generation[id - MIN_ID]);
+}
+
+// 释放句柄对应的ID，句柄已失效（对象早已释放、ID可能已被复用）时什么也不做
+void id_pool_release_handle(IDPool *pool, id_handle_t handle) {
+    if (id_pool_lookup(pool, handle)) {
+        id_pool_release(pool, HANDLE2ID(handle));
+    }
+}
+
+// 根据句柄查找对象，句柄已失效时返回NULL
+void *id_pool_lookup(IDPool *pool, id_handle_t handle) {
+    int id = HANDLE2ID(handle);
+    if (!pool || id < MIN_ID || id > pool->max_id) return NULL;
+
+    size_t pos = (size_t)(id - MIN_ID);
+    if (!(pool->bitmap[pos / BITS_PER_WORD] & (1ULL << (pos % BITS_PER_WORD)))) {
+        return NULL;
+    }
+    if (pool->generation[pos] != HANDLE2GEN(handle)) {
+        return NULL;
+    }
+    return pool->objects[pos];
 }
 
 // 打印ID池状态(调试用)
 void id_pool_print(IDPool *pool) {
     if (!pool) return;
     
-    tk_debug("ID Pool Status (Range: %d-%d):\n", MIN_ID, pool->max_id);
+    tk_debug("ID Pool Status (Range: %d-%d, used %zu):\n", MIN_ID, pool->max_id, pool->used);
     for (size_t i = 0; i < pool->size; i++) {
         size_t word_idx = i / BITS_PER_WORD;
         size_t bit = i % BITS_PER_WORD;
         
         if (i % 64 == 0) printf("\n%04zu: ", i + MIN_ID);
-        printf("%d", (pool->bitmap[word_idx] & (1 << bit)) ? 1 : 0);
+        printf("%d", (pool->bitmap[word_idx] & (1ULL << bit)) ? 1 : 0);
     }
     printf("\n");
 }
 
+// 检查点（见game_checkpoint_save()）：池的大小与各数组原样拷贝，ID池只会扩容，恢复时当前的数组不会比保存时小
+size_t id_pool_checkpoint_size(const IDPool *pool) {
+    return sizeof(pool->size) + sizeof(pool->used) + (BITMAP_WORDS(pool->size) + SUMMARY_WORDS(pool->size)) * sizeof(uint64_t) +
+        pool->size * (sizeof(uint16_t) + sizeof(void *));
+}
+
+void id_pool_checkpoint_save(const IDPool *pool, void *buf) {
+    uint8_t *p = (uint8_t *)buf;
+
+#define ID_POOL_PUT(src, len) do { memcpy(p, (src), (len)); p += (len); } while (0)
+    ID_POOL_PUT(&pool->size, sizeof(pool->size));
+    ID_POOL_PUT(&pool->used, sizeof(pool->used));
+    ID_POOL_PUT(pool->bitmap, BITMAP_WORDS(pool->size) * sizeof(uint64_t));
+    ID_POOL_PUT(pool->summary, SUMMARY_WORDS(pool->size) * sizeof(uint64_t));
+    ID_POOL_PUT(pool->generation, pool->size * sizeof(uint16_t));
+    ID_POOL_PUT(pool->objects, pool->size * sizeof(void *));
+#undef ID_POOL_PUT
+}
+
+int id_pool_checkpoint_restore(IDPool *pool, const void *buf) {
+    const uint8_t *p = (const uint8_t *)buf;
+    size_t size = 0;
+
+    memcpy(&size, p, sizeof(size));
+    if (size > pool->size) {
+        tk_debug("Error: %s checkpoint of %zu ids does not fit the pool(%zu)\n", __func__, size, pool->size);
+        return -1;
+    }
+#define ID_POOL_GET(dst, len) do { memcpy((dst), p, (len)); p += (len); } while (0)
+    ID_POOL_GET(&pool->size, sizeof(pool->size)); // 之后扩容时id_pool_resize()会清零超出部分
+    ID_POOL_GET(&pool->used, sizeof(pool->used));
+    ID_POOL_GET(pool->bitmap, BITMAP_WORDS(size) * sizeof(uint64_t));
+    ID_POOL_GET(pool->summary, SUMMARY_WORDS(size) * sizeof(uint64_t));
+    ID_POOL_GET(pool->generation, size * sizeof(uint16_t));
+    ID_POOL_GET(pool->objects, size * sizeof(void *));
+#undef ID_POOL_GET
+    pool->max_id = size - MIN_ID + 1;
+    return 0;
+}
+
 #if 0
 // 示例用法
 int main() {
@@ -115,6 +239,12 @@ int main() {
     // 再次分配应该会重用id2
     int id4 = id_pool_allocate(pool);
     printf("Allocated new ID: %d (should be same as released ID %d)\n", id4, id2);
+
+    // 句柄：ID被复用后旧句柄失效
+    id_handle_t h1 = id_pool_allocate_handle(pool, &id1);
+    id_pool_release_handle(pool, h1);
+    id_handle_t h2 = id_pool_allocate_handle(pool, &id2);
+    printf("stale handle %#x -> %p, new handle %#x -> %p\n", h1, id_pool_lookup(pool, h1), h2, id_pool_lookup(pool, h2));
     
     // 打印池状态
     id_pool_print(pool);
@@ -4,6 +4,7 @@
 #include <time.h>
 #include "maze.h"
 #include "debug.h"
+#include "tools.h"
 
 // 方向数组：上、左、下、右
 static const int dx[] = {0, -1, 0, 1};
@@ -46,10 +47,24 @@ int is_two_grids_adjacent(Grid *g1, Grid *g2) {
     return MAZE_UNRELATED_GRID; // can't be here
 }
 
+// g2相对于g1的方向（方向数组下标），非上下左右相邻返回-1
+static int grid_direction(Grid *g1, Grid *g2) {
+    for (int i = 0; i < 4; i++) {
+        if ((g2->x - g1->x == dx[i]) && (g2->y - g1->y == dy[i])) {
+            return i;
+        }
+    }
+    return -1;
+}
+
 // 判断两个网格之间是否打通（调用者自己应确保输入的两个网格是上下左右相邻的：is_two_grids_adjacent return MAZE_ADJACENT_GRID。
 // 因为对于非上下左右相邻的网格，没有“打通”这一说）
 int is_two_grids_connected(Maze* maze, Grid *g1, Grid *g2) {
-    return maze->map[grid_id(g1)][grid_id(g2)];
+    int dir = grid_direction(g1, g2);
+    if (dir < 0) {
+        return 0;
+    }
+    return (maze->open[grid_id(g1)] >> dir) & 1;
 }
 
 int is_two_grids_the_same(Grid *g1, Grid *g2) {
@@ -57,19 +72,19 @@ int is_two_grids_the_same(Grid *g1, Grid *g2) {
 }
 
 // 生成随机数
-int get_random_number(int min, int max) {
-    return rand() % (max - min + 1) + min;
+static int get_random_number(uint32_t *rng, int min, int max) {
+    return tk_rand_r(rng) % (max - min + 1) + min;
 }
 
 // 初始化迷宫
 void maze_init(Maze* maze) {
-    memset(maze->map, 0, sizeof(maze->map));
+    memset(maze->open, 0, sizeof(maze->open));
     memset(maze->vis, 0, sizeof(maze->vis));
 }
 
-// 生成迷宫（Prim遍历墙算法）
-void maze_generate(Maze* maze) {
-    srand(time(NULL));
+// 生成迷宫（Prim遍历墙算法），相同的种子生成相同的地图
+void maze_generate(Maze* maze, uint32_t seed) {
+    uint32_t rng = tk_rand_seed(seed);
     maze_init(maze);
     
     Wall* walls = malloc(sizeof(Wall) * HORIZON_GRID_NUMBER * VERTICAL_GRID_NUMBER * 4); // 候选墙列表
@@ -81,7 +96,7 @@ void maze_generate(Maze* maze) {
     
     while (wall_count > 0) {
         // 从候选墙列表中随机选择一堵墙来打通
-        int n = get_random_number(0, wall_count - 1);
+        int n = get_random_number(&rng, 0, wall_count - 1);
         Wall wall = walls[n];
 
         // 并从候选墙列表中移除所选的这堵墙
@@ -92,7 +107,9 @@ void maze_generate(Maze* maze) {
             // 打通两个网格
             int id1 = grid_id(&wall.first); // 第i列第j行网格的id为：i + HORIZON_GRID_NUMBER*j，譬如5行3列的地图，总计15个网格，第1行1列的网格就是第0个网格，最后一行最后一列的网格就是第14个网格
             int id2 = grid_id(&wall.second);
-            maze->map[id1][id2] = maze->map[id2][id1] = 1; // map数组标识的含义是：任意相邻两个网格之间是否打通，譬如map[m][n]=1表示第m个网格和第n个网格之间已被打通，但注意只能记录和查询上下左右相邻网格之间的打通状态
+            int dir = grid_direction(&wall.first, &wall.second);
+            maze->open[id1] |= 1 << dir; // open数组标识的含义是：每个网格朝上下左右哪些方向已被打通，两侧网格各记一次，查询见is_two_grids_connected()
+            maze->open[id2] |= 1 << ((dir + 2) % 4); // 方向数组中相反方向的下标相差2
             
             maze->vis[wall.second.x][wall.second.y] = 1;
             
@@ -109,10 +126,8 @@ void maze_generate(Maze* maze) {
                 if (maze->vis[nx][ny]) continue; // 如果墙壁对应的网格已访问过，则该墙壁不能再放入候选列表
                 
                 Grid next = {nx, ny};
-                int current_id = grid_id(&wall.second);
-                int next_id = grid_id(&next);
                 
-                if (maze->map[current_id][next_id] == 0) {
+                if (!is_two_grids_connected(maze, &wall.second, &next)) {
                     walls[wall_count++] = (Wall){wall.second, next};
                 }
             }
@@ -131,7 +146,7 @@ Block* get_block_positions(Maze* maze, tk_uint16_t* block_count) {
         for (int x = 0; x < HORIZON_GRID_NUMBER - 1; x++) {
             Grid g1 = {x, y};
             Grid g2 = {x + 1, y};
-            if (maze->map[grid_id(&g1)][grid_id(&g2)] == 0) {
+            if (!is_two_grids_connected(maze, &g1, &g2)) {
                 blocks[*block_count].start = (Vec){(x + 1) * GRID_SIZE, y * GRID_SIZE};
                 blocks[*block_count].end = (Vec){(x + 1) * GRID_SIZE, (y + 1) * GRID_SIZE};
                 (*block_count)++;
@@ -144,7 +159,7 @@ Block* get_block_positions(Maze* maze, tk_uint16_t* block_count) {
         for (int y = 0; y < VERTICAL_GRID_NUMBER - 1; y++) {
             Grid g1 = {x, y};
             Grid g2 = {x, y + 1};
-            if (maze->map[grid_id(&g1)][grid_id(&g2)] == 0) {
+            if (!is_two_grids_connected(maze, &g1, &g2)) {
                 blocks[*block_count].start = (Vec){x * GRID_SIZE, (y + 1) * GRID_SIZE};
                 blocks[*block_count].end = (Vec){(x + 1) * GRID_SIZE, (y + 1) * GRID_SIZE};
                 (*block_count)++;
@@ -191,7 +206,7 @@ void print_maze_walls(Maze* maze) {
             // 打印右侧垂直墙
             if (x < HORIZON_GRID_NUMBER - 1) {
                 Grid right = {x + 1, y};
-                printf("%s", maze->map[grid_id(&current)][grid_id(&right)] ? " " : "|");
+                printf("%s", is_two_grids_connected(maze, &current, &right) ? " " : "|");
             } else {
                 printf("|");
             }
@@ -204,7 +219,7 @@ void print_maze_walls(Maze* maze) {
             for (int x = 0; x < HORIZON_GRID_NUMBER; x++) {
                 Grid current = {x, y};
                 Grid below = {x, y + 1};
-                printf("%s", maze->map[grid_id(&current)][grid_id(&below)] ? "   " : "---");
+                printf("%s", is_two_grids_connected(maze, &current, &below) ? "   " : "---");
                 printf("+");
             }
             printf("\n");
@@ -246,7 +261,7 @@ void bfs_shortest_path_search(void *maze_path_bfs_search_manager) {
         current = manager->bfs_queue[manager->front++];
         if (is_two_grids_the_same(&current->current, &manager->end)) {
             manager->success = 1;
-            if (!is_two_grids_the_same(&manager->start, &manager->end)) {
+            if (DEBUG_BFS_SEARCH_PATH && !is_two_grids_the_same(&manager->start, &manager->end)) {
                 tk_debug("找到BFS最短路径(%d,%d)->(%d,%d)：\n", POS(manager->start), POS(manager->end));
 #if 0
                 next = current->current;
@@ -293,7 +308,7 @@ void bfs_shortest_path_search(void *maze_path_bfs_search_manager) {
 #if 0
 int main() {
     Maze maze;
-    maze_generate(&maze);
+    maze_generate(&maze, time(NULL));
     
     int block_count;
     Block* blocks = get_block_positions(&maze, &block_count);
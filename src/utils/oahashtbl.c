@@ -0,0 +1,308 @@
+#include "oahashtbl.h"
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+#define CTRL_EMPTY   ((tk_int8_t)-128) /*0x80*/
+#define CTRL_DELETED ((tk_int8_t)-2)   /*0xFE*/
+#define IS_FULL(c)   ((c) >= 0)
+
+#define CAPACITY(hashtbl) ((tk_uint32_t)1 << (hashtbl)->log_size)
+#define MAX_LOAD(capacity) ((capacity) - (capacity) / 8)
+
+/*调用者给的key通常已经是哈希值，但低位分布未必均匀（比如djb2截断），再混合一次*/
+static inline uint64_t oa_hash(int key)
+{
+	return (uint64_t)(uint32_t)key * 0x9E3779B97F4A7C15ULL;
+}
+#define H1(hash) ((tk_uint32_t)((hash) >> 7))
+#define H2(hash) ((tk_int8_t)((hash) >> 57)) /*高7位，取值0~127*/
+
+/*一组控制字节中匹配的位置，bit i 对应组内第 i 个槽位*/
+static inline tk_uint32_t group_match(const tk_int8_t *group, tk_int8_t h2)
+{
+#ifdef __SSE2__
+	__m128i ctrl = _mm_loadu_si128((const __m128i *)group);
+	return (tk_uint32_t)_mm_movemask_epi8(_mm_cmpeq_epi8(ctrl, _mm_set1_epi8(h2)));
+#else
+	tk_uint32_t mask = 0;
+	int i;
+	for (i = 0; i < OAHASHTBL_GROUP_WIDTH; i++) {
+		if (group[i] == h2)
+			mask |= (1U << i);
+	}
+	return mask;
+#endif
+}
+
+static inline tk_uint32_t group_match_empty(const tk_int8_t *group)
+{
+	return group_match(group, CTRL_EMPTY);
+}
+
+static inline tk_uint32_t group_match_empty_or_deleted(const tk_int8_t *group)
+{
+#ifdef __SSE2__
+	__m128i ctrl = _mm_loadu_si128((const __m128i *)group);
+	return (tk_uint32_t)_mm_movemask_epi8(_mm_cmpgt_epi8(_mm_set1_epi8(-1), ctrl));
+#else
+	tk_uint32_t mask = 0;
+	int i;
+	for (i = 0; i < OAHASHTBL_GROUP_WIDTH; i++) {
+		if (group[i] < -1)
+			mask |= (1U << i);
+	}
+	return mask;
+#endif
+}
+
+/*设置控制字节，开头一组的控制字节同时写到末尾的镜像区*/
+static inline void set_ctrl(oahashtbl_t *hashtbl, tk_uint32_t idx, tk_int8_t c)
+{
+	hashtbl->ctrl[idx] = c;
+	if (idx < OAHASHTBL_GROUP_WIDTH)
+		hashtbl->ctrl[CAPACITY(hashtbl) + idx] = c;
+}
+
+static int oahashtbl_alloc(oahashtbl_t *hashtbl, int log_size)
+{
+	tk_uint32_t capacity = (tk_uint32_t)1 << log_size;
+
+	hashtbl->ctrl = (tk_int8_t *)malloc(capacity + OAHASHTBL_GROUP_WIDTH);
+	hashtbl->slots = (oahashtbl_slot_t *)malloc(sizeof(oahashtbl_slot_t) * capacity);
+	if (!hashtbl->ctrl || !hashtbl->slots) {
+		free(hashtbl->ctrl);
+		free(hashtbl->slots);
+		hashtbl->ctrl = NULL;
+		hashtbl->slots = NULL;
+		return -1;
+	}
+	memset(hashtbl->ctrl, CTRL_EMPTY, capacity + OAHASHTBL_GROUP_WIDTH);
+	hashtbl->log_size = log_size;
+	hashtbl->num_items = 0;
+	hashtbl->growth_left = MAX_LOAD(capacity);
+	return 0;
+}
+
+oahashtbl_t *oahashtbl_init(int log_size)
+{
+	oahashtbl_t *hashtbl;
+
+	if (log_size < 0 || log_size > OAHASHTBL_MAX_LOG_SIZE) {
+		return NULL;
+	}
+	log_size = MAX(log_size, OAHASHTBL_MIN_LOG_SIZE);
+
+	hashtbl = (oahashtbl_t *)malloc(sizeof(oahashtbl_t));
+	if (!hashtbl) {
+		return NULL;
+	}
+	memset(hashtbl, 0, sizeof(*hashtbl));
+	if (oahashtbl_alloc(hashtbl, log_size) < 0) {
+		free(hashtbl);
+		return NULL;
+	}
+
+	return hashtbl;
+}
+
+/*在探测序列上找第一个空槽或墓碑（不检查重复，调用者保证有可用额度）*/
+static tk_uint32_t find_insert_slot(oahashtbl_t *hashtbl, uint64_t hash)
+{
+	tk_uint32_t mask = CAPACITY(hashtbl) - 1;
+	tk_uint32_t pos = H1(hash) & mask;
+	tk_uint32_t probe = 0;
+	tk_uint32_t match;
+
+	while (1) {
+		match = group_match_empty_or_deleted(hashtbl->ctrl + pos);
+		if (match)
+			return (pos + __builtin_ctz(match)) & mask;
+		probe += OAHASHTBL_GROUP_WIDTH;
+		pos = (pos + probe) & mask;
+	}
+}
+
+/*重建到指定容量，同时清除墓碑*/
+static int oahashtbl_resize(oahashtbl_t *hashtbl, int new_log_size)
+{
+	oahashtbl_t old = *hashtbl;
+	tk_uint32_t old_capacity = CAPACITY(&old);
+	tk_uint32_t i, idx;
+	uint64_t hash;
+	int num_items = hashtbl->num_items;
+
+	if (oahashtbl_alloc(hashtbl, new_log_size) < 0) {
+		*hashtbl = old;
+		return -1;
+	}
+	for (i = 0; i < old_capacity; i++) {
+		if (!IS_FULL(old.ctrl[i]))
+			continue;
+		hash = oa_hash(old.slots[i].key);
+		idx = find_insert_slot(hashtbl, hash);
+		set_ctrl(hashtbl, idx, H2(hash));
+		hashtbl->slots[idx] = old.slots[i];
+	}
+	hashtbl->num_items = num_items;
+	hashtbl->growth_left -= num_items;
+	if (new_log_size != old.log_size)
+		hashtbl->grow_num++;
+
+	free(old.ctrl);
+	free(old.slots);
+	return 0;
+}
+
+int oahashtbl_insert(oahashtbl_t *hashtbl, int key, void *obj)
+{
+	uint64_t hash = oa_hash(key);
+	tk_uint32_t capacity, idx;
+
+	if (hashtbl->growth_left <= 0) {
+		capacity = CAPACITY(hashtbl);
+		/*额度大多被墓碑占用时原地整理，否则扩容一倍*/
+		if ((tk_uint32_t)hashtbl->num_items * 2 < MAX_LOAD(capacity) || hashtbl->log_size >= OAHASHTBL_MAX_LOG_SIZE) {
+			if (oahashtbl_resize(hashtbl, hashtbl->log_size) < 0)
+				return -1;
+		} else if (oahashtbl_resize(hashtbl, hashtbl->log_size + 1) < 0) {
+			return -1;
+		}
+		if (hashtbl->growth_left <= 0)
+			return -1;
+	}
+
+	idx = find_insert_slot(hashtbl, hash);
+	if (hashtbl->ctrl[idx] == CTRL_EMPTY)
+		hashtbl->growth_left--; /*复用墓碑不消耗额度*/
+	set_ctrl(hashtbl, idx, H2(hash));
+	hashtbl->slots[idx].key = key;
+	hashtbl->slots[idx].obj = obj;
+	hashtbl->num_items++;
+	return 0;
+}
+
+/*沿探测序列查找，对每个key相同的候选调用match回调，返回槽位下标，找不到返回-1*/
+static long oahashtbl_lookup(oahashtbl_t *hashtbl, int key, void *target_obj, hashtbl_comp_func func, void *obj)
+{
+	uint64_t hash = oa_hash(key);
+	tk_int8_t h2 = H2(hash);
+	tk_uint32_t mask = CAPACITY(hashtbl) - 1;
+	tk_uint32_t pos = H1(hash) & mask;
+	tk_uint32_t probe = 0;
+	tk_uint32_t match, idx;
+	const tk_int8_t *group;
+
+	while (1) {
+		group = hashtbl->ctrl + pos;
+		for (match = group_match(group, h2); match; match &= match - 1) {
+			idx = (pos + __builtin_ctz(match)) & mask;
+			if (hashtbl->slots[idx].key != key)
+				continue;
+			if (func ? (func)(hashtbl->slots[idx].obj, target_obj) : (hashtbl->slots[idx].obj == obj))
+				return idx;
+		}
+		if (group_match_empty(group))
+			return -1;
+		probe += OAHASHTBL_GROUP_WIDTH;
+		if (probe > CAPACITY(hashtbl))
+			return -1;
+		pos = (pos + probe) & mask;
+	}
+}
+
+void *oahashtbl_find(oahashtbl_t *hashtbl, void *target_obj, int key, hashtbl_comp_func func)
+{
+	long idx = oahashtbl_lookup(hashtbl, key, target_obj, func, NULL);
+	return (idx < 0) ? NULL : hashtbl->slots[idx].obj;
+}
+
+int oahashtbl_remove(oahashtbl_t *hashtbl, int key, void *obj)
+{
+	long idx = oahashtbl_lookup(hashtbl, key, NULL, NULL, obj);
+	tk_uint32_t mask = CAPACITY(hashtbl) - 1;
+	tk_uint32_t before, after;
+
+	if (idx < 0)
+		return 0;
+
+	/*如果该槽位所在的任意一个16字节窗口里仍有空槽，说明没有探测序列越过它，可以直接置空而不必留墓碑*/
+	before = group_match_empty(hashtbl->ctrl + ((idx - OAHASHTBL_GROUP_WIDTH) & mask));
+	after = group_match_empty(hashtbl->ctrl + idx);
+	if (before && after && (__builtin_ctz(after) + __builtin_clz(before << 16)) < OAHASHTBL_GROUP_WIDTH) {
+		set_ctrl(hashtbl, idx, CTRL_EMPTY);
+		hashtbl->growth_left++;
+	} else {
+		set_ctrl(hashtbl, idx, CTRL_DELETED);
+	}
+	hashtbl->slots[idx].obj = NULL;
+	hashtbl->num_items--;
+	return 0;
+}
+
+int oahashtbl_free_all_objects(oahashtbl_t *hashtbl, hashtbl_traverse_func func, void *args)
+{
+	if (NULL == hashtbl || (hashtbl->num_items == 0)) {
+		return 0;
+	}
+
+	oahashtbl_traverse_each_safe(hashtbl, func, args);
+	oahashtbl_reset(hashtbl);
+
+	return 0;
+}
+
+int oahashtbl_destroy(oahashtbl_t *hashtbl)
+{
+	free(hashtbl->ctrl);
+	free(hashtbl->slots);
+	free(hashtbl);
+	return 0;
+}
+
+int oahashtbl_reset(oahashtbl_t *hashtbl)
+{
+	tk_uint32_t capacity = CAPACITY(hashtbl);
+	memset(hashtbl->ctrl, CTRL_EMPTY, capacity + OAHASHTBL_GROUP_WIDTH);
+	hashtbl->num_items = 0;
+	hashtbl->growth_left = MAX_LOAD(capacity);
+	return 0;
+}
+
+int oahashtbl_traverse_each(oahashtbl_t *hashtbl, hashtbl_traverse_func func, void *args)
+{
+	tk_uint32_t i, capacity;
+
+	if (NULL == hashtbl || NULL == func || (hashtbl->num_items == 0)) {
+		return 0;
+	}
+
+	capacity = CAPACITY(hashtbl);
+	for (i = 0; i < capacity; i++) {
+		if (!IS_FULL(hashtbl->ctrl[i]))
+			continue;
+		if ((func)(hashtbl->slots[i].obj, args))
+			return -1;
+	}
+	return 0;
+}
+
+int oahashtbl_traverse_each_safe(oahashtbl_t *hashtbl, hashtbl_traverse_func func, void *args)
+{
+	tk_uint32_t i, capacity;
+
+	if (NULL == hashtbl || NULL == func || (hashtbl->num_items == 0)) {
+		return 0;
+	}
+
+	capacity = CAPACITY(hashtbl);
+	for (i = 0; i < capacity; i++) {
+		if (!IS_FULL(hashtbl->ctrl[i]))
+			continue;
+		(func)(hashtbl->slots[i].obj, args);
+	}
+	return 0;
+}
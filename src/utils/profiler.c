@@ -0,0 +1,184 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#include "profiler.h"
+#include "trace.h"
+#include "tools.h"
+#include "debug.h"
+
+void tk_histogram_init(tk_histogram_t *hist) {
+    memset(hist, 0, sizeof(*hist));
+    hist->min = UINT64_MAX;
+}
+
+static int tk_histogram_bucket_index(uint64_t value) {
+    int msb = 0, group = 0, sub = 0;
+
+    if (value < TK_HIST_SUB_BUCKETS) {
+        return (int)value;
+    }
+    msb = 63 - __builtin_clzll(value);
+    group = msb - TK_HIST_SUB_BUCKET_BITS + 1;
+    if (group >= TK_HIST_GROUPS) {
+        return TK_HIST_BUCKETS - 1;
+    }
+    sub = (int)((value >> (msb - TK_HIST_SUB_BUCKET_BITS)) & (TK_HIST_SUB_BUCKETS - 1));
+    return group * TK_HIST_SUB_BUCKETS + sub;
+}
+
+// 桶内取值上界（百分位数按所落桶的上界报告，偏保守）
+static uint64_t tk_histogram_bucket_upper(int index) {
+    int group = index / TK_HIST_SUB_BUCKETS;
+    int sub = index % TK_HIST_SUB_BUCKETS;
+
+    if (group == 0) {
+        return (uint64_t)sub;
+    }
+    return (((uint64_t)(TK_HIST_SUB_BUCKETS + sub + 1)) << (group - 1)) - 1;
+}
+
+void tk_histogram_record(tk_histogram_t *hist, uint64_t value) {
+    hist->counts[tk_histogram_bucket_index(value)]++;
+    hist->total_count++;
+    hist->sum += value;
+    if (value < hist->min) hist->min = value;
+    if (value > hist->max) hist->max = value;
+}
+
+// 多个线程可能同时写同一个直方图时使用（如同名锁共用的统计，见tk_lock.c）
+void tk_histogram_record_atomic(tk_histogram_t *hist, uint64_t value) {
+    uint64_t old = 0;
+
+    __atomic_add_fetch(&hist->counts[tk_histogram_bucket_index(value)], 1, __ATOMIC_RELAXED);
+    __atomic_add_fetch(&hist->total_count, 1, __ATOMIC_RELAXED);
+    __atomic_add_fetch(&hist->sum, value, __ATOMIC_RELAXED);
+    old = __atomic_load_n(&hist->min, __ATOMIC_RELAXED);
+    while ((value < old) && !__atomic_compare_exchange_n(&hist->min, &old, value, 1, __ATOMIC_RELAXED, __ATOMIC_RELAXED));
+    old = __atomic_load_n(&hist->max, __ATOMIC_RELAXED);
+    while ((value > old) && !__atomic_compare_exchange_n(&hist->max, &old, value, 1, __ATOMIC_RELAXED, __ATOMIC_RELAXED));
+}
+
+void tk_histogram_merge(tk_histogram_t *dst, const tk_histogram_t *src) {
+    for (int i = 0; i < TK_HIST_BUCKETS; i++) {
+        dst->counts[i] += src->counts[i];
+    }
+    dst->total_count += src->total_count;
+    dst->sum += src->sum;
+    dst->min = MIN(dst->min, src->min);
+    dst->max = MAX(dst->max, src->max);
+}
+
+// percentile取值0~100
+uint64_t tk_histogram_percentile(const tk_histogram_t *hist, double percentile) {
+    uint64_t target = 0, seen = 0;
+
+    if (hist->total_count == 0) {
+        return 0;
+    }
+    target = (uint64_t)(hist->total_count * percentile / 100.0 + 0.5);
+    if (target < 1) target = 1;
+    for (int i = 0; i < TK_HIST_BUCKETS; i++) {
+        seen += hist->counts[i];
+        if (seen >= target) {
+            return MIN(tk_histogram_bucket_upper(i), hist->max);
+        }
+    }
+    return hist->max;
+}
+
+void tk_histogram_print_header(const char *title) {
+    printf("%-14s %10s %9s %9s %9s %9s %9s %9s", title, "count", "mean", "p50", "p90", "p99", "p99.9", "max");
+}
+
+void tk_histogram_print_row(const char *title, const tk_histogram_t *hist, double scale) {
+    printf("%-14s %10lu %9.1f %9.1f %9.1f %9.1f %9.1f %9.1f", title, (unsigned long)hist->total_count,
+        hist->total_count ? (double)hist->sum / hist->total_count / scale : 0.0,
+        tk_histogram_percentile(hist, 50) / scale, tk_histogram_percentile(hist, 90) / scale,
+        tk_histogram_percentile(hist, 99) / scale, tk_histogram_percentile(hist, 99.9) / scale, hist->max / scale);
+}
+
+#ifdef ENABLE_PHASE_PROFILER
+static const char *tk_phase_names[TK_PHASE_NUM] = {
+    "tick", "ai", "tank move", "shell physics", "collision", "event drain", "frame", "scene build", "present"
+};
+
+// 每个线程一份直方图，首次使用时挂到全局链表上（无锁压栈），之后的记录都只写本线程的数据
+typedef struct _ThreadProfile {
+    tk_histogram_t hist[TK_PHASE_NUM];
+    pid_t tid;
+    struct _ThreadProfile *next;
+} ThreadProfile;
+
+static ThreadProfile *tk_thread_profiles = NULL;
+static __thread ThreadProfile *tk_my_profile = NULL;
+
+static ThreadProfile *get_thread_profile() {
+    ThreadProfile *profile = tk_my_profile;
+    ThreadProfile *head = NULL;
+
+    if (profile) {
+        return profile;
+    }
+    profile = malloc(sizeof(ThreadProfile));
+    if (!profile) {
+        return NULL;
+    }
+    for (int i = 0; i < TK_PHASE_NUM; i++) {
+        tk_histogram_init(&profile->hist[i]);
+    }
+    profile->tid = syscall(SYS_gettid);
+    head = __atomic_load_n(&tk_thread_profiles, __ATOMIC_ACQUIRE);
+    do {
+        profile->next = head;
+    } while (!__atomic_compare_exchange_n(&tk_thread_profiles, &head, profile, 1, __ATOMIC_RELEASE, __ATOMIC_ACQUIRE));
+    tk_my_profile = profile;
+    return profile;
+}
+
+void tk_profiler_record(tk_phase_t phase, uint64_t ns) {
+    ThreadProfile *profile = get_thread_profile();
+    if (profile && (phase < TK_PHASE_NUM)) {
+        tk_histogram_record(&profile->hist[phase], ns);
+    }
+}
+
+tk_profile_scope_t tk_profile_scope_begin(tk_phase_t phase) {
+    tk_profile_scope_t scope = {phase, tk_get_monotonic_ns(), 0};
+    if (TK_TRACE_ON()) {
+        tk_trace_event(TK_TRACE_PH_BEGIN, tk_phase_names[phase], scope.start_ns, 0, 0);
+        scope.traced = 1;
+    }
+    return scope;
+}
+
+void tk_profile_scope_end(tk_profile_scope_t *scope) {
+    uint64_t end_ns = tk_get_monotonic_ns();
+    tk_profiler_record(scope->phase, end_ns - scope->start_ns);
+    if (scope->traced) {
+        tk_trace_event(TK_TRACE_PH_END, tk_phase_names[scope->phase], end_ns, 0, 0);
+    }
+}
+
+// 打印各阶段耗时分布（微秒），在所有线程退出之后调用
+void tk_profiler_report() {
+    ThreadProfile *profile = NULL;
+    tk_histogram_t merged;
+
+    tk_debug("Phase timing (us):\n");
+    tk_histogram_print_header("phase");
+    printf("\n");
+    for (int i = 0; i < TK_PHASE_NUM; i++) {
+        tk_histogram_init(&merged);
+        for (profile = __atomic_load_n(&tk_thread_profiles, __ATOMIC_ACQUIRE); profile; profile = profile->next) {
+            tk_histogram_merge(&merged, &profile->hist[i]);
+        }
+        if (merged.total_count == 0) {
+            continue;
+        }
+        tk_histogram_print_row(tk_phase_names[i], &merged, 1000.0);
+        printf("\n");
+    }
+}
+#endif
@@ -0,0 +1,55 @@
+#include <stdio.h>
+#include <string.h>
+#include <sys/mman.h>
+#include "slab.h"
+#include "debug.h"
+
+#define SLAB_ALIGN 64
+
+int tk_slab_init(TkSlab *slab, size_t slot_size, size_t capacity) {
+    void *base = NULL;
+
+    memset(slab, 0, sizeof(*slab));
+    slot_size = (slot_size + SLAB_ALIGN - 1) / SLAB_ALIGN * SLAB_ALIGN;
+    base = mmap(NULL, slot_size * capacity, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+    if (base == MAP_FAILED) {
+        tk_debug("Error: %s reserve %zu slots of %zuB failed\n", __func__, capacity, slot_size);
+        return -1;
+    }
+    slab->base = base;
+    slab->slot_size = slot_size;
+    slab->capacity = capacity;
+    return 0;
+}
+
+void tk_slab_destroy(TkSlab *slab) {
+    if (slab->base) {
+        munmap(slab->base, slab->slot_size * slab->capacity);
+    }
+    memset(slab, 0, sizeof(*slab));
+}
+
+// 优先复用空闲链表上的槽位，其次启用下一个从未用过的槽位。返回的槽位内容未清零
+void* tk_slab_alloc(TkSlab *slab) {
+    uint8_t *slot = NULL;
+
+    if (slab->free_head) {
+        slot = slab->base + (slab->free_head - 1) * slab->slot_size;
+        memcpy(&slab->free_head, slot, sizeof(slab->free_head));
+    } else if (slab->high_water < slab->capacity) {
+        slot = slab->base + slab->high_water * slab->slot_size;
+        slab->high_water++;
+    } else {
+        return NULL;
+    }
+    slab->used++;
+    return slot;
+}
+
+void tk_slab_free(TkSlab *slab, void *slot) {
+    size_t index = ((uint8_t *)slot - slab->base) / slab->slot_size;
+
+    memcpy(slot, &slab->free_head, sizeof(slab->free_head));
+    slab->free_head = index + 1;
+    slab->used--;
+}
@@ -0,0 +1,202 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+#include <unistd.h>
+#include <sys/syscall.h>
+#include <linux/futex.h>
+#include "tk_lock.h"
+#include "profiler.h"
+#include "trace.h"
+#include "tools.h"
+#include "debug.h"
+
+#if defined(__x86_64__) || defined(__i386__)
+#define cpu_relax() __builtin_ia32_pause()
+#elif defined(__aarch64__)
+#define cpu_relax() __asm__ __volatile__("yield" ::: "memory")
+#else
+#define cpu_relax() do {} while (0)
+#endif
+
+#ifdef ENABLE_LOCK_STATS
+struct _tk_lock_stats {
+    const char *name;
+    uint64_t acquisitions;
+    uint64_t contended;
+    tk_histogram_t wait_hist; // 只记录发生争用的那些获取
+    tk_histogram_t hold_hist;
+#define TK_LOCK_BLAME_SITES 8
+    struct {
+        const char *site;
+        uint64_t count;
+    } blame[TK_LOCK_BLAME_SITES]; // 发生争用时持有者加锁所在的函数（各自的次数）
+    struct _tk_lock_stats *next;
+};
+
+static tk_lock_stats_t *tk_lock_stats_list = NULL;
+static pthread_mutex_t tk_lock_stats_mutex = PTHREAD_MUTEX_INITIALIZER;
+static __thread int tk_lock_my_tid = 0;
+
+static tk_lock_stats_t *get_lock_stats(const char *name) {
+    tk_lock_stats_t *stats = NULL;
+
+    pthread_mutex_lock(&tk_lock_stats_mutex);
+    for (stats = tk_lock_stats_list; stats; stats = stats->next) {
+        if (!strcmp(stats->name, name)) {
+            goto out;
+        }
+    }
+    stats = malloc(sizeof(tk_lock_stats_t));
+    if (!stats) {
+        goto out;
+    }
+    memset(stats, 0, sizeof(tk_lock_stats_t));
+    stats->name = name;
+    tk_histogram_init(&stats->wait_hist);
+    tk_histogram_init(&stats->hold_hist);
+    stats->next = tk_lock_stats_list;
+    __atomic_store_n(&tk_lock_stats_list, stats, __ATOMIC_RELEASE);
+out:
+    pthread_mutex_unlock(&tk_lock_stats_mutex);
+    return stats;
+}
+
+static void blame_lock_holder(tk_lock_stats_t *stats, const char *site) {
+    const char *expected = NULL;
+
+    if (!site) {
+        return;
+    }
+    for (int i = 0; i < TK_LOCK_BLAME_SITES; i++) {
+        expected = __atomic_load_n(&stats->blame[i].site, __ATOMIC_RELAXED);
+        if (!expected && __atomic_compare_exchange_n(&stats->blame[i].site, &expected, site, 0, __ATOMIC_RELAXED, __ATOMIC_RELAXED)) {
+            expected = site;
+        }
+        if (expected == site) {
+            __atomic_add_fetch(&stats->blame[i].count, 1, __ATOMIC_RELAXED);
+            return;
+        }
+    }
+}
+#endif
+
+void tk_lock_init(tk_lock_t *l, const char *name, tk_lock_kind_t kind) {
+    memset(l, 0, sizeof(*l));
+    l->kind = kind;
+    l->name = name ? name : "unnamed lock";
+#ifdef ENABLE_LOCK_STATS
+    l->stats = get_lock_stats(l->name);
+#endif
+}
+
+void tk_lock_destroy(tk_lock_t *l) {
+    if (__atomic_load_n(&l->state, __ATOMIC_RELAXED) != 0) {
+        tk_debug("Warn: lock(%s) destroyed while held\n", l->name);
+    }
+}
+
+// 加锁的慢路径：自旋锁一直自旋；自适应锁自旋一段时间后把状态置为2（有等待者）并在futex上睡眠
+static void tk_lock_wait(tk_lock_t *l) {
+    int c = 0;
+
+    for (int i = 0; (l->kind == TK_LOCK_SPIN) || (i < TK_LOCK_SPIN_LIMIT); i++) {
+        if (__atomic_load_n(&l->state, __ATOMIC_RELAXED) == 0) {
+            c = 0;
+            if (__atomic_compare_exchange_n(&l->state, &c, 1, 0, __ATOMIC_ACQUIRE, __ATOMIC_RELAXED)) {
+                return;
+            }
+        }
+        cpu_relax();
+    }
+    c = __atomic_exchange_n(&l->state, 2, __ATOMIC_ACQUIRE);
+    while (c != 0) {
+        syscall(SYS_futex, &l->state, FUTEX_WAIT_PRIVATE, 2, NULL, NULL, 0);
+        c = __atomic_exchange_n(&l->state, 2, __ATOMIC_ACQUIRE);
+    }
+}
+
+void tk_lock_acquire(tk_lock_t *l, const char *site) {
+    int c = 0;
+    int traced = 0;
+#ifdef ENABLE_LOCK_STATS
+    uint64_t wait_start_ns = 0, now_ns = 0;
+#endif
+
+    if (!__atomic_compare_exchange_n(&l->state, &c, 1, 0, __ATOMIC_ACQUIRE, __ATOMIC_RELAXED)) { // 发生争用
+#ifdef ENABLE_LOCK_STATS
+        wait_start_ns = tk_get_monotonic_ns();
+        if (l->stats) {
+            blame_lock_holder(l->stats, __atomic_load_n(&l->holder_site, __ATOMIC_RELAXED));
+        }
+#endif
+        if (TK_TRACE_ON()) {
+            tk_trace_event(TK_TRACE_PH_BEGIN, l->name, 0, 0, 0);
+            traced = 1;
+        }
+        tk_lock_wait(l);
+        if (traced) {
+            tk_trace_event(TK_TRACE_PH_END, l->name, 0, 0, 0);
+        }
+    }
+#ifdef ENABLE_LOCK_STATS
+    now_ns = tk_get_monotonic_ns();
+    if (l->stats) {
+        __atomic_add_fetch(&l->stats->acquisitions, 1, __ATOMIC_RELAXED);
+        if (wait_start_ns) {
+            __atomic_add_fetch(&l->stats->contended, 1, __ATOMIC_RELAXED);
+            tk_histogram_record_atomic(&l->stats->wait_hist, now_ns - wait_start_ns);
+        }
+    }
+    if (!tk_lock_my_tid) {
+        tk_lock_my_tid = syscall(SYS_gettid);
+    }
+    l->holder_tid = tk_lock_my_tid;
+    __atomic_store_n(&l->holder_site, site, __ATOMIC_RELAXED);
+    l->acquired_ns = now_ns;
+#endif
+}
+
+void tk_lock_release(tk_lock_t *l) {
+#ifdef ENABLE_LOCK_STATS
+    if (l->stats) {
+        tk_histogram_record_atomic(&l->stats->hold_hist, tk_get_monotonic_ns() - l->acquired_ns);
+    }
+    l->holder_tid = 0;
+    __atomic_store_n(&l->holder_site, NULL, __ATOMIC_RELAXED);
+#endif
+    if (__atomic_exchange_n(&l->state, 0, __ATOMIC_RELEASE) == 2) { // 有线程在futex上等待，唤醒一个
+        syscall(SYS_futex, &l->state, FUTEX_WAKE_PRIVATE, 1, NULL, NULL, 0);
+    }
+}
+
+// 打印各组锁的统计（耗时单位微秒），在所有线程退出之后调用
+void tk_lock_report() {
+#ifdef ENABLE_LOCK_STATS
+    tk_lock_stats_t *stats = NULL;
+    int top = 0;
+
+    tk_debug("Lock stats (us):\n");
+    tk_log_flush();
+    printf("%-18s %10s %9s %9s %9s %9s %9s %9s %9s  %s\n", "lock", "acquire", "contended", "wait p50", "wait p99", "wait max",
+        "hold p50", "hold p99", "hold max", "top holder when contended");
+    for (stats = __atomic_load_n(&tk_lock_stats_list, __ATOMIC_ACQUIRE); stats; stats = stats->next) {
+        if (stats->acquisitions == 0) {
+            continue;
+        }
+        top = 0;
+        for (int i = 1; i < TK_LOCK_BLAME_SITES; i++) {
+            if (stats->blame[i].count > stats->blame[top].count) {
+                top = i;
+            }
+        }
+        printf("%-18s %10lu %9lu %9.1f %9.1f %9.1f %9.1f %9.1f %9.1f  %s(%lu)\n", stats->name,
+            (unsigned long)stats->acquisitions, (unsigned long)stats->contended,
+            tk_histogram_percentile(&stats->wait_hist, 50) / 1000.0, tk_histogram_percentile(&stats->wait_hist, 99) / 1000.0,
+            stats->wait_hist.total_count ? stats->wait_hist.max / 1000.0 : 0.0,
+            tk_histogram_percentile(&stats->hold_hist, 50) / 1000.0, tk_histogram_percentile(&stats->hold_hist, 99) / 1000.0,
+            stats->hold_hist.total_count ? stats->hold_hist.max / 1000.0 : 0.0,
+            stats->blame[top].site ? stats->blame[top].site : "-", (unsigned long)stats->blame[top].count);
+    }
+#endif
+}
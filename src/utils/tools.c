@@ -2,6 +2,8 @@
 #include <stdlib.h>
 #include <string.h>
 #include <pthread.h>
+#include <stdint.h>
+#include <time.h>
 #include "debug.h"
 
 #define PATH_MAX_LEN 512
@@ -50,9 +52,29 @@ char* uint_to_str(unsigned int num) {
     return str;
 }
 
-// 生成 [m,n] 之间的随机整数
-int random_range(int m, int n) {
-    return m + rand() / (RAND_MAX / (n - m + 1) + 1);
+// xorshift32，state不能为0
+uint32_t tk_rand_r(uint32_t *state) {
+    uint32_t x = *state;
+    x ^= x << 13;
+    x ^= x >> 17;
+    x ^= x << 5;
+    *state = x;
+    return x;
+}
+
+// 把任意种子（包括0和相邻的小整数）打散成可用的xorshift32初始状态
+uint32_t tk_rand_seed(uint32_t seed) {
+    seed ^= seed >> 16;
+    seed *= 0x7feb352d;
+    seed ^= seed >> 15;
+    seed *= 0x846ca68b;
+    seed ^= seed >> 16;
+    return seed ? seed : 0x9e3779b9;
+}
+
+// 生成 [m,n] 之间的随机整数（state为调用者自己的发生器状态，如每局游戏的GameState.rng_state）
+int tk_rand_range(uint32_t *state, int m, int n) {
+    return m + (int)(tk_rand_r(state) % (uint32_t)(n - m + 1));
 }
 
 size_t strlcpy(char *dst, const char *src, size_t size) {
@@ -63,4 +85,11 @@ size_t strlcpy(char *dst, const char *src, size_t size) {
         dst[copy_len] = '\0';
     }
     return len;
-}
\ No newline at end of file
+}
+
+// 单调时钟（纳秒），不受系统时间调整影响，用于测量耗时
+uint64_t tk_get_monotonic_ns() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ULL + (uint64_t)ts.tv_nsec;
+}
@@ -0,0 +1,191 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#include "trace.h"
+#include "tools.h"
+#include "debug.h"
+
+typedef struct {
+    uint64_t ts_ns;
+    const char *name;
+    uint64_t arg;
+    uint16_t aux;
+    char ph;
+} TraceEvent;
+
+// 每个线程一个事件缓冲区，首次记录时挂到全局链表上（无锁压栈），之后一直保留
+typedef struct _ThreadTrace {
+    TraceEvent *events;
+    uint32_t count;    // 已写入的事件数（release发布，导出时acquire读取）
+    uint32_t dropped;
+    uint32_t session;  // 缓冲区内容所属的跟踪会话，所属线程发现会话变化时自行清空
+    pid_t tid;
+    char name[32];
+    struct _ThreadTrace *next;
+} ThreadTrace;
+
+int tk_trace_enabled = 0;
+static uint32_t tk_trace_session = 0;
+static uint64_t tk_trace_start_ns = 0;
+static char tk_trace_path[256] = TK_TRACE_DEFAULT_PATH;
+static uint32_t tk_trace_files = 0; // 已写出的文件数，第二个文件起在文件名后加序号
+static ThreadTrace *tk_thread_traces = NULL;
+static __thread ThreadTrace *tk_my_trace = NULL;
+static __thread char tk_my_trace_name[32];
+
+static ThreadTrace *get_thread_trace() {
+    ThreadTrace *trace = tk_my_trace;
+    ThreadTrace *head = NULL;
+
+    if (trace) {
+        return trace;
+    }
+    trace = malloc(sizeof(ThreadTrace));
+    if (!trace) {
+        return NULL;
+    }
+    memset(trace, 0, sizeof(ThreadTrace));
+    trace->events = malloc(sizeof(TraceEvent) * TK_TRACE_BUF_EVENTS);
+    if (!trace->events) {
+        free(trace);
+        return NULL;
+    }
+    trace->tid = syscall(SYS_gettid);
+    if (tk_my_trace_name[0]) {
+        strlcpy(trace->name, tk_my_trace_name, sizeof(trace->name));
+    } else {
+        snprintf(trace->name, sizeof(trace->name), "thread-%d", trace->tid);
+    }
+    head = __atomic_load_n(&tk_thread_traces, __ATOMIC_ACQUIRE);
+    do {
+        trace->next = head;
+    } while (!__atomic_compare_exchange_n(&tk_thread_traces, &head, trace, 1, __ATOMIC_RELEASE, __ATOMIC_ACQUIRE));
+    tk_my_trace = trace;
+    return trace;
+}
+
+void tk_trace_event(char ph, const char *name, uint64_t ts_ns, uint64_t arg, uint16_t aux) {
+    ThreadTrace *trace = get_thread_trace();
+    uint32_t session = __atomic_load_n(&tk_trace_session, __ATOMIC_ACQUIRE);
+    TraceEvent *event = NULL;
+
+    if (!trace) {
+        return;
+    }
+    if (trace->session != session) { // 新的跟踪会话，丢弃上一次的内容
+        __atomic_store_n(&trace->count, 0, __ATOMIC_RELEASE);
+        trace->dropped = 0;
+        trace->session = session;
+    }
+    if (trace->count >= TK_TRACE_BUF_EVENTS) {
+        trace->dropped++;
+        return;
+    }
+    event = &trace->events[trace->count];
+    event->ts_ns = ts_ns ? ts_ns : tk_get_monotonic_ns();
+    event->name = name;
+    event->arg = arg;
+    event->aux = aux;
+    event->ph = ph;
+    __atomic_store_n(&trace->count, trace->count + 1, __ATOMIC_RELEASE);
+}
+
+// 为当前线程命名（显示在时间线上），线程启动时调用一次。缓冲区在第一次记录事件时才分配
+void tk_trace_thread_name(const char *name) {
+    strlcpy(tk_my_trace_name, name, sizeof(tk_my_trace_name));
+    if (tk_my_trace) {
+        strlcpy(tk_my_trace->name, name, sizeof(tk_my_trace->name));
+    }
+}
+
+void tk_trace_set_output(const char *path) {
+    strlcpy(tk_trace_path, path, sizeof(tk_trace_path));
+}
+
+void tk_trace_start() {
+    if (tk_trace_enabled) {
+        return;
+    }
+    tk_trace_start_ns = tk_get_monotonic_ns();
+    __atomic_add_fetch(&tk_trace_session, 1, __ATOMIC_RELEASE);
+    __atomic_store_n(&tk_trace_enabled, 1, __ATOMIC_RELEASE);
+    tk_debug("trace started\n");
+}
+
+static void write_trace_event(FILE *fp, const ThreadTrace *trace, const TraceEvent *event) {
+    double ts_us = (event->ts_ns >= tk_trace_start_ns) ? (event->ts_ns - tk_trace_start_ns) / 1000.0 : 0;
+
+    fprintf(fp, ",\n{\"name\":\"%s\",\"ph\":\"%c\",\"ts\":%.3f,\"pid\":%d,\"tid\":%d", event->name, event->ph, ts_us,
+        (int)getpid(), (int)trace->tid);
+    switch (event->ph) {
+    case TK_TRACE_PH_COMPLETE:
+        fprintf(fp, ",\"dur\":%.3f", event->arg / 1000.0);
+        break;
+    case TK_TRACE_PH_INSTANT:
+        fprintf(fp, ",\"s\":\"t\",\"args\":{\"id\":%lu,\"type\":%u}", (unsigned long)event->arg, event->aux);
+        break;
+    case TK_TRACE_PH_FLOW_START:
+        fprintf(fp, ",\"cat\":\"flow\",\"id\":%lu", (unsigned long)event->arg);
+        break;
+    case TK_TRACE_PH_FLOW_END:
+        fprintf(fp, ",\"cat\":\"flow\",\"id\":%lu,\"bp\":\"e\"", (unsigned long)event->arg); // 绑定到包含它的区间
+        break;
+    default:
+        break;
+    }
+    fprintf(fp, "}");
+}
+
+// 停止跟踪并把本次会话的事件写到文件。仍在记录中的其他线程最多再写入几条，不会被导出
+int tk_trace_stop() {
+    ThreadTrace *trace = NULL;
+    char path[300];
+    FILE *fp = NULL;
+    uint32_t count = 0, total = 0, dropped = 0;
+    uint32_t session = __atomic_load_n(&tk_trace_session, __ATOMIC_ACQUIRE);
+
+    if (!tk_trace_enabled) {
+        return 0;
+    }
+    __atomic_store_n(&tk_trace_enabled, 0, __ATOMIC_RELEASE);
+    if (tk_trace_files == 0) {
+        strlcpy(path, tk_trace_path, sizeof(path));
+    } else {
+        snprintf(path, sizeof(path), "%s.%u", tk_trace_path, tk_trace_files);
+    }
+    fp = fopen(path, "w");
+    if (!fp) {
+        tk_debug("Error: failed to open trace file %s\n", path);
+        return -1;
+    }
+    fprintf(fp, "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n");
+    fprintf(fp, "{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":%d,\"args\":{\"name\":\"tank\"}}", (int)getpid());
+    for (trace = __atomic_load_n(&tk_thread_traces, __ATOMIC_ACQUIRE); trace; trace = trace->next) {
+        fprintf(fp, ",\n{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":%d,\"tid\":%d,\"args\":{\"name\":\"%s\"}}",
+            (int)getpid(), (int)trace->tid, trace->name);
+        if (trace->session != session) {
+            continue;
+        }
+        count = __atomic_load_n(&trace->count, __ATOMIC_ACQUIRE);
+        for (uint32_t i = 0; i < count; i++) {
+            write_trace_event(fp, trace, &trace->events[i]);
+        }
+        total += count;
+        dropped += trace->dropped;
+    }
+    fprintf(fp, "\n]}\n");
+    fclose(fp);
+    tk_trace_files++;
+    tk_debug("trace stopped: %u events written to %s%s\n", total, path, dropped ? " (some events dropped, buffer full)" : "");
+    return 0;
+}
+
+void tk_trace_toggle() {
+    if (tk_trace_enabled) {
+        tk_trace_stop();
+    } else {
+        tk_trace_start();
+    }
+}
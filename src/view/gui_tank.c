@@ -4,8 +4,8 @@
 #include "tools.h"
 #include "debug.h"
 #include "event_loop.h"
-
-extern MazePathBFSearchManager tk_bfs_search_manager;
+#include "profiler.h"
+#include "trace.h"
 
 // SDL相关变量
 SDL_Window*   tk_window = NULL;
@@ -13,8 +13,18 @@ SDL_Renderer* tk_renderer = NULL;
 TTF_Font* tank_font8 = NULL;
 KeyValue tk_key_value;
 TankMusic tk_music;
-tk_uint8_t tk_gui_stop_game = 0;
+tk_uint8_t tk_gui_stop_game = 0; // 暂停原因，TK_GUI_PAUSED_BY_*的组合
 Button* tk_stop_game_button = NULL;
+FramePacer tk_frame_pacer;
+// 空闲模式下待重绘的内容
+#define TK_GUI_REDRAW_BUTTONS 0x01 // 只在缓存的画面上重绘按钮
+#define TK_GUI_REDRAW_SCENE   0x02 // 重新生成整个画面并缓存
+static tk_uint8_t tk_gui_redraw = 0;
+static tk_uint8_t tk_gui_scene_stale = 0; // 控制线程可能还会异步更新画面（如路径搜索），等待超时后再刷新一次
+static SDL_Texture *tk_idle_frame = NULL;
+// 渲染帧率与游戏逻辑节奏解耦：按键自动重发、爆炸粒子动画、game_time仍按RENDER_FPS_MS的固定节奏推进，
+// 置1表示本渲染帧恰好到达一个逻辑帧
+tk_uint8_t tk_gui_logic_tick = 0;
 
 // 颜色数组
 SDL_Color tk_colors[] = {
@@ -54,7 +64,15 @@ int init_gui(void) {
     }
 
     // 创建渲染器
-    tk_renderer = SDL_CreateRenderer(tk_window, -1, SDL_RENDERER_ACCELERATED);
+    char *env = getenv("TK_FPS");
+    tk_uint32_t target_fps = env ? (tk_uint32_t)atoi(env) : TK_TARGET_FPS;
+    tk_uint8_t vsync = TK_RENDER_VSYNC;
+    env = getenv("TK_VSYNC");
+    if (env) {
+        vsync = (atoi(env) != 0);
+    }
+    tk_renderer = SDL_CreateRenderer(tk_window, -1, SDL_RENDERER_ACCELERATED | (vsync ? SDL_RENDERER_PRESENTVSYNC : 0));
+    frame_pacer_init(&tk_frame_pacer, target_fps, vsync);
     if (tk_renderer == NULL) {
         tk_debug("Renderer could not be created! SDL_Error: %s\n", SDL_GetError());
         return -3;
@@ -68,6 +86,10 @@ int init_gui(void) {
 
 // 清理GUI资源
 void cleanup_gui(void) {
+    if (tk_idle_frame) {
+        SDL_DestroyTexture(tk_idle_frame);
+        tk_idle_frame = NULL;
+    }
     // 销毁渲染器
     if (tk_renderer) {
         SDL_DestroyRenderer(tk_renderer);
@@ -251,13 +273,13 @@ static void draw_arrow_head(SDL_Renderer* renderer, Point end, float angle) {
 }
 
 // 绘制坦克坐标系（北轴和右轴）
-static void draw_tank_coordinates(SDL_Renderer* renderer, Tank* tank) {
+static void draw_tank_coordinates(SDL_Renderer* renderer, Tank* tank, Point position, tk_float32_t tank_angle_deg) {
     if (!renderer || !tank) return;
 
     // 设置绘制颜色
     SDL_SetRenderDrawColor(renderer, 255, 255, 255, 255); // 白色
     // 坐标系原点（坦克中心）
-    Point origin = tank->position;
+    Point origin = position;
 
     float north_angle_rad = 270 * M_PI / 180.0f;
     Point north_end = {
@@ -283,7 +305,7 @@ static void draw_tank_coordinates(SDL_Renderer* renderer, Tank* tank) {
 
     // 坦克前进方向轴（不带箭头）
 #define SCOPE_LEN 200 // 便于瞄准敌人
-    float tank_ang = (tank->angle_deg + 270);
+    float tank_ang = (tank_angle_deg + 270);
     if (tank_ang > 360) {
         tank_ang -= 360;
     }
@@ -299,9 +321,10 @@ static void draw_tank_coordinates(SDL_Renderer* renderer, Tank* tank) {
 #else
     // 绘制坦克前进方向轴（遇墙壁自动反射版本）
     Ray_Intersection_Dot_Info info;
+    info.maze = &tk_shared_game_state.maze;
     info.start_point = origin;
-    info.angle_deg = tank->angle_deg;
-    info.current_grid = get_grid_by_tank_position(&tank->position);
+    info.angle_deg = tank_angle_deg;
+    info.current_grid = get_grid_by_tank_position(&position);
     info.terminate_flag = 0;
     tk_debug_internal(DEBUG_SIGHT_LINE, "draw_tank_coordinates...\n");
     for (int i=0; i<6; i++) { // 至多反射6次
@@ -323,9 +346,8 @@ static void draw_tank_coordinates(SDL_Renderer* renderer, Tank* tank) {
     if (!tank_font8) {
         tank_font8 = load_cached_font(DEFAULT_FONT_PATH, 8);
     }
-    SDL_Texture* text1 = render_cached_text(renderer, tank_font8, uint_to_str(tank->angle_deg), ID2COLOR(TK_BLACK)); // TODO: 缓存只有100，
-    // 而旋转角度有360，因此缓存经常失效，而且当前缓存是基于数组实现，性能较差，应该改造为基于哈希表
-    draw_text(renderer, text1, POS(text_pos));
+    // 角度有360种取值，走字形图集绘制，避免每个取值都缓存一张纹理
+    draw_text_with_cache(renderer, tank_font8, uint_to_str(tank_angle_deg), ID2COLOR(TK_BLACK), text_pos.x, text_pos.y);
 #endif
 }
 
@@ -566,11 +588,14 @@ void render_tank(SDL_Renderer* renderer, Tank* tank) {
     if (TST_FLAG(tank, flags, TANK_DEAD)) {
         return;
     }
-    if ((tank->health <= 0) || TST_FLAG(tank, flags, TANK_DYING)) {
-        if (TST_FLAG(tank, flags, TANK_ALIVE)) { // only enter once
-            CLR_FLAG(tank, flags, TANK_ALIVE);
+    if (!tank->basic_color) { // 坦克由控制线程创建，首次绘制时设置颜色
+        gui_init_tank(tank);
+    }
+    // ALIVE/DYING/DEAD的迁移由控制线程在模拟帧内完成（见update_dying_tanks()），这里只负责播放爆炸效果
+    if ((tank->health <= 0) || !TST_FLAG(tank, flags, TANK_ALIVE)) {
+        if (!tank->explode_effect.triggered) { // only enter once
+            tank->explode_effect.triggered = 1;
             trigger_explode(tank);
-            SET_FLAG(tank, flags, TANK_DYING);
             if (is_music_playing(&(tk_music.explode))) {
                 pause_music(&(tk_music.explode));
             }
@@ -578,11 +603,9 @@ void render_tank(SDL_Renderer* renderer, Tank* tank) {
         }
         // 绘制爆炸效果
         render_explode_effect(renderer, tank);
-        // 更新爆炸粒子
-        update_explode_particles_state(tank);
-        if (tank->explode_effect.active_count <= 0) {
-            CLR_FLAG(tank, flags, TANK_DYING);
-            SET_FLAG(tank, flags, TANK_DEAD);
+        // 更新爆炸粒子（粒子寿命以逻辑帧计，与渲染帧率无关）
+        if (tk_gui_logic_tick) {
+            update_explode_particles_state(tank);
         }
         return;
     }
@@ -596,7 +619,11 @@ void render_tank(SDL_Renderer* renderer, Tank* tank) {
     Point health_bar_lefttop;
     tk_float32_t life_percentage = 0;
 
-    tk_float32_t angle_deg = tank->angle_deg;
+    Point position;
+    tk_float32_t tank_angle_deg = 0;
+    get_interpolated_motion(&tank->motion, &tank->position, tank->angle_deg, &position, &tank_angle_deg);
+
+    tk_float32_t angle_deg = tank_angle_deg;
     if (angle_deg < 0) {
         angle_deg = 0;
     }
@@ -608,7 +635,7 @@ void render_tank(SDL_Renderer* renderer, Tank* tank) {
         angle_deg -= 360;
     }
     // 绘制坦克主体
-    rect = draw_solid_rectangle(renderer, &(tank->position), TANK_LENGTH, TANK_WIDTH, angle_deg, &body_color);
+    rect = draw_solid_rectangle(renderer, &position, TANK_LENGTH, TANK_WIDTH, angle_deg, &body_color);
 
     // 绘制履带
     topline_center = get_line_center(&rect.lefttop, &rect.righttop);
@@ -617,14 +644,14 @@ void render_tank(SDL_Renderer* renderer, Tank* tank) {
     draw_solid_rectangle(renderer, &bottomline_center, TANK_LENGTH-4, 4, angle_deg, color);
 
     // 绘制炮塔
-    draw_solid_rectangle(renderer, &(tank->position), 15, 15, angle_deg, color);
+    draw_solid_rectangle(renderer, &position, 15, 15, angle_deg, color);
     rightline_center = get_line_center(&rect.righttop, &rect.rightbottom);
-    gun_barrel_center = get_line_k_center(&(tank->position), &rightline_center, 0.8);
+    gun_barrel_center = get_line_k_center(&position, &rightline_center, 0.8);
     draw_solid_rectangle(renderer, &gun_barrel_center, 18, 9, angle_deg, color);
 
     // 绘制坦克生命值
-    SDL_RenderDrawPoint(renderer, POS(tank->position));
-    health_bar_lefttop = (Point){tank->position.x-22, tank->position.y-30};
+    SDL_RenderDrawPoint(renderer, POS(position));
+    health_bar_lefttop = (Point){position.x-22, position.y-30};
     SDL_SetRenderDrawColor(renderer, COLORPTR2PARAM2(ID2COLORPTR(TK_GREEN), 0.65));
     SDL_RenderDrawRect(renderer, &(SDL_Rect){POS(health_bar_lefttop), 43, 5});
     life_percentage = ((tk_float32_t)(tank->health) / tank->max_health);
@@ -638,11 +665,10 @@ void render_tank(SDL_Renderer* renderer, Tank* tank) {
 
     // 绘制坦克名称
     tank_font8 = load_cached_font(DEFAULT_FONT_PATH, 8); // TODO: 改造为哈希表实现
-    SDL_Texture* text1 = render_cached_text(renderer, tank_font8, tank->name, ID2COLOR(TK_BLACK));
-    draw_text(renderer, text1, tank->position.x-22, tank->position.y-43);
+    draw_text_with_cache(renderer, tank_font8, tank->name, ID2COLOR(TK_BLACK), position.x-22, position.y-43);
 
     if (TANK_ROLE_SELF == tank->role) {
-        draw_tank_coordinates(renderer, tank);
+        draw_tank_coordinates(renderer, tank, position, tank_angle_deg);
     }
     tank_font8 = NULL;
 
@@ -698,7 +724,13 @@ void draw_solid_circle(SDL_Renderer* renderer, tk_float32_t x0, tk_float32_t y0,
 // 绘制炮弹
 void draw_shell(SDL_Renderer* renderer, Shell *shell) {
     if (!shell->ttl) return;
-    draw_solid_circle(renderer, POS(shell->position), SHELL_RADIUS_LENGTH, (SDL_Color*)(((Tank*)(shell->tank_owner))->basic_color));
+    Point position;
+    tk_float32_t angle_deg = 0;
+    get_interpolated_motion(&shell->motion, &shell->position, shell->angle_deg, &position, &angle_deg);
+    if (!((Tank*)(shell->tank_owner))->basic_color) {
+        gui_init_tank((Tank*)(shell->tank_owner));
+    }
+    draw_solid_circle(renderer, POS(position), SHELL_RADIUS_LENGTH, (SDL_Color*)(((Tank*)(shell->tank_owner))->basic_color));
 }
 
 // 对目标位置pos1进行偏移处理（pos2为偏移量）
@@ -746,9 +778,8 @@ void fill_grid(SDL_Renderer* renderer, Grid *previous, Grid *current, Grid *next
     SDL_RenderFillRect(renderer, &rect);
 }
 
-// 渲染场景
-void render_gui_scene() {
-    // tk_debug("render_gui_scene...\n");
+// 绘制除按钮以外的整个画面（不提交显示）
+static void build_gui_scene() {
     Tank *tank = NULL;
     Shell *shell = NULL;
     Grid previous = {-1, -1}, current, next;
@@ -766,15 +797,15 @@ void render_gui_scene() {
 
     // 绘制搜索路径
     SDL_SetRenderDrawBlendMode(tk_renderer, SDL_BLENDMODE_BLEND); // 启用混合
-    lock(&tk_bfs_search_manager.spinlock);
-    if (tk_bfs_search_manager.success) {
-        FOREACH_BFS_SEARCH_MANAGER_GRID(&tk_bfs_search_manager, current) {
-            next = NEXT_BFS_SEARCH_GRID(&tk_bfs_search_manager, current);
+    lock(&tk_shared_game_state.bfs.spinlock);
+    if (tk_shared_game_state.bfs.success) {
+        FOREACH_BFS_SEARCH_MANAGER_GRID(&tk_shared_game_state.bfs, current) {
+            next = NEXT_BFS_SEARCH_GRID(&tk_shared_game_state.bfs, current);
             fill_grid(tk_renderer, &previous, &current, &next);
             previous = current;
         }
     }
-    unlock(&tk_bfs_search_manager.spinlock);
+    unlock(&tk_shared_game_state.bfs.spinlock);
 
     // 渲染坦克和炮弹
     lock(&tk_shared_game_state.spinlock);
@@ -795,14 +826,62 @@ void render_gui_scene() {
         unlock(&tank->spinlock);
     }
     unlock(&tk_shared_game_state.spinlock);
+}
 
+// 渲染场景
+void render_gui_scene() {
+    // tk_debug("render_gui_scene...\n");
+    {
+    TK_PROFILE_SCOPE(TK_PHASE_SCENE_BUILD);
+    build_gui_scene();
     // 绘制按钮
     render_all_buttons(tk_renderer);
+    }
 
     // 显示渲染内容
+    TK_PROFILE_SCOPE(TK_PHASE_PRESENT);
     SDL_RenderPresent(tk_renderer);
 }
 
+// 空闲模式下的绘制：需要时把整个画面渲染到纹理缓存，之后只把缓存拷贝到屏幕并重绘按钮，不再遍历坦克和炮弹。
+// 不支持渲染到纹理时退化为按需整帧重绘
+static void render_idle_frame() {
+    int w = 0, h = 0, tw = 0, th = 0;
+
+    if (!tk_gui_redraw) {
+        return;
+    }
+    if (!SDL_RenderTargetSupported(tk_renderer)) {
+        render_gui_scene();
+        tk_gui_redraw = 0;
+        return;
+    }
+    if (tk_gui_redraw & TK_GUI_REDRAW_SCENE) {
+        SDL_GetRendererOutputSize(tk_renderer, &w, &h);
+        if (tk_idle_frame && ((SDL_QueryTexture(tk_idle_frame, NULL, NULL, &tw, &th) != 0) || (tw != w) || (th != h))) {
+            SDL_DestroyTexture(tk_idle_frame);
+            tk_idle_frame = NULL;
+        }
+        if (!tk_idle_frame) {
+            tk_idle_frame = SDL_CreateTexture(tk_renderer, SDL_PIXELFORMAT_RGBA8888, SDL_TEXTUREACCESS_TARGET, w, h);
+            if (!tk_idle_frame) {
+                tk_debug("Error: failed to create idle frame texture: %s\n", SDL_GetError());
+                render_gui_scene();
+                tk_gui_redraw = 0;
+                return;
+            }
+            SDL_SetTextureBlendMode(tk_idle_frame, SDL_BLENDMODE_NONE);
+        }
+        SDL_SetRenderTarget(tk_renderer, tk_idle_frame);
+        build_gui_scene();
+        SDL_SetRenderTarget(tk_renderer, NULL);
+    }
+    SDL_RenderCopy(tk_renderer, tk_idle_frame, NULL, NULL);
+    render_all_buttons(tk_renderer);
+    SDL_RenderPresent(tk_renderer);
+    tk_gui_redraw = 0;
+}
+
 int check_resource_file() {
     if (!get_absolute_path(DEFAULT_FONT_PATH)) {
         return -1;
@@ -841,9 +920,9 @@ void notify_control_thread_exit() {
     if (!e) {
         exit(1);
     }
-    enqueue_event(&tk_event_queue, e);
-    notify_event_loop();
-    close_write_end_of_pipe();
+    enqueue_event(&tk_event_loop.queue, e);
+    notify_event_loop(&tk_event_loop);
+    close_write_end_of_pipe(&tk_event_loop);
 }
 
 void notify_control_thread_stop() {
@@ -852,8 +931,8 @@ void notify_control_thread_stop() {
     if (!e) {
         exit(1);
     }
-    enqueue_event(&tk_event_queue, e);
-    notify_event_loop();
+    enqueue_event(&tk_event_loop.queue, e);
+    notify_event_loop(&tk_event_loop);
 }
 
 void notify_control_thread_start() {
@@ -862,8 +941,18 @@ void notify_control_thread_start() {
     if (!e) {
         exit(1);
     }
-    enqueue_event(&tk_event_queue, e);
-    notify_event_loop();
+    enqueue_event(&tk_event_loop.queue, e);
+    notify_event_loop(&tk_event_loop);
+}
+
+void notify_control_thread_restart() {
+    Event *e = NULL;
+    e = create_event(EVENT_GAME_RESTART);
+    if (!e) {
+        exit(1);
+    }
+    enqueue_event(&tk_event_loop.queue, e);
+    notify_event_loop(&tk_event_loop);
 }
 
 void send_key_to_control_thread(int key_type, int key_value) {
@@ -904,8 +993,8 @@ void send_key_to_control_thread(int key_type, int key_value) {
         exit(1);
     }
     e->data.key = value;
-    enqueue_event(&tk_event_queue, e);
-    notify_event_loop();
+    enqueue_event(&tk_event_loop.queue, e);
+    notify_event_loop(&tk_event_loop);
 }
 
 #define OP_LIST_LEN 50
@@ -970,8 +1059,8 @@ void send_maze_path_search_request_to_control_thread(Grid *end) {
         exit(1);
     }
     e->data.path_search_request.end = *end;
-    enqueue_event(&tk_event_queue, e);
-    notify_event_loop();
+    enqueue_event(&tk_event_loop.queue, e);
+    notify_event_loop(&tk_event_loop);
 }
 
 void handle_click_event_for_all_grids(SDL_Event* event) {
@@ -983,6 +1072,36 @@ void handle_click_event_for_all_grids(SDL_Event* event) {
     if (get_grid_by_key_mouse(mouseX, mouseY, &grid) == 0) {
         tk_debug_internal(DEBUG_GUI_THREAD_DETAIL, "网格(%d,%d)被点击\n", POS(grid));
         send_maze_path_search_request_to_control_thread(&grid);
+        tk_gui_scene_stale = 1;
+    }
+}
+
+// 窗口事件：失去焦点时自动暂停，重新获得焦点时只解除由失去焦点引起的暂停（用户手动暂停的保持暂停）
+void handle_window_event(SDL_Event* event) {
+    switch (event->window.event) {
+    case SDL_WINDOWEVENT_FOCUS_LOST:
+#if TK_PAUSE_ON_FOCUS_LOST
+        if (!tk_gui_stop_game) {
+            tk_debug("window lost focus, pause game\n");
+            notify_control_thread_stop();
+        }
+        tk_gui_stop_game |= TK_GUI_PAUSED_BY_FOCUS;
+#endif
+        break;
+    case SDL_WINDOWEVENT_FOCUS_GAINED:
+        if (tk_gui_stop_game & TK_GUI_PAUSED_BY_FOCUS) {
+            tk_gui_stop_game &= ~TK_GUI_PAUSED_BY_FOCUS;
+            if (!tk_gui_stop_game) {
+                tk_debug("window gained focus, resume game\n");
+                notify_control_thread_start();
+            }
+        }
+        break;
+    case SDL_WINDOWEVENT_EXPOSED:
+    case SDL_WINDOWEVENT_SIZE_CHANGED:
+    case SDL_WINDOWEVENT_RESTORED:
+        tk_gui_redraw |= TK_GUI_REDRAW_SCENE;
+        break;
     }
 }
 
@@ -990,9 +1109,39 @@ void gui_main_loop() {
     int quit = 0;
     SDL_Event e;
     int op = 0;
+    uint64_t next_logic_tick_ns = tk_get_monotonic_ns();
+    tk_uint8_t idle = 0;
     while (!quit) {
+        if (tk_gui_stop_game && !idle) { // 进入空闲模式
+            idle = 1;
+            frame_pacer_pause(&tk_frame_pacer);
+            tk_gui_redraw |= TK_GUI_REDRAW_SCENE;
+        } else if (!tk_gui_stop_game && idle) { // 退出空闲模式
+            idle = 0;
+            frame_pacer_resume(&tk_frame_pacer);
+            next_logic_tick_ns = tk_get_monotonic_ns();
+        }
+        if (idle) {
+            // 没有待重绘的内容就阻塞等待下一个事件（不取出，由下面的SDL_PollEvent统一处理）
+            if (!tk_gui_redraw && !SDL_WaitEventTimeout(NULL, TK_GUI_IDLE_WAIT_MS) && tk_gui_scene_stale) {
+                tk_gui_scene_stale = 0;
+                tk_gui_redraw |= TK_GUI_REDRAW_SCENE;
+            }
+            tk_gui_logic_tick = 0;
+        } else {
+        frame_pacer_begin_frame(&tk_frame_pacer);
+        tk_gui_logic_tick = (tk_frame_pacer.frame_start_ns >= next_logic_tick_ns);
+        if (tk_gui_logic_tick) {
+            next_logic_tick_ns += RENDER_FPS_MS * 1000000ULL;
+            if (next_logic_tick_ns < tk_frame_pacer.frame_start_ns) { // 卡顿过久则不补帧
+                next_logic_tick_ns = tk_frame_pacer.frame_start_ns + RENDER_FPS_MS * 1000000ULL;
+            }
+        }
+        }
         // 处理事件
         init_op_list();
+        {
+        TK_TRACE_SCOPE("poll");
         while (SDL_PollEvent(&e) != 0) {
             // 用户请求退出
             if (e.type == SDL_QUIT) {
@@ -1001,6 +1150,10 @@ void gui_main_loop() {
                 notify_control_thread_exit();
                 goto out;
             } else if (e.type == SDL_KEYDOWN) { // 处理键盘事件
+                if (e.key.keysym.sym == SDLK_F9) { // 开始/停止时间线跟踪（停止时写出文件，见trace.h）
+                    tk_trace_toggle();
+                    continue;
+                }
                 if (tk_gui_stop_game && (e.key.keysym.sym != SDLK_ESCAPE)) {
                     break;
                 }
@@ -1082,10 +1235,20 @@ void gui_main_loop() {
                         break;
                 }
             } else if ((e.type == SDL_MOUSEMOTION) || (e.type == SDL_MOUSEBUTTONDOWN) || (e.type == SDL_MOUSEBUTTONUP)) {
-                handle_click_event_for_all_buttons(&e);
+                if (handle_click_event_for_all_buttons(&e)) {
+                    tk_gui_redraw |= TK_GUI_REDRAW_BUTTONS;
+                }
                 handle_click_event_for_all_grids(&e);
+                if (tk_gui_scene_stale && (e.type == SDL_MOUSEBUTTONDOWN)) {
+                    tk_gui_redraw |= TK_GUI_REDRAW_SCENE;
+                }
+            } else if (e.type == SDL_WINDOWEVENT) {
+                handle_window_event(&e);
+            } else if (e.type == SDL_RENDER_TARGETS_RESET) { // 纹理内容丢失
+                tk_gui_redraw |= TK_GUI_REDRAW_SCENE;
             }
         }
+        }
         if (!tk_gui_stop_game) {
         // print_op_list();
         iter_op_list(op) {
@@ -1109,7 +1272,8 @@ void gui_main_loop() {
                 send_key_to_control_thread(EVENT_KEY_PRESS, KEY_SPACE);
             }
         }
-        if ((get_op_list_num() == 0) && (tk_key_value.mask != 0) /*&& (tk_shared_game_state.game_time % 2 == 0) && 0*/) {
+        // 按住按键时每个逻辑帧重发一次（控制线程每收到一次按键移动一步，重发频率决定了移动速度，不能随渲染帧率变化）
+        if (tk_gui_logic_tick && (get_op_list_num() == 0) && (tk_key_value.mask != 0) /*&& (tk_shared_game_state.game_time % 2 == 0) && 0*/) {
             tk_debug_internal(DEBUG_GUI_THREAD_DETAIL, "auto send key event(%u)\n", tk_shared_game_state.game_time);
             if (TST_FLAG(&tk_key_value, mask, TK_KEY_W_ACTIVE)) {
                 send_key_to_control_thread(EVENT_KEY_PRESS, KEY_W);
@@ -1122,36 +1286,32 @@ void gui_main_loop() {
             }
         }
         }
+        if (idle) { // 空闲模式只按需重绘
+            render_idle_frame();
+            continue;
+        }
         // 渲染场景
         render_gui_scene();
-        tk_shared_game_state.game_time++;
-        // 控制帧率
-        SDL_Delay(RENDER_FPS_MS); // 42ms约24FPS
+        if (tk_gui_logic_tick) {
+            tk_shared_game_state.game_time++;
+        }
+        // 控制帧率：只睡眠本帧预算的剩余部分
+        frame_pacer_end_frame(&tk_frame_pacer);
+        tk_profiler_record(TK_PHASE_FRAME, tk_frame_pacer.last_frame_cost_ns);
+        TK_TRACE_COMPLETE("frame", tk_frame_pacer.frame_start_ns, tk_frame_pacer.last_frame_cost_ns);
     }
 out:
+    frame_pacer_print_stats(&tk_frame_pacer);
     return;
 }
 
-int init_simple_game_tanks() {
-    if (mytankptr) {
-        delete_tank(mytankptr, 1);
-    }
-    create_tank("yangdai", get_random_grid_pos_for_tank(), 300, TANK_ROLE_SELF);
-    create_tank("muggle-0", get_random_grid_pos_for_tank(), random_range(0, 360), TANK_ROLE_ENEMY_MUGGLE);
-    if (!mytankptr) {
-        return -1;
-    }
-    gui_init_all_tank();
-    return 0;
-}
-
 #define BUTTON_GAME_RESTART 0x01
 void stop_game_button_click_callback(void* button, void* data) {
     tk_debug("按钮[%s]被点击! \n", ((Button*)button)->text);
     if (!TST_FLAG(((Button*)button), user_flag, BUTTON_GAME_RESTART)) {
         SET_FLAG(((Button*)button), user_flag, BUTTON_GAME_RESTART);
         strlcpy(((Button*)button)->text, "开始", sizeof(((Button*)button)));
-        tk_gui_stop_game = 1;
+        tk_gui_stop_game |= TK_GUI_PAUSED_BY_USER;
         notify_control_thread_stop();
     } else {
         CLR_FLAG(((Button*)button), user_flag, BUTTON_GAME_RESTART);
@@ -1163,7 +1323,6 @@ void stop_game_button_click_callback(void* button, void* data) {
 
 void restart_game_button_click_callback(void* button, void* data) {
     tk_debug("按钮[%s]被点击! \n", ((Button*)button)->text);
-    delete_all_tanks();
     if (tk_gui_stop_game || tk_shared_game_state.stop_game) {
         if (tk_stop_game_button) {
             CLR_FLAG(tk_stop_game_button, user_flag, BUTTON_GAME_RESTART);
@@ -1171,11 +1330,9 @@ void restart_game_button_click_callback(void* button, void* data) {
         } else {
             exit(1);
         }
-        notify_control_thread_start();
         tk_gui_stop_game = 0;
-        tk_shared_game_state.stop_game = 0;
     }
-    init_simple_game_tanks();
+    notify_control_thread_restart(); // 由控制线程重建坦克（同时解除暂停），保证录像中事件与模拟帧的顺序就是实际执行顺序
 }
 
 int init_game_buttons() {
@@ -1214,10 +1371,10 @@ int main() { //gcc tank.c -o tank `sdl2-config --cflags --libs` -lm -g -lbsd
     if (init_ttf() != 0) {
         goto out;
     }
-    if (init_idpool() != 0) {
+    if (init_game_state(&tk_shared_game_state, 0, 0) != 0) {
         goto out;
     }
-    tank = create_tank("muggledy", (Point){400,300}, 300, TANK_ROLE_SELF);
+    tank = create_tank(&tk_shared_game_state, "muggledy", (Point){400,300}, 300, TANK_ROLE_SELF);
     if (!tank) {
         goto out;
     }
@@ -1290,7 +1447,7 @@ int main() { //gcc tank.c -o tank `sdl2-config --cflags --libs` -lm -g -lbsd
 
 out:
     delete_tank(&tank);
-    cleanup_idpool();
+    cleanup_game_state(&tk_shared_game_state);
     cleanup_ttf();
     cleanup_music();
     cleanup_gui();
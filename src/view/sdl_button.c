@@ -2,17 +2,12 @@
 #include <stdlib.h>
 #include "sdl_text.h"
 #ifdef BUTTON_LOCK
-#include <pthread.h>
-#endif
-
-#ifdef BUTTON_LOCK
-extern void lock(pthread_spinlock_t *spinlock);
-extern void unlock(pthread_spinlock_t *spinlock);
+#include "tk_lock.h"
 #endif
 
 TAILQ_HEAD(_tk_buttons_list, _Button) tk_button_list = TAILQ_HEAD_INITIALIZER(tk_button_list);
 #ifdef BUTTON_LOCK
-pthread_spinlock_t tk_button_list_op_spinlock; // 参考tank->spinlock
+tk_lock_t tk_button_list_op_spinlock = TK_LOCK_INITIALIZER("button list", TK_LOCK_SPIN); // 参考tank->spinlock
 #endif
 
 Button* create_button(int x, int y, int w, int h, int text_offset_x, int text_offset_y, const char* text, 
@@ -60,7 +55,6 @@ void destroy_button(Button* button) {
 // 渲染按钮
 void render_button(SDL_Renderer* renderer, Button* button) {
     TTF_Font *button_font = NULL;
-    SDL_Texture *button_text = NULL;
     if (!button || !renderer) return;
 
     if ((0 != button->rect.w) && (0 != button->rect.h)) {
@@ -85,20 +79,24 @@ void render_button(SDL_Renderer* renderer, Button* button) {
             printf("render button(%s) at pos(%d,%d) with size(%d,%d)\n", button->text, 
                 button->rect.x, button->rect.y, button->rect.w, button->rect.h);
         }
-        button_text = render_cached_text(renderer, button_font, button->text, button->textColor);
-        draw_text(renderer, button_text, button->rect.x+button->text_offset_x, button->rect.y+button->text_offset_y);
+        draw_text_with_cache(renderer, button_font, button->text, button->textColor, 
+            button->rect.x+button->text_offset_x, button->rect.y+button->text_offset_y);
     }
 }
 
-// 处理按钮事件
-void handle_button_event(Button* button, SDL_Event* event) {
-    if (!button || button->state == BUTTON_DISABLED) return;
+// 处理按钮事件，按钮外观发生变化（状态改变或被点击）时返回1
+int handle_button_event(Button* button, SDL_Event* event) {
+    ButtonState old_state;
+    int clicked = 0;
+
+    if (!button || button->state == BUTTON_DISABLED) return 0;
+    old_state = button->state;
     
     int mouseX, mouseY;
     Uint32 mouseState = SDL_GetMouseState(&mouseX, &mouseY);
     
     if ((0 == button->rect.w) || (0 == button->rect.h)) {
-        return;
+        return 0;
     }
     // 检查鼠标是否在按钮区域内
     int isInside = ((mouseX >= button->rect.x) && (mouseX < button->rect.x + button->rect.w) &&
@@ -120,11 +118,13 @@ void handle_button_event(Button* button, SDL_Event* event) {
                     if (button->onClick) {
                         button->onClick((void *)button, button->callbackData);
                     }
+                    clicked = 1;
                 }
                 button->state = isInside ? BUTTON_HOVER : BUTTON_NORMAL;
             }
             break;
     }
+    return clicked || (button->state != old_state);
 }
 
 void render_all_buttons(SDL_Renderer* renderer) {
@@ -140,17 +140,20 @@ void render_all_buttons(SDL_Renderer* renderer) {
 #endif
 }
 
-void handle_click_event_for_all_buttons(SDL_Event* event) {
+// 返回是否有按钮需要重绘（空闲模式下据此只重绘按钮）
+int handle_click_event_for_all_buttons(SDL_Event* event) {
     Button *button = NULL;
+    int dirty = 0;
 #ifdef BUTTON_LOCK
     lock(&tk_button_list_op_spinlock);
 #endif
     TAILQ_FOREACH(button, &tk_button_list, chain) {
-        handle_button_event(button, event);
+        dirty |= handle_button_event(button, event);
     }
 #ifdef BUTTON_LOCK
     unlock(&tk_button_list_op_spinlock);
 #endif
+    return dirty;
 }
 
 void cleanup_all_buttons() {
@@ -165,6 +168,6 @@ void cleanup_all_buttons() {
     }
 #ifdef BUTTON_LOCK
     unlock(&tk_button_list_op_spinlock);
-    destroy_spinlock(&tk_button_list_op_spinlock);
+    tk_lock_destroy(&tk_button_list_op_spinlock);
 #endif
 }
\ No newline at end of file
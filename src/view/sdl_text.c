@@ -11,17 +11,26 @@
 // 文本缓存数组
 #ifdef FONT_CACHE_BASED_ON_HASH
 hashtbl_t *text_cache_hashtbl;
+TAILQ_HEAD(text_cache_lru_head, _TextCacheItem) text_cache_lru = TAILQ_HEAD_INITIALIZER(text_cache_lru);
+size_t text_cache_bytes = 0;
+size_t text_cache_budget_bytes = DEFAULT_TEXT_CACHE_BUDGET_BYTES;
 #else
 #define MAX_CACHE_ITEMS 100
 TextCacheItem text_cache[MAX_CACHE_ITEMS];
 int cache_count = 0;
-unsigned int total_not_hit_text_cache_num = 0;
 #endif
+unsigned int total_hit_text_cache_num = 0;
+unsigned int total_not_hit_text_cache_num = 0;
+unsigned int total_evicted_text_cache_num = 0;
 unsigned int total_not_hit_font_cache_num = 0;
 
 #define MAX_FONTS 5
 FontCacheItem font_cache[MAX_FONTS] = {0};
 
+#define MAX_GLYPH_ATLAS MAX_FONTS
+GlyphAtlas* glyph_atlas[MAX_GLYPH_ATLAS] = {0};
+unsigned int total_rasterized_glyph_num = 0; // 字形光栅化（TTF调用）总次数，预热完成后应当不再增长
+
 // 初始化SDL和TTF
 int init(SDL_Window** window, SDL_Renderer** renderer) {
     // 初始化SDL
@@ -64,7 +73,9 @@ int init_ttf() {
     }
     memset(font_cache, 0, sizeof(font_cache));
 #ifdef FONT_CACHE_BASED_ON_HASH
-    text_cache_hashtbl = hashtbl_init(12, offsetof(struct _TextCacheItem, hashlink), 0);
+    text_cache_hashtbl = hashtbl_init(6, offsetof(struct _TextCacheItem, hashlink), 1); // 从小表开始，随缓存项增多渐进扩容
+    TAILQ_INIT(&text_cache_lru);
+    text_cache_bytes = 0;
 #else
     memset(text_cache, 0, sizeof(text_cache));
 #endif
@@ -84,6 +95,7 @@ tk_uint32_t calc_text_hash_tag(char *text, int max_len) {
 #endif
 
 void cleanup_ttf() {
+    clear_glyph_atlas();
     clear_cached_text();
     clear_cached_font();
     TTF_Quit();
@@ -124,8 +136,14 @@ static SDL_Texture* find_cached_texture(const char* text, SDL_Color color, int f
     match_obj = (TextCacheItem *)hashtbl_find(text_cache_hashtbl, &cmp_obj, hashkey, text_cache_item_hash_cmp);
     if (match_obj) {
         match_obj->hits++;
+        total_hit_text_cache_num++;
+        if (match_obj != TAILQ_FIRST(&text_cache_lru)) { // 移到链表头，标记为最近使用
+            TAILQ_REMOVE(&text_cache_lru, match_obj, lrulink);
+            TAILQ_INSERT_HEAD(&text_cache_lru, match_obj, lrulink);
+        }
         return match_obj->texture;
     }
+    total_not_hit_text_cache_num++;
     return NULL;
 #else
     for (int i = 0; i < cache_count; i++) {
@@ -136,6 +154,7 @@ static SDL_Texture* find_cached_texture(const char* text, SDL_Color color, int f
             text_cache[i].color.a == color.a &&
             text_cache[i].font_size == font_size) {
             text_cache[i].hits++;
+            total_hit_text_cache_num++;
             return text_cache[i].texture;
         }
     }
@@ -144,10 +163,38 @@ static SDL_Texture* find_cached_texture(const char* text, SDL_Color color, int f
 #endif
 }
 
+#ifdef FONT_CACHE_BASED_ON_HASH
+static void free_text_cache_item(TextCacheItem *item) {
+    hashtbl_remove(text_cache_hashtbl, item->hashkey, (void *)item);
+    TAILQ_REMOVE(&text_cache_lru, item, lrulink);
+    text_cache_bytes -= item->bytes;
+    free(item->text);
+    SDL_DestroyTexture(item->texture);
+    free(item);
+}
+
+// 从链表尾部开始淘汰最久未使用的项，直到总大小回到预算之内。keep是刚插入（马上要返回给调用者使用）的项，不能淘汰
+static void evict_text_cache(TextCacheItem *keep) {
+    TextCacheItem *victim = NULL;
+    while (text_cache_bytes > text_cache_budget_bytes) {
+        victim = TAILQ_LAST(&text_cache_lru, text_cache_lru_head);
+        if (!victim || (victim == keep)) {
+            break;
+        }
+        free_text_cache_item(victim);
+        total_evicted_text_cache_num++;
+    }
+}
+#endif
+
 // 添加文本到缓存
 static void add_text_to_cache(const char* text, SDL_Color color, int font_size, SDL_Texture* texture) {
 #ifdef FONT_CACHE_BASED_ON_HASH
     TextCacheItem *item = NULL;
+    int w = 0, h = 0;
+    if (!texture) {
+        return;
+    }
     item = malloc(sizeof(TextCacheItem));
     if (!item) {
         return;
@@ -158,7 +205,12 @@ static void add_text_to_cache(const char* text, SDL_Color color, int font_size,
     item->color = color;
     item->font_size = font_size;
     item->texture = texture;
+    SDL_QueryTexture(texture, NULL, NULL, &w, &h);
+    item->bytes = (size_t)w * h * 4;
     hashtbl_insert(text_cache_hashtbl, item->hashkey, item);
+    TAILQ_INSERT_HEAD(&text_cache_lru, item, lrulink);
+    text_cache_bytes += item->bytes;
+    evict_text_cache(item);
 #else
     int i = 0;
     unsigned int min_hits = 0;
@@ -187,43 +239,65 @@ set_cache:
         i = min_hits_index;
         free(text_cache[i].text);
         SDL_DestroyTexture(text_cache[i].texture);
+        total_evicted_text_cache_num++;
         goto set_cache;
     }
 #endif
 }
 
+// 设置文本纹理缓存的内存预算（字节），立即按新预算淘汰
+void set_text_cache_budget(size_t budget_bytes) {
 #ifdef FONT_CACHE_BASED_ON_HASH
-int textcache_hashtbl_item_count = 0;
-int print_text_cacha_hashtbl_item(void *_item, void *_args) {
-    TextCacheItem *item = (TextCacheItem *)_item;
-    printf("(%d) %s. hits:%u\n", textcache_hashtbl_item_count++, item->text, item->hits);
-    return 0;
+    text_cache_budget_bytes = budget_bytes;
+    evict_text_cache(NULL);
+#endif
 }
+
+void get_text_cache_stats(TextCacheStats* stats) {
+    if (!stats) return;
+    memset(stats, 0, sizeof(*stats));
+    stats->hits = total_hit_text_cache_num;
+    stats->misses = total_not_hit_text_cache_num;
+    stats->evictions = total_evicted_text_cache_num;
+#ifdef FONT_CACHE_BASED_ON_HASH
+    stats->items = text_cache_hashtbl ? text_cache_hashtbl->num_items : 0;
+    stats->bytes = text_cache_bytes;
+    stats->budget_bytes = text_cache_budget_bytes;
+#else
+    stats->items = cache_count;
 #endif
+}
 
 void print_text_cache() {
+    TextCacheStats stats;
+    get_text_cache_stats(&stats);
+    if (stats.hits || stats.misses) { // 启用字形图集时游戏内的文本都不经过文本纹理缓存，没有数据可打印
+        tk_debug("Text Cache: items %u, bytes %zu/%zu, hits %u, misses %u, evictions %u\n", stats.items, 
+            stats.bytes, stats.budget_bytes, stats.hits, stats.misses, stats.evictions);
+    }
+    tk_log_flush(); // 以下直接printf，先等异步日志输出完，避免乱序
+    printf("statistic: not hit font num: %u\n", total_not_hit_font_cache_num);
 #ifdef FONT_CACHE_BASED_ON_HASH
-    textcache_hashtbl_item_count = 0;
-    tk_debug("Cached Text Table(hashtbl):\n");
-    hashtbl_traverse_each(text_cache_hashtbl, print_text_cacha_hashtbl_item, NULL);
-#else
-    int i = 0;
-    tk_debug("Cached Text Table(count %d):\n", cache_count);
-    for (i = 0; i < cache_count; i++) {
-        printf("(%d) %s. hits:%u\n", i, text_cache[i].text, text_cache[i].hits);
+    hashtbl_stats_t tbl_stats;
+    if (stats.hits || stats.misses) {
+        hashtbl_get_stats(text_cache_hashtbl, &tbl_stats);
+        printf("text cache hashtbl: buckets %lu(grow %u times%s), load factor %.2f, avg chain %.2f, max chain %lu\n", 
+            tbl_stats.bucket_num, tbl_stats.grow_num, tbl_stats.rehashing ? ", rehashing" : "", 
+            tbl_stats.load_factor, tbl_stats.avg_chain_len, tbl_stats.max_chain_len);
     }
-    printf("statistic: not hit text num: %u, not hit font num: %u\n", total_not_hit_text_cache_num, total_not_hit_font_cache_num);
 #endif
+    for (int j = 0; j < MAX_GLYPH_ATLAS; j++) {
+        if (glyph_atlas[j]) {
+            printf("glyph atlas(font size %d): hashed glyphs %d, reset %u times\n", glyph_atlas[j]->font_size, 
+                glyph_atlas[j]->glyph_hashtbl->num_items, glyph_atlas[j]->reset_num);
+        }
+    }
+    printf("statistic: rasterized glyph num: %u\n", total_rasterized_glyph_num);
 }
 
 #ifdef FONT_CACHE_BASED_ON_HASH
 int del_text_cacha_hashtbl_item(void *_item, void *_args) {
-    TextCacheItem *item = (TextCacheItem *)_item;
-    // printf("free textcache item: %s\n", item->text);
-    free(item->text);
-    SDL_DestroyTexture(item->texture);
-    hashtbl_remove(text_cache_hashtbl, item->hashkey, (void *)item);
-    free(item);
+    free_text_cache_item((TextCacheItem *)_item);
     return 0;
 }
 #endif
@@ -302,6 +376,261 @@ void draw_text(SDL_Renderer* renderer, SDL_Texture* texture, int x, int y) {
     SDL_RenderCopy(renderer, texture, NULL, &dest_rect);
 }
 
+// 解码一个UTF-8字符，返回其码点并将*p推进到下一个字符（非法字节按单字节跳过）
+static tk_uint32_t utf8_next_codepoint(const char** p) {
+    const unsigned char* s = (const unsigned char*)(*p);
+    tk_uint32_t cp = 0;
+    int len = 1;
+
+    if (s[0] < 0x80) {
+        cp = s[0];
+    } else if (((s[0] & 0xE0) == 0xC0) && ((s[1] & 0xC0) == 0x80)) {
+        cp = ((s[0] & 0x1F) << 6) | (s[1] & 0x3F);
+        len = 2;
+    } else if (((s[0] & 0xF0) == 0xE0) && ((s[1] & 0xC0) == 0x80) && ((s[2] & 0xC0) == 0x80)) {
+        cp = ((s[0] & 0x0F) << 12) | ((s[1] & 0x3F) << 6) | (s[2] & 0x3F);
+        len = 3;
+    } else if (((s[0] & 0xF8) == 0xF0) && ((s[1] & 0xC0) == 0x80) && ((s[2] & 0xC0) == 0x80) && ((s[3] & 0xC0) == 0x80)) {
+        cp = ((s[0] & 0x07) << 18) | ((s[1] & 0x3F) << 12) | ((s[2] & 0x3F) << 6) | (s[3] & 0x3F);
+        len = 4;
+    } else {
+        cp = '?';
+    }
+    *p += len;
+    return cp;
+}
+
+int glyph_hash_cmp(void *_item, void *_target_item) {
+    return ((GlyphInfo *)_item)->codepoint == ((GlyphInfo *)_target_item)->codepoint;
+}
+
+int del_glyph_hashtbl_item(void *_item, void *_args) {
+    hashtbl_t *hashtbl = (hashtbl_t *)_args;
+    GlyphInfo *glyph = (GlyphInfo *)_item;
+    hashtbl_remove(hashtbl, (int)glyph->codepoint, (void *)glyph);
+    free(glyph);
+    return 0;
+}
+
+// 清空图集中的全部字形（纹理保留复用）
+static void reset_glyph_atlas(GlyphAtlas* atlas) {
+    memset(atlas->ascii, 0, sizeof(atlas->ascii));
+    hashtbl_traverse_each_safe(atlas->glyph_hashtbl, del_glyph_hashtbl_item, atlas->glyph_hashtbl);
+    atlas->pen_x = atlas->pen_y = GLYPH_ATLAS_PADDING;
+    atlas->row_height = 0;
+}
+
+static void destroy_glyph_atlas(GlyphAtlas* atlas) {
+    if (!atlas) return;
+    if (atlas->glyph_hashtbl) {
+        reset_glyph_atlas(atlas);
+        hashtbl_destroy(atlas->glyph_hashtbl);
+    }
+    if (atlas->texture) {
+        SDL_DestroyTexture(atlas->texture);
+    }
+    free(atlas);
+}
+
+static GlyphAtlas* create_glyph_atlas(SDL_Renderer* renderer, int font_size) {
+    GlyphAtlas* atlas = NULL;
+    void* blank = NULL;
+
+    atlas = malloc(sizeof(GlyphAtlas));
+    if (!atlas) {
+        return NULL;
+    }
+    memset(atlas, 0, sizeof(*atlas));
+    atlas->font_size = font_size;
+    atlas->pen_x = atlas->pen_y = GLYPH_ATLAS_PADDING;
+    atlas->glyph_hashtbl = hashtbl_init(4, offsetof(struct _GlyphInfo, hashlink), 1);
+    atlas->texture = SDL_CreateTexture(renderer, SDL_PIXELFORMAT_ARGB8888, SDL_TEXTUREACCESS_STATIC, 
+        GLYPH_ATLAS_WIDTH, GLYPH_ATLAS_HEIGHT);
+    if (!atlas->glyph_hashtbl || !atlas->texture) {
+        tk_debug("字形图集创建失败: %s\n", SDL_GetError());
+        destroy_glyph_atlas(atlas);
+        return NULL;
+    }
+    SDL_SetTextureBlendMode(atlas->texture, SDL_BLENDMODE_BLEND);
+    // 纹理初始内容未定义，先整体清为透明，避免字形边缘采样到脏数据
+    blank = calloc(GLYPH_ATLAS_WIDTH * GLYPH_ATLAS_HEIGHT, 4);
+    if (blank) {
+        SDL_UpdateTexture(atlas->texture, NULL, blank, GLYPH_ATLAS_WIDTH * 4);
+        free(blank);
+    }
+    return atlas;
+}
+
+// 获取指定字号的字形图集（没有则创建；槽位已满时替换第一个，同get_cached_font()）
+static GlyphAtlas* get_glyph_atlas(SDL_Renderer* renderer, int font_size) {
+    int i = 0;
+    for (i = 0; i < MAX_GLYPH_ATLAS; i++) {
+        if (glyph_atlas[i] && (glyph_atlas[i]->font_size == font_size)) {
+            return glyph_atlas[i];
+        }
+    }
+    for (i = 0; i < MAX_GLYPH_ATLAS; i++) {
+        if (!glyph_atlas[i]) {
+            break;
+        }
+    }
+    if (i >= MAX_GLYPH_ATLAS) {
+        destroy_glyph_atlas(glyph_atlas[0]);
+        glyph_atlas[0] = NULL;
+        i = 0;
+    }
+    glyph_atlas[i] = create_glyph_atlas(renderer, font_size);
+    return glyph_atlas[i];
+}
+
+// 光栅化一个字形并写入图集，图集写满时清空重建（*reset置1告知调用者之前取得的字形位置已失效）。
+// 每次绘制最多清空一次：*reset已为1时不再清空，放不下的字形返回NULL（这段文本的字形一张图集装不下）
+static GlyphInfo* load_glyph(GlyphAtlas* atlas, TTF_Font* font, tk_uint32_t codepoint, int* reset) {
+    GlyphInfo cmp_obj;
+    GlyphInfo* glyph = NULL;
+    SDL_Surface* surface = NULL;
+    SDL_Surface* converted = NULL;
+    int minx, maxx, miny, maxy, advance;
+
+    if (codepoint < 128) {
+        glyph = &(atlas->ascii[codepoint]);
+        if (glyph->loaded) {
+            return glyph;
+        }
+    } else {
+        cmp_obj.codepoint = codepoint;
+        glyph = (GlyphInfo *)hashtbl_find(atlas->glyph_hashtbl, &cmp_obj, (int)codepoint, glyph_hash_cmp);
+        if (glyph) {
+            return glyph;
+        }
+    }
+
+    if ((codepoint > 0xFFFF) || (TTF_GlyphMetrics(font, (Uint16)codepoint, &minx, &maxx, &miny, &maxy, &advance) != 0)) {
+        return NULL; // 超出BMP范围或字体中不存在的字形，直接跳过不绘制
+    }
+    surface = TTF_RenderGlyph_Blended(font, (Uint16)codepoint, (SDL_Color){255, 255, 255, 255});
+    if (!surface) {
+        tk_debug("字形渲染失败: %s\n", TTF_GetError());
+        return NULL;
+    }
+    converted = SDL_ConvertSurfaceFormat(surface, SDL_PIXELFORMAT_ARGB8888, 0);
+    SDL_FreeSurface(surface);
+    if (!converted) {
+        return NULL;
+    }
+    if ((converted->w + 2*GLYPH_ATLAS_PADDING > GLYPH_ATLAS_WIDTH) || (converted->h + 2*GLYPH_ATLAS_PADDING > GLYPH_ATLAS_HEIGHT)) {
+        SDL_FreeSurface(converted);
+        return NULL;
+    }
+    // 当前行放不下则换行，整张图集都放不下则清空重建
+    if (atlas->pen_x + converted->w + GLYPH_ATLAS_PADDING > GLYPH_ATLAS_WIDTH) {
+        atlas->pen_x = GLYPH_ATLAS_PADDING;
+        atlas->pen_y += atlas->row_height + GLYPH_ATLAS_PADDING;
+        atlas->row_height = 0;
+    }
+    if (atlas->pen_y + converted->h + GLYPH_ATLAS_PADDING > GLYPH_ATLAS_HEIGHT) {
+        if (*reset) {
+            SDL_FreeSurface(converted);
+            return NULL;
+        }
+        tk_debug("字形图集(font size %d)已满，清空重建\n", atlas->font_size);
+        reset_glyph_atlas(atlas);
+        atlas->reset_num++;
+        *reset = 1;
+    }
+    if (codepoint >= 128) {
+        glyph = malloc(sizeof(GlyphInfo));
+        if (!glyph) {
+            SDL_FreeSurface(converted);
+            return NULL;
+        }
+    } else {
+        glyph = &(atlas->ascii[codepoint]);
+    }
+    memset(glyph, 0, sizeof(*glyph));
+    glyph->codepoint = codepoint;
+    glyph->rect = (SDL_Rect){atlas->pen_x, atlas->pen_y, converted->w, converted->h};
+    glyph->advance = advance;
+    glyph->loaded = 1;
+    SDL_UpdateTexture(atlas->texture, &glyph->rect, converted->pixels, converted->pitch);
+    SDL_FreeSurface(converted);
+    if (codepoint >= 128) {
+        hashtbl_insert(atlas->glyph_hashtbl, (int)codepoint, glyph);
+    }
+
+    atlas->pen_x += glyph->rect.w + GLYPH_ATLAS_PADDING;
+    atlas->row_height = MAX(atlas->row_height, glyph->rect.h);
+    total_rasterized_glyph_num++;
+    return glyph;
+}
+
+// 基于字形图集绘制文本：整段文本拼成一批四边形，一次SDL_RenderGeometry()提交，返回绘制宽度
+int draw_atlas_text(SDL_Renderer* renderer, TTF_Font* font, const char* text, SDL_Color color, int x, int y) {
+#define ATLAS_TEXT_MAX_GLYPHS 128 // 单次绘制的最大字形数，超出部分被截断
+    static SDL_Vertex vertices[ATLAS_TEXT_MAX_GLYPHS * 4];
+    static int indices[ATLAS_TEXT_MAX_GLYPHS * 6];
+    GlyphInfo* glyphs[ATLAS_TEXT_MAX_GLYPHS];
+    GlyphAtlas* atlas = NULL;
+    GlyphInfo* glyph = NULL;
+    const char* p = text;
+    int glyph_num = 0;
+    int reset = 0, pass_reset = 0;
+    int pen_x = x;
+    int i = 0, retry = 0;
+    float u0, v0, u1, v1;
+
+    if (!renderer || !font || !text) return 0;
+    atlas = get_glyph_atlas(renderer, TTF_FontHeight(font));
+    if (!atlas) return 0;
+
+    // 先确保所有字形都已在图集中。如果中途图集被清空重建，之前拿到的字形位置已失效（非ASCII字形已被释放），
+    // 需要重新收集一遍；第二遍不会再清空图集（见load_glyph()），收集到的字形都有效
+    for (retry = 0; retry < 2; retry++) {
+        p = text;
+        glyph_num = 0;
+        pass_reset = reset;
+        while ((*p != '\0') && (glyph_num < ATLAS_TEXT_MAX_GLYPHS)) {
+            glyph = load_glyph(atlas, font, utf8_next_codepoint(&p), &reset);
+            if (glyph) {
+                glyphs[glyph_num++] = glyph;
+            }
+        }
+        if (reset == pass_reset) {
+            break;
+        }
+    }
+
+    for (i = 0; i < glyph_num; i++) {
+        glyph = glyphs[i];
+        u0 = (float)glyph->rect.x / GLYPH_ATLAS_WIDTH;
+        v0 = (float)glyph->rect.y / GLYPH_ATLAS_HEIGHT;
+        u1 = (float)(glyph->rect.x + glyph->rect.w) / GLYPH_ATLAS_WIDTH;
+        v1 = (float)(glyph->rect.y + glyph->rect.h) / GLYPH_ATLAS_HEIGHT;
+        vertices[i*4+0] = (SDL_Vertex){{pen_x, y}, color, {u0, v0}};
+        vertices[i*4+1] = (SDL_Vertex){{pen_x + glyph->rect.w, y}, color, {u1, v0}};
+        vertices[i*4+2] = (SDL_Vertex){{pen_x + glyph->rect.w, y + glyph->rect.h}, color, {u1, v1}};
+        vertices[i*4+3] = (SDL_Vertex){{pen_x, y + glyph->rect.h}, color, {u0, v1}};
+        indices[i*6+0] = i*4+0;
+        indices[i*6+1] = i*4+1;
+        indices[i*6+2] = i*4+2;
+        indices[i*6+3] = i*4+2;
+        indices[i*6+4] = i*4+3;
+        indices[i*6+5] = i*4+0;
+        pen_x += glyph->advance;
+    }
+    if (glyph_num > 0) {
+        SDL_RenderGeometry(renderer, atlas->texture, vertices, glyph_num * 4, indices, glyph_num * 6);
+    }
+    return pen_x - x;
+}
+
+void clear_glyph_atlas() {
+    for (int i = 0; i < MAX_GLYPH_ATLAS; i++) {
+        destroy_glyph_atlas(glyph_atlas[i]);
+        glyph_atlas[i] = NULL;
+    }
+}
+
 // 清理资源
 void cleanup(SDL_Window* window, SDL_Renderer* renderer) {
     // 释放缓存的纹理